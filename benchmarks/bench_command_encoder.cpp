@@ -0,0 +1,74 @@
+// Compares SAM-BA command encoding through std::stringstream (the previous
+// builder implementation) with the table-driven SambaCommand encoder.
+#include <Core/samba_protocol.h>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace SamFlash;
+
+namespace {
+    constexpr int ITERATIONS = 1000000;
+
+    std::vector<uint8_t> stringstream_command(char op, uint32_t address, uint32_t size) {
+        std::vector<uint8_t> cmd;
+        cmd.push_back(static_cast<uint8_t>(op));
+
+        std::stringstream ss;
+        ss << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << address;
+        for (char c : ss.str()) {
+            cmd.push_back(static_cast<uint8_t>(c));
+        }
+        cmd.push_back(',');
+
+        ss.str("");
+        ss << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << size;
+        for (char c : ss.str()) {
+            cmd.push_back(static_cast<uint8_t>(c));
+        }
+        cmd.push_back('#');
+        return cmd;
+    }
+
+    template<typename Encode>
+    double nanoseconds_per_command(Encode encode) {
+        uint64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; ++i) {
+            checksum += encode(0x00400000u + static_cast<uint32_t>(i) * 256u, 256u);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        // Keep the work observable so it isn't optimized away
+        if (checksum == 1) {
+            std::printf("%llu\n", static_cast<unsigned long long>(checksum));
+        }
+        return std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+    }
+}
+
+int main() {
+    // Both paths must produce the same bytes
+    auto reference = stringstream_command('S', 0x20004000, 0x1000);
+    SambaCommand encoded('S', 0x20004000, 0x1000);
+    if (reference != encoded.span().to_vector()) {
+        std::fprintf(stderr, "encoders disagree\n");
+        return 1;
+    }
+
+    double legacy = nanoseconds_per_command([](uint32_t address, uint32_t size) {
+        auto cmd = stringstream_command('S', address, size);
+        return static_cast<uint64_t>(cmd[cmd.size() - 2]);
+    });
+    double table = nanoseconds_per_command([](uint32_t address, uint32_t size) {
+        SambaCommand cmd('S', address, size);
+        return static_cast<uint64_t>(cmd.data()[cmd.size() - 2]);
+    });
+
+    std::printf("stringstream encoder: %8.1f ns/command\n", legacy);
+    std::printf("table encoder:        %8.1f ns/command\n", table);
+    std::printf("speedup:              %8.1fx\n", legacy / table);
+    return 0;
+}
@@ -0,0 +1,98 @@
+// End-to-end flashing throughput against the simulated SAM-BA target:
+// erase, write and verify an image through GenericStrategy and
+// USBSerialInterface exactly as the CLI does, for a few transfer settings.
+//
+// usage: bench_samba_throughput [image_kb] [baud] [page_program_us] [page_erase_us]
+#include <Core/generic_strategy.h>
+#include <Core/usb_serial_interface.h>
+#include <Simulator/samba_simulator.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace SamFlash;
+
+namespace {
+    struct Scenario {
+        const char* name;
+        uint32_t pipeline_depth;
+        bool adaptive;
+    };
+
+    double seconds_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t image_kb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    SambaTimingModel timing;
+    timing.baud_rate = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 921600;
+    timing.page_program_time = std::chrono::microseconds(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1500);
+    timing.page_erase_time = std::chrono::microseconds(argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 500);
+
+    std::vector<uint8_t> image(image_kb * 1024);
+    for (size_t i = 0; i < image.size(); ++i) {
+        image[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+    }
+
+    std::printf("image %zu KB, %u baud, %lld us/page program, %lld us/page erase\n", image_kb, timing.baud_rate,
+                static_cast<long long>(timing.page_program_time.count()),
+                static_cast<long long>(timing.page_erase_time.count()));
+    std::printf("%-22s %9s %9s %9s %11s\n", "scenario", "erase s", "write s", "verify s", "write KB/s");
+
+    const Scenario scenarios[] = {
+        {"depth 1", 1, false},
+        {"depth 4", 4, false},
+        {"adaptive", 4, true},
+    };
+    for (const auto& scenario : scenarios) {
+        SambaSimulator simulator(SambaDeviceModel{}, timing);
+        if (!simulator.start()) {
+            std::fprintf(stderr, "simulator: %s\n", simulator.get_last_error().c_str());
+            return 1;
+        }
+
+        auto device = std::make_shared<USBSerialInterface>();
+        if (!device->connect(simulator.port_path())) {
+            std::fprintf(stderr, "connect: %s\n", device->get_last_error().c_str());
+            return 1;
+        }
+
+        FlashConfig config;
+        config.pipeline_depth = scenario.pipeline_depth;
+        config.adaptive_transfer = scenario.adaptive;
+        config.erase_before_write = false;
+        config.skip_blank_pages = false;
+        GenericStrategy strategy;
+        strategy.initialize(device, config);
+
+        auto start = std::chrono::steady_clock::now();
+        if (!device->erase_region(0, static_cast<uint32_t>(image.size()))) {
+            std::fprintf(stderr, "erase: %s\n", device->get_last_error().c_str());
+            return 1;
+        }
+        double erase_time = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        if (!strategy.write_firmware(image)) {
+            std::fprintf(stderr, "write: %s\n", strategy.get_last_error().c_str());
+            return 1;
+        }
+        double write_time = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        if (!strategy.verify_firmware(image)) {
+            std::fprintf(stderr, "verify: %s\n", strategy.get_last_error().c_str());
+            return 1;
+        }
+        double verify_time = seconds_since(start);
+
+        std::printf("%-22s %9.3f %9.3f %9.3f %11.1f\n", scenario.name, erase_time, write_time, verify_time,
+                    image.size() / 1024.0 / write_time);
+        device->disconnect();
+    }
+    return 0;
+}
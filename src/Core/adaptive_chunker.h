@@ -0,0 +1,195 @@
+#ifndef ADAPTIVE_CHUNKER_H
+#define ADAPTIVE_CHUNKER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace SamFlash {
+
+// Picks transfer chunk size and pipeline depth from what the link actually
+// delivers. Throughput is measured over a few chunks at a time; the
+// controller then hill-climbs one setting at a time (grow chunk, grow
+// depth, shrink chunk, shrink depth), keeping a change only if it helps.
+// Once no step helps it holds the best setting and re-probes periodically
+// in case the link changes. A timeout immediately backs off.
+class AdaptiveChunker {
+public:
+    struct Limits {
+        uint32_t min_chunk = 256;
+        uint32_t max_chunk = 64 * 1024;
+        uint32_t granularity = 1; // chunks stay a multiple of this
+        uint32_t min_depth = 1;
+        uint32_t max_depth = 1;
+    };
+
+    explicit AdaptiveChunker(const Limits& limits, uint32_t initial_chunk = 0, uint32_t initial_depth = 0)
+        : limits_(normalize(limits)) {
+        chunk_size_ = clamp_chunk(initial_chunk == 0 ? limits_.min_chunk : initial_chunk);
+        pipeline_depth_ = clamp_depth(initial_depth == 0 ? limits_.min_depth : initial_depth);
+        best_chunk_ = chunk_size_;
+        best_depth_ = pipeline_depth_;
+    }
+
+    uint32_t chunk_size() const { return chunk_size_; }
+    uint32_t pipeline_depth() const { return pipeline_depth_; }
+    double throughput_bps() const { return throughput_bps_; }
+    std::chrono::microseconds round_trip_time() const { return std::chrono::microseconds(static_cast<int64_t>(rtt_us_)); }
+    bool converged() const { return converged_; }
+
+    // One chunk completed. interval is the time since the previous
+    // completion (what the link sustains); rtt is send-to-acknowledge.
+    void record(size_t bytes, std::chrono::steady_clock::duration interval,
+                std::chrono::steady_clock::duration rtt = std::chrono::steady_clock::duration::zero()) {
+        double rtt_us = std::chrono::duration<double, std::micro>(rtt).count();
+        if (rtt_us > 0.0) {
+            rtt_us_ = (rtt_us_ == 0.0) ? rtt_us : rtt_us_ + RTT_WEIGHT * (rtt_us - rtt_us_);
+        }
+
+        window_bytes_ += bytes;
+        window_seconds_ += std::chrono::duration<double>(interval).count();
+        if (++window_samples_ < SAMPLES_PER_STEP) {
+            return;
+        }
+
+        double measured = window_seconds_ > 0.0 ? window_bytes_ / window_seconds_ : 0.0;
+        window_bytes_ = 0;
+        window_seconds_ = 0.0;
+        window_samples_ = 0;
+        throughput_bps_ = measured;
+
+        if (converged_) {
+            // Track drift on the held setting, and re-probe now and then
+            best_throughput_ = measured;
+            if (++windows_since_probe_ >= REPROBE_WINDOWS) {
+                converged_ = false;
+                failed_moves_ = 0;
+                move_ = Move::SHRINK_DEPTH;
+                try_next_move();
+            }
+            return;
+        }
+
+        if (best_throughput_ == 0.0) {
+            // First window on this setting is the baseline to beat
+            best_throughput_ = measured;
+            best_chunk_ = chunk_size_;
+            best_depth_ = pipeline_depth_;
+            try_next_move();
+            return;
+        }
+
+        if (measured > best_throughput_ * (1.0 + MIN_IMPROVEMENT)) {
+            // Keep going the same way
+            best_throughput_ = measured;
+            best_chunk_ = chunk_size_;
+            best_depth_ = pipeline_depth_;
+            failed_moves_ = 0;
+            if (!apply_move(move_)) {
+                try_next_move();
+            }
+            return;
+        }
+
+        // No gain: return to the best setting and try another direction
+        chunk_size_ = best_chunk_;
+        pipeline_depth_ = best_depth_;
+        ++failed_moves_;
+        try_next_move();
+    }
+
+    // A chunk timed out or had to be retried: the setting is too aggressive
+    void record_timeout() {
+        chunk_size_ = clamp_chunk(chunk_size_ / 2);
+        pipeline_depth_ = clamp_depth(pipeline_depth_ - (pipeline_depth_ > 1 ? 1 : 0));
+        best_chunk_ = chunk_size_;
+        best_depth_ = pipeline_depth_;
+        best_throughput_ = 0.0;
+        window_bytes_ = 0;
+        window_seconds_ = 0.0;
+        window_samples_ = 0;
+        failed_moves_ = 0;
+        converged_ = false;
+        move_ = Move::SHRINK_DEPTH;
+    }
+
+private:
+    enum class Move { GROW_CHUNK, GROW_DEPTH, SHRINK_CHUNK, SHRINK_DEPTH };
+    static constexpr int MOVE_COUNT = 4;
+    static constexpr uint32_t SAMPLES_PER_STEP = 4;
+    static constexpr uint32_t REPROBE_WINDOWS = 32;
+    static constexpr double MIN_IMPROVEMENT = 0.05;
+    static constexpr double RTT_WEIGHT = 0.125;
+
+    static Limits normalize(Limits limits) {
+        limits.granularity = std::max<uint32_t>(1, limits.granularity);
+        limits.min_chunk = std::max(limits.granularity, limits.min_chunk / limits.granularity * limits.granularity);
+        limits.max_chunk = std::max(limits.min_chunk, limits.max_chunk / limits.granularity * limits.granularity);
+        limits.min_depth = std::max<uint32_t>(1, limits.min_depth);
+        limits.max_depth = std::max(limits.min_depth, limits.max_depth);
+        return limits;
+    }
+
+    uint32_t clamp_chunk(uint64_t chunk) const {
+        chunk = chunk / limits_.granularity * limits_.granularity;
+        return static_cast<uint32_t>(std::min<uint64_t>(limits_.max_chunk, std::max<uint64_t>(limits_.min_chunk, chunk)));
+    }
+
+    uint32_t clamp_depth(uint32_t depth) const {
+        return std::min(limits_.max_depth, std::max(limits_.min_depth, depth));
+    }
+
+    // Returns false when the move can't change anything (already at a limit)
+    bool apply_move(Move move) {
+        uint32_t chunk = chunk_size_;
+        uint32_t depth = pipeline_depth_;
+        switch (move) {
+            case Move::GROW_CHUNK:   chunk = clamp_chunk(uint64_t(chunk_size_) * 2); break;
+            case Move::SHRINK_CHUNK: chunk = clamp_chunk(chunk_size_ / 2); break;
+            case Move::GROW_DEPTH:   depth = clamp_depth(pipeline_depth_ + 1); break;
+            case Move::SHRINK_DEPTH: depth = clamp_depth(pipeline_depth_ - 1); break;
+        }
+        if (chunk == chunk_size_ && depth == pipeline_depth_) {
+            return false;
+        }
+        chunk_size_ = chunk;
+        pipeline_depth_ = depth;
+        move_ = move;
+        return true;
+    }
+
+    void try_next_move() {
+        while (failed_moves_ < MOVE_COUNT) {
+            Move next = static_cast<Move>((static_cast<int>(move_) + 1) % MOVE_COUNT);
+            move_ = next;
+            if (apply_move(next)) {
+                return;
+            }
+            ++failed_moves_;
+        }
+        converged_ = true;
+        windows_since_probe_ = 0;
+    }
+
+    Limits limits_;
+    uint32_t chunk_size_ = 0;
+    uint32_t pipeline_depth_ = 1;
+
+    uint32_t best_chunk_ = 0;
+    uint32_t best_depth_ = 1;
+    double best_throughput_ = 0.0;
+    Move move_ = Move::SHRINK_DEPTH; // the move after it is GROW_CHUNK
+    int failed_moves_ = 0;
+    bool converged_ = false;
+    uint32_t windows_since_probe_ = 0;
+
+    double throughput_bps_ = 0.0;
+    double rtt_us_ = 0.0;
+    size_t window_bytes_ = 0;
+    double window_seconds_ = 0.0;
+    uint32_t window_samples_ = 0;
+};
+
+} // namespace SamFlash
+
+#endif // ADAPTIVE_CHUNKER_H
@@ -0,0 +1,132 @@
+#include "blank_detect.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SAMFLASH_BLANK_DETECT_X86
+#include <immintrin.h>
+#elif defined(_M_X64)
+#define SAMFLASH_BLANK_DETECT_SSE2_ONLY
+#include <emmintrin.h>
+#endif
+
+namespace SamFlash {
+
+namespace {
+    constexpr uint64_t ERASED_WORD = ~uint64_t(0);
+
+    bool is_erased_scalar(const uint8_t* data, size_t size) {
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            if (word != ERASED_WORD) {
+                return false;
+            }
+        }
+        for (; i < size; ++i) {
+            if (data[i] != ERASED_BYTE) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+#if defined(SAMFLASH_BLANK_DETECT_X86) || defined(SAMFLASH_BLANK_DETECT_SSE2_ONLY)
+#if defined(SAMFLASH_BLANK_DETECT_X86)
+    __attribute__((target("sse2")))
+#endif
+    bool is_erased_sse2(const uint8_t* data, size_t size) {
+        const __m128i erased = _mm_set1_epi8(static_cast<char>(ERASED_BYTE));
+        size_t i = 0;
+        // Four vectors per iteration; AND them so only one compare is needed
+        for (; i + 64 <= size; i += 64) {
+            __m128i v = _mm_and_si128(
+                _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)),
+                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16))),
+                _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 32)),
+                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 48))));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, erased)) != 0xFFFF) {
+                return false;
+            }
+        }
+        for (; i + 16 <= size; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, erased)) != 0xFFFF) {
+                return false;
+            }
+        }
+        return is_erased_scalar(data + i, size - i);
+    }
+#endif
+
+#if defined(SAMFLASH_BLANK_DETECT_X86)
+    __attribute__((target("avx2")))
+    bool is_erased_avx2(const uint8_t* data, size_t size) {
+        const __m256i erased = _mm256_set1_epi8(static_cast<char>(ERASED_BYTE));
+        size_t i = 0;
+        for (; i + 128 <= size; i += 128) {
+            __m256i v = _mm256_and_si256(
+                _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)),
+                                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32))),
+                _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 64)),
+                                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 96))));
+            // testc is set when v has every bit of erased set
+            if (!_mm256_testc_si256(v, erased)) {
+                return false;
+            }
+        }
+        for (; i + 32 <= size; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            if (!_mm256_testc_si256(v, erased)) {
+                return false;
+            }
+        }
+        return is_erased_scalar(data + i, size - i);
+    }
+#endif
+
+    using IsErasedFn = bool (*)(const uint8_t*, size_t);
+
+    IsErasedFn select_is_erased() {
+#if defined(SAMFLASH_BLANK_DETECT_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return is_erased_avx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return is_erased_sse2;
+        }
+#elif defined(SAMFLASH_BLANK_DETECT_SSE2_ONLY)
+        return is_erased_sse2;
+#endif
+        return is_erased_scalar;
+    }
+}
+
+bool is_erased(ByteSpan data) {
+    // Resolved once; the CPU doesn't change under us
+    static const IsErasedFn impl = select_is_erased();
+    return impl(data.data(), data.size());
+}
+
+std::vector<ImageExtent> find_programmed_extents(ByteSpan image, uint32_t page_size) {
+    std::vector<ImageExtent> extents;
+    if (page_size == 0) {
+        page_size = 256;
+    }
+
+    for (size_t offset = 0; offset < image.size(); offset += page_size) {
+        ByteSpan page = image.subspan(offset, page_size);
+        if (is_erased(page)) {
+            continue;
+        }
+        if (!extents.empty() && extents.back().offset + extents.back().size == offset) {
+            extents.back().size += page.size();
+        } else {
+            extents.push_back({offset, page.size()});
+        }
+    }
+    return extents;
+}
+
+} // namespace SamFlash
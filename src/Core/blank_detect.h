@@ -0,0 +1,31 @@
+#ifndef BLANK_DETECT_H
+#define BLANK_DETECT_H
+
+#include "byte_span.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SamFlash {
+
+// Value every byte of flash holds after an erase
+constexpr uint8_t ERASED_BYTE = 0xFF;
+
+// True when every byte is ERASED_BYTE. Uses AVX2 or SSE2 when the CPU has
+// them and falls back to a word-at-a-time scalar loop otherwise.
+bool is_erased(ByteSpan data);
+
+// Contiguous run of pages that hold data, relative to the image start
+struct ImageExtent {
+    size_t offset;
+    size_t size;
+};
+
+// Split an image into the page-aligned runs that still need programming
+// once the device is erased. Adjacent non-blank pages are merged so each
+// run can be streamed as one transfer; the last run may end mid-page.
+std::vector<ImageExtent> find_programmed_extents(ByteSpan image, uint32_t page_size);
+
+} // namespace SamFlash
+
+#endif // BLANK_DETECT_H
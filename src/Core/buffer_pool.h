@@ -0,0 +1,124 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "byte_span.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace SamFlash {
+
+// Fixed set of equally sized buffers passed from a producer thread to a
+// consumer thread and back. Filled buffers come out in the order they went
+// in. The producer blocks once every buffer is filled and waiting, which
+// bounds both how far it runs ahead and how much memory is held.
+class BufferPool {
+public:
+    struct Buffer {
+        std::vector<uint8_t> data; // sized to the pool's buffer size
+        size_t size = 0;           // bytes filled
+        size_t tag = 0;            // producer-defined, e.g. which file
+        uint64_t offset = 0;       // producer-defined, e.g. where in it
+
+        ByteSpan filled() const { return ByteSpan(data.data(), size); }
+    };
+
+    BufferPool(size_t count, size_t buffer_size) : buffers_(count) {
+        for (auto& buffer : buffers_) {
+            buffer.data.resize(buffer_size);
+            free_.push_back(&buffer);
+        }
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Producer: an empty buffer to fill; nullptr once cancelled
+    Buffer* acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto start = std::chrono::steady_clock::now();
+        free_cv_.wait(lock, [this] { return cancelled_ || !free_.empty(); });
+        producer_stalled_ += std::chrono::steady_clock::now() - start;
+        if (cancelled_) {
+            return nullptr;
+        }
+        Buffer* buffer = free_.front();
+        free_.pop_front();
+        return buffer;
+    }
+
+    // Producer: pass a filled buffer on
+    void submit(Buffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        filled_.push_back(buffer);
+        filled_cv_.notify_one();
+    }
+
+    // Producer: nothing more will be submitted
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        filled_cv_.notify_all();
+    }
+
+    // Consumer: the next filled buffer; nullptr once finished and drained,
+    // or cancelled
+    Buffer* next() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto start = std::chrono::steady_clock::now();
+        filled_cv_.wait(lock, [this] { return cancelled_ || finished_ || !filled_.empty(); });
+        consumer_stalled_ += std::chrono::steady_clock::now() - start;
+        if (cancelled_ || filled_.empty()) {
+            return nullptr;
+        }
+        Buffer* buffer = filled_.front();
+        filled_.pop_front();
+        return buffer;
+    }
+
+    // Either side: hand a buffer back for reuse
+    void release(Buffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer->size = 0;
+        free_.push_back(buffer);
+        free_cv_.notify_one();
+    }
+
+    // Either side: stop the pipeline; blocked and later calls return nullptr
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+        free_cv_.notify_all();
+        filled_cv_.notify_all();
+    }
+
+    // Time each side spent blocked on the other
+    double producer_stalled_seconds() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::chrono::duration<double>(producer_stalled_).count();
+    }
+    double consumer_stalled_seconds() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::chrono::duration<double>(consumer_stalled_).count();
+    }
+
+private:
+    std::vector<Buffer> buffers_;
+    std::deque<Buffer*> free_;
+    std::deque<Buffer*> filled_;
+    mutable std::mutex mutex_;
+    std::condition_variable free_cv_;
+    std::condition_variable filled_cv_;
+    bool finished_ = false;
+    bool cancelled_ = false;
+    std::chrono::steady_clock::duration producer_stalled_{};
+    std::chrono::steady_clock::duration consumer_stalled_{};
+};
+
+} // namespace SamFlash
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,23 @@
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <cstdint>
+
+namespace SamFlash {
+
+// Little-endian fields, as found in Odin packets, PITs, sparse images and
+// LZ4 frames; independent of the host's byte order
+constexpr uint32_t read_le32(const uint8_t* in) {
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+
+constexpr void write_le32(uint32_t value, uint8_t* out) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+} // namespace SamFlash
+
+#endif // BYTE_ORDER_H
@@ -0,0 +1,59 @@
+#ifndef BYTE_SPAN_H
+#define BYTE_SPAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SamFlash {
+
+// Non-owning view over contiguous bytes (C++17 stand-in for std::span).
+// Used on the flashing hot path so page data can flow from the loaded
+// image to the port without intermediate copies.
+template<typename T>
+class BasicByteSpan {
+public:
+    constexpr BasicByteSpan() noexcept : data_(nullptr), size_(0) {}
+    constexpr BasicByteSpan(T* data, size_t size) noexcept : data_(data), size_(size) {}
+
+    template<typename U>
+    BasicByteSpan(std::vector<U>& vec) noexcept : data_(vec.data()), size_(vec.size()) {}
+    template<typename U>
+    BasicByteSpan(const std::vector<U>& vec) noexcept : data_(vec.data()), size_(vec.size()) {}
+
+    // Allow mutable -> const conversion
+    template<typename U>
+    constexpr BasicByteSpan(const BasicByteSpan<U>& other) noexcept : data_(other.data()), size_(other.size()) {}
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+
+    constexpr T* begin() const noexcept { return data_; }
+    constexpr T* end() const noexcept { return data_ + size_; }
+    constexpr T& operator[](size_t index) const noexcept { return data_[index]; }
+
+    // Clamped sub-view; out of range offsets produce an empty span
+    constexpr BasicByteSpan subspan(size_t offset, size_t count = static_cast<size_t>(-1)) const noexcept {
+        if (offset >= size_) {
+            return BasicByteSpan(data_ + size_, 0);
+        }
+        size_t remaining = size_ - offset;
+        return BasicByteSpan(data_ + offset, count < remaining ? count : remaining);
+    }
+
+    std::vector<uint8_t> to_vector() const {
+        return std::vector<uint8_t>(data_, data_ + size_);
+    }
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+using ByteSpan = BasicByteSpan<const uint8_t>;
+using MutableByteSpan = BasicByteSpan<uint8_t>;
+
+} // namespace SamFlash
+
+#endif // BYTE_SPAN_H
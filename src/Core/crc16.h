@@ -0,0 +1,54 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include "byte_span.h"
+#include <array>
+#include <cstdint>
+
+namespace SamFlash {
+
+namespace detail {
+    // MSB-first CRC-16/CCITT (polynomial 0x1021)
+    constexpr std::array<uint16_t, 256> make_crc16_table() {
+        std::array<uint16_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint16_t crc = static_cast<uint16_t>(i << 8);
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    inline constexpr std::array<uint16_t, 256> CRC16_TABLE = make_crc16_table();
+}
+
+// Incremental CRC-16/CCITT with a zero seed (the XMODEM variant), which is
+// what the SAM-BA monitor's checksum command returns.
+class Crc16 {
+public:
+    void update(ByteSpan data) {
+        uint16_t crc = state_;
+        for (uint8_t byte : data) {
+            crc = static_cast<uint16_t>(detail::CRC16_TABLE[((crc >> 8) ^ byte) & 0xFF] ^ (crc << 8));
+        }
+        state_ = crc;
+    }
+
+    uint16_t value() const { return state_; }
+    void reset() { state_ = 0; }
+
+    static uint16_t compute(ByteSpan data) {
+        Crc16 crc;
+        crc.update(data);
+        return crc.value();
+    }
+
+private:
+    uint16_t state_ = 0;
+};
+
+} // namespace SamFlash
+
+#endif // CRC16_H
@@ -0,0 +1,53 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include "byte_span.h"
+#include <array>
+#include <cstdint>
+
+namespace SamFlash {
+
+namespace detail {
+    // Reflected CRC-32 (IEEE 802.3, polynomial 0xEDB88320)
+    constexpr std::array<uint32_t, 256> make_crc32_table() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    inline constexpr std::array<uint32_t, 256> CRC32_TABLE = make_crc32_table();
+}
+
+// Incremental CRC-32, matching zlib's crc32().
+class Crc32 {
+public:
+    void update(ByteSpan data) {
+        uint32_t crc = state_;
+        for (uint8_t byte : data) {
+            crc = detail::CRC32_TABLE[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+        }
+        state_ = crc;
+    }
+
+    uint32_t value() const { return state_ ^ 0xFFFFFFFFu; }
+    void reset() { state_ = 0xFFFFFFFFu; }
+
+    static uint32_t compute(ByteSpan data) {
+        Crc32 crc;
+        crc.update(data);
+        return crc.value();
+    }
+
+private:
+    uint32_t state_ = 0xFFFFFFFFu;
+};
+
+} // namespace SamFlash
+
+#endif // CRC32_H
@@ -1,10 +1,12 @@
 #ifndef DEVICE_INTERFACE_H
 #define DEVICE_INTERFACE_H
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 #include <functional>
+#include "byte_span.h"
 
 namespace SamFlash {
 
@@ -35,14 +37,26 @@ struct DeviceInfo {
     uint32_t flash_size;
     uint32_t page_size;
     bool is_connected;
+    uint32_t erase_block_size = 0; // smallest erasable unit; 0 if only pages are known
+    uint32_t lock_region_size = 0;
+    uint32_t lock_region_count = 0;
+    uint32_t ram_buffer_address = 0; // device SRAM the host may stage writes in
+    uint32_t ram_buffer_size = 0;
+    std::vector<uint32_t> erase_granularities{}; // aligned erase sizes, ascending
+    std::string serial_number{}; // identifies this unit (chip ID or USB serial); empty if unknown
+    uint16_t vendor_id = 0; // USB vendor ID of the port; 0 if not a USB device
 };
 
 struct FlashProgress {
-    uint32_t bytes_written;
-    uint32_t total_bytes;
+    uint64_t bytes_written;
+    uint64_t total_bytes;
     double percentage;
     std::string current_operation;
     FlashStatus status;
+    // What the transfer settled on; zero when not applicable
+    uint32_t transfer_chunk_size = 0;
+    uint32_t pipeline_depth = 0;
+    double throughput_bps = 0.0;
 };
 
 class IDeviceInterface {
@@ -62,10 +76,102 @@ public:
     // Flash operations
     virtual bool erase_chip() = 0;
     virtual bool erase_page(uint32_t address) = 0;
+    // Erase an aligned region; devices with native sector or block erase
+    // should override this. The default erases it page by page.
+    virtual bool erase_region(uint32_t address, uint32_t size) {
+        uint32_t page_size = get_device_info().page_size;
+        if (page_size == 0) {
+            page_size = 256;
+        }
+        for (uint64_t offset = 0; offset < size; offset += page_size) {
+            if (!erase_page(address + static_cast<uint32_t>(offset))) {
+                return false;
+            }
+        }
+        return true;
+    }
     virtual bool write_page(uint32_t address, const std::vector<uint8_t>& data) = 0;
     virtual std::vector<uint8_t> read_page(uint32_t address, uint32_t size) = 0;
     virtual bool verify_flash(const std::vector<uint8_t>& expected_data, uint32_t start_address = 0) = 0;
     
+    // Zero-copy variants; the defaults bridge to the vector API above.
+    // Implementations on the hot path should override these directly.
+    virtual bool write_page(uint32_t address, ByteSpan data) {
+        return write_page(address, data.to_vector());
+    }
+    virtual bool read_page(uint32_t address, MutableByteSpan buffer) {
+        auto data = read_page(address, static_cast<uint32_t>(buffer.size()));
+        if (data.size() != buffer.size()) {
+            return false;
+        }
+        std::copy(data.begin(), data.end(), buffer.begin());
+        return true;
+    }
+    virtual bool verify_flash(ByteSpan expected_data, uint32_t start_address = 0) {
+        return verify_flash(expected_data.to_vector(), start_address);
+    }
+    
+    // Bulk transfer tuning, applied by the flashing strategy before writing.
+    // block_size is the number of bytes moved per device command (0 lets the
+    // device pick); pipeline_depth is how many blocks may be in flight. With
+    // adaptive set these are starting points and upper bounds, and the
+    // device tunes them to the measured link.
+    struct TransferOptions {
+        uint32_t pipeline_depth = 1;
+        uint32_t block_size = 0;
+        bool adaptive = false;
+    };
+    virtual void set_transfer_options(const TransferOptions& options) {
+        (void)options;
+    }
+    
+    // Transfer settings currently in use, for progress reporting
+    struct TransferStats {
+        uint32_t chunk_size = 0;
+        uint32_t pipeline_depth = 0;
+        double throughput_bps = 0.0;
+    };
+    virtual TransferStats get_transfer_stats() const {
+        return TransferStats{};
+    }
+    
+    // Multi-page write. Devices that can overlap transfer and programming
+    // honour the transfer options; the default writes one page at a time.
+    // on_progress receives the number of bytes confirmed.
+    using WriteProgressFn = std::function<void(size_t bytes_completed)>;
+    virtual bool write_pages(uint32_t address, ByteSpan data, const WriteProgressFn& on_progress = nullptr) {
+        uint32_t page_size = get_device_info().page_size;
+        if (page_size == 0) {
+            page_size = 256;
+        }
+        for (size_t offset = 0; offset < data.size(); offset += page_size) {
+            ByteSpan page = data.subspan(offset, page_size);
+            if (!write_page(address + static_cast<uint32_t>(offset), page)) {
+                return false;
+            }
+            if (on_progress) {
+                on_progress(offset + page.size());
+            }
+        }
+        return true;
+    }
+    
+    // Checksum of a flash region computed on the device, so only the digest
+    // crosses the link. Devices without a checksum command return false
+    // and callers fall back to reading the data back.
+    virtual bool compute_flash_checksum(uint32_t address, uint32_t size, uint32_t& checksum) {
+        (void)address;
+        (void)size;
+        (void)checksum;
+        return false;
+    }
+    
+    // The same digest computed on the host, to compare against
+    virtual uint32_t checksum_of(ByteSpan data) const {
+        (void)data;
+        return 0;
+    }
+    
     // Progress and status
     virtual void set_progress_callback(std::function<void(const FlashProgress&)> callback) = 0;
     virtual FlashStatus get_status() const = 0;
@@ -0,0 +1,107 @@
+#include "erase_planner.h"
+#include <algorithm>
+
+namespace SamFlash {
+
+namespace {
+    bool is_power_of_two(uint32_t value) {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+}
+
+EraseGeometry EraseGeometry::from_device_info(const DeviceInfo& info) {
+    EraseGeometry geometry;
+    geometry.flash_size = info.flash_size;
+    std::vector<uint32_t> sizes = info.erase_granularities;
+    if (sizes.empty()) {
+        sizes = {info.page_size, info.erase_block_size};
+    }
+    for (uint32_t size : sizes) {
+        if (is_power_of_two(size)) {
+            geometry.granularities.push_back(size);
+        }
+    }
+    std::sort(geometry.granularities.begin(), geometry.granularities.end());
+    geometry.granularities.erase(std::unique(geometry.granularities.begin(), geometry.granularities.end()),
+                                 geometry.granularities.end());
+    return geometry;
+}
+
+std::vector<EraseOperation> plan_erase(std::vector<FlashRange> ranges, const EraseGeometry& geometry) {
+    std::vector<EraseOperation> plan;
+
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(), [](const FlashRange& range) { return range.size == 0; }),
+                 ranges.end());
+    if (ranges.empty()) {
+        return plan;
+    }
+
+    // Without any known granularity the only safe erase is the whole chip
+    if (geometry.granularities.empty()) {
+        plan.push_back({EraseOperation::Kind::CHIP, 0, geometry.flash_size});
+        return plan;
+    }
+
+    // Widen to the smallest unit, then merge overlapping or touching ranges
+    const uint64_t unit = geometry.granularities.front();
+    struct Span {
+        uint64_t start;
+        uint64_t end;
+    };
+    std::vector<Span> spans;
+    spans.reserve(ranges.size());
+    for (const auto& range : ranges) {
+        uint64_t start = range.address / unit * unit;
+        uint64_t end = (uint64_t(range.address) + range.size + unit - 1) / unit * unit;
+        spans.push_back({start, end});
+    }
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.start < b.start; });
+
+    std::vector<Span> merged;
+    for (const auto& span : spans) {
+        if (!merged.empty() && span.start <= merged.back().end) {
+            merged.back().end = std::max(merged.back().end, span.end);
+        } else {
+            merged.push_back(span);
+        }
+    }
+
+    if (geometry.flash_size != 0 && merged.size() == 1 &&
+        merged[0].start == 0 && merged[0].end >= geometry.flash_size) {
+        plan.push_back({EraseOperation::Kind::CHIP, 0, geometry.flash_size});
+        return plan;
+    }
+
+    // Cover each range with the largest aligned unit that fits at each step
+    for (const auto& span : merged) {
+        uint64_t address = span.start;
+        while (address < span.end) {
+            uint64_t size = unit;
+            for (auto it = geometry.granularities.rbegin(); it != geometry.granularities.rend(); ++it) {
+                if (address % *it == 0 && address + *it <= span.end) {
+                    size = *it;
+                    break;
+                }
+            }
+            plan.push_back({EraseOperation::Kind::REGION, static_cast<uint32_t>(address), static_cast<uint32_t>(size)});
+            address += size;
+        }
+    }
+    return plan;
+}
+
+bool execute_erase_plan(IDeviceInterface& device, const std::vector<EraseOperation>& plan, std::string& error) {
+    for (const auto& operation : plan) {
+        bool ok = operation.kind == EraseOperation::Kind::CHIP
+                      ? device.erase_chip()
+                      : device.erase_region(operation.address, operation.size);
+        if (!ok) {
+            error = "Erase error at address: " + std::to_string(operation.address) +
+                    " (" + device.get_last_error() + ")";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace SamFlash
@@ -0,0 +1,47 @@
+#ifndef ERASE_PLANNER_H
+#define ERASE_PLANNER_H
+
+#include "device_interface.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SamFlash {
+
+// Byte range of device flash
+struct FlashRange {
+    uint32_t address;
+    uint32_t size;
+};
+
+struct EraseOperation {
+    enum class Kind {
+        REGION, // one aligned unit of the given size
+        CHIP    // the whole device
+    };
+    Kind kind;
+    uint32_t address;
+    uint32_t size;
+};
+
+// What the device can erase. Granularities are the aligned unit sizes it
+// accepts (page, sector, block, ...), each a power of two.
+struct EraseGeometry {
+    uint32_t flash_size = 0;
+    std::vector<uint32_t> granularities;
+
+    static EraseGeometry from_device_info(const DeviceInfo& info);
+};
+
+// Turn the ranges an image touches into the shortest list of erase
+// commands: ranges are widened to the smallest granularity, merged, and
+// each merged range is covered greedily with the largest aligned unit
+// that fits. A plan that would cover the whole device is a chip erase.
+std::vector<EraseOperation> plan_erase(std::vector<FlashRange> ranges, const EraseGeometry& geometry);
+
+// Run a plan against a device. On failure error describes the operation.
+bool execute_erase_plan(IDeviceInterface& device, const std::vector<EraseOperation>& plan, std::string& error);
+
+} // namespace SamFlash
+
+#endif // ERASE_PLANNER_H
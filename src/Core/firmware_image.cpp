@@ -0,0 +1,104 @@
+#include "firmware_image.h"
+#include <fstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SamFlash {
+
+namespace {
+    // Read size for images that can't be mapped
+    constexpr size_t BUFFERED_READ_SIZE = 1024 * 1024;
+}
+
+FirmwareImage::~FirmwareImage() {
+    close();
+}
+
+FirmwareImage::FirmwareImage(FirmwareImage&& other) noexcept {
+    *this = std::move(other);
+}
+
+FirmwareImage& FirmwareImage::operator=(FirmwareImage&& other) noexcept {
+    if (this != &other) {
+        close();
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        mapped_size_ = std::exchange(other.mapped_size_, 0);
+        buffer_ = std::move(other.buffer_);
+        last_error_ = std::move(other.last_error_);
+    }
+    return *this;
+}
+
+bool FirmwareImage::open(const std::string& path) {
+    close();
+    last_error_.clear();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        last_error_ = "Failed to open firmware file: " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            // Flashing reads front to back once: read ahead aggressively
+            // and let pages behind the write position go first
+            madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+            mapping_ = mapping;
+            mapped_size_ = static_cast<size_t>(info.st_size);
+        }
+    }
+    ::close(fd);
+    if (mapping_) {
+        return true;
+    }
+#endif
+    return read_buffered(path);
+}
+
+void FirmwareImage::close() {
+#ifndef _WIN32
+    if (mapping_) {
+        munmap(mapping_, mapped_size_);
+    }
+#endif
+    mapping_ = nullptr;
+    mapped_size_ = 0;
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+}
+
+ByteSpan FirmwareImage::data() const {
+    if (mapping_) {
+        return ByteSpan(static_cast<const uint8_t*>(mapping_), mapped_size_);
+    }
+    return ByteSpan(buffer_);
+}
+
+bool FirmwareImage::read_buffered(const std::string& path) {
+    // Pipes have no size up front, so read until the end
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        last_error_ = "Failed to open firmware file: " + path;
+        return false;
+    }
+    std::vector<char> chunk(BUFFERED_READ_SIZE);
+    while (file.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || file.gcount() > 0) {
+        buffer_.insert(buffer_.end(), chunk.begin(), chunk.begin() + file.gcount());
+    }
+    if (file.bad()) {
+        last_error_ = "Failed to read firmware file: " + path;
+        buffer_.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace SamFlash
@@ -0,0 +1,47 @@
+#ifndef FIRMWARE_IMAGE_H
+#define FIRMWARE_IMAGE_H
+
+#include "byte_span.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SamFlash {
+
+// Read-only firmware image. A regular file is memory-mapped and read
+// sequentially, so loading costs next to nothing and clean pages can be
+// dropped under memory pressure instead of holding a second copy of a
+// multi-GB image. Pipes and other files that can't be mapped are read
+// into memory instead.
+class FirmwareImage {
+public:
+    FirmwareImage() = default;
+    ~FirmwareImage();
+
+    FirmwareImage(const FirmwareImage&) = delete;
+    FirmwareImage& operator=(const FirmwareImage&) = delete;
+    FirmwareImage(FirmwareImage&& other) noexcept;
+    FirmwareImage& operator=(FirmwareImage&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    ByteSpan data() const;
+    size_t size() const { return data().size(); }
+    bool empty() const { return size() == 0; }
+    bool is_mapped() const { return mapping_ != nullptr; }
+
+    std::string get_last_error() const { return last_error_; }
+
+private:
+    bool read_buffered(const std::string& path);
+
+    void* mapping_ = nullptr;
+    size_t mapped_size_ = 0;
+    std::vector<uint8_t> buffer_; // when not mapped
+    std::string last_error_;
+};
+
+} // namespace SamFlash
+
+#endif // FIRMWARE_IMAGE_H
@@ -0,0 +1,255 @@
+#include "firmware_source.h"
+#include "lz4_frame.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace SamFlash {
+
+namespace {
+    // The budget is split over this many buffers, so the reader can fill
+    // some while the strategy sends others
+    constexpr size_t STREAM_BUFFER_COUNT = 4;
+    // Buffers are whole multiples of this, so the chunks a strategy asks
+    // for (whole file parts or sectors) line up with them
+    constexpr size_t STREAM_BUFFER_ALIGNMENT = 1024 * 1024;
+    constexpr size_t COMPRESSED_READ_SIZE = 1024 * 1024;
+}
+
+StreamingFirmwareSource::StreamingFirmwareSource(size_t memory_budget)
+    : buffer_size_(std::max(STREAM_BUFFER_ALIGNMENT,
+                            memory_budget / STREAM_BUFFER_COUNT / STREAM_BUFFER_ALIGNMENT * STREAM_BUFFER_ALIGNMENT)) {}
+
+StreamingFirmwareSource::~StreamingFirmwareSource() {
+    stop_reader();
+}
+
+bool StreamingFirmwareSource::open(const std::string& path) {
+    stop_reader();
+    last_error_.clear();
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        last_error_ = "Failed to open firmware file: " + path;
+        return false;
+    }
+    uint8_t head[LZ4_MAX_HEADER_SIZE] = {};
+    file.read(reinterpret_cast<char*>(head), sizeof(head));
+    ByteSpan header(head, static_cast<size_t>(file.gcount()));
+    compressed_ = Lz4FrameDecoder::is_lz4(header);
+    if (compressed_) {
+        auto content_size = Lz4FrameDecoder::content_size(header);
+        if (content_size) {
+            size_ = *content_size;
+        } else if (!measure_compressed(file, path)) {
+            return false;
+        }
+    } else {
+        file.clear();
+        file.seekg(0, std::ios::end);
+        std::streamoff end = file.tellg();
+        if (end < 0) {
+            last_error_ = "Size of firmware file is unknown: " + path;
+            return false;
+        }
+        size_ = static_cast<uint64_t>(end);
+    }
+    path_ = path;
+    start_reader();
+    return true;
+}
+
+bool StreamingFirmwareSource::next(size_t max_size, FirmwareChunk& chunk) {
+    if (!last_error_.empty() || !pool_) {
+        return false;
+    }
+    size_t want = static_cast<size_t>(std::min<uint64_t>(max_size, size_ - position_));
+    if (want == 0) {
+        return false;
+    }
+    assembled_.clear();
+    while (true) {
+        if (!current_ || current_used_ == current_->size) {
+            if (current_) {
+                pool_->release(current_);
+            }
+            current_ = pool_->next();
+            current_used_ = 0;
+            if (!current_) {
+                last_error_ = !reader_error_.empty() ? reader_error_ : "Firmware file ended early: " + path_;
+                return false;
+            }
+        }
+        size_t available = current_->size - current_used_;
+        if (assembled_.empty() && available >= want) {
+            // The usual case: a view into the buffer, no copy
+            chunk.offset = position_;
+            chunk.data = ByteSpan(current_->data.data() + current_used_, want);
+            current_used_ += want;
+            position_ += want;
+            return position_ < size_ || finish_reading();
+        }
+        size_t take = std::min(available, want - assembled_.size());
+        const uint8_t* from = current_->data.data() + current_used_;
+        assembled_.insert(assembled_.end(), from, from + take);
+        current_used_ += take;
+        if (assembled_.size() == want) {
+            chunk.offset = position_;
+            chunk.data = ByteSpan(assembled_);
+            position_ += want;
+            return position_ < size_ || finish_reading();
+        }
+    }
+}
+
+bool StreamingFirmwareSource::rewind() {
+    if (path_.empty()) {
+        last_error_ = "No firmware file open";
+        return false;
+    }
+    stop_reader();
+    last_error_.clear();
+    start_reader();
+    return true;
+}
+
+bool StreamingFirmwareSource::finish_reading() {
+    // The reader needs no more buffers once the last byte is out, so it
+    // can be waited for; what it found after that byte fails the chunk
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+    if (!reader_error_.empty()) {
+        last_error_ = reader_error_;
+        return false;
+    }
+    return true;
+}
+
+void StreamingFirmwareSource::start_reader() {
+    pool_ = std::make_unique<BufferPool>(STREAM_BUFFER_COUNT, buffer_size_);
+    reader_error_.clear();
+    current_ = nullptr;
+    current_used_ = 0;
+    position_ = 0;
+    reader_ = std::thread([this] { read_ahead(); });
+}
+
+void StreamingFirmwareSource::stop_reader() {
+    if (pool_) {
+        pool_->cancel();
+    }
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+    current_ = nullptr;
+    pool_.reset();
+}
+
+bool StreamingFirmwareSource::measure_compressed(std::ifstream& file, const std::string& path) {
+    // Decoded once with the output dropped, so the size is known before
+    // anything is sent without holding the image
+    file.clear();
+    file.seekg(0);
+    Lz4FrameDecoder decoder;
+    std::vector<uint8_t> input(COMPRESSED_READ_SIZE);
+    while (file.read(reinterpret_cast<char*>(input.data()), static_cast<std::streamsize>(input.size())) ||
+           file.gcount() > 0) {
+        if (!decoder.feed(ByteSpan(input.data(), static_cast<size_t>(file.gcount())), [](ByteSpan) { return true; })) {
+            last_error_ = "Failed to decompress " + path + ": " + decoder.get_last_error();
+            return false;
+        }
+    }
+    if (!decoder.finished()) {
+        last_error_ = "Compressed firmware file is truncated: " + path;
+        return false;
+    }
+    size_ = decoder.output_size();
+    return true;
+}
+
+void StreamingFirmwareSource::read_ahead() {
+    std::ifstream file(path_, std::ios::binary);
+    if (!file.is_open()) {
+        reader_error_ = "Failed to open firmware file: " + path_;
+    } else if (compressed_) {
+        read_compressed(file);
+    } else {
+        read_plain(file);
+    }
+    pool_->finish();
+}
+
+void StreamingFirmwareSource::read_plain(std::ifstream& file) {
+    uint64_t offset = 0;
+    while (offset < size_) {
+        BufferPool::Buffer* buffer = pool_->acquire();
+        if (!buffer) {
+            return;
+        }
+        size_t size = static_cast<size_t>(std::min<uint64_t>(buffer->data.size(), size_ - offset));
+        if (!file.read(reinterpret_cast<char*>(buffer->data.data()), static_cast<std::streamsize>(size))) {
+            pool_->release(buffer);
+            reader_error_ = "Failed to read firmware file at offset " + std::to_string(offset) + ": " + path_;
+            return;
+        }
+        buffer->size = size;
+        buffer->offset = offset;
+        offset += size;
+        pool_->submit(buffer);
+    }
+}
+
+void StreamingFirmwareSource::read_compressed(std::ifstream& file) {
+    Lz4FrameDecoder decoder;
+    BufferPool::Buffer* pending = nullptr;
+    bool stopped = false;
+    uint64_t produced = 0;
+    auto on_output = [&](ByteSpan data) {
+        // Refused before a buffer is taken for it, which is what lets
+        // finish_reading() wait for this thread
+        if (data.size() > size_ - produced) {
+            reader_error_ = "Compressed firmware file decompresses past its recorded " + std::to_string(size_) +
+                            " bytes: " + path_;
+            return false;
+        }
+        produced += data.size();
+        while (!data.empty()) {
+            if (!pending && !(pending = pool_->acquire())) {
+                stopped = true;
+                return false;
+            }
+            size_t take = std::min(data.size(), pending->data.size() - pending->size);
+            std::memcpy(pending->data.data() + pending->size, data.data(), take);
+            pending->size += take;
+            data = data.subspan(take);
+            if (pending->size == pending->data.size()) {
+                pool_->submit(pending);
+                pending = nullptr;
+            }
+        }
+        return true;
+    };
+
+    std::vector<uint8_t> input(COMPRESSED_READ_SIZE);
+    bool decoded = true;
+    while (decoded && (file.read(reinterpret_cast<char*>(input.data()), static_cast<std::streamsize>(input.size())) ||
+                       file.gcount() > 0)) {
+        decoded = decoder.feed(ByteSpan(input.data(), static_cast<size_t>(file.gcount())), on_output);
+    }
+    if (decoded && (!decoder.finished() || decoder.output_size() != size_)) {
+        reader_error_ = "Compressed firmware file decompressed to " + std::to_string(decoder.output_size()) +
+                        " bytes instead of " + std::to_string(size_) + ": " + path_;
+        decoded = false;
+    } else if (!decoded && !stopped && reader_error_.empty()) {
+        reader_error_ = "Failed to decompress " + path_ + ": " + decoder.get_last_error();
+    }
+    if (pending) {
+        if (decoded) {
+            pool_->submit(pending);
+        } else {
+            pool_->release(pending);
+        }
+    }
+}
+
+} // namespace SamFlash
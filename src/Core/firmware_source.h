@@ -0,0 +1,126 @@
+#ifndef FIRMWARE_SOURCE_H
+#define FIRMWARE_SOURCE_H
+
+#include "byte_span.h"
+#include "buffer_pool.h"
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SamFlash {
+
+// Piece of an image pulled from a FirmwareSource
+struct FirmwareChunk {
+    uint64_t offset = 0; // within the image
+    ByteSpan data;
+};
+
+// Firmware image pulled front to back in chunks, so that a strategy only
+// holds part of it at a time
+class FirmwareSource {
+public:
+    virtual ~FirmwareSource() = default;
+
+    // Total bytes, known before the first chunk
+    virtual uint64_t size() const = 0;
+    // Next chunk of max_size bytes, shorter only at the end of the image.
+    // Its data stays valid until the next call. Returns false at the end
+    // or on an error, which at_end() tells apart.
+    virtual bool next(size_t max_size, FirmwareChunk& chunk) = 0;
+    virtual bool at_end() const = 0;
+    // Back to the first byte, e.g. to verify what was written
+    virtual bool rewind() = 0;
+    // Largest chunk worth asking for at once
+    virtual size_t chunk_size_hint() const = 0;
+    // The whole image when it is already in memory, else empty
+    virtual ByteSpan contiguous() const { return ByteSpan(); }
+
+    std::string get_last_error() const { return last_error_; }
+
+protected:
+    std::string last_error_;
+};
+
+// Image already in memory or mapped; chunks are views into it
+class MemoryFirmwareSource : public FirmwareSource {
+public:
+    explicit MemoryFirmwareSource(ByteSpan image) : image_(image) {}
+
+    uint64_t size() const override { return image_.size(); }
+    bool next(size_t max_size, FirmwareChunk& chunk) override {
+        if (position_ == image_.size()) {
+            return false;
+        }
+        chunk.offset = position_;
+        chunk.data = image_.subspan(position_, max_size);
+        position_ += chunk.data.size();
+        return true;
+    }
+    bool at_end() const override { return position_ == image_.size(); }
+    bool rewind() override {
+        position_ = 0;
+        return true;
+    }
+    size_t chunk_size_hint() const override { return std::numeric_limits<size_t>::max(); }
+    ByteSpan contiguous() const override { return image_; }
+
+private:
+    ByteSpan image_;
+    size_t position_ = 0;
+};
+
+// Reads a file on a background thread, running ahead of the strategy
+// through a fixed set of buffers that together take memory_budget bytes,
+// however large the image. An .lz4 file is decompressed on that thread;
+// one that doesn't record its decompressed size is decoded once up front
+// to find it.
+class StreamingFirmwareSource : public FirmwareSource {
+public:
+    explicit StreamingFirmwareSource(size_t memory_budget);
+    ~StreamingFirmwareSource() override;
+
+    StreamingFirmwareSource(const StreamingFirmwareSource&) = delete;
+    StreamingFirmwareSource& operator=(const StreamingFirmwareSource&) = delete;
+
+    bool open(const std::string& path);
+
+    uint64_t size() const override { return size_; }
+    bool next(size_t max_size, FirmwareChunk& chunk) override;
+    bool at_end() const override { return position_ == size_ && last_error_.empty(); }
+    bool rewind() override;
+    size_t chunk_size_hint() const override { return buffer_size_; }
+
+    bool is_compressed() const { return compressed_; }
+
+private:
+    void start_reader();
+    void stop_reader();
+    bool finish_reading();
+    bool measure_compressed(std::ifstream& file, const std::string& path);
+    void read_ahead();
+    void read_plain(std::ifstream& file);
+    void read_compressed(std::ifstream& file);
+
+    std::string path_;
+    uint64_t size_ = 0;
+    bool compressed_ = false;
+    size_t buffer_size_ = 0;
+
+    std::unique_ptr<BufferPool> pool_;
+    std::thread reader_;
+    std::string reader_error_; // set by the reader before it finishes
+
+    // Consumer side
+    BufferPool::Buffer* current_ = nullptr;
+    size_t current_used_ = 0;
+    uint64_t position_ = 0;
+    std::vector<uint8_t> assembled_; // a chunk that spans two buffers
+};
+
+} // namespace SamFlash
+
+#endif // FIRMWARE_SOURCE_H
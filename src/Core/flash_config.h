@@ -0,0 +1,36 @@
+#ifndef FLASH_CONFIG_H
+#define FLASH_CONFIG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SamFlash {
+
+enum class VerifyMode {
+    READ_BACK,  // read the image back and compare on the host
+    DEVICE_CRC  // compare checksums computed on the device; falls back to READ_BACK
+};
+
+struct FlashConfig {
+    bool verify_after_write = true;
+    bool erase_before_write = true;
+    uint32_t retry_count = 3;
+    uint32_t timeout_ms = 5000;
+    bool enable_progress_reporting = true;
+    uint32_t pipeline_depth = 4; // block transfers kept in flight; 1 disables pipelining
+    uint32_t transfer_block_size = 0; // bytes per bulk command; 0 sizes blocks from the device RAM buffer
+    bool adaptive_transfer = true; // tune block size and depth to the measured link
+    VerifyMode verify_mode = VerifyMode::DEVICE_CRC;
+    bool skip_blank_pages = true; // don't rewrite all-0xFF pages after a full erase
+    bool differential_flash = false; // erase/write only sectors whose device checksum differs
+    std::string journal_path{}; // keep session checkpoints in this file; empty keeps them only with resume, next to the firmware file
+    bool resume = false; // continue an interrupted session recorded in the journal, and journal this one
+    std::vector<std::string> partitions{}; // PIT partitions to erase and write; empty takes all the firmware has
+    size_t memory_budget = 0; // bytes of the image held at once while flashing (4 MB minimum); 0 maps a plain file whole, .lz4 files always stream
+};
+
+} // namespace SamFlash
+
+#endif // FLASH_CONFIG_H
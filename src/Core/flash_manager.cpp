@@ -1,13 +1,23 @@
 #include "flash_manager.h"
 #include <algorithm>
-#include <fstream>
 #include <iostream>
 #include "samsung_flasher.h"
 #include "generic_strategy.h"
 #include "samsung_strategy.h"
+#include "session_journal.h"
+#include "crc32.h"
+#include "lz4_frame.h"
+#include <chrono>
+#include <filesystem>
 
 namespace SamFlash {
 
+namespace {
+    // Journal saves are throttled to one per this much progress or time
+    constexpr size_t CHECKPOINT_INTERVAL_BYTES = 1024 * 1024;
+    constexpr auto CHECKPOINT_INTERVAL_TIME = std::chrono::seconds(1);
+}
+
 FlashManager::FlashManager()
     : current_status_(FlashStatus::IDLE), progress_percentage_(0.0) {
     // Initialize with USB Serial interface by default
@@ -29,22 +39,50 @@ FlashConfig FlashManager::get_config() const {
 }
 
 std::vector<DeviceInfo> FlashManager::scan_devices() {
-    return device_interface_->discover_devices();
+    // Phones in download mode are listed by vendor ID and flashed over
+    // Odin; everything else is offered to the SAM-BA interface
+    std::vector<DeviceInfo> devices = SamsungFlasher().discover_devices();
+    if (auto serial = DeviceInterfaceFactory::create_interface(DeviceType::USB_SERIAL)) {
+        for (auto& device : serial->discover_devices()) {
+            if (device.vendor_id != SamsungFlasher::SAMSUNG_VENDOR_ID) {
+                devices.push_back(std::move(device));
+            }
+        }
+    }
+    return devices;
 }
 
 bool FlashManager::connect_device(const std::string& device_id) {
+    DeviceInfo device{};
+    device.id = device_id;
+    device.type = DeviceType::USB_SERIAL;
+    device.port_or_address = device_id;
+    for (const auto& port : SerialTransport::enumerate_ports()) {
+        if (port.port_name == device_id) {
+            device.vendor_id = port.vendor_id;
+            break;
+        }
+    }
+    return connect_device(device);
+}
+
+bool FlashManager::connect_device(const DeviceInfo& device) {
     std::lock_guard<std::mutex> lock(status_mutex_);
-    if (device_interface_->connect(device_id)) {
-        // Check if it's a Samsung device
-        if(device_interface_->get_device_signature() == "samsung_signature") {
-            device_interface_ = std::make_unique<SamsungFlasher>();
-            device_interface_->connect(device_id);
+    // The interface is picked before anything is sent: a SAM-BA probe
+    // would leave an Odin bootloader out of step, and vice versa
+    if (!device_interface_->is_connected()) {
+        if (device.vendor_id == SamsungFlasher::SAMSUNG_VENDOR_ID) {
+            device_interface_ = std::make_shared<SamsungFlasher>();
+        } else if (auto interface = DeviceInterfaceFactory::create_interface(device.type)) {
+            device_interface_ = std::move(interface);
         }
+    }
+    if (device_interface_->connect(device.id)) {
         select_strategy();
         current_status_ = FlashStatus::CONNECTED;
         return true;
     }
-    set_error("Failed to connect to device");
+    set_error("Failed to connect to device: " + device_interface_->get_last_error());
     return false;
 }
 
@@ -63,25 +101,54 @@ DeviceInfo FlashManager::get_connected_device() const {
 }
 
 bool FlashManager::load_firmware_file(const std::string& file_path) {
-    std::ifstream file(file_path, std::ios::binary);
-    if (!file.is_open()) {
-        set_error("Failed to open firmware file: " + file_path);
-        return false;
+    firmware_archive_.reset();
+    if (OdinArchive::is_archive(file_path)) {
+        auto archive = std::make_unique<OdinArchive>();
+        if (!archive->open(file_path)) {
+            set_error(archive->get_last_error());
+            return false;
+        }
+        firmware_source_.reset();
+        firmware_image_.close();
+        firmware_archive_ = std::move(archive);
+        firmware_path_ = file_path;
+        return validate_firmware_data();
     }
     
-    // Get file size
-    file.seekg(0, std::ios::end);
-    size_t file_size = file.tellg();
-    file.seekg(0, std::ios::beg);
+    // Without a budget a plain image is mapped, not read: nothing is
+    // copied until the strategy touches it. Pipes can't be streamed and
+    // are read whole.
+    std::error_code ec;
+    const bool regular = std::filesystem::is_regular_file(file_path, ec);
+    firmware_source_.reset();
+    if (config_.memory_budget == 0 || !regular) {
+        if (!firmware_image_.open(file_path)) {
+            set_error(firmware_image_.get_last_error());
+            return false;
+        }
+        if (!Lz4FrameDecoder::is_lz4(firmware_image_.data())) {
+            firmware_source_ = std::make_unique<MemoryFirmwareSource>(firmware_image_.data());
+            firmware_path_ = file_path;
+            return validate_firmware_data();
+        }
+        firmware_image_.close();
+        if (!regular) {
+            set_error("Compressed firmware has to be read from a regular file: " + file_path);
+            return false;
+        }
+    }
     
-    // Read file data
-    firmware_data_.resize(file_size);
-    if (!file.read(reinterpret_cast<char*>(firmware_data_.data()), file_size)) {
-        set_error("Failed to read firmware file: " + file_path);
+    // Everything else is read ahead from disk through the memory budget
+    // while it is flashed, and .lz4 files are decompressed on the way
+    // rather than whole, whatever the budget
+    auto source = std::make_unique<StreamingFirmwareSource>(config_.memory_budget);
+    if (!source->open(file_path)) {
+        set_error(source->get_last_error());
         return false;
     }
-    
-    file.close();
+    firmware_image_.close();
+    firmware_source_ = std::move(source);
+    firmware_path_ = file_path;
     return validate_firmware_data();
 }
 
@@ -90,7 +157,105 @@ bool FlashManager::flash_firmware() {
         set_error("No flashing strategy selected");
         return false;
     }
-    return flash_strategy_->write_firmware(firmware_data_);
+    if (firmware_archive_) {
+        return flash_archive();
+    }
+    if (!firmware_source_) {
+        set_error("No firmware loaded");
+        return false;
+    }
+    
+    // Journal the session so an interrupted flash can pick up where it
+    // stopped. Identifying the image costs a full pass over it, so that
+    // only happens when a journal or resume was asked for and the strategy
+    // can continue from a checkpoint at all.
+    if (!flash_strategy_->can_resume() || (!config_.resume && config_.journal_path.empty())) {
+        if (config_.resume) {
+            std::cout << flash_strategy_->get_strategy_name() << " can't resume, flashing from the start" << std::endl;
+        }
+        if (!flash_strategy_->write_firmware(*firmware_source_)) {
+            set_error(flash_strategy_->get_last_error());
+            return false;
+        }
+    } else if (!flash_journaled()) {
+        return false;
+    }
+    
+    if (config_.verify_after_write && !flash_strategy_->verify_firmware(*firmware_source_)) {
+        set_error(flash_strategy_->get_last_error());
+        return false;
+    }
+    return true;
+}
+
+bool FlashManager::flash_journaled() {
+    SessionJournal journal(!config_.journal_path.empty() ? config_.journal_path
+                                                         : SessionJournal::default_path_for(firmware_path_));
+    SessionCheckpoint session;
+    session.image_path = firmware_path_;
+    session.image_size = firmware_source_->size();
+    if (!image_crc32(session.image_crc32)) {
+        return false;
+    }
+    session.device_identity = device_identity();
+    
+    if (config_.resume) {
+        SessionCheckpoint previous;
+        if (session.device_identity.empty()) {
+            // Another unit of the same model would match; never resume onto it
+            std::cout << "Device reports no serial number or unique ID, flashing from the start" << std::endl;
+        } else if (!journal.load(previous)) {
+            std::cout << "No session to resume (" << journal.get_last_error() << "), flashing from the start" << std::endl;
+        } else if (!previous.matches(session)) {
+            std::cout << "Journal is for a different image or device, flashing from the start" << std::endl;
+        } else {
+            std::cout << "Resuming " << previous.partition << " after " << previous.confirmed_bytes << " bytes" << std::endl;
+            flash_strategy_->set_resume_point(previous.partition, previous.confirmed_bytes);
+        }
+    }
+    
+    size_t saved_bytes = 0;
+    auto saved_at = std::chrono::steady_clock::now();
+    flash_strategy_->set_checkpoint_callback([&](const std::string& partition, size_t confirmed_bytes) {
+        session.partition = partition;
+        session.confirmed_bytes = confirmed_bytes;
+        auto now = std::chrono::steady_clock::now();
+        if (confirmed_bytes >= saved_bytes + CHECKPOINT_INTERVAL_BYTES || now - saved_at >= CHECKPOINT_INTERVAL_TIME) {
+            if (!journal.save(session)) {
+                std::cerr << journal.get_last_error() << std::endl;
+            }
+            saved_bytes = confirmed_bytes;
+            saved_at = now;
+        }
+    });
+    
+    // The strategy erases what the image covers when erase_before_write is set
+    bool result = flash_strategy_->write_firmware(*firmware_source_);
+    flash_strategy_->set_checkpoint_callback(nullptr);
+    if (!result) {
+        // Keep the latest confirmed offset for a later --resume
+        set_error(flash_strategy_->get_last_error());
+        if (!session.partition.empty() && !journal.save(session)) {
+            set_error(last_error_ + "; checkpoint not saved: " + journal.get_last_error());
+        }
+        return false;
+    }
+    journal.clear();
+    return true;
+}
+
+bool FlashManager::flash_archive() {
+    // Download mode can't seek into a partition, so there is nothing to
+    // journal; an interrupted archive is flashed again from the start
+    if (!flash_strategy_->write_archive(*firmware_archive_)) {
+        set_error(flash_strategy_->get_last_error());
+        return false;
+    }
+    if (config_.verify_after_write && !flash_strategy_->verify_firmware(ByteSpan())) {
+        set_error(flash_strategy_->get_last_error());
+        return false;
+    }
+    return true;
 }
 
 bool FlashManager::verify_firmware() {
@@ -98,7 +263,10 @@ bool FlashManager::verify_firmware() {
         set_error("No flashing strategy selected");
         return false;
     }
-    return flash_strategy_->verify_firmware(firmware_data_);
+    if (!firmware_source_) {
+        return flash_strategy_->verify_firmware(ByteSpan());
+    }
+    return flash_strategy_->verify_firmware(*firmware_source_);
 }
 
 bool FlashManager::erase_device() {
@@ -149,7 +317,42 @@ void FlashManager::update_progress(const FlashProgress& progress) {
 }
 
 bool FlashManager::validate_firmware_data() {
-    return !firmware_data_.empty();
+    if (firmware_archive_) {
+        return !firmware_archive_->members().empty();
+    }
+    return firmware_source_ && firmware_source_->size() > 0;
+}
+
+bool FlashManager::image_crc32(uint32_t& crc32) {
+    ByteSpan image = firmware_source_->contiguous();
+    if (!image.empty()) {
+        crc32 = Crc32::compute(image);
+        return true;
+    }
+    // A streamed image takes an extra pass over the file
+    Crc32 crc;
+    FirmwareChunk chunk;
+    firmware_source_->rewind();
+    while (firmware_source_->next(firmware_source_->chunk_size_hint(), chunk)) {
+        crc.update(chunk.data);
+    }
+    if (!firmware_source_->at_end()) {
+        set_error(firmware_source_->get_last_error());
+        return false;
+    }
+    crc32 = crc.value();
+    return true;
+}
+
+std::string FlashManager::device_identity() const {
+    // This very unit, not just its model and layout; empty when the device
+    // can't say which unit it is
+    DeviceInfo info = device_interface_->get_device_info();
+    if (info.serial_number.empty()) {
+        return std::string();
+    }
+    return device_interface_->get_device_signature() + "/" + info.name + "/" + std::to_string(info.flash_size) + "/" +
+           info.serial_number;
 }
 
 void FlashManager::select_strategy() {
@@ -180,6 +383,9 @@ void FlashManager::select_strategy() {
         legacy_progress.percentage = enhanced_progress.percentage;
         legacy_progress.current_operation = enhanced_progress.current_operation;
         legacy_progress.status = enhanced_progress.status;
+        legacy_progress.transfer_chunk_size = enhanced_progress.transfer_chunk_size;
+        legacy_progress.pipeline_depth = enhanced_progress.pipeline_depth;
+        legacy_progress.throughput_bps = enhanced_progress.throughput_bps;
         
         update_progress(legacy_progress);
     });
@@ -8,18 +8,13 @@
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include "flash_config.h"
 #include "iflash_strategy.h"
+#include "odin_archive.h"
+#include "firmware_image.h"
 
 namespace SamFlash {
 
-struct FlashConfig {
-    bool verify_after_write = true;
-    bool erase_before_write = true;
-    uint32_t retry_count = 3;
-    uint32_t timeout_ms = 5000;
-    bool enable_progress_reporting = true;
-};
-
 class FlashManager {
 public:
     FlashManager();
@@ -31,11 +26,17 @@ public:
     
     // Device management
     std::vector<DeviceInfo> scan_devices();
+    // Ports are routed by USB vendor ID: Samsung's go to the Odin
+    // flasher, the rest to the interface for their device type
     bool connect_device(const std::string& device_id);
+    bool connect_device(const DeviceInfo& device);
     bool disconnect_device();
     DeviceInfo get_connected_device() const;
     
-    // Firmware operations
+    // Firmware operations. Plain images are memory-mapped rather than
+    // read, or with a memory budget set streamed from disk through that
+    // much memory; Samsung .tar/.tar.md5 packages are indexed, and
+    // streamed member by member when flashed.
     bool load_firmware_file(const std::string& file_path);
     bool flash_firmware();
     bool verify_firmware();
@@ -59,10 +60,17 @@ private:
     void set_error(const std::string& error);
     void update_progress(const FlashProgress& progress);
     bool validate_firmware_data();
+    bool flash_archive();
+    bool flash_journaled();
+    bool image_crc32(uint32_t& crc32);
+    std::string device_identity() const;
     
-std::unique_ptr<IDeviceInterface> device_interface_;
+std::shared_ptr<IDeviceInterface> device_interface_;
     std::unique_ptr<IFlashStrategy> flash_strategy_;
-    std::vector<uint8_t> firmware_data_;
+    FirmwareImage firmware_image_;
+    std::unique_ptr<FirmwareSource> firmware_source_; // over firmware_image_, or streaming
+    std::unique_ptr<OdinArchive> firmware_archive_;
+    std::string firmware_path_;
     FlashConfig config_;
     
     mutable std::mutex status_mutex_;
@@ -2,6 +2,7 @@
 #define GENERIC_STRATEGY_H
 
 #include "iflash_strategy.h"
+#include "blank_detect.h"
 #include <iostream>
 #include <algorithm>
 
@@ -18,6 +19,14 @@ public:
         config_ = config;
         last_error_.clear();
         
+        if (device_interface_) {
+            IDeviceInterface::TransferOptions options;
+            options.pipeline_depth = config_.pipeline_depth;
+            options.block_size = config_.transfer_block_size;
+            options.adaptive = config_.adaptive_transfer;
+            device_interface_->set_transfer_options(options);
+        }
+        
         std::cout << "GenericStrategy: Initialized for generic device flashing" << std::endl;
         return true;
     }
@@ -35,6 +44,10 @@ public:
             last_error_ = "Device interface not initialized";
             return false;
         }
+        if (!config_.partitions.empty()) {
+            last_error_ = "Partitions can't be selected: device has no PIT";
+            return false;
+        }
         
         // Report erase progress
         EnhancedFlashProgress progress;
@@ -61,6 +74,7 @@ public:
         update_progress(progress);
         
         bool result = device_interface_->erase_chip();
+        device_erased_ = result;
         
         if (result) {
             progress.percentage = 100.0;
@@ -71,31 +85,48 @@ public:
             update_progress(progress);
             std::cout << "GenericStrategy: Device erase completed successfully" << std::endl;
         } else {
-            last_error_ = "Failed to erase device";
+            last_error_ = "Failed to erase device: " + device_interface_->get_last_error();
             std::cout << "GenericStrategy: Device erase failed" << std::endl;
         }
         
         return result;
     }
     
-    bool write_firmware(const std::vector<uint8_t>& firmware_data) override {
+    bool write_firmware(ByteSpan firmware_data) override {
+        MemoryFirmwareSource source(firmware_data);
+        return write_firmware(source);
+    }
+    
+    bool write_firmware(FirmwareSource& source) override {
         std::cout << "GenericStrategy: Starting firmware write..." << std::endl;
         
         if (!device_interface_) {
             last_error_ = "Device interface not initialized";
             return false;
         }
+        if (!config_.partitions.empty()) {
+            last_error_ = "Partitions can't be selected: device has no PIT";
+            return false;
+        }
         
-        if (firmware_data.empty()) {
+        if (source.size() == 0) {
             last_error_ = "No firmware data to write";
             return false;
         }
-        
-        const size_t page_size = 256; // Standard page size
-        size_t total_pages = (firmware_data.size() + page_size - 1) / page_size;
+        if (source.size() > UINT32_MAX) {
+            last_error_ = "Image does not fit the device address space";
+            return false;
+        }
+        if (!source.rewind()) {
+            last_error_ = source.get_last_error();
+            return false;
+        }
+        const size_t image_size = static_cast<size_t>(source.size());
         
         EnhancedFlashProgress progress;
-        progress.total_bytes = firmware_data.size();
+        progress.bytes_written = 0;
+        progress.total_bytes = image_size;
+        progress.percentage = 0.0;
         progress.current_operation = "Writing firmware";
         progress.status = FlashStatus::FLASHING;
         progress.current_partition = "main";
@@ -106,31 +137,150 @@ public:
         PartitionProgress partition_progress;
         partition_progress.partition_name = "main";
         partition_progress.partition_id = 0;
-        partition_progress.partition_size = firmware_data.size();
+        partition_progress.bytes_written = 0;
+        partition_progress.partition_size = image_size;
+        partition_progress.partition_percentage = 0.0;
         partition_progress.current_operation = "Writing";
         partition_progress.status = FlashStatus::FLASHING;
         progress.partition_progress.push_back(partition_progress);
         
-        for (size_t i = 0; i < firmware_data.size(); i += page_size) {
-            std::vector<uint8_t> page(firmware_data.begin() + i,
-                                    firmware_data.begin() + std::min(firmware_data.size(), i + page_size));
-            
-            if (!device_interface_->write_page(i, page)) {
-                last_error_ = "Write error at address: " + std::to_string(i);
-                return false;
-            }
+        uint32_t page_size = device_interface_->get_device_info().page_size;
+        
+        // A resumed session continues at the last confirmed offset, backed
+        // up to a sector boundary so the erase below can't touch data the
+        // earlier session already wrote
+        size_t resume_offset = take_resume_offset(progress.current_partition);
+        resume_offset = std::min(resume_offset, image_size) / sector_size() * sector_size();
+        if (resume_offset > 0) {
+            std::cout << "GenericStrategy: Resuming at offset " << resume_offset << std::endl;
+        }
+        
+        // Blocks are streamed with up to pipeline_depth transfers in flight;
+        // progress advances as the device confirms each block
+        size_t confirmed_offset = resume_offset;
+        auto on_progress = [&](size_t confirmed_end) {
+            confirmed_offset = confirmed_end;
+            progress.bytes_written = confirmed_end;
+            progress.percentage = 100.0 * static_cast<double>(progress.bytes_written) / image_size;
             
-            // Update progress
-            progress.bytes_written = i + page.size();
-            progress.percentage = 100.0 * static_cast<double>(progress.bytes_written) / firmware_data.size();
+            auto stats = device_interface_->get_transfer_stats();
+            progress.transfer_chunk_size = stats.chunk_size;
+            progress.pipeline_depth = stats.pipeline_depth;
+            progress.throughput_bps = stats.throughput_bps;
             
             // Update partition progress
             progress.partition_progress[0].bytes_written = progress.bytes_written;
             progress.partition_progress[0].partition_percentage = progress.percentage;
             
             update_progress(progress);
+            report_checkpoint(progress.current_partition, confirmed_end);
+        };
+        
+        // The image is erased, compared and written one sector-aligned
+        // window at a time; an image in memory is a single window
+        const size_t window_size = std::max<size_t>(sector_size(), source.chunk_size_hint() / sector_size() * sector_size());
+        const bool device_erased = device_erased_;
+        bool differential = config_.differential_flash && !device_erased;
+        size_t changed_regions = 0;
+        size_t changed_bytes = 0;
+        std::vector<ImageExtent> written;
+        device_erased_ = false;
+        programmed_extents_.clear();
+        
+        FirmwareChunk chunk;
+        while (source.next(window_size, chunk)) {
+            const size_t base = static_cast<size_t>(chunk.offset);
+            const size_t window_end = base + chunk.data.size();
+            if (window_end <= resume_offset) {
+                continue;
+            }
+            const size_t start = std::max(base, resume_offset);
+            
+            // Runs of the window still to be written, and whether they are
+            // known to be erased
+            std::vector<ImageExtent> extents{{start, window_end - start}};
+            bool extents_erased = device_erased;
+            
+            // Differential mode: only sectors whose device checksum differs
+            // from the image are erased and rewritten
+            bool erase_window = config_.erase_before_write && !device_erased;
+            if (differential) {
+                std::vector<ImageExtent> changed;
+                if (find_changed_sectors(chunk.data, base, start, changed)) {
+                    std::vector<FlashRange> ranges;
+                    for (const auto& extent : changed) {
+                        ranges.push_back({static_cast<uint32_t>(extent.offset), static_cast<uint32_t>(extent.size)});
+                        changed_bytes += extent.size;
+                    }
+                    if (!erase_ranges(ranges)) {
+                        return false;
+                    }
+                    changed_regions += changed.size();
+                    extents = changed;
+                    extents_erased = true;
+                    erase_window = false;
+                } else {
+                    std::cout << "GenericStrategy: Device has no sector checksums, rewriting whole image" << std::endl;
+                    differential = false;
+                }
+            }
+            
+            // Erase only what the image covers, not the whole device
+            if (erase_window) {
+                FlashRange pending{static_cast<uint32_t>(start), static_cast<uint32_t>(window_end - start)};
+                if (!erase_ranges({pending})) {
+                    return false;
+                }
+                extents_erased = true;
+            }
+            
+            // Once erased, pages that are entirely 0xFF already hold their
+            // final contents and only the remaining runs are written
+            if (config_.skip_blank_pages && extents_erased) {
+                std::vector<ImageExtent> programmed;
+                for (const auto& extent : extents) {
+                    ByteSpan run_data = chunk.data.subspan(extent.offset - base, extent.size);
+                    for (const auto& run : find_programmed_extents(run_data, page_size)) {
+                        programmed.push_back({extent.offset + run.offset, run.size});
+                    }
+                }
+                extents.swap(programmed);
+            }
+            
+            size_t programmed_bytes = 0;
+            for (const auto& extent : extents) {
+                programmed_bytes += extent.size;
+            }
+            progress.skipped_bytes += window_end - start - programmed_bytes;
+            
+            for (const auto& extent : extents) {
+                if (!write_extent(chunk.data, base, extent, page_size, on_progress, confirmed_offset)) {
+                    last_error_ = "Write error at address: " + std::to_string(confirmed_offset) +
+                                  " (" + device_interface_->get_last_error() + ")";
+                    return false;
+                }
+            }
+            written.insert(written.end(), extents.begin(), extents.end());
+        }
+        if (!source.at_end()) {
+            last_error_ = source.get_last_error();
+            return false;
+        }
+        if (differential) {
+            std::cout << "GenericStrategy: " << changed_regions << " changed region(s), "
+                      << changed_bytes << " of " << image_size - resume_offset << " bytes differ" << std::endl;
         }
         
+        // Verification can then skip the same unchanged or blank pages
+        if (progress.skipped_bytes > 0 && resume_offset == 0) {
+            programmed_extents_ = written;
+            programmed_image_size_ = image_size;
+        }
+        
+        progress.bytes_written = image_size;
+        progress.percentage = 100.0;
+        progress.partition_progress[0].bytes_written = progress.bytes_written;
+        progress.partition_progress[0].partition_percentage = progress.percentage;
         progress.status = FlashStatus::COMPLETE;
         progress.completed_partitions = 1;
         progress.partition_progress[0].status = FlashStatus::COMPLETE;
@@ -140,17 +290,27 @@ public:
         return true;
     }
     
-    bool verify_firmware(const std::vector<uint8_t>& expected_data) override {
+    bool verify_firmware(ByteSpan expected_data) override {
+        MemoryFirmwareSource source(expected_data);
+        return verify_firmware(source);
+    }
+    
+    bool verify_firmware(FirmwareSource& source) override {
         std::cout << "GenericStrategy: Starting firmware verification..." << std::endl;
         
         if (!device_interface_) {
             last_error_ = "Device interface not initialized";
             return false;
         }
+        if (!source.rewind()) {
+            last_error_ = source.get_last_error();
+            return false;
+        }
+        const size_t image_size = static_cast<size_t>(source.size());
         
         EnhancedFlashProgress progress;
         progress.bytes_written = 0;
-        progress.total_bytes = expected_data.size();
+        progress.total_bytes = image_size;
         progress.percentage = 0.0;
         progress.current_operation = "Verifying firmware";
         progress.status = FlashStatus::VERIFYING;
@@ -163,7 +323,7 @@ public:
         partition_progress.partition_name = "main";
         partition_progress.partition_id = 0;
         partition_progress.bytes_written = 0;
-        partition_progress.partition_size = expected_data.size();
+        partition_progress.partition_size = image_size;
         partition_progress.partition_percentage = 0.0;
         partition_progress.current_operation = "Verifying";
         partition_progress.status = FlashStatus::VERIFYING;
@@ -171,20 +331,69 @@ public:
         
         update_progress(progress);
         
-        bool result = device_interface_->verify_flash(expected_data);
+        // Blank pages skipped by the preceding write are not checked again
+        std::vector<ImageExtent> extents;
+        if (!programmed_extents_.empty() && programmed_image_size_ == image_size) {
+            extents = programmed_extents_;
+            size_t checked_bytes = 0;
+            for (const auto& extent : extents) {
+                checked_bytes += extent.size;
+            }
+            progress.skipped_bytes = image_size - checked_bytes;
+        } else {
+            extents.push_back({0, image_size});
+        }
+        
+        // Prefer comparing device-computed digests; only read the image
+        // back when the device has no checksum command. Each window of the
+        // image is checked against the extents it overlaps.
+        bool result = true;
+        bool crc_supported = config_.verify_mode == VerifyMode::DEVICE_CRC;
+        std::string mismatch;
+        const size_t window_size = std::max<size_t>(sector_size(), source.chunk_size_hint() / sector_size() * sector_size());
+        FirmwareChunk chunk;
+        while (result && source.next(window_size, chunk)) {
+            const size_t base = static_cast<size_t>(chunk.offset);
+            const size_t window_end = base + chunk.data.size();
+            for (const auto& extent : extents) {
+                size_t begin = std::max(extent.offset, base);
+                size_t end = std::min(extent.offset + extent.size, window_end);
+                if (begin >= end) {
+                    continue;
+                }
+                ByteSpan expected = chunk.data.subspan(begin - base, end - begin);
+                uint32_t address = static_cast<uint32_t>(begin);
+                if (crc_supported) {
+                    result = verify_by_device_crc(expected, address, begin, progress, crc_supported, mismatch);
+                }
+                if (!crc_supported) {
+                    result = device_interface_->verify_flash(expected, address);
+                }
+                if (!result) {
+                    break;
+                }
+            }
+        }
+        if (result && !source.at_end()) {
+            result = false;
+            mismatch = source.get_last_error();
+        }
         
         if (result) {
-            progress.bytes_written = expected_data.size();
+            progress.bytes_written = image_size;
             progress.percentage = 100.0;
             progress.status = FlashStatus::COMPLETE;
             progress.completed_partitions = 1;
-            progress.partition_progress[0].bytes_written = expected_data.size();
+            progress.partition_progress[0].bytes_written = image_size;
             progress.partition_progress[0].partition_percentage = 100.0;
             progress.partition_progress[0].status = FlashStatus::COMPLETE;
             update_progress(progress);
             std::cout << "GenericStrategy: Firmware verification completed successfully" << std::endl;
         } else {
             last_error_ = "Firmware verification failed";
+            if (!mismatch.empty()) {
+                last_error_ += ": " + mismatch;
+            }
             std::cout << "GenericStrategy: Firmware verification failed" << std::endl;
         }
         
@@ -215,10 +424,88 @@ public:
     }
     
     // Device-specific validation
+    bool can_resume() const override {
+        return true;
+    }
+    
     bool is_compatible_with_device(const DeviceInfo& device_info) const override {
         // Generic strategy is compatible with all non-Samsung devices
         return device_info.manufacturer != "Samsung";
     }
+    
+private:
+    // Smallest unit the device erases
+    uint32_t sector_size() const {
+        DeviceInfo info = device_interface_->get_device_info();
+        uint32_t size = info.erase_block_size != 0 ? info.erase_block_size : info.page_size;
+        return std::max<uint32_t>(1, size);
+    }
+    
+    // Write one extent of a window, which holds the image from offset base
+    // on. When the link drops a block, the pages the device already
+    // confirmed are kept and the rest is resent; each failure without
+    // progress counts against config_.retry_count.
+    bool write_extent(ByteSpan window, size_t base, const ImageExtent& extent, uint32_t page_size,
+                      const IDeviceInterface::WriteProgressFn& on_progress, size_t& confirmed_offset) {
+        const size_t extent_end = extent.offset + extent.size;
+        size_t start = extent.offset;
+        uint32_t failures = 0;
+        while (true) {
+            confirmed_offset = start;
+            auto report = [&](size_t bytes_completed) {
+                on_progress(start + bytes_completed);
+            };
+            if (device_interface_->write_pages(static_cast<uint32_t>(start),
+                                               window.subspan(start - base, extent_end - start), report)) {
+                return true;
+            }
+            
+            size_t confirmed = confirmed_offset - extent.offset;
+            confirmed = page_size != 0 ? confirmed / page_size * page_size : confirmed;
+            size_t restart = extent.offset + confirmed;
+            failures = restart > start ? 1 : failures + 1;
+            if (failures > config_.retry_count) {
+                return false;
+            }
+            std::cout << "GenericStrategy: Write failed at " << restart << " ("
+                      << device_interface_->get_last_error() << "), retrying" << std::endl;
+            start = restart;
+        }
+    }
+    
+    // Compare per-sector device checksums with a window of the image, which
+    // holds it from offset base on, from start_offset on and collect the
+    // sector-aligned runs that differ. Returns false when the device can't
+    // compute checksums.
+    bool find_changed_sectors(ByteSpan window, size_t base, size_t start_offset, std::vector<ImageExtent>& changed) {
+        const uint32_t sector_size = this->sector_size();
+        
+        changed.clear();
+        for (size_t offset = start_offset; offset < base + window.size(); offset += sector_size) {
+            ByteSpan sector = window.subspan(offset - base, sector_size);
+            uint32_t device_crc = 0;
+            if (!device_interface_->compute_flash_checksum(static_cast<uint32_t>(offset),
+                                                           static_cast<uint32_t>(sector.size()), device_crc)) {
+                return false;
+            }
+            if (device_crc == device_interface_->checksum_of(sector)) {
+                continue;
+            }
+            if (!changed.empty() && changed.back().offset + changed.back().size == offset) {
+                changed.back().size += sector.size();
+            } else {
+                changed.push_back({offset, sector.size()});
+            }
+        }
+        return true;
+    }
+    
+    // Set by a successful full erase, which is what makes skipping blank
+    // pages safe; cleared as soon as anything is written
+    bool device_erased_ = false;
+    // Runs programmed by the last write when blank pages were skipped
+    std::vector<ImageExtent> programmed_extents_;
+    size_t programmed_image_size_ = 0;
 };
 
 } // namespace SamFlash
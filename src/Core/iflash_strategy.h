@@ -2,6 +2,9 @@
 #define IFLASH_STRATEGY_H
 
 #include "device_interface.h"
+#include "flash_config.h"
+#include "erase_planner.h"
+#include "firmware_source.h"
 #include <memory>
 #include <vector>
 #include <functional>
@@ -11,25 +14,39 @@ namespace SamFlash {
 
 // Forward declarations
 struct FlashProgress;
-struct FlashConfig;
 struct PartitionInfo;
+class OdinArchive;
 
 // Enhanced progress structure to include partition-level status
 struct PartitionProgress {
     std::string partition_name;
     uint32_t partition_id;
-    uint32_t bytes_written;
-    uint32_t partition_size;
+    uint64_t bytes_written;
+    uint64_t partition_size;
     double partition_percentage;
     std::string current_operation; // "Erasing", "Writing", "Verifying"
     FlashStatus status;
 };
 
+// How one stage of a streaming pipeline spent the elapsed time; the stage
+// with the highest utilization is the bottleneck
+struct PipelineStageStats {
+    std::string name;
+    double utilization = 0.0;     // share of the elapsed time spent working
+    double stalled_seconds = 0.0; // blocked waiting on the neighbouring stage
+};
+
 struct EnhancedFlashProgress : public FlashProgress {
     std::vector<PartitionProgress> partition_progress;
     std::string current_partition;
     uint32_t total_partitions;
     uint32_t completed_partitions;
+    uint64_t skipped_bytes = 0; // erased-equivalent bytes not sent to the device
+    // Position in the expanded image. bytes_written counts what crossed the
+    // link, which for a sparse image is less than what lands on the device.
+    uint64_t logical_bytes_written = 0;
+    uint64_t logical_total_bytes = 0;
+    std::vector<PipelineStageStats> pipeline_stages; // empty when not pipelined
 };
 
 // Strategy interface for different flashing protocols
@@ -43,12 +60,40 @@ public:
     
     // Main flashing operations
     virtual bool erase_device() = 0;
-    virtual bool write_firmware(const std::vector<uint8_t>& firmware_data) = 0;
-    virtual bool verify_firmware(const std::vector<uint8_t>& expected_data) = 0;
+    // The image is a read-only view, typically of a mapped file
+    virtual bool write_firmware(ByteSpan firmware_data) = 0;
+    virtual bool verify_firmware(ByteSpan expected_data) = 0;
+    // The same, pulling the image from source a window at a time so only
+    // part of it is held in memory; both start from the source's first byte
+    virtual bool write_firmware(FirmwareSource& source) = 0;
+    virtual bool verify_firmware(FirmwareSource& source) = 0;
+    // Flash each member of a firmware archive to its partition, streaming
+    // it from the file; only devices with a partition table support this
+    virtual bool write_archive(OdinArchive& archive) {
+        (void)archive;
+        last_error_ = get_strategy_name() + " cannot flash firmware archives";
+        return false;
+    }
     
     // Progress reporting
     virtual void set_progress_callback(std::function<void(const EnhancedFlashProgress&)> callback) = 0;
     
+    // Resumable sessions. The checkpoint callback receives the partition
+    // being written and how many of its leading bytes the device has
+    // confirmed; a later session passes that back as the resume point and
+    // write_firmware continues from there instead of starting over.
+    using CheckpointFn = std::function<void(const std::string& partition, size_t confirmed_bytes)>;
+    void set_checkpoint_callback(CheckpointFn callback) {
+        checkpoint_callback_ = std::move(callback);
+    }
+    void set_resume_point(const std::string& partition, size_t offset) {
+        resume_partition_ = partition;
+        resume_offset_ = offset;
+    }
+    // Whether write_firmware can continue from a resume point at all;
+    // without it there is no point in keeping checkpoints
+    virtual bool can_resume() const { return false; }
+    
     // Strategy information
     virtual std::string get_strategy_name() const = 0;
     virtual std::vector<std::string> get_supported_device_signatures() const = 0;
@@ -68,7 +113,67 @@ protected:
         }
     }
     
+    // Erase exactly the sectors the given ranges touch, using the largest
+    // erase units the device supports
+    bool erase_ranges(const std::vector<FlashRange>& ranges) {
+        auto geometry = EraseGeometry::from_device_info(device_interface_->get_device_info());
+        auto plan = plan_erase(ranges, geometry);
+        return execute_erase_plan(*device_interface_, plan, last_error_);
+    }
+    
+    // Region granularity for checksum verification; a mismatch is reported
+    // against the region that failed
+    static constexpr uint32_t CRC_VERIFY_REGION_SIZE = 64 * 1024;
+    
+    // Compare device-computed checksums against the expected image.
+    // supported is false when the device has no checksum command, in which
+    // case the caller should fall back to a read-back verification.
+    // progress_base is where expected starts within the image being reported.
+    bool verify_by_device_crc(ByteSpan expected, uint32_t start_address, size_t progress_base,
+                              EnhancedFlashProgress& progress, bool& supported, std::string& mismatch) {
+        supported = true;
+        for (size_t offset = 0; offset < expected.size(); offset += CRC_VERIFY_REGION_SIZE) {
+            ByteSpan region = expected.subspan(offset, CRC_VERIFY_REGION_SIZE);
+            uint32_t region_address = start_address + static_cast<uint32_t>(offset);
+            uint32_t device_crc = 0;
+            if (!device_interface_->compute_flash_checksum(region_address, static_cast<uint32_t>(region.size()), device_crc)) {
+                if (offset == 0) {
+                    supported = false;
+                } else {
+                    mismatch = device_interface_->get_last_error();
+                }
+                return false;
+            }
+            if (device_crc != device_interface_->checksum_of(region)) {
+                mismatch = "Checksum mismatch in region at address " + std::to_string(region_address);
+                return false;
+            }
+            
+            progress.bytes_written = progress_base + offset + region.size();
+            progress.percentage = 100.0 * static_cast<double>(progress.bytes_written) / progress.total_bytes;
+            update_progress(progress);
+        }
+        return true;
+    }
+    
+    void report_checkpoint(const std::string& partition, size_t confirmed_bytes) {
+        if (checkpoint_callback_) {
+            checkpoint_callback_(partition, confirmed_bytes);
+        }
+    }
+    
+    // Where to resume the given partition; the point is used only once
+    size_t take_resume_offset(const std::string& partition) {
+        size_t offset = partition == resume_partition_ ? resume_offset_ : 0;
+        resume_partition_.clear();
+        resume_offset_ = 0;
+        return offset;
+    }
+    
     std::function<void(const EnhancedFlashProgress&)> progress_callback_;
+    CheckpointFn checkpoint_callback_;
+    std::string resume_partition_;
+    size_t resume_offset_ = 0;
     std::shared_ptr<IDeviceInterface> device_interface_;
     FlashConfig config_;
     std::string last_error_;
@@ -0,0 +1,308 @@
+#include "lz4_frame.h"
+#include "byte_order.h"
+#include <algorithm>
+#include <cstring>
+
+namespace SamFlash {
+
+namespace {
+    constexpr uint32_t LZ4_SKIPPABLE_MAGIC = 0x184D2A50; // low nibble is free
+    constexpr uint32_t BLOCK_UNCOMPRESSED = 0x80000000u;
+    constexpr size_t HISTORY_SIZE = 64 * 1024;           // furthest a match reaches back
+    constexpr size_t SKIP_STEP = 64 * 1024;
+
+    constexpr uint8_t FLG_DICTIONARY = 0x01;
+    constexpr uint8_t FLG_RESERVED = 0x02;
+    constexpr uint8_t FLG_CONTENT_CHECKSUM = 0x04;
+    constexpr uint8_t FLG_CONTENT_SIZE = 0x08;
+    constexpr uint8_t FLG_BLOCK_CHECKSUM = 0x10;
+
+    // FLG, BD, the optional content size and dictionary ID, header checksum
+    size_t descriptor_size(uint8_t flg) {
+        return 3 + ((flg & FLG_CONTENT_SIZE) ? 8 : 0) + ((flg & FLG_DICTIONARY) ? 4 : 0);
+    }
+
+    uint64_t read_le64(const uint8_t* in) {
+        return read_le32(in) | (static_cast<uint64_t>(read_le32(in + 4)) << 32);
+    }
+
+    // Match lengths and literal runs of 15 continue in bytes of 255
+    bool read_length(const uint8_t*& in, const uint8_t* end, size_t& length) {
+        uint8_t byte;
+        do {
+            if (in == end) {
+                return false;
+            }
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+bool Lz4FrameDecoder::is_lz4(ByteSpan head) {
+    return head.size() >= 4 && read_le32(head.data()) == LZ4_FRAME_MAGIC;
+}
+
+std::optional<uint64_t> Lz4FrameDecoder::content_size(ByteSpan head) {
+    if (!is_lz4(head) || head.size() < 5) {
+        return std::nullopt;
+    }
+    uint8_t flg = head.data()[4];
+    if (!(flg & FLG_CONTENT_SIZE) || head.size() < 4 + descriptor_size(flg)) {
+        return std::nullopt;
+    }
+    return read_le64(head.data() + 6);
+}
+
+bool Lz4FrameDecoder::feed(ByteSpan input, const OutputFn& on_output) {
+    if (!last_error_.empty()) {
+        return false;
+    }
+    size_t used = 0;
+    while (used < input.size()) {
+        size_t unit_size = need_;
+        if (staged_.empty() && input.size() - used >= unit_size) {
+            // Whole units are decoded straight from the input
+            used += unit_size;
+            if (!process(input.subspan(used - unit_size, unit_size), on_output)) {
+                return false;
+            }
+            continue;
+        }
+        size_t take = std::min(input.size() - used, unit_size - staged_.size());
+        staged_.insert(staged_.end(), input.data() + used, input.data() + used + take);
+        used += take;
+        if (staged_.size() == unit_size) {
+            bool ok = process(ByteSpan(staged_), on_output);
+            staged_.clear();
+            if (!ok) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Lz4FrameDecoder::finished() const {
+    return last_error_.empty() && frames_ > 0 && stage_ == Stage::MAGIC && staged_.empty();
+}
+
+void Lz4FrameDecoder::reset() {
+    stage_ = Stage::MAGIC;
+    need_ = 4;
+    staged_.clear();
+    window_fill_ = 0;
+    output_size_ = 0;
+    frames_ = 0;
+    last_error_.clear();
+}
+
+bool Lz4FrameDecoder::process(ByteSpan unit, const OutputFn& on_output) {
+    const uint8_t* in = unit.data();
+    switch (stage_) {
+    case Stage::MAGIC: {
+        uint32_t magic = read_le32(in);
+        if (magic == LZ4_FRAME_MAGIC) {
+            stage_ = Stage::FRAME_FLAGS;
+            need_ = 2;
+        } else if ((magic & 0xFFFFFFF0u) == LZ4_SKIPPABLE_MAGIC) {
+            stage_ = Stage::SKIP_SIZE;
+            need_ = 4;
+        } else {
+            return fail("Not an LZ4 frame");
+        }
+        return true;
+    }
+    case Stage::FRAME_FLAGS:
+        std::memcpy(flags_, in, sizeof(flags_));
+        stage_ = Stage::DESCRIPTOR;
+        need_ = descriptor_size(flags_[0]) - sizeof(flags_);
+        return true;
+    case Stage::DESCRIPTOR: {
+        uint8_t descriptor[LZ4_MAX_HEADER_SIZE];
+        std::memcpy(descriptor, flags_, sizeof(flags_));
+        std::memcpy(descriptor + sizeof(flags_), in, unit.size());
+        return start_frame(ByteSpan(descriptor, sizeof(flags_) + unit.size()));
+    }
+    case Stage::BLOCK_SIZE: {
+        uint32_t value = read_le32(in);
+        if (value == 0) {
+            // End mark
+            if (content_checksum_) {
+                stage_ = Stage::CONTENT_CHECKSUM;
+                need_ = 4;
+                return true;
+            }
+            return end_frame(ByteSpan());
+        }
+        size_t size = value & ~BLOCK_UNCOMPRESSED;
+        if (size > block_max_) {
+            return fail("LZ4 block of " + std::to_string(size) + " bytes exceeds the frame's maximum of " +
+                        std::to_string(block_max_));
+        }
+        block_compressed_ = !(value & BLOCK_UNCOMPRESSED);
+        stage_ = Stage::BLOCK;
+        need_ = size + (block_checksums_ ? 4 : 0);
+        return true;
+    }
+    case Stage::BLOCK: {
+        ByteSpan block = unit.subspan(0, unit.size() - (block_checksums_ ? 4 : 0));
+        if (block_checksums_ && XxHash32::compute(block) != read_le32(in + block.size())) {
+            return fail("LZ4 block checksum mismatch at output offset " + std::to_string(output_size_));
+        }
+        // Keep only the history a match can reach once the window is full
+        if (window_fill_ + block_max_ > window_.size()) {
+            size_t keep = std::min(window_fill_, HISTORY_SIZE);
+            std::memmove(window_.data(), window_.data() + window_fill_ - keep, keep);
+            window_fill_ = keep;
+        }
+        size_t start = window_fill_;
+        if (!decode_block(block)) {
+            return false;
+        }
+        ByteSpan output(window_.data() + start, window_fill_ - start);
+        if (content_checksum_) {
+            content_hash_.update(output);
+        }
+        frame_output_ += output.size();
+        output_size_ += output.size();
+        stage_ = Stage::BLOCK_SIZE;
+        need_ = 4;
+        if (on_output && !output.empty() && !on_output(output)) {
+            return fail("Stopped at output offset " + std::to_string(output_size_ - output.size()));
+        }
+        return true;
+    }
+    case Stage::CONTENT_CHECKSUM:
+        return end_frame(unit);
+    case Stage::SKIP_SIZE:
+        skip_left_ = read_le32(in);
+        stage_ = skip_left_ == 0 ? Stage::MAGIC : Stage::SKIP;
+        need_ = skip_left_ == 0 ? 4 : static_cast<size_t>(std::min<uint64_t>(skip_left_, SKIP_STEP));
+        return true;
+    case Stage::SKIP:
+        skip_left_ -= unit.size();
+        stage_ = skip_left_ == 0 ? Stage::MAGIC : Stage::SKIP;
+        need_ = skip_left_ == 0 ? 4 : static_cast<size_t>(std::min<uint64_t>(skip_left_, SKIP_STEP));
+        return true;
+    }
+    return fail("Invalid LZ4 decoder state");
+}
+
+bool Lz4FrameDecoder::start_frame(ByteSpan descriptor) {
+    const uint8_t* in = descriptor.data();
+    uint8_t flg = in[0];
+    uint8_t bd = in[1];
+    if ((flg >> 6) != 1) {
+        return fail("Unsupported LZ4 frame version " + std::to_string(flg >> 6));
+    }
+    if (flg & FLG_DICTIONARY) {
+        return fail("LZ4 frames that need a dictionary are not supported");
+    }
+    unsigned block_id = (bd >> 4) & 0x07;
+    if ((flg & FLG_RESERVED) || (bd & 0x8F) || block_id < 4) {
+        return fail("Corrupt LZ4 frame descriptor");
+    }
+    size_t checked = descriptor.size() - 1;
+    if (((XxHash32::compute(descriptor.subspan(0, checked)) >> 8) & 0xFF) != in[checked]) {
+        return fail("LZ4 frame header checksum mismatch");
+    }
+
+    block_max_ = size_t(1) << (8 + 2 * block_id); // 64 KB, 256 KB, 1 MB or 4 MB
+    block_checksums_ = (flg & FLG_BLOCK_CHECKSUM) != 0;
+    content_checksum_ = (flg & FLG_CONTENT_CHECKSUM) != 0;
+    content_size_ = (flg & FLG_CONTENT_SIZE) ? std::optional<uint64_t>(read_le64(in + 2)) : std::nullopt;
+    frame_output_ = 0;
+    content_hash_.reset();
+    if (window_.size() < HISTORY_SIZE + block_max_) {
+        window_.resize(HISTORY_SIZE + block_max_);
+    }
+    window_fill_ = 0; // frames never refer into each other
+
+    stage_ = Stage::BLOCK_SIZE;
+    need_ = 4;
+    return true;
+}
+
+bool Lz4FrameDecoder::decode_block(ByteSpan block) {
+    uint8_t* base = window_.data();
+    uint8_t* out = base + window_fill_;
+    if (!block_compressed_) {
+        std::memcpy(out, block.data(), block.size());
+        window_fill_ += block.size();
+        return true;
+    }
+
+    // Sequences of a literal run followed by a match into earlier output;
+    // the last sequence is literals only
+    const uint8_t* in = block.data();
+    const uint8_t* in_end = in + block.size();
+    const uint8_t* out_end = out + block_max_;
+    const std::string corrupt = "Corrupt LZ4 block at output offset " + std::to_string(output_size_);
+    while (true) {
+        if (in == in_end) {
+            return fail(corrupt);
+        }
+        uint8_t token = *in++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(in, in_end, literals)) {
+            return fail(corrupt);
+        }
+        if (literals > static_cast<size_t>(in_end - in) || literals > static_cast<size_t>(out_end - out)) {
+            return fail(corrupt);
+        }
+        std::memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+        if (in == in_end) {
+            break;
+        }
+
+        if (in_end - in < 2) {
+            return fail(corrupt);
+        }
+        size_t distance = in[0] | (in[1] << 8);
+        in += 2;
+        size_t length = token & 0x0F;
+        if (length == 15 && !read_length(in, in_end, length)) {
+            return fail(corrupt);
+        }
+        length += 4;
+        if (distance == 0 || distance > static_cast<size_t>(out - base) || length > static_cast<size_t>(out_end - out)) {
+            return fail(corrupt);
+        }
+        // An overlapping match repeats the last distance bytes; copy in
+        // growing non-overlapping steps instead of byte by byte
+        for (size_t period = distance; length > 0;) {
+            size_t step = std::min(period, length);
+            std::memcpy(out, out - period, step);
+            out += step;
+            length -= step;
+            period += step;
+        }
+    }
+    window_fill_ = static_cast<size_t>(out - base);
+    return true;
+}
+
+bool Lz4FrameDecoder::end_frame(ByteSpan checksum) {
+    if (content_size_ && frame_output_ != *content_size_) {
+        return fail("LZ4 frame decoded to " + std::to_string(frame_output_) + " bytes, its header says " +
+                    std::to_string(*content_size_));
+    }
+    if (content_checksum_ && read_le32(checksum.data()) != content_hash_.digest()) {
+        return fail("LZ4 content checksum mismatch");
+    }
+    ++frames_;
+    stage_ = Stage::MAGIC;
+    need_ = 4;
+    return true;
+}
+
+bool Lz4FrameDecoder::fail(const std::string& error) {
+    last_error_ = error;
+    return false;
+}
+
+} // namespace SamFlash
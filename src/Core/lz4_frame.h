@@ -0,0 +1,78 @@
+#ifndef LZ4_FRAME_H
+#define LZ4_FRAME_H
+
+#include "byte_span.h"
+#include "xxhash32.h"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace SamFlash {
+
+constexpr uint32_t LZ4_FRAME_MAGIC = 0x184D2204;
+constexpr size_t LZ4_MAX_HEADER_SIZE = 19; // magic + descriptor with every optional field
+
+// Streaming decoder for the LZ4 frame format written by the lz4 tool, as
+// found in .img.lz4 members of newer Samsung packages. Input may be fed in
+// pieces of any size. Decoded data comes out a block at a time from a
+// window of the frame's block size plus 64 KB of history, so memory stays
+// bounded whatever the image size. Header, block and content checksums
+// are verified when the frame carries them; concatenated and skippable
+// frames are accepted.
+class Lz4FrameDecoder {
+public:
+    // Receives decoded data, valid only during the call; return false to abort
+    using OutputFn = std::function<bool(ByteSpan data)>;
+
+    // True when data starts with an LZ4 frame
+    static bool is_lz4(ByteSpan head);
+    // Decompressed size from the frame header, when the encoder recorded
+    // it (lz4 --content-size); head is the start of the frame
+    static std::optional<uint64_t> content_size(ByteSpan head);
+
+    bool feed(ByteSpan input, const OutputFn& on_output);
+    // True between frames, once at least one has been decoded
+    bool finished() const;
+    void reset();
+
+    uint64_t output_size() const { return output_size_; }
+    std::string get_last_error() const { return last_error_; }
+
+private:
+    enum class Stage { MAGIC, FRAME_FLAGS, DESCRIPTOR, BLOCK_SIZE, BLOCK, CONTENT_CHECKSUM, SKIP_SIZE, SKIP };
+
+    bool process(ByteSpan unit, const OutputFn& on_output);
+    bool start_frame(ByteSpan descriptor);
+    bool decode_block(ByteSpan block);
+    bool end_frame(ByteSpan checksum);
+    bool fail(const std::string& error);
+
+    Stage stage_ = Stage::MAGIC;
+    size_t need_ = 4;             // bytes the current stage consumes
+    std::vector<uint8_t> staged_; // a unit split across feed() calls
+
+    // Current frame
+    uint8_t flags_[2] = {};       // FLG and BD, ahead of the rest of the descriptor
+    size_t block_max_ = 0;
+    bool block_compressed_ = true;
+    bool block_checksums_ = false;
+    bool content_checksum_ = false;
+    std::optional<uint64_t> content_size_;
+    uint64_t frame_output_ = 0;
+    XxHash32 content_hash_;
+    uint64_t skip_left_ = 0;
+
+    // Decoded blocks plus the history later blocks may refer back to
+    std::vector<uint8_t> window_;
+    size_t window_fill_ = 0;
+
+    uint64_t output_size_ = 0;
+    size_t frames_ = 0;
+    std::string last_error_;
+};
+
+} // namespace SamFlash
+
+#endif // LZ4_FRAME_H
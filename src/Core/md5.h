@@ -0,0 +1,143 @@
+#ifndef MD5_H
+#define MD5_H
+
+#include "byte_span.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace SamFlash {
+
+namespace detail {
+    // Per-round shift amounts and sine-derived constants from RFC 1321
+    inline constexpr uint8_t MD5_SHIFTS[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+    inline constexpr uint32_t MD5_CONSTANTS[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+}
+
+// Incremental MD5, as used for the checksum trailer of Samsung .tar.md5
+// firmware packages.
+class Md5 {
+public:
+    using Digest = std::array<uint8_t, 16>;
+
+    void update(ByteSpan data) {
+        const uint8_t* in = data.data();
+        size_t size = data.size();
+        size_t buffered = static_cast<size_t>(length_ % 64);
+        length_ += size;
+
+        if (buffered != 0) {
+            size_t take = std::min(size, 64 - buffered);
+            std::memcpy(buffer_ + buffered, in, take);
+            in += take;
+            size -= take;
+            if (buffered + take < 64) {
+                return;
+            }
+            transform(buffer_);
+        }
+        for (; size >= 64; in += 64, size -= 64) {
+            transform(in);
+        }
+        std::memcpy(buffer_, in, size);
+    }
+
+    // Digest of everything so far; the hash can't be updated afterwards
+    Digest digest() {
+        uint64_t bit_length = length_ * 8;
+        uint8_t padding[72] = {0x80};
+        size_t pad = 64 - static_cast<size_t>((length_ + 8) % 64);
+        for (int i = 0; i < 8; ++i) {
+            padding[pad + i] = static_cast<uint8_t>(bit_length >> (8 * i));
+        }
+        update(ByteSpan(padding, pad + 8));
+
+        Digest out;
+        for (size_t i = 0; i < 4; ++i) {
+            for (size_t b = 0; b < 4; ++b) {
+                out[4 * i + b] = static_cast<uint8_t>(state_[i] >> (8 * b));
+            }
+        }
+        return out;
+    }
+
+    static std::string to_hex(const Digest& digest) {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        for (uint8_t byte : digest) {
+            hex += digits[byte >> 4];
+            hex += digits[byte & 0x0F];
+        }
+        return hex;
+    }
+
+    static Digest compute(ByteSpan data) {
+        Md5 md5;
+        md5.update(data);
+        return md5.digest();
+    }
+
+private:
+    static uint32_t rotate_left(uint32_t value, uint32_t bits) {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    void transform(const uint8_t* block) {
+        uint32_t words[16];
+        for (size_t i = 0; i < 16; ++i) {
+            words[i] = uint32_t(block[4 * i]) | uint32_t(block[4 * i + 1]) << 8 |
+                       uint32_t(block[4 * i + 2]) << 16 | uint32_t(block[4 * i + 3]) << 24;
+        }
+
+        uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        for (uint32_t i = 0; i < 64; ++i) {
+            uint32_t f;
+            uint32_t g;
+            if (i < 16) {
+                f = (b & c) | (~b & d);
+                g = i;
+            } else if (i < 32) {
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+            } else if (i < 48) {
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+            } else {
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+            }
+            uint32_t rotated = rotate_left(a + f + detail::MD5_CONSTANTS[i] + words[g], detail::MD5_SHIFTS[i]);
+            a = d;
+            d = c;
+            c = b;
+            b += rotated;
+        }
+        state_[0] += a;
+        state_[1] += b;
+        state_[2] += c;
+        state_[3] += d;
+    }
+
+    uint32_t state_[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    uint64_t length_ = 0;
+    uint8_t buffer_[64] = {};
+};
+
+} // namespace SamFlash
+
+#endif // MD5_H
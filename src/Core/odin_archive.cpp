@@ -0,0 +1,338 @@
+#include "odin_archive.h"
+#include "md5.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace SamFlash {
+
+namespace {
+    constexpr size_t TAR_NAME_OFFSET = 0;
+    constexpr size_t TAR_NAME_SIZE = 100;
+    constexpr size_t TAR_SIZE_OFFSET = 124;
+    constexpr size_t TAR_SIZE_FIELD = 12;
+    constexpr size_t TAR_CHECKSUM_OFFSET = 148;
+    constexpr size_t TAR_CHECKSUM_FIELD = 8;
+    constexpr size_t TAR_TYPE_OFFSET = 156;
+    constexpr size_t TAR_MAGIC_OFFSET = 257;
+    constexpr size_t TAR_PREFIX_OFFSET = 345;
+    constexpr size_t TAR_PREFIX_SIZE = 155;
+    constexpr size_t MD5_HEX_LENGTH = 32;
+
+    std::string field_string(const uint8_t* field, size_t width) {
+        const void* end = std::memchr(field, 0, width);
+        size_t length = end ? static_cast<const uint8_t*>(end) - field : width;
+        return std::string(reinterpret_cast<const char*>(field), length);
+    }
+
+    // Octal ASCII, or GNU base-256 when the top bit of the first byte is
+    // set (sizes of 8 GB and up)
+    bool parse_number(const uint8_t* field, size_t width, uint64_t& value) {
+        value = 0;
+        if (field[0] & 0x80) {
+            value = field[0] & 0x7F;
+            for (size_t i = 1; i < width; ++i) {
+                value = (value << 8) | field[i];
+            }
+            return true;
+        }
+        size_t i = 0;
+        while (i < width && field[i] == ' ') {
+            ++i;
+        }
+        bool digits = false;
+        for (; i < width && field[i] >= '0' && field[i] <= '7'; ++i) {
+            value = value * 8 + (field[i] - '0');
+            digits = true;
+        }
+        return digits && (i == width || field[i] == ' ' || field[i] == 0);
+    }
+
+    bool checksum_matches(const uint8_t* header) {
+        uint64_t stored = 0;
+        if (!parse_number(header + TAR_CHECKSUM_OFFSET, TAR_CHECKSUM_FIELD, stored)) {
+            return false;
+        }
+        // The checksum field itself counts as spaces
+        uint64_t sum = 0;
+        for (size_t i = 0; i < TAR_BLOCK_SIZE; ++i) {
+            bool in_field = i >= TAR_CHECKSUM_OFFSET && i < TAR_CHECKSUM_OFFSET + TAR_CHECKSUM_FIELD;
+            sum += in_field ? ' ' : header[i];
+        }
+        return sum == stored;
+    }
+
+    uint64_t round_to_block(uint64_t size) {
+        return (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+    }
+}
+
+bool OdinArchive::is_archive(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    uint8_t header[TAR_BLOCK_SIZE];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+        return false;
+    }
+    return std::memcmp(header + TAR_MAGIC_OFFSET, "ustar", 5) == 0 && checksum_matches(header);
+}
+
+bool OdinArchive::open(const std::string& path) {
+    close();
+    last_error_.clear();
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) {
+        last_error_ = "Failed to open archive: " + path;
+        return false;
+    }
+    path_ = path;
+
+    file_.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(file_.tellg());
+    if (!read_trailer(file_size)) {
+        close();
+        return false;
+    }
+
+    // Walk the headers only, seeking over member data
+    uint8_t header[TAR_BLOCK_SIZE];
+    std::string long_name;
+    uint64_t offset = 0;
+    while (offset + TAR_BLOCK_SIZE <= tar_size_) {
+        if (!read_header(offset, header)) {
+            close();
+            return false;
+        }
+        if (std::all_of(header, header + TAR_BLOCK_SIZE, [](uint8_t b) { return b == 0; })) {
+            break; // end-of-archive marker
+        }
+        uint64_t size = 0;
+        if (!checksum_matches(header) || !parse_number(header + TAR_SIZE_OFFSET, TAR_SIZE_FIELD, size)) {
+            last_error_ = "Corrupt tar header at offset " + std::to_string(offset);
+            close();
+            return false;
+        }
+        uint64_t data_offset = offset + TAR_BLOCK_SIZE;
+        if (size > tar_size_ - data_offset) {
+            last_error_ = "Archive is truncated at offset " + std::to_string(offset);
+            close();
+            return false;
+        }
+
+        char type = static_cast<char>(header[TAR_TYPE_OFFSET]);
+        if (type == 'L') {
+            // GNU long name for the next member
+            long_name.assign(static_cast<size_t>(size), '\0');
+            file_.seekg(static_cast<std::streamoff>(data_offset));
+            if (!file_.read(&long_name[0], static_cast<std::streamsize>(size))) {
+                last_error_ = "Failed to read archive: " + path;
+                close();
+                return false;
+            }
+            long_name = long_name.c_str();
+        } else if (type == '0' || type == '\0' || type == '7') {
+            ArchiveMember member;
+            if (!long_name.empty()) {
+                member.name.swap(long_name);
+            } else {
+                member.name = field_string(header + TAR_NAME_OFFSET, TAR_NAME_SIZE);
+                std::string prefix = field_string(header + TAR_PREFIX_OFFSET, TAR_PREFIX_SIZE);
+                if (std::memcmp(header + TAR_MAGIC_OFFSET, "ustar", 5) == 0 && !prefix.empty()) {
+                    member.name = prefix + "/" + member.name;
+                }
+            }
+            member.data_offset = data_offset;
+            member.size = size;
+            members_.push_back(std::move(member));
+        } else {
+            long_name.clear(); // directories, links and pax headers carry no image data
+        }
+        offset = data_offset + round_to_block(size);
+    }
+    return true;
+}
+
+void OdinArchive::close() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+    file_.clear();
+    path_.clear();
+    members_.clear();
+    tar_size_ = 0;
+    expected_md5_.clear();
+    position_ = 0;
+    member_index_ = 0;
+    member_offset_ = 0;
+}
+
+uint64_t OdinArchive::data_size() const {
+    uint64_t total = 0;
+    for (const auto& member : members_) {
+        total += member.size;
+    }
+    return total;
+}
+
+bool OdinArchive::stream(size_t chunk_size, const MemberFn& on_member, const DataFn& on_data) {
+    if (!rewind()) {
+        return false;
+    }
+    std::vector<uint8_t> buffer(std::max(chunk_size, TAR_BLOCK_SIZE));
+    ArchivePiece piece;
+    while (read_next(MutableByteSpan(buffer.data(), buffer.size()), piece)) {
+        const ArchiveMember& member = members_[piece.member];
+        if (piece.offset == 0 && on_member && !on_member(member)) {
+            last_error_ = "Stopped at " + member.name;
+            return false;
+        }
+        if (on_data && !on_data(member, piece.offset, ByteSpan(buffer.data(), piece.size))) {
+            last_error_ = "Stopped in " + member.name + " at offset " + std::to_string(piece.offset);
+            return false;
+        }
+    }
+    return at_end();
+}
+
+bool OdinArchive::rewind() {
+    if (!file_.is_open()) {
+        last_error_ = "Archive not open";
+        return false;
+    }
+    file_.clear();
+    file_.seekg(0);
+    md5_ = Md5();
+    md5_checked_ = false;
+    position_ = 0;
+    member_index_ = 0;
+    member_offset_ = 0;
+    last_error_.clear();
+    return true;
+}
+
+bool OdinArchive::read_next(MutableByteSpan buffer, ArchivePiece& piece) {
+    if (!last_error_.empty() || buffer.empty()) {
+        return false;
+    }
+    while (member_index_ < members_.size() && member_offset_ == members_[member_index_].size) {
+        ++member_index_;
+        member_offset_ = 0;
+    }
+    if (member_index_ == members_.size()) {
+        // Hash the end-of-archive blocks and compare, once
+        if (has_md5() && !md5_checked_) {
+            md5_checked_ = true;
+            if (!read_to(tar_size_, buffer)) {
+                return false;
+            }
+            std::string actual = Md5::to_hex(md5_.digest());
+            if (actual != expected_md5_) {
+                last_error_ = "MD5 mismatch: archive has " + actual + ", trailer says " + expected_md5_;
+            }
+        }
+        return false;
+    }
+
+    const ArchiveMember& member = members_[member_index_];
+    if (!read_to(member.data_offset + member_offset_, buffer)) {
+        return false;
+    }
+    size_t size = static_cast<size_t>(std::min<uint64_t>(buffer.size(), member.size - member_offset_));
+    if (!read_hashed(buffer.data(), size)) {
+        return false;
+    }
+    piece.member = member_index_;
+    piece.offset = member_offset_;
+    piece.size = size;
+    member_offset_ += size;
+    return true;
+}
+
+size_t OdinArchive::peek(const ArchiveMember& member, MutableByteSpan buffer) {
+    size_t size = static_cast<size_t>(std::min<uint64_t>(buffer.size(), member.size));
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(member.data_offset));
+    if (!file_.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(size))) {
+        last_error_ = "Failed to read archive: " + path_;
+        return 0;
+    }
+    return size;
+}
+
+bool OdinArchive::read_hashed(uint8_t* out, size_t size) {
+    if (!file_.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(size))) {
+        last_error_ = "Failed to read archive: " + path_;
+        return false;
+    }
+    if (has_md5()) {
+        md5_.update(ByteSpan(out, size));
+    }
+    position_ += size;
+    return true;
+}
+
+bool OdinArchive::read_to(uint64_t offset, MutableByteSpan scratch) {
+    // Headers and padding are read rather than seeked over so the MD5
+    // sees every byte
+    while (position_ < offset) {
+        if (!read_hashed(scratch.data(), static_cast<size_t>(std::min<uint64_t>(scratch.size(), offset - position_)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OdinArchive::read_header(uint64_t offset, uint8_t* header) {
+    file_.seekg(static_cast<std::streamoff>(offset));
+    if (!file_.read(reinterpret_cast<char*>(header), TAR_BLOCK_SIZE)) {
+        last_error_ = "Failed to read archive: " + path_;
+        return false;
+    }
+    return true;
+}
+
+bool OdinArchive::read_trailer(uint64_t file_size) {
+    // A tar is whole blocks, so anything past the last one is the MD5 line
+    uint64_t trailer_size = file_size % TAR_BLOCK_SIZE;
+    tar_size_ = file_size - trailer_size;
+    if (trailer_size == 0) {
+        return true;
+    }
+
+    std::string trailer(static_cast<size_t>(trailer_size), '\0');
+    file_.seekg(static_cast<std::streamoff>(tar_size_));
+    if (!file_.read(&trailer[0], static_cast<std::streamsize>(trailer_size))) {
+        last_error_ = "Failed to read archive: " + path_;
+        return false;
+    }
+    bool hex = trailer.size() > MD5_HEX_LENGTH &&
+               std::all_of(trailer.begin(), trailer.begin() + MD5_HEX_LENGTH,
+                           [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; }) &&
+               trailer[MD5_HEX_LENGTH] == ' ';
+    if (!hex) {
+        last_error_ = "Archive ends in a partial block that is not an MD5 trailer";
+        return false;
+    }
+    expected_md5_ = trailer.substr(0, MD5_HEX_LENGTH);
+    std::transform(expected_md5_.begin(), expected_md5_.end(), expected_md5_.begin(),
+                   [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return true;
+}
+
+bool is_lz4_member(std::string_view member_name) {
+    return member_name.size() > 4 && member_name.substr(member_name.size() - 4) == ".lz4";
+}
+
+std::optional<PitEntryView> find_partition_for_member(const PitTable& pit, std::string_view member_name) {
+    std::string_view base = member_name.substr(member_name.find_last_of('/') + 1);
+    if (is_lz4_member(base)) {
+        base.remove_suffix(4);
+    }
+    for (size_t i = 0; i < pit.size(); ++i) {
+        if (!pit[i].flash_filename().empty() && pit[i].flash_filename() == base) {
+            return pit[i];
+        }
+    }
+    return pit.find_ignoring_case(base.substr(0, base.find('.')));
+}
+
+} // namespace SamFlash
@@ -0,0 +1,106 @@
+#ifndef ODIN_ARCHIVE_H
+#define ODIN_ARCHIVE_H
+
+#include "byte_span.h"
+#include "md5.h"
+#include "pit_parser.h"
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SamFlash {
+
+constexpr size_t TAR_BLOCK_SIZE = 512;
+
+// Regular file inside a firmware archive
+struct ArchiveMember {
+    std::string name;
+    uint64_t data_offset = 0; // first data byte within the archive file
+    uint64_t size = 0;
+};
+
+// Where read_next() put a piece of member data
+struct ArchivePiece {
+    size_t member = 0;   // index into members()
+    uint64_t offset = 0; // within the member
+    size_t size = 0;
+};
+
+// Samsung firmware package (BL/AP/CP/CSC): a plain tar, optionally with
+// the MD5 of the tar appended as a "<hex>  <name>\n" line (.tar.md5).
+// open() reads just the member headers; stream() then reads the archive
+// once, front to back, handing out member data and checking the MD5 on
+// the way instead of in a separate pass.
+class OdinArchive {
+public:
+    // Called before a member's first data; return false to abort
+    using MemberFn = std::function<bool(const ArchiveMember& member)>;
+    // Called with consecutive pieces of the member's data
+    using DataFn = std::function<bool(const ArchiveMember& member, uint64_t offset, ByteSpan data)>;
+
+    // True when the file starts with a ustar header
+    static bool is_archive(const std::string& path);
+
+    bool open(const std::string& path);
+    void close();
+
+    const std::vector<ArchiveMember>& members() const { return members_; }
+    const std::string& path() const { return path_; }
+    bool has_md5() const { return !expected_md5_.empty(); }
+    uint64_t data_size() const; // sum of member sizes
+
+    // Pieces are chunk_size bytes except for the last of each member. A
+    // .tar.md5 whose checksum doesn't match fails after the last member.
+    bool stream(size_t chunk_size, const MemberFn& on_member, const DataFn& on_data);
+
+    // Pull-style reading for callers that bring their own buffers: after
+    // rewind(), each read_next() fills buffer with the next piece of member
+    // data. It returns false at the end or on an error, which at_end()
+    // tells apart; the MD5 is checked on the way to the end.
+    bool rewind();
+    bool read_next(MutableByteSpan buffer, ArchivePiece& piece);
+    bool at_end() const { return member_index_ == members_.size() && last_error_.empty(); }
+
+    // First bytes of a member, e.g. to read a compressed image's header.
+    // Returns the number read, 0 on an error. Moves the read position, so
+    // call it before rewind().
+    size_t peek(const ArchiveMember& member, MutableByteSpan buffer);
+
+    std::string get_last_error() const { return last_error_; }
+
+private:
+    bool read_header(uint64_t offset, uint8_t* header);
+    bool read_trailer(uint64_t file_size);
+    bool read_hashed(uint8_t* out, size_t size);
+    bool read_to(uint64_t offset, MutableByteSpan scratch);
+
+    std::ifstream file_;
+    std::string path_;
+    std::vector<ArchiveMember> members_;
+    uint64_t tar_size_ = 0;     // bytes covered by the MD5
+    std::string expected_md5_;  // lowercase hex; empty for a plain tar
+
+    // Read position for read_next()
+    Md5 md5_;
+    bool md5_checked_ = false;
+    uint64_t position_ = 0;
+    size_t member_index_ = 0;
+    uint64_t member_offset_ = 0;
+    std::string last_error_;
+};
+
+// True for LZ4-compressed members (boot.img.lz4)
+bool is_lz4_member(std::string_view member_name);
+
+// PIT partition a member is flashed to: the entry whose flash filename
+// matches the member name less any .lz4 suffix, else one whose partition
+// name matches the member's base name up to the first dot, ignoring case
+std::optional<PitEntryView> find_partition_for_member(const PitTable& pit, std::string_view member_name);
+
+} // namespace SamFlash
+
+#endif // ODIN_ARCHIVE_H
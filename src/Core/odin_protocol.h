@@ -0,0 +1,120 @@
+#ifndef ODIN_PROTOCOL_H
+#define ODIN_PROTOCOL_H
+
+#include "byte_order.h"
+#include "byte_span.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace SamFlash {
+
+// Odin is the download-mode protocol of Samsung bootloaders. After the
+// "ODIN"/"LOKE" handshake every host request is a fixed-size control packet
+// of little-endian words (type, request, arguments) and the device answers
+// each with an 8-byte response (type, value). File data travels as raw
+// packets of the negotiated part size between FILE_PART requests.
+
+struct SamsungHandshake {
+    static const uint32_t SESSION_BEGIN = 0x64;
+    static const uint32_t PIT_FILE = 0x65;
+    static const uint32_t FILE_PART = 0x66;
+    static const uint32_t SESSION_END = 0x67;
+};
+
+// Requests within each packet type
+struct OdinSessionRequest {
+    static const uint32_t BEGIN = 0;          // response value: protocol version
+    static const uint32_t DEVICE_TYPE = 1;
+    static const uint32_t TOTAL_BYTES = 2;    // args: low word, high word
+    static const uint32_t FILE_PART_SIZE = 5; // arg: part size in bytes
+};
+
+struct OdinTransferRequest {
+    static const uint32_t FLASH = 0; // FILE_PART arg: sequence bytes
+    static const uint32_t DUMP = 1;  // PIT_FILE response value: PIT size
+    static const uint32_t PART = 2;  // PIT_FILE arg: part index
+    static const uint32_t END = 3;   // FILE_PART args: see OdinFileEnd
+};
+
+struct OdinEndRequest {
+    static const uint32_t END = 0;
+    static const uint32_t REBOOT = 1;
+};
+
+// Argument slots of a FILE_PART END packet
+struct OdinFileEnd {
+    static const size_t DESTINATION = 0; // 0 phone, 1 modem
+    static const size_t SEQUENCE_BYTES = 1;
+    static const size_t DEVICE_TYPE = 3;
+    static const size_t IDENTIFIER = 4;  // PIT partition identifier
+    static const size_t LAST_SEQUENCE = 5;
+};
+
+constexpr char ODIN_HANDSHAKE[] = "ODIN";
+constexpr char ODIN_HANDSHAKE_REPLY[] = "LOKE";
+constexpr size_t ODIN_HANDSHAKE_LENGTH = 4;
+constexpr size_t ODIN_CONTROL_PACKET_SIZE = 1024;
+constexpr size_t ODIN_RESPONSE_SIZE = 8;
+constexpr size_t ODIN_PIT_PART_SIZE = 500;
+// Response type a device uses to reject a request
+constexpr uint32_t ODIN_RESPONSE_FAIL = 0xFFFFFFFF;
+
+// One host request, zero padded to the full packet size
+class OdinControlPacket {
+public:
+    static constexpr size_t MAX_ARGUMENTS = ODIN_CONTROL_PACKET_SIZE / 4 - 2;
+
+    constexpr OdinControlPacket() = default;
+    constexpr OdinControlPacket(uint32_t type, uint32_t request) {
+        write_le32(type, bytes_.data());
+        write_le32(request, bytes_.data() + 4);
+    }
+
+    // Decode a received packet; data must hold ODIN_CONTROL_PACKET_SIZE bytes
+    static OdinControlPacket from_bytes(const uint8_t* data) {
+        OdinControlPacket packet;
+        for (size_t i = 0; i < ODIN_CONTROL_PACKET_SIZE; ++i) {
+            packet.bytes_[i] = data[i];
+        }
+        return packet;
+    }
+
+    constexpr OdinControlPacket& set_argument(size_t index, uint32_t value) {
+        write_le32(value, bytes_.data() + 8 + 4 * index);
+        return *this;
+    }
+
+    constexpr uint32_t type() const { return read_le32(bytes_.data()); }
+    constexpr uint32_t request() const { return read_le32(bytes_.data() + 4); }
+    constexpr uint32_t argument(size_t index) const { return read_le32(bytes_.data() + 8 + 4 * index); }
+
+    constexpr const uint8_t* data() const { return bytes_.data(); }
+    constexpr size_t size() const { return bytes_.size(); }
+    constexpr ByteSpan span() const { return ByteSpan(bytes_.data(), bytes_.size()); }
+    constexpr operator ByteSpan() const { return span(); }
+
+private:
+    std::array<uint8_t, ODIN_CONTROL_PACKET_SIZE> bytes_{};
+};
+
+struct OdinResponse {
+    uint32_t type = 0;
+    uint32_t value = 0;
+
+    std::array<uint8_t, ODIN_RESPONSE_SIZE> encode() const {
+        std::array<uint8_t, ODIN_RESPONSE_SIZE> bytes{};
+        write_le32(type, bytes.data());
+        write_le32(value, bytes.data() + 4);
+        return bytes;
+    }
+
+    // data must hold ODIN_RESPONSE_SIZE bytes
+    static OdinResponse decode(const uint8_t* data) {
+        return OdinResponse{read_le32(data), read_le32(data + 4)};
+    }
+};
+
+} // namespace SamFlash
+
+#endif // ODIN_PROTOCOL_H
@@ -0,0 +1,122 @@
+#include "pit_parser.h"
+#include "odin_protocol.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace SamFlash {
+
+namespace {
+    // Nine integer fields precede the three names
+    constexpr size_t PIT_NAMES_OFFSET = 9 * 4;
+}
+
+uint32_t PitEntryView::field(size_t index) const {
+    return read_le32(record_ + 4 * index);
+}
+
+std::string_view PitEntryView::name(size_t index) const {
+    const char* text = reinterpret_cast<const char*>(record_ + PIT_NAMES_OFFSET + index * PIT_NAME_SIZE);
+    // Names fill their field when they're exactly 32 characters long
+    const void* end = std::memchr(text, '\0', PIT_NAME_SIZE);
+    return std::string_view(text, end ? static_cast<const char*>(end) - text : PIT_NAME_SIZE);
+}
+
+PITEntry PitEntryView::to_entry() const {
+    PITEntry entry;
+    entry.binary_type = binary_type();
+    entry.device_type = device_type();
+    entry.identifier = identifier();
+    entry.attributes = attributes();
+    entry.update_attributes = update_attributes();
+    entry.block_size_or_offset = block_size_or_offset();
+    entry.block_count_or_size = block_count_or_size();
+    entry.file_offset = file_offset();
+    entry.file_size = file_size();
+    entry.partition_name = std::string(partition_name());
+    entry.flash_filename = std::string(flash_filename());
+    entry.fota_filename = std::string(fota_filename());
+    return entry;
+}
+
+bool PitTable::parse(ByteSpan data) {
+    clear();
+
+    if (data.size() < PIT_HEADER_SIZE) {
+        last_error_ = "PIT is shorter than its header (" + std::to_string(data.size()) + " bytes)";
+        return false;
+    }
+    if (read_le32(data.data()) != PIT_MAGIC) {
+        last_error_ = "Not a PIT: bad magic";
+        return false;
+    }
+
+    uint32_t count = read_le32(data.data() + 4);
+    if (count > PIT_MAX_ENTRIES) {
+        last_error_ = "PIT claims " + std::to_string(count) + " entries";
+        return false;
+    }
+    if (data.size() < PIT_HEADER_SIZE + size_t(count) * PIT_ENTRY_SIZE) {
+        last_error_ = "PIT is truncated: " + std::to_string(count) + " entries need " +
+                      std::to_string(PIT_HEADER_SIZE + size_t(count) * PIT_ENTRY_SIZE) + " bytes, got " +
+                      std::to_string(data.size());
+        return false;
+    }
+
+    data_ = data;
+    count_ = count;
+    return true;
+}
+
+void PitTable::clear() {
+    data_ = ByteSpan();
+    count_ = 0;
+    last_error_.clear();
+}
+
+std::optional<PitEntryView> PitTable::find(std::string_view partition_name) const {
+    for (size_t i = 0; i < count_; ++i) {
+        PitEntryView entry = (*this)[i];
+        if (entry.partition_name() == partition_name) {
+            return entry;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<PitEntryView> PitTable::find(uint32_t identifier) const {
+    for (size_t i = 0; i < count_; ++i) {
+        PitEntryView entry = (*this)[i];
+        if (entry.identifier() == identifier) {
+            return entry;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<PitEntryView> PitTable::find_ignoring_case(std::string_view partition_name) const {
+    for (size_t i = 0; i < count_; ++i) {
+        PitEntryView entry = (*this)[i];
+        if (partition_names_equal(entry.partition_name(), partition_name)) {
+            return entry;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<PITEntry> PitTable::to_entries() const {
+    std::vector<PITEntry> entries;
+    entries.reserve(count_);
+    for (size_t i = 0; i < count_; ++i) {
+        entries.push_back((*this)[i].to_entry());
+    }
+    return entries;
+}
+
+bool partition_names_equal(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+} // namespace SamFlash
@@ -0,0 +1,99 @@
+#ifndef PIT_PARSER_H
+#define PIT_PARSER_H
+
+#include "byte_span.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SamFlash {
+
+// PIT (Partition Information Table) layout: a 28-byte header holding the
+// magic and entry count, then one fixed 132-byte record per partition.
+// All integers are little-endian; names are NUL-padded 32-byte fields.
+constexpr uint32_t PIT_MAGIC = 0x12349876;
+constexpr size_t PIT_HEADER_SIZE = 28;
+constexpr size_t PIT_ENTRY_SIZE = 132;
+constexpr size_t PIT_NAME_SIZE = 32;
+// More entries than any shipping device has; guards against garbage counts
+constexpr uint32_t PIT_MAX_ENTRIES = 512;
+
+struct PITEntry {
+    uint32_t binary_type;
+    uint32_t device_type;
+    uint32_t identifier;
+    uint32_t attributes;
+    uint32_t update_attributes;
+    uint32_t block_size_or_offset;
+    uint32_t block_count_or_size;
+    uint32_t file_offset;
+    uint32_t file_size;
+    std::string partition_name;
+    std::string flash_filename;
+    std::string fota_filename;
+};
+
+// One PIT record read in place; valid as long as the PIT buffer is
+class PitEntryView {
+public:
+    explicit PitEntryView(const uint8_t* record) : record_(record) {}
+
+    uint32_t binary_type() const { return field(0); }
+    uint32_t device_type() const { return field(1); }
+    uint32_t identifier() const { return field(2); }
+    uint32_t attributes() const { return field(3); }
+    uint32_t update_attributes() const { return field(4); }
+    uint32_t block_size_or_offset() const { return field(5); }
+    uint32_t block_count_or_size() const { return field(6); }
+    uint32_t file_offset() const { return field(7); }
+    uint32_t file_size() const { return field(8); }
+
+    std::string_view partition_name() const { return name(0); }
+    std::string_view flash_filename() const { return name(1); }
+    std::string_view fota_filename() const { return name(2); }
+
+    // Owned copy, for callers that outlive the PIT buffer
+    PITEntry to_entry() const;
+
+private:
+    uint32_t field(size_t index) const;
+    std::string_view name(size_t index) const;
+
+    const uint8_t* record_;
+};
+
+// Validated index over a received PIT. Nothing is copied; the buffer
+// passed to parse() must stay alive and unchanged while the table is used.
+class PitTable {
+public:
+    bool parse(ByteSpan data);
+    void clear();
+
+    bool empty() const { return count_ == 0; }
+    size_t size() const { return count_; }
+    PitEntryView operator[](size_t index) const {
+        return PitEntryView(data_.data() + PIT_HEADER_SIZE + index * PIT_ENTRY_SIZE);
+    }
+
+    std::optional<PitEntryView> find(std::string_view partition_name) const;
+    std::optional<PitEntryView> find(uint32_t identifier) const;
+    // Names as users type them: "boot" finds the BOOT partition
+    std::optional<PitEntryView> find_ignoring_case(std::string_view partition_name) const;
+
+    std::vector<PITEntry> to_entries() const;
+
+    std::string get_last_error() const { return last_error_; }
+
+private:
+    ByteSpan data_;
+    size_t count_ = 0;
+    std::string last_error_;
+};
+
+bool partition_names_equal(std::string_view a, std::string_view b); // ASCII, ignoring case
+
+} // namespace SamFlash
+
+#endif // PIT_PARSER_H
@@ -0,0 +1,103 @@
+#ifndef RESPONSE_FRAMER_H
+#define RESPONSE_FRAMER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SamFlash {
+
+// Incremental response framer. Bytes are fed as they arrive; the framer
+// consumes only what belongs to the current frame so anything after it
+// stays buffered for the next response.
+class IResponseFramer {
+public:
+    virtual ~IResponseFramer() = default;
+
+    // Returns the number of bytes consumed from data
+    virtual size_t consume(const uint8_t* data, size_t size) = 0;
+    virtual bool is_complete() const = 0;
+    virtual void reset() = 0;
+
+    const std::vector<uint8_t>& frame() const { return frame_; }
+    std::vector<uint8_t> take_frame() {
+        std::vector<uint8_t> result;
+        result.swap(frame_);
+        reset();
+        return result;
+    }
+
+protected:
+    std::vector<uint8_t> frame_;
+};
+
+// Frame terminated by a delimiter, e.g. the SAM-BA "\n\r>" prompt.
+// The delimiter is included in the frame.
+class DelimiterFramer : public IResponseFramer {
+public:
+    explicit DelimiterFramer(std::string delimiter, size_t max_frame_size = 64 * 1024)
+        : delimiter_(std::move(delimiter)), max_frame_size_(max_frame_size), complete_(false) {}
+
+    size_t consume(const uint8_t* data, size_t size) override {
+        size_t consumed = 0;
+        while (consumed < size && !complete_) {
+            frame_.push_back(data[consumed++]);
+            // Only the tail can newly match, so compare just that
+            if (frame_.size() >= delimiter_.size() &&
+                std::equal(delimiter_.begin(), delimiter_.end(), frame_.end() - delimiter_.size())) {
+                complete_ = true;
+            } else if (frame_.size() >= max_frame_size_) {
+                complete_ = true; // runaway response; hand back what we have
+                overflow_ = true;
+            }
+        }
+        return consumed;
+    }
+
+    bool is_complete() const override { return complete_; }
+    bool overflowed() const { return overflow_; }
+
+    void reset() override {
+        frame_.clear();
+        complete_ = false;
+        overflow_ = false;
+    }
+
+private:
+    std::string delimiter_;
+    size_t max_frame_size_;
+    bool complete_;
+    bool overflow_ = false;
+};
+
+// Frame of a known length, e.g. Odin response packets or raw SAM-BA reads.
+class FixedSizeFramer : public IResponseFramer {
+public:
+    explicit FixedSizeFramer(size_t frame_size) : frame_size_(frame_size) {
+        frame_.reserve(frame_size_);
+    }
+
+    size_t consume(const uint8_t* data, size_t size) override {
+        size_t wanted = std::min(size, frame_size_ - frame_.size());
+        frame_.insert(frame_.end(), data, data + wanted);
+        return wanted;
+    }
+
+    bool is_complete() const override { return frame_.size() == frame_size_; }
+
+    void reset() override {
+        frame_.clear();
+        frame_.reserve(frame_size_);
+    }
+
+    size_t frame_size() const { return frame_size_; }
+
+private:
+    size_t frame_size_;
+};
+
+} // namespace SamFlash
+
+#endif // RESPONSE_FRAMER_H
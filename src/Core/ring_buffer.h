@@ -0,0 +1,112 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+
+namespace SamFlash {
+
+// Lock-free single-producer/single-consumer byte ring. One thread may call
+// write(); one (other) thread may call peek()/skip()/read(). Capacity is
+// rounded up to a power of two so indices wrap with a mask.
+class SpscByteRing {
+public:
+    explicit SpscByteRing(size_t capacity)
+        : capacity_(round_up_pow2(capacity)),
+          mask_(capacity_ - 1),
+          buffer_(new uint8_t[capacity_]),
+          head_(0),
+          tail_(0) {}
+
+    SpscByteRing(const SpscByteRing&) = delete;
+    SpscByteRing& operator=(const SpscByteRing&) = delete;
+
+    size_t capacity() const { return capacity_; }
+
+    // Bytes ready for the consumer
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    size_t free_space() const {
+        return capacity_ - size();
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Producer side. Returns the number of bytes stored (may be short when full).
+    size_t write(const uint8_t* data, size_t count) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        count = std::min(count, capacity_ - (head - tail));
+        copy_in(head, data, count);
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side. Copies up to count bytes without consuming them.
+    size_t peek(uint8_t* out, size_t count) const {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        count = std::min(count, head - tail);
+        copy_out(tail, out, count);
+        return count;
+    }
+
+    // Consumer side. Drops up to count bytes.
+    size_t skip(size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        count = std::min(count, head - tail);
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t read(uint8_t* out, size_t count) {
+        count = peek(out, count);
+        return skip(count);
+    }
+
+    // Consumer side. Drops everything currently buffered.
+    void clear() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    void copy_in(size_t position, const uint8_t* data, size_t count) {
+        const size_t offset = position & mask_;
+        const size_t first = std::min(count, capacity_ - offset);
+        std::memcpy(buffer_.get() + offset, data, first);
+        std::memcpy(buffer_.get(), data + first, count - first);
+    }
+
+    void copy_out(size_t position, uint8_t* out, size_t count) const {
+        const size_t offset = position & mask_;
+        const size_t first = std::min(count, capacity_ - offset);
+        std::memcpy(out, buffer_.get() + offset, first);
+        std::memcpy(out + first, buffer_.get(), count - first);
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<uint8_t[]> buffer_;
+    // Monotonic counters; producer owns head_, consumer owns tail_
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+} // namespace SamFlash
+
+#endif // RING_BUFFER_H
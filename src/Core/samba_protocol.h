@@ -0,0 +1,102 @@
+#ifndef SAMBA_PROTOCOL_H
+#define SAMBA_PROTOCOL_H
+
+#include "byte_span.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace SamFlash {
+
+namespace detail {
+    // Two upper-case hex digits for every byte value, so a 32-bit field is
+    // four lookups instead of eight nibble conversions
+    constexpr std::array<std::array<uint8_t, 2>, 256> make_hex_pair_table() {
+        constexpr char digits[] = "0123456789ABCDEF";
+        std::array<std::array<uint8_t, 2>, 256> table{};
+        for (size_t i = 0; i < 256; ++i) {
+            table[i][0] = static_cast<uint8_t>(digits[i >> 4]);
+            table[i][1] = static_cast<uint8_t>(digits[i & 0xF]);
+        }
+        return table;
+    }
+
+    inline constexpr std::array<std::array<uint8_t, 2>, 256> HEX_PAIR_TABLE = make_hex_pair_table();
+}
+
+// Width of every numeric SAM-BA command field
+constexpr size_t SAMBA_HEX_FIELD_LENGTH = 8;
+
+// Write value as eight upper-case hex digits at out; returns the end
+constexpr uint8_t* encode_hex32(uint32_t value, uint8_t* out) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        const auto& pair = detail::HEX_PAIR_TABLE[(value >> shift) & 0xFF];
+        *out++ = pair[0];
+        *out++ = pair[1];
+    }
+    return out;
+}
+
+// A SAM-BA monitor command ("R20004000,00000100#") encoded into a fixed
+// stack buffer. Several commands can be appended so they go out in a
+// single write; one that doesn't fit is dropped and marks the command as
+// overflowed.
+class SambaCommand {
+public:
+    // One full "X<addr>,<arg>#" command, and room for two
+    static constexpr size_t COMMAND_LENGTH = 1 + SAMBA_HEX_FIELD_LENGTH + 1 + SAMBA_HEX_FIELD_LENGTH + 1;
+    static constexpr size_t LITERAL_COMMAND_LENGTH = 1 + SAMBA_HEX_FIELD_LENGTH + 3;
+    static constexpr size_t CAPACITY = 2 * COMMAND_LENGTH;
+
+    constexpr SambaCommand() = default;
+    constexpr SambaCommand(char op, uint32_t address, uint32_t argument) {
+        append(op, address, argument);
+    }
+
+    // "<op><address>,<argument>#"
+    constexpr SambaCommand& append(char op, uint32_t address, uint32_t argument) {
+        if (CAPACITY - length_ < COMMAND_LENGTH) {
+            overflowed_ = true;
+            return *this;
+        }
+        uint8_t* out = bytes_.data() + length_;
+        *out++ = static_cast<uint8_t>(op);
+        out = encode_hex32(address, out);
+        *out++ = ',';
+        out = encode_hex32(argument, out);
+        *out++ = '#';
+        length_ = static_cast<size_t>(out - bytes_.data());
+        return *this;
+    }
+
+    // "<op><address>,<argument>#" with a single-character argument
+    constexpr SambaCommand& append_literal(char op, uint32_t address, char argument) {
+        if (CAPACITY - length_ < LITERAL_COMMAND_LENGTH) {
+            overflowed_ = true;
+            return *this;
+        }
+        uint8_t* out = bytes_.data() + length_;
+        *out++ = static_cast<uint8_t>(op);
+        out = encode_hex32(address, out);
+        *out++ = ',';
+        *out++ = static_cast<uint8_t>(argument);
+        *out++ = '#';
+        length_ = static_cast<size_t>(out - bytes_.data());
+        return *this;
+    }
+
+    constexpr const uint8_t* data() const { return bytes_.data(); }
+    constexpr size_t size() const { return length_; }
+    constexpr ByteSpan span() const { return ByteSpan(bytes_.data(), length_); }
+    constexpr operator ByteSpan() const { return span(); }
+    constexpr bool overflowed() const { return overflowed_; }
+
+private:
+    std::array<uint8_t, CAPACITY> bytes_{};
+    size_t length_ = 0;
+    bool overflowed_ = false;
+};
+
+} // namespace SamFlash
+
+#endif // SAMBA_PROTOCOL_H
@@ -0,0 +1,532 @@
+#include "samsung_flasher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace SamFlash {
+
+SamsungFlasher::SamsungFlasher()
+    : connected_(false), session_open_(false), total_bytes_sent_(false), protocol_version_(0), file_part_size_(LEGACY_FILE_PART_SIZE),
+      throughput_bps_(0.0), file_open_(false), file_identifier_(0), file_device_type_(0), file_size_(0), file_offset_(0),
+      progress_callback_(nullptr) {}
+
+SamsungFlasher::~SamsungFlasher() {
+    disconnect();
+}
+
+// Device discovery and connection
+std::vector<DeviceInfo> SamsungFlasher::discover_devices() {
+    std::cout << "Discovering Samsung Devices..." << std::endl;
+
+    std::vector<DeviceInfo> devices;
+    for (const auto& port : SerialTransport::enumerate_ports()) {
+        if (port.vendor_id != SAMSUNG_VENDOR_ID) {
+            continue;
+        }
+        DeviceInfo device;
+        device.id = port.port_name;
+        device.name = port.product.empty() ? "Samsung Device" : port.product;
+        device.manufacturer = "Samsung";
+        device.type = DeviceType::USB_SERIAL;
+        device.port_or_address = port.port_name;
+        device.vendor_id = port.vendor_id;
+        device.flash_size = 0;
+        device.page_size = 0;
+        device.is_connected = false;
+        devices.push_back(device);
+    }
+    return devices;
+}
+
+bool SamsungFlasher::connect(const std::string& device_id) {
+    std::cout << "Connecting to Samsung device: " << device_id << std::endl;
+    disconnect();
+
+    if (!transport_.open(device_id)) {
+        last_error_ = "Failed to open " + device_id + ": " + transport_.get_last_error();
+        return false;
+    }
+    transport_.clear_buffers();
+    port_ = device_id;
+    // Download mode has no command for it; the phone's USB serial is per unit
+    serial_number_ = transport_.get_port_info().serial_number;
+
+    if (!perform_handshake()) {
+        transport_.close();
+        return false;
+    }
+    connected_ = true;
+    return true;
+}
+
+bool SamsungFlasher::disconnect() {
+    if (!transport_.is_open()) {
+        connected_ = false;
+        return true;
+    }
+    std::cout << "Disconnecting Samsung device..." << std::endl;
+
+    bool result = !session_open_ || end_session(OdinEndRequest::END);
+    transport_.close();
+    connected_ = false;
+    session_open_ = false;
+    total_bytes_sent_ = false;
+    file_open_ = false;
+    pit_table_.clear();
+    pit_entries_.clear();
+    pit_data_.clear();
+    return result;
+}
+
+bool SamsungFlasher::is_connected() const {
+    return connected_;
+}
+
+// Device information
+DeviceInfo SamsungFlasher::get_device_info() const {
+    DeviceInfo info = {"samsung_01", "Samsung Device", "Samsung", DeviceType::USB_SERIAL, port_, 0, 0, connected_};
+    info.serial_number = serial_number_;
+    info.vendor_id = SAMSUNG_VENDOR_ID;
+    return info;
+}
+
+std::string SamsungFlasher::get_device_signature() {
+    return "samsung_signature";
+}
+
+// Flash operations
+bool SamsungFlasher::erase_chip() {
+    // Odin overwrites partitions in place; there is no separate erase
+    std::cout << "Erasing Samsung chip..." << std::endl;
+    return true;
+}
+
+bool SamsungFlasher::erase_page(uint32_t address) {
+    (void)address;
+    return true;
+}
+
+bool SamsungFlasher::write_page(uint32_t address, const std::vector<uint8_t>& data) {
+    return write_page(address, ByteSpan(data));
+}
+
+bool SamsungFlasher::write_page(uint32_t address, ByteSpan data) {
+    return write_pages(address, data);
+}
+
+bool SamsungFlasher::write_pages(uint32_t address, ByteSpan data, const WriteProgressFn& on_progress) {
+    return write_file(address, data, on_progress);
+}
+
+bool SamsungFlasher::write_file(uint64_t offset, ByteSpan data, const WriteProgressFn& on_progress) {
+    if (!connected_) {
+        last_error_ = "Device not connected";
+        return false;
+    }
+
+    if (!file_open_) {
+        last_error_ = "No partition selected for writing";
+        return false;
+    }
+    if (offset != file_offset_) {
+        last_error_ = "Odin writes are sequential: expected offset " + std::to_string(file_offset_) +
+                      ", got " + std::to_string(offset);
+        return false;
+    }
+    if (data.size() > file_size_ - file_offset_) {
+        last_error_ = "Write runs past the end of the file";
+        return false;
+    }
+
+    // Write data using Samsung protocol
+    return write_data_chunks(data, on_progress);
+}
+
+void SamsungFlasher::set_transfer_options(const TransferOptions& options) {
+    transfer_options_ = options;
+    // Part size is per session; agree on the new one unless a file is
+    // halfway through
+    if (connected_ && (!file_open_ || file_offset_ == 0 || file_offset_ == file_size_)) {
+        negotiate_file_part_size();
+    }
+}
+
+IDeviceInterface::TransferStats SamsungFlasher::get_transfer_stats() const {
+    TransferStats stats;
+    stats.chunk_size = file_part_size_;
+    stats.pipeline_depth = std::max<uint32_t>(1, transfer_options_.pipeline_depth);
+    stats.throughput_bps = throughput_bps_;
+    return stats;
+}
+
+std::vector<uint8_t> SamsungFlasher::read_page(uint32_t address, uint32_t size) {
+    (void)address;
+    (void)size;
+    return {};
+}
+
+bool SamsungFlasher::read_page(uint32_t address, MutableByteSpan buffer) {
+    (void)address;
+    (void)buffer;
+    return false;
+}
+
+bool SamsungFlasher::verify_flash(const std::vector<uint8_t>& expected_data, uint32_t start_address) {
+    return verify_flash(ByteSpan(expected_data), start_address);
+}
+
+bool SamsungFlasher::verify_flash(ByteSpan expected_data, uint32_t start_address) {
+    (void)expected_data;
+    (void)start_address;
+    std::cout << "Samsung: Starting flash verification..." << std::endl;
+
+    // Perform Samsung-specific final verification
+    return final_verification();
+}
+
+// Progress and status
+void SamsungFlasher::set_progress_callback(std::function<void(const FlashProgress&)> callback) {
+    progress_callback_ = callback;
+}
+
+FlashStatus SamsungFlasher::get_status() const {
+    return connected_ ? FlashStatus::CONNECTED : FlashStatus::DISCONNECTED;
+}
+
+// Error handling
+std::string SamsungFlasher::get_last_error() const {
+    return last_error_;
+}
+
+void SamsungFlasher::clear_error() {
+    last_error_.clear();
+}
+
+// Samsung-specific public methods
+bool SamsungFlasher::parse_pit() {
+    return parse_pit_internal();
+}
+
+void SamsungFlasher::map_partitions() {
+    map_partitions_internal();
+}
+
+bool SamsungFlasher::set_total_bytes(uint64_t total) {
+    if (!connected_) {
+        last_error_ = "Device not connected";
+        return false;
+    }
+    uint32_t ignored = 0;
+    if (!send_command(SamsungHandshake::SESSION_BEGIN, OdinSessionRequest::TOTAL_BYTES,
+                      {static_cast<uint32_t>(total), static_cast<uint32_t>(total >> 32)}) ||
+        !wait_for_response(SamsungHandshake::SESSION_BEGIN, ignored)) {
+        return false;
+    }
+    total_bytes_sent_ = true;
+    return true;
+}
+
+bool SamsungFlasher::begin_file(uint32_t identifier, size_t size) {
+    if (!connected_) {
+        last_error_ = "Device not connected";
+        return false;
+    }
+    if (file_open_ && file_offset_ != file_size_) {
+        last_error_ = "Previous file was not finished";
+        return false;
+    }
+
+    // The end of every sequence names the partition's device type
+    if (pit_table_.empty()) {
+        if (!parse_pit_internal()) {
+            return false;
+        }
+        map_partitions_internal();
+    }
+    auto entry = pit_table_.find(identifier);
+    if (!entry) {
+        last_error_ = "Partition " + std::to_string(identifier) + " is not in the PIT";
+        return false;
+    }
+    if (!total_bytes_sent_ && !set_total_bytes(size)) {
+        return false;
+    }
+    file_open_ = true;
+    file_identifier_ = identifier;
+    file_device_type_ = entry->device_type();
+    file_size_ = size;
+    file_offset_ = 0;
+    return true;
+}
+
+// Samsung protocol implementation
+bool SamsungFlasher::perform_handshake() {
+    std::cout << "Samsung: Initiating handshake sequence..." << std::endl;
+
+    // Step 1: "ODIN" must be answered with "LOKE"
+    uint8_t reply[ODIN_HANDSHAKE_LENGTH];
+    if (!transport_.write(reinterpret_cast<const uint8_t*>(ODIN_HANDSHAKE), ODIN_HANDSHAKE_LENGTH) ||
+        !receive(reply, sizeof(reply), 1000) ||
+        std::memcmp(reply, ODIN_HANDSHAKE_REPLY, ODIN_HANDSHAKE_LENGTH) != 0) {
+        last_error_ = "Device did not answer the Odin handshake";
+        std::cout << "Samsung: Handshake failed" << std::endl;
+        return false;
+    }
+
+    // Step 2: open a session and agree on the file part size
+    if (!send_command(SamsungHandshake::SESSION_BEGIN, OdinSessionRequest::BEGIN) ||
+        !wait_for_response(SamsungHandshake::SESSION_BEGIN, protocol_version_)) {
+        std::cout << "Samsung: Handshake failed" << std::endl;
+        return false;
+    }
+    session_open_ = true;
+    total_bytes_sent_ = false;
+
+    if (!negotiate_file_part_size()) {
+        std::cout << "Samsung: Handshake failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "Samsung: Handshake successful, " << file_part_size_ / 1024 << " KB file parts" << std::endl;
+    return true;
+}
+
+bool SamsungFlasher::negotiate_file_part_size() {
+    // Version 0 bootloaders only know their built-in part size
+    file_part_size_ = LEGACY_FILE_PART_SIZE;
+    if (protocol_version_ == 0) {
+        return true;
+    }
+
+    uint32_t size = DEFAULT_FILE_PART_SIZE;
+    if (transfer_options_.block_size != 0) {
+        size = std::max(LEGACY_FILE_PART_SIZE, std::min(size, transfer_options_.block_size));
+    }
+    for (; size >= LEGACY_FILE_PART_SIZE; size /= 2) {
+        uint32_t ignored = 0;
+        if (!send_command(SamsungHandshake::SESSION_BEGIN, OdinSessionRequest::FILE_PART_SIZE, {size})) {
+            return false;
+        }
+        if (wait_for_response(SamsungHandshake::SESSION_BEGIN, ignored)) {
+            file_part_size_ = size;
+            last_error_.clear();
+            return true;
+        }
+    }
+    last_error_ = "Device accepted no file part size";
+    return false;
+}
+
+bool SamsungFlasher::parse_pit_internal() {
+    std::cout << "Samsung: Parsing PIT (Partition Information Table)..." << std::endl;
+
+    // Send PIT file request; the device answers with the PIT size and
+    // then hands it out in fixed-size parts
+    uint32_t pit_size = 0;
+    if (!send_command(SamsungHandshake::PIT_FILE, OdinTransferRequest::DUMP) ||
+        !wait_for_response(SamsungHandshake::PIT_FILE, pit_size)) {
+        return false;
+    }
+
+    pit_table_.clear();
+    pit_entries_.clear();
+    pit_data_.assign(pit_size, 0);
+    uint32_t part_count = static_cast<uint32_t>((pit_size + ODIN_PIT_PART_SIZE - 1) / ODIN_PIT_PART_SIZE);
+    for (uint32_t part = 0; part < part_count; ++part) {
+        size_t offset = part * ODIN_PIT_PART_SIZE;
+        size_t length = std::min<size_t>(ODIN_PIT_PART_SIZE, pit_size - offset);
+        if (!send_command(SamsungHandshake::PIT_FILE, OdinTransferRequest::PART, {part}) ||
+            !receive(pit_data_.data() + offset, length, 5000)) {
+            pit_data_.clear();
+            return false;
+        }
+    }
+
+    uint32_t ignored = 0;
+    if (!send_command(SamsungHandshake::PIT_FILE, OdinTransferRequest::END) ||
+        !wait_for_response(SamsungHandshake::PIT_FILE, ignored)) {
+        pit_data_.clear();
+        return false;
+    }
+
+    // Entries are read in place; nothing is copied until someone asks
+    // for owned PITEntry values
+    if (!pit_table_.parse(ByteSpan(pit_data_))) {
+        last_error_ = pit_table_.get_last_error();
+        pit_data_.clear();
+        return false;
+    }
+
+    std::cout << "Samsung: Found " << pit_table_.size() << " partitions" << std::endl;
+    return true;
+}
+
+void SamsungFlasher::map_partitions_internal() {
+    std::cout << "Samsung: Mapping partitions..." << std::endl;
+
+    for (size_t i = 0; i < pit_table_.size(); ++i) {
+        PitEntryView entry = pit_table_[i];
+        std::cout << "  - " << entry.partition_name()
+                  << " @ 0x" << std::hex << entry.block_size_or_offset()
+                  << " (size: 0x" << entry.block_count_or_size() << ")" << std::dec << std::endl;
+    }
+
+    std::cout << "Samsung: Partition mapping complete" << std::endl;
+}
+
+bool SamsungFlasher::write_data_chunks(ByteSpan data, const WriteProgressFn& on_progress) {
+    // Sequences are whole parts, so only the last one of a file is padded
+    const size_t max_sequence = MAX_SEQUENCE_BYTES / file_part_size_ * file_part_size_;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t offset = 0; offset < data.size(); ) {
+        ByteSpan sequence = data.subspan(offset, max_sequence);
+        if (!send_sequence(sequence, offset, on_progress)) {
+            return false;
+        }
+        offset += sequence.size();
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed > 0) {
+            throughput_bps_ = offset / elapsed;
+        }
+
+        // Update progress
+        if (progress_callback_) {
+            FlashProgress progress;
+            progress.bytes_written = offset;
+            progress.total_bytes = data.size();
+            progress.percentage = 100.0 * offset / data.size();
+            progress.current_operation = "Writing firmware";
+            progress.status = FlashStatus::FLASHING;
+            progress.transfer_chunk_size = file_part_size_;
+            progress.pipeline_depth = std::max<uint32_t>(1, transfer_options_.pipeline_depth);
+            progress.throughput_bps = throughput_bps_;
+            progress_callback_(progress);
+        }
+    }
+    return true;
+}
+
+bool SamsungFlasher::send_sequence(ByteSpan sequence, size_t base, const WriteProgressFn& on_progress) {
+    const uint32_t length = static_cast<uint32_t>(sequence.size());
+    const size_t part_count = (sequence.size() + file_part_size_ - 1) / file_part_size_;
+    const size_t window = std::max<uint32_t>(1, transfer_options_.pipeline_depth);
+    const bool last = file_offset_ + length == file_size_;
+
+    // Announce the sequence, keep up to window parts on the wire, then
+    // close it against the target partition
+    uint32_t value = 0;
+    if (!send_command(SamsungHandshake::FILE_PART, OdinTransferRequest::FLASH, {length}) ||
+        !wait_for_response(SamsungHandshake::FILE_PART, value)) {
+        return false;
+    }
+
+    size_t sent = 0;
+    size_t acknowledged = 0;
+    while (acknowledged < part_count) {
+        for (; sent < part_count && sent - acknowledged < window; ++sent) {
+            ByteSpan part = sequence.subspan(sent * file_part_size_, file_part_size_);
+            if (part.size() < file_part_size_) {
+                part_buffer_.assign(file_part_size_, 0);
+                std::copy(part.begin(), part.end(), part_buffer_.begin());
+                part = ByteSpan(part_buffer_);
+            }
+            if (!transport_.write(part)) {
+                last_error_ = "Failed to send file part: " + transport_.get_last_error();
+                return false;
+            }
+        }
+
+        // Parts are acknowledged in order by index
+        if (!wait_for_response(SamsungHandshake::FILE_PART, value)) {
+            return false;
+        }
+        if (value != acknowledged) {
+            last_error_ = "Device acknowledged part " + std::to_string(value) + ", expected " +
+                          std::to_string(acknowledged);
+            return false;
+        }
+        ++acknowledged;
+        if (on_progress) {
+            on_progress(base + std::min<size_t>(acknowledged * file_part_size_, sequence.size()));
+        }
+    }
+
+    if (!send_command(SamsungHandshake::FILE_PART, OdinTransferRequest::END,
+                      {0, length, 0, file_device_type_, file_identifier_, last ? 1u : 0u}) ||
+        !wait_for_response(SamsungHandshake::FILE_PART, value)) {
+        return false;
+    }
+    file_offset_ += length;
+    return true;
+}
+
+bool SamsungFlasher::final_verification() {
+    std::cout << "Samsung: Performing final verification..." << std::endl;
+
+    // Odin can't read partitions back; every sequence was acknowledged as
+    // it was written, so what's left is that the file arrived in full
+    if (file_open_ && file_offset_ != file_size_) {
+        last_error_ = "Only " + std::to_string(file_offset_) + " of " + std::to_string(file_size_) +
+                      " bytes were written";
+        return false;
+    }
+
+    // Send session end command
+    if (session_open_ && !end_session(OdinEndRequest::END)) {
+        return false;
+    }
+
+    std::cout << "Samsung: Flash verification complete" << std::endl;
+    return true;
+}
+
+bool SamsungFlasher::end_session(uint32_t request) {
+    session_open_ = false;
+    total_bytes_sent_ = false;
+    uint32_t ignored = 0;
+    return send_command(SamsungHandshake::SESSION_END, request) &&
+           wait_for_response(SamsungHandshake::SESSION_END, ignored);
+}
+
+// Communication helpers
+bool SamsungFlasher::send_command(uint32_t command, uint32_t request, std::initializer_list<uint32_t> arguments) {
+    OdinControlPacket packet(command, request);
+    size_t index = 0;
+    for (uint32_t argument : arguments) {
+        packet.set_argument(index++, argument);
+    }
+    if (!transport_.write(packet.span())) {
+        last_error_ = "Failed to send Odin command: " + transport_.get_last_error();
+        return false;
+    }
+    return true;
+}
+
+bool SamsungFlasher::wait_for_response(uint32_t command, uint32_t& value, uint32_t timeout_ms) {
+    uint8_t bytes[ODIN_RESPONSE_SIZE];
+    if (!receive(bytes, sizeof(bytes), timeout_ms)) {
+        last_error_ = "No response from device: " + transport_.get_last_error();
+        return false;
+    }
+
+    OdinResponse response = OdinResponse::decode(bytes);
+    if (response.type != command) {
+        last_error_ = response.type == ODIN_RESPONSE_FAIL
+            ? "Device rejected Odin request type " + std::to_string(command)
+            : "Unexpected response type " + std::to_string(response.type);
+        return false;
+    }
+    value = response.value;
+    return true;
+}
+
+bool SamsungFlasher::receive(uint8_t* buffer, size_t size, uint32_t timeout_ms) {
+    transport_.set_read_timeout(std::chrono::milliseconds(timeout_ms));
+    size_t bytes_read = 0;
+    return transport_.read(buffer, size, bytes_read) && bytes_read == size;
+}
+
+}
@@ -2,245 +2,149 @@
 #define SAMSUNG_FLASHER_H
 
 #include "device_interface.h"
+#include "odin_protocol.h"
+#include "pit_parser.h"
+#include "serial_transport.h"
 #include <vector>
 #include <string>
-#include <iostream>
 #include <cstdint>
 #include <functional>
+#include <initializer_list>
 
 namespace SamFlash {
 
-// Samsung-specific structures and constants
-struct PITEntry {
-    uint32_t binary_type;
-    uint32_t device_type;
-    uint32_t identifier;
-    uint32_t attributes;
-    uint32_t update_attributes;
-    uint32_t block_size_or_offset;
-    uint32_t block_count_or_size;
-    uint32_t file_offset;
-    uint32_t file_size;
-    std::string partition_name;
-    std::string flash_filename;
-    std::string fota_filename;
-};
-
-struct SamsungHandshake {
-    static const uint32_t SESSION_BEGIN = 0x64;
-    static const uint32_t PIT_FILE = 0x65;
-    static const uint32_t FILE_PART = 0x66;
-    static const uint32_t SESSION_END = 0x67;
-};
-
+// Samsung download-mode device spoken to over the Odin protocol on a
+// serial port. Odin has no addressing: a file is streamed into one PIT
+// partition front to back, so select it with begin_file() and write the
+// data in order.
 class SamsungFlasher : public IDeviceInterface {
 public:
-    SamsungFlasher() : connected_(false), progress_callback_(nullptr) {}
-    ~SamsungFlasher() override {}
-    
+    // Bytes per FILE_PART packet. The flasher asks for the default and
+    // halves it until the device agrees; version 0 bootloaders are fixed
+    // at the legacy size.
+    static constexpr uint32_t DEFAULT_FILE_PART_SIZE = 128 * 1024;
+    static constexpr uint32_t LEGACY_FILE_PART_SIZE = 1024;
+    // Largest transfer sequence; each one costs a FLASH/END exchange
+    static constexpr uint32_t MAX_SEQUENCE_BYTES = 30 * 1024 * 1024;
+    // Samsung's USB vendor ID, used to pick download-mode ports
+    static constexpr uint16_t SAMSUNG_VENDOR_ID = 0x04E8;
+
+    SamsungFlasher();
+    ~SamsungFlasher() override;
+
+    // pit_table_ views pit_data_, so a copy or move would point into the
+    // original; declaring the copy deleted rules out moves too
+    SamsungFlasher(const SamsungFlasher&) = delete;
+    SamsungFlasher& operator=(const SamsungFlasher&) = delete;
+
     // Device discovery and connection
-    std::vector<DeviceInfo> discover_devices() override {
-        // Simulate Samsung device discovery
-        std::cout << "Discovering Samsung Devices..." << std::endl;
-        return {};
-    }
-    
-    bool connect(const std::string& device_id) override {
-        std::cout << "Connecting to Samsung device: " << device_id << std::endl;
-        perform_handshake();
-        return true;
-    }
-    
-    bool disconnect() override {
-        std::cout << "Disconnecting Samsung device..." << std::endl;
-        return true;
-    }
-    
-    bool is_connected() const override {
-        return true;
-    }
-    
+    std::vector<DeviceInfo> discover_devices() override;
+    bool connect(const std::string& device_id) override;
+    bool disconnect() override;
+    bool is_connected() const override;
+
     // Device information
-    DeviceInfo get_device_info() const override {
-        return {"samsung_01", "Samsung Device", "Samsung", DeviceType::USB_SERIAL, "COM5", 0, 0, true};
-    }
-    
-    std::string get_device_signature() override {
-        return "samsung_signature";
-    }
-    
+    DeviceInfo get_device_info() const override;
+    std::string get_device_signature() override;
+
     // Flash operations
-    bool erase_chip() override {
-        std::cout << "Erasing Samsung chip..." << std::endl;
-        return true;
-    }
-    
-    bool erase_page(uint32_t address) override {
-        return true;
-    }
-    
-    bool write_page(uint32_t address, const std::vector<uint8_t>& data) override {
-        std::cout << "Samsung: Writing page at address 0x" << std::hex << address << std::endl;
-        
-        // Parse PIT if not done already
-        if (pit_entries_.empty()) {
-            parse_pit_internal();
-            map_partitions_internal();
-        }
-        
-        // Write data using Samsung protocol
-        write_data_chunks(data);
-        
-        return true;
-    }
-    
-    std::vector<uint8_t> read_page(uint32_t address, uint32_t size) override {
-        return {};
-    }
-    
-    bool verify_flash(const std::vector<uint8_t>& expected_data, uint32_t start_address = 0) override {
-        std::cout << "Samsung: Starting flash verification..." << std::endl;
-        
-        // Perform Samsung-specific final verification
-        final_verification();
-        
-        return true;
-    }
-    
+    bool erase_chip() override;
+    bool erase_page(uint32_t address) override;
+    bool write_page(uint32_t address, const std::vector<uint8_t>& data) override;
+    bool write_page(uint32_t address, ByteSpan data) override;
+    // Streams data as file parts with up to pipeline_depth parts
+    // unacknowledged; block_size, when set, caps the part size
+    bool write_pages(uint32_t address, ByteSpan data, const WriteProgressFn& on_progress = nullptr) override;
+    void set_transfer_options(const TransferOptions& options) override;
+    TransferStats get_transfer_stats() const override;
+    std::vector<uint8_t> read_page(uint32_t address, uint32_t size) override;
+    bool read_page(uint32_t address, MutableByteSpan buffer) override;
+    bool verify_flash(const std::vector<uint8_t>& expected_data, uint32_t start_address = 0) override;
+    bool verify_flash(ByteSpan expected_data, uint32_t start_address = 0) override;
+
     // Progress and status
-    void set_progress_callback(std::function<void(const FlashProgress&)> callback) override {
-        progress_callback_ = callback;
-    }
-    
-    FlashStatus get_status() const override {
-        return FlashStatus::CONNECTED;
-    }
-    
+    void set_progress_callback(std::function<void(const FlashProgress&)> callback) override;
+    FlashStatus get_status() const override;
+
     // Error handling
-    std::string get_last_error() const override {
-        return last_error_;
-    }
-    
-    void clear_error() override {
-        last_error_.clear();
-    }
-    
+    std::string get_last_error() const override;
+    void clear_error() override;
+
     // Samsung-specific public methods
+    // Partition table read in place from the PIT the device sent
+    const PitTable& get_pit_table() const {
+        return pit_table_;
+    }
+
+    // Owned copies of the entries, built on first use
     const std::vector<PITEntry>& get_pit_entries() const {
+        if (pit_entries_.empty() && !pit_table_.empty()) {
+            pit_entries_ = pit_table_.to_entries();
+        }
         return pit_entries_;
     }
-    
-    void parse_pit() {
-        parse_pit_internal();
-    }
-    
-    void map_partitions() {
-        map_partitions_internal();
+
+    // PIT exactly as the device sent it
+    const std::vector<uint8_t>& get_pit_data() const {
+        return pit_data_;
     }
 
+    bool parse_pit();
+    void map_partitions();
+
+    // Tell the bootloader how many bytes the session's files add up to.
+    // It wants this once, before the first file; begin_file announces its
+    // own size when nothing was.
+    bool set_total_bytes(uint64_t total);
+
+    // Start streaming a size-byte file into the partition with the given
+    // PIT identifier; write_page calls then continue from offset zero.
+    // The PIT is read first if it hasn't been, and must hold the identifier.
+    bool begin_file(uint32_t identifier, size_t size);
+
+    // Continue the open file at offset, which must be where the last write
+    // ended. Unlike a write_pages address it can lie past 4 GiB.
+    bool write_file(uint64_t offset, ByteSpan data, const WriteProgressFn& on_progress = nullptr);
+
 private:
     // Samsung protocol implementation
-    void perform_handshake() {
-        std::cout << "Samsung: Initiating handshake sequence..." << std::endl;
-        
-        // Step 1: Send session begin command
-        send_command(SamsungHandshake::SESSION_BEGIN);
-        
-        // Step 2: Wait for device response
-        if (wait_for_response()) {
-            std::cout << "Samsung: Handshake successful" << std::endl;
-        } else {
-            std::cout << "Samsung: Handshake failed" << std::endl;
-        }
-    }
-    
-    void parse_pit_internal() {
-        std::cout << "Samsung: Parsing PIT (Partition Information Table)..." << std::endl;
-        
-        // Send PIT file request
-        send_command(SamsungHandshake::PIT_FILE);
-        
-        // Parse PIT entries (simplified)
-        for (int i = 0; i < 10; ++i) {
-            PITEntry entry;
-            entry.identifier = i;
-            entry.partition_name = "partition_" + std::to_string(i);
-            entry.block_size_or_offset = i * 0x1000;
-            entry.block_count_or_size = 0x1000;
-            pit_entries_.push_back(entry);
-        }
-        
-        std::cout << "Samsung: Found " << pit_entries_.size() << " partitions" << std::endl;
-    }
-    
-    void map_partitions_internal() {
-        std::cout << "Samsung: Mapping partitions..." << std::endl;
-        
-        for (const auto& entry : pit_entries_) {
-            std::cout << "  - " << entry.partition_name 
-                      << " @ 0x" << std::hex << entry.block_size_or_offset
-                      << " (size: 0x" << entry.block_count_or_size << ")" << std::endl;
-        }
-        
-        std::cout << "Samsung: Partition mapping complete" << std::endl;
-    }
-    
-    void write_data_chunks(const std::vector<uint8_t>& data) {
-        std::cout << "Samsung: Writing firmware in chunks..." << std::endl;
-        
-        const size_t chunk_size = 1024; // 1KB chunks
-        size_t total_chunks = (data.size() + chunk_size - 1) / chunk_size;
-        
-        for (size_t i = 0; i < total_chunks; ++i) {
-            size_t start = i * chunk_size;
-            size_t end = std::min(start + chunk_size, data.size());
-            
-            // Send file part command
-            send_command(SamsungHandshake::FILE_PART);
-            
-            // Send chunk data (simulated)
-            std::cout << "Samsung: Chunk " << (i + 1) << "/" << total_chunks 
-                      << " (" << (end - start) << " bytes)" << std::endl;
-            
-            // Update progress
-            if (progress_callback_) {
-                FlashProgress progress;
-                progress.bytes_written = end;
-                progress.total_bytes = data.size();
-                progress.percentage = 100.0 * end / data.size();
-                progress.current_operation = "Writing firmware";
-                progress.status = FlashStatus::FLASHING;
-                progress_callback_(progress);
-            }
-        }
-    }
-    
-    void final_verification() {
-        std::cout << "Samsung: Performing final verification..." << std::endl;
-        
-        // Send session end command
-        send_command(SamsungHandshake::SESSION_END);
-        
-        // Verify checksums (simplified)
-        std::cout << "Samsung: Verifying checksums..." << std::endl;
-        std::cout << "Samsung: Flash verification complete" << std::endl;
-    }
-    
+    bool perform_handshake();
+    bool parse_pit_internal();
+    void map_partitions_internal();
+    bool negotiate_file_part_size();
+    bool write_data_chunks(ByteSpan data, const WriteProgressFn& on_progress);
+    bool send_sequence(ByteSpan sequence, size_t base, const WriteProgressFn& on_progress);
+    bool final_verification();
+    bool end_session(uint32_t request);
+
     // Communication helpers
-    void send_command(uint32_t command) {
-        std::cout << "Samsung: Sending command 0x" << std::hex << command << std::endl;
-        // Actual serial communication would go here
-    }
-    
-    bool wait_for_response(uint32_t timeout_ms = 5000) {
-        std::cout << "Samsung: Waiting for device response..." << std::endl;
-        // Actual response handling would go here
-        return true; // Simulate success
-    }
-    
+    bool send_command(uint32_t command, uint32_t request, std::initializer_list<uint32_t> arguments = {});
+    bool wait_for_response(uint32_t command, uint32_t& value, uint32_t timeout_ms = 5000);
+    bool receive(uint8_t* buffer, size_t size, uint32_t timeout_ms);
+
     // Private member variables
+    SerialTransport transport_;
+    std::string port_;
+    std::string serial_number_;
     bool connected_;
-    std::vector<PITEntry> pit_entries_;
+    bool session_open_;
+    bool total_bytes_sent_; // TOTAL_BYTES went out this session
+    uint32_t protocol_version_;
+    uint32_t file_part_size_; // in effect for this session
+    TransferOptions transfer_options_;
+    double throughput_bps_;
+    std::vector<uint8_t> pit_data_;
+    PitTable pit_table_; // views into pit_data_
+    mutable std::vector<PITEntry> pit_entries_;
+    std::vector<uint8_t> part_buffer_; // short final part, zero padded
+
+    // File currently being streamed
+    bool file_open_;
+    uint32_t file_identifier_;
+    uint32_t file_device_type_; // from the PIT entry, echoed in FILE_PART END
+    size_t file_size_;
+    size_t file_offset_;
+
     std::function<void(const FlashProgress&)> progress_callback_;
     std::string last_error_;
 };
@@ -248,4 +152,3 @@ private:
 }
 
 #endif // SAMSUNG_FLASHER_H
-
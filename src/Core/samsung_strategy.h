@@ -3,7 +3,16 @@
 
 #include "iflash_strategy.h"
 #include "samsung_flasher.h"
+#include "odin_archive.h"
+#include "buffer_pool.h"
+#include "lz4_frame.h"
+#include "sparse_image.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
 
 namespace SamFlash {
 
@@ -18,6 +27,14 @@ public:
         config_ = config;
         last_error_.clear();
         
+        if (device_interface_) {
+            IDeviceInterface::TransferOptions options;
+            options.pipeline_depth = config_.pipeline_depth;
+            options.block_size = config_.transfer_block_size;
+            options.adaptive = config_.adaptive_transfer;
+            device_interface_->set_transfer_options(options);
+        }
+        
         std::cout << "SamsungStrategy: Initialized for Samsung device flashing" << std::endl;
         return true;
     }
@@ -36,6 +53,10 @@ public:
             return false;
         }
         
+        if (!config_.partitions.empty()) {
+            return erase_partitions();
+        }
+        
         // Use Samsung-specific erase
         bool result = device_interface_->erase_chip();
         
@@ -70,7 +91,12 @@ public:
         return result;
     }
     
-    bool write_firmware(const std::vector<uint8_t>& firmware_data) override {
+    bool write_firmware(ByteSpan firmware_data) override {
+        MemoryFirmwareSource source(firmware_data);
+        return write_firmware(source);
+    }
+    
+    bool write_firmware(FirmwareSource& source) override {
         std::cout << "SamsungStrategy: Starting firmware write..." << std::endl;
         
         if (!device_interface_) {
@@ -80,46 +106,125 @@ public:
         
         // Ensure PIT is parsed before writing
         auto samsung_flasher = dynamic_cast<SamsungFlasher*>(device_interface_.get());
-        if (samsung_flasher && samsung_flasher->get_pit_entries().empty()) {
+        if (!samsung_flasher) {
+            last_error_ = "Firmware images need a download-mode device";
+            return false;
+        }
+        if (samsung_flasher->get_pit_table().empty()) {
             samsung_flasher->parse_pit();
             samsung_flasher->map_partitions();
         }
         
-        const size_t chunk_size = 1024; // Samsung-specific chunk size
-        size_t total_chunks = (firmware_data.size() + chunk_size - 1) / chunk_size;
+        // A flat image goes to one partition: the one selected, else the
+        // first in the PIT
+        std::string partition_name = "Samsung main";
+        uint32_t identifier = 0;
+        if (!config_.partitions.empty()) {
+            std::vector<PitEntryView> selected;
+            if (!select_partitions(samsung_flasher, selected)) {
+                return false;
+            }
+            if (selected.size() > 1) {
+                last_error_ = "A single image can only be written to one partition; use an archive for several";
+                return false;
+            }
+            identifier = selected[0].identifier();
+            partition_name = std::string(selected[0].partition_name());
+        } else if (!samsung_flasher->get_pit_table().empty()) {
+            identifier = samsung_flasher->get_pit_table()[0].identifier();
+        }
+        
+        if (!source.rewind()) {
+            last_error_ = source.get_last_error();
+            return false;
+        }
+        const size_t file_size = static_cast<size_t>(source.size());
+        
+        // The image is pulled a window of whole file parts at a time, so
+        // only the last part is padded
+        const size_t window_unit = std::max<uint32_t>(1, device_interface_->get_transfer_stats().chunk_size);
+        const size_t window_size = std::max(window_unit, source.chunk_size_hint() / window_unit * window_unit);
+        FirmwareChunk chunk;
+        bool have_chunk = source.next(window_size, chunk);
+        
+        // Download mode expands sparse images itself, so Odin gets the file
+        // as is and only the progress is translated. With the whole image
+        // in memory the chunk headers are walked up front, which validates
+        // the file before anything is sent and tells how much of the
+        // expanded image each chunk covers; a streamed one is estimated
+        // from the header's expanded size.
+        ByteSpan image = source.contiguous();
+        const bool is_sparse = have_chunk && SparseImageReader::is_sparse(chunk.data);
+        std::vector<SparseChunk> sparse_chunks;
+        uint64_t logical_size = file_size;
+        if (is_sparse && !image.empty()) {
+            if (!read_sparse_chunks(image, sparse_chunks, logical_size)) {
+                return false;
+            }
+        } else if (is_sparse) {
+            SparseImageReader reader;
+            if (!reader.open(chunk.data)) {
+                last_error_ = reader.get_last_error();
+                return false;
+            }
+            logical_size = reader.output_size();
+        }
+        
+        // Odin streams a partition front to back with no way to seek into
+        // it and overwrites it in place, so the whole file is always sent
+        // and there is nothing to erase first
+        if (!samsung_flasher->set_total_bytes(file_size) || !samsung_flasher->begin_file(identifier, file_size)) {
+            last_error_ = samsung_flasher->get_last_error();
+            return false;
+        }
         
         EnhancedFlashProgress progress;
-        progress.total_bytes = firmware_data.size();
+        progress.total_bytes = file_size;
+        progress.logical_total_bytes = logical_size;
         progress.current_operation = "Writing firmware";
         progress.status = FlashStatus::FLASHING;
-        progress.current_partition = "Samsung main";
+        progress.current_partition = partition_name;
         progress.total_partitions = 1;
         progress.completed_partitions = 0;
         
         PartitionProgress partition_progress;
-        partition_progress.partition_name = "Samsung main";
-        partition_progress.partition_id = 0;
-        partition_progress.partition_size = firmware_data.size();
+        partition_progress.partition_name = partition_name;
+        partition_progress.partition_id = identifier;
+        partition_progress.partition_size = file_size;
         partition_progress.current_operation = "Writing";
         partition_progress.status = FlashStatus::FLASHING;
         progress.partition_progress.push_back(partition_progress);
         
-        for (size_t i = 0; i < firmware_data.size(); i += chunk_size) {
-            std::vector<uint8_t> chunk(firmware_data.begin() + i, firmware_data.begin() + std::min(firmware_data.size(), i + chunk_size));
-            
-            if (!device_interface_->write_page(i, chunk)) {
-                last_error_ = "Write error at address: " + std::to_string(i);
+        // The device streams each window in as few, as large transfers as
+        // it supports and confirms them as they land. A failed transfer
+        // leaves the bootloader mid-file with no way back in, so there is
+        // no retry.
+        for (; have_chunk; have_chunk = source.next(window_size, chunk)) {
+            const size_t base = static_cast<size_t>(chunk.offset);
+            auto on_progress = [&](size_t bytes_completed) {
+                progress.bytes_written = base + bytes_completed;
+                if (!sparse_chunks.empty()) {
+                    progress.logical_bytes_written = logical_offset(sparse_chunks, progress.bytes_written);
+                } else if (is_sparse) {
+                    progress.logical_bytes_written = static_cast<uint64_t>(
+                        static_cast<double>(progress.bytes_written) / file_size * logical_size);
+                } else {
+                    progress.logical_bytes_written = progress.bytes_written;
+                }
+                report_write_progress(progress);
+            };
+            if (!samsung_flasher->write_file(base, chunk.data, on_progress)) {
+                last_error_ = "Write error at address: " + std::to_string(progress.bytes_written) + ": " +
+                              device_interface_->get_last_error();
                 return false;
             }
-            
-            progress.bytes_written = i + chunk.size();
-            progress.percentage = 100.0 * static_cast<double>(progress.bytes_written) / firmware_data.size();
-            progress.partition_progress[0].bytes_written = progress.bytes_written;
-            progress.partition_progress[0].partition_percentage = progress.percentage;
-            
-            update_progress(progress);
+        }
+        if (!source.at_end()) {
+            last_error_ = source.get_last_error();
+            return false;
         }
         
+        progress.logical_bytes_written = logical_size;
         progress.status = FlashStatus::COMPLETE;
         progress.completed_partitions = 1;
         progress.partition_progress[0].status = FlashStatus::COMPLETE;
@@ -129,7 +234,260 @@ public:
         return true;
     }
     
-    bool verify_firmware(const std::vector<uint8_t>& expected_data) override {
+    bool write_archive(OdinArchive& archive) override {
+        std::cout << "SamsungStrategy: Flashing archive " << archive.path() << "..." << std::endl;
+        
+        auto samsung_flasher = dynamic_cast<SamsungFlasher*>(device_interface_.get());
+        if (!samsung_flasher) {
+            last_error_ = "Firmware archives need a download-mode device";
+            return false;
+        }
+        if (samsung_flasher->get_pit_table().empty() && !samsung_flasher->parse_pit()) {
+            last_error_ = samsung_flasher->get_last_error();
+            return false;
+        }
+        
+        std::vector<PitEntryView> selected;
+        if (!config_.partitions.empty() && !select_partitions(samsung_flasher, selected)) {
+            return false;
+        }
+        auto is_selected = [&selected](uint32_t identifier) {
+            return selected.empty() || std::any_of(selected.begin(), selected.end(), [identifier](const PitEntryView& entry) {
+                return entry.identifier() == identifier;
+            });
+        };
+        
+        // Map every member before sending anything, so an archive meant
+        // for another device is turned away untouched. Members for
+        // partitions that weren't selected are read past, not sent.
+        const PitTable& pit = samsung_flasher->get_pit_table();
+        const std::vector<ArchiveMember>& members = archive.members();
+        std::vector<uint32_t> targets(members.size(), NO_PARTITION);
+        std::vector<uint64_t> image_sizes(members.size(), 0); // decompressed size for .lz4
+        bool any_compressed = false;
+        EnhancedFlashProgress progress;
+        progress.bytes_written = 0;
+        progress.total_bytes = 0;
+        progress.current_operation = "Writing firmware";
+        progress.status = FlashStatus::FLASHING;
+        progress.completed_partitions = 0;
+        for (size_t i = 0; i < members.size(); ++i) {
+            const ArchiveMember& member = members[i];
+            if (member.size == 0) {
+                continue;
+            }
+            auto entry = find_partition_for_member(pit, member.name);
+            if (!entry) {
+                std::cout << "SamsungStrategy: No partition for " << member.name << ", skipping" << std::endl;
+                continue;
+            }
+            if (!is_selected(entry->identifier())) {
+                continue;
+            }
+            image_sizes[i] = member.size;
+            if (is_lz4_member(member.name)) {
+                // Download mode needs the file size before the first byte
+                uint8_t head[LZ4_MAX_HEADER_SIZE];
+                size_t head_size = archive.peek(member, MutableByteSpan(head, sizeof(head)));
+                auto content_size = Lz4FrameDecoder::content_size(ByteSpan(head, head_size));
+                if (!content_size) {
+                    last_error_ = head_size == 0 ? archive.get_last_error()
+                                                 : member.name + " does not record its decompressed size";
+                    return false;
+                }
+                image_sizes[i] = *content_size;
+                any_compressed = true;
+                if (image_sizes[i] == 0) {
+                    continue;
+                }
+            }
+            targets[i] = entry->identifier();
+            progress.total_bytes += image_sizes[i];
+            
+            PartitionProgress partition_progress;
+            partition_progress.partition_name = std::string(entry->partition_name());
+            partition_progress.partition_id = entry->identifier();
+            partition_progress.bytes_written = 0;
+            partition_progress.partition_size = image_sizes[i];
+            partition_progress.partition_percentage = 0.0;
+            partition_progress.current_operation = "Pending";
+            partition_progress.status = FlashStatus::IDLE;
+            progress.partition_progress.push_back(partition_progress);
+        }
+        for (const auto& entry : selected) {
+            if (std::find(targets.begin(), targets.end(), entry.identifier()) == targets.end()) {
+                last_error_ = "Archive has no image for partition " + std::string(entry.partition_name());
+                return false;
+            }
+        }
+        if (progress.partition_progress.empty()) {
+            last_error_ = "No archive member matches a partition on this device";
+            return false;
+        }
+        progress.total_partitions = static_cast<uint32_t>(progress.partition_progress.size());
+        progress.logical_total_bytes = progress.total_bytes;
+        if (!samsung_flasher->set_total_bytes(progress.total_bytes)) {
+            last_error_ = samsung_flasher->get_last_error();
+            return false;
+        }
+        
+        // Whole file parts per read, so only a member's last part is padded
+        const size_t part_size = std::max<uint32_t>(1, device_interface_->get_transfer_stats().chunk_size);
+        const size_t chunk_size = std::max(part_size, ARCHIVE_READ_SIZE / part_size * part_size);
+        
+        // A reader thread reads and hashes the archive into a small pool of
+        // buffers while this thread streams the filled ones out, so the link
+        // doesn't wait on the disk between transfers. Members that aren't
+        // flashed are only hashed and never leave the reader. Compressed
+        // members add a decoder thread, and a second pool, in between.
+        BufferPool pool(ARCHIVE_BUFFER_COUNT, chunk_size);
+        std::unique_ptr<BufferPool> compressed_pool;
+        if (any_compressed) {
+            compressed_pool = std::make_unique<BufferPool>(ARCHIVE_BUFFER_COUNT, chunk_size);
+        }
+        BufferPool& read_pool = compressed_pool ? *compressed_pool : pool;
+        std::atomic<int64_t> read_busy_ns{0};
+        std::atomic<int64_t> decode_busy_ns{0};
+        std::chrono::steady_clock::duration transfer_busy{};
+        std::string decode_error;
+        const auto started = std::chrono::steady_clock::now();
+        std::thread reader([&] {
+            if (!archive.rewind()) {
+                read_pool.finish();
+                return;
+            }
+            while (BufferPool::Buffer* buffer = read_pool.acquire()) {
+                ArchivePiece piece;
+                bool more;
+                do {
+                    auto start = std::chrono::steady_clock::now();
+                    more = archive.read_next(MutableByteSpan(buffer->data.data(), buffer->data.size()), piece);
+                    read_busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+                } while (more && targets[piece.member] == NO_PARTITION);
+                if (!more) {
+                    read_pool.release(buffer);
+                    break;
+                }
+                buffer->size = piece.size;
+                buffer->tag = piece.member;
+                buffer->offset = piece.offset;
+                read_pool.submit(buffer);
+            }
+            read_pool.finish();
+        });
+        std::thread decoder;
+        if (compressed_pool) {
+            decoder = std::thread([&] {
+                decode_error = decode_archive_members(*compressed_pool, pool, members, image_sizes, decode_busy_ns);
+            });
+        }
+        
+        auto update_stages = [&] {
+            double elapsed = std::max(1e-9, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+            progress.pipeline_stages.clear();
+            progress.pipeline_stages.push_back({"read", read_busy_ns / 1e9 / elapsed, read_pool.producer_stalled_seconds()});
+            if (compressed_pool) {
+                progress.pipeline_stages.push_back({"decode", decode_busy_ns / 1e9 / elapsed,
+                                                    compressed_pool->consumer_stalled_seconds() + pool.producer_stalled_seconds()});
+            }
+            progress.pipeline_stages.push_back({"transfer", std::chrono::duration<double>(transfer_busy).count() / elapsed,
+                                                pool.consumer_stalled_seconds()});
+        };
+        
+        PartitionProgress* current = nullptr;
+        uint64_t member_base = 0;
+        bool written = true;
+        while (BufferPool::Buffer* buffer = pool.next()) {
+            const ArchiveMember& member = members[buffer->tag];
+            auto start = std::chrono::steady_clock::now();
+            if (buffer->offset == 0) {
+                if (current) {
+                    current->status = FlashStatus::COMPLETE;
+                    current->current_operation = "Done";
+                    ++progress.completed_partitions;
+                }
+                current = &progress.partition_progress[progress.completed_partitions];
+                current->status = FlashStatus::FLASHING;
+                current->current_operation = "Writing";
+                progress.current_partition = current->partition_name;
+                member_base = progress.bytes_written;
+                std::cout << "SamsungStrategy: Writing " << member.name << " to " << current->partition_name << std::endl;
+                if (!samsung_flasher->begin_file(targets[buffer->tag], image_sizes[buffer->tag])) {
+                    last_error_ = samsung_flasher->get_last_error();
+                    written = false;
+                }
+            }
+            
+            const uint64_t offset = buffer->offset;
+            auto on_progress = [&](size_t bytes_completed) {
+                current->bytes_written = offset + bytes_completed;
+                current->partition_percentage = 100.0 * static_cast<double>(current->bytes_written) / current->partition_size;
+                progress.bytes_written = member_base + current->bytes_written;
+                progress.logical_bytes_written = progress.bytes_written;
+                progress.percentage = 100.0 * static_cast<double>(progress.bytes_written) / progress.total_bytes;
+                auto stats = device_interface_->get_transfer_stats();
+                progress.transfer_chunk_size = stats.chunk_size;
+                progress.pipeline_depth = stats.pipeline_depth;
+                progress.throughput_bps = stats.throughput_bps;
+                update_stages();
+                update_progress(progress);
+            };
+            if (written && !samsung_flasher->write_file(offset, buffer->filled(), on_progress)) {
+                last_error_ = "Write error in " + current->partition_name + " at offset " + std::to_string(offset) +
+                              ": " + device_interface_->get_last_error();
+                written = false;
+            }
+            transfer_busy += std::chrono::steady_clock::now() - start;
+            pool.release(buffer);
+            if (!written) {
+                pool.cancel();
+                break;
+            }
+        }
+        reader.join();
+        if (decoder.joinable()) {
+            decoder.join();
+        }
+        
+        update_stages();
+        for (const auto& stage : progress.pipeline_stages) {
+            std::cout << "SamsungStrategy: " << stage.name << " stage " << static_cast<int>(stage.utilization * 100)
+                      << "% busy, stalled " << stage.stalled_seconds << " s" << std::endl;
+        }
+        if (!written) {
+            return false;
+        }
+        if (!decode_error.empty()) {
+            last_error_ = decode_error;
+            return false;
+        }
+        // The MD5 is only known once the last byte has gone out; a mismatch
+        // still fails the flash before the session is closed
+        if (!archive.at_end()) {
+            last_error_ = archive.get_last_error();
+            return false;
+        }
+        if (current) {
+            current->status = FlashStatus::COMPLETE;
+            current->current_operation = "Done";
+            ++progress.completed_partitions;
+        }
+        
+        progress.status = FlashStatus::COMPLETE;
+        update_progress(progress);
+        std::cout << "SamsungStrategy: Archive written to " << progress.completed_partitions << " partitions" << std::endl;
+        return true;
+    }
+    
+    bool verify_firmware(ByteSpan expected_data) override {
+        MemoryFirmwareSource source(expected_data);
+        return verify_firmware(source);
+    }
+    
+    // Download mode checks the file as it arrives and only confirms the
+    // session here, so the image isn't read again
+    bool verify_firmware(FirmwareSource& source) override {
         std::cout << "SamsungStrategy: Starting firmware verification..." << std::endl;
         
         if (!device_interface_) {
@@ -144,7 +502,8 @@ public:
         }
         
         EnhancedFlashProgress progress;
-        progress.total_bytes = expected_data.size();
+        const size_t image_size = static_cast<size_t>(source.size());
+        progress.total_bytes = image_size;
         progress.current_operation = "Verifying firmware";
         progress.status = FlashStatus::VERIFYING;
         progress.current_partition = "Samsung main";
@@ -154,17 +513,17 @@ public:
         PartitionProgress partition_progress;
         partition_progress.partition_name = "Samsung main";
         partition_progress.bytes_written = 0;
-        partition_progress.partition_size = expected_data.size();
+        partition_progress.partition_size = image_size;
         partition_progress.current_operation = "Verifying";
         partition_progress.status = FlashStatus::VERIFYING;
         progress.partition_progress.push_back(partition_progress);
         
-        if (samsung_flasher->verify_flash(expected_data)) {
-            progress.bytes_written = expected_data.size();
+        if (samsung_flasher->verify_flash(source.contiguous())) {
+            progress.bytes_written = image_size;
             progress.percentage = 100.0;
             progress.status = FlashStatus::COMPLETE;
             progress.completed_partitions = 1;
-            progress.partition_progress[0].bytes_written = expected_data.size();
+            progress.partition_progress[0].bytes_written = image_size;
             progress.partition_progress[0].partition_percentage = 100.0;
             progress.partition_progress[0].status = FlashStatus::COMPLETE;
             update_progress(progress);
@@ -204,6 +563,202 @@ public:
     bool is_compatible_with_device(const DeviceInfo& device_info) const override {
         return device_info.manufacturer == "Samsung";
     }
+    
+private:
+    // Look the configured partition names up in the device's PIT
+    bool select_partitions(SamsungFlasher* samsung_flasher, std::vector<PitEntryView>& selected) {
+        if (samsung_flasher && samsung_flasher->get_pit_table().empty()) {
+            samsung_flasher->parse_pit();
+        }
+        if (!samsung_flasher || samsung_flasher->get_pit_table().empty()) {
+            last_error_ = "Selecting partitions needs a download-mode device with a partition table";
+            return false;
+        }
+        const PitTable& pit = samsung_flasher->get_pit_table();
+        for (const auto& name : config_.partitions) {
+            auto entry = pit.find_ignoring_case(name);
+            if (!entry) {
+                last_error_ = "Partition " + name + " is not in the device's PIT";
+                return false;
+            }
+            selected.push_back(*entry);
+        }
+        return true;
+    }
+    
+    // Download mode has no erase command: a partition is replaced as it
+    // is written. A selective erase therefore only checks the selection
+    // against the PIT and leaves every other partition untouched.
+    bool erase_partitions() {
+        std::vector<PitEntryView> selected;
+        if (!select_partitions(dynamic_cast<SamsungFlasher*>(device_interface_.get()), selected)) {
+            return false;
+        }
+        
+        EnhancedFlashProgress progress;
+        progress.bytes_written = 0;
+        progress.total_bytes = selected.size();
+        progress.percentage = 100.0;
+        progress.current_operation = "Erasing partitions";
+        progress.status = FlashStatus::COMPLETE;
+        progress.total_partitions = static_cast<uint32_t>(selected.size());
+        progress.completed_partitions = progress.total_partitions;
+        for (const auto& entry : selected) {
+            PartitionProgress partition_progress;
+            partition_progress.partition_name = std::string(entry.partition_name());
+            partition_progress.partition_id = entry.identifier();
+            partition_progress.bytes_written = 0;
+            partition_progress.partition_size = 0;
+            partition_progress.partition_percentage = 100.0;
+            partition_progress.current_operation = "Erasing";
+            partition_progress.status = FlashStatus::COMPLETE;
+            progress.partition_progress.push_back(partition_progress);
+            std::cout << "SamsungStrategy: " << partition_progress.partition_name
+                      << " will be replaced when written" << std::endl;
+        }
+        progress.current_partition = progress.partition_progress.back().partition_name;
+        update_progress(progress);
+        return true;
+    }
+    
+    // Archive data is read ahead in ARCHIVE_BUFFER_COUNT buffers of about
+    // ARCHIVE_READ_SIZE bytes, each sent with one write
+    static constexpr size_t ARCHIVE_READ_SIZE = 8 * 1024 * 1024;
+    static constexpr size_t ARCHIVE_BUFFER_COUNT = 4;
+    static constexpr uint32_t NO_PARTITION = UINT32_MAX;
+    
+    // Decoder stage of write_archive(): decompresses .lz4 members from in
+    // into out and copies plain ones across. Every buffer handed on is
+    // full except a member's last, so only that one is padded on the
+    // link. Returns an error, or an empty string.
+    static std::string decode_archive_members(BufferPool& in, BufferPool& out, const std::vector<ArchiveMember>& members,
+                                              const std::vector<uint64_t>& image_sizes, std::atomic<int64_t>& busy_ns) {
+        Lz4FrameDecoder decoder;
+        BufferPool::Buffer* pending = nullptr; // output being filled
+        bool stopped = false;                  // the transfer side gave up
+        std::string error;
+        while (BufferPool::Buffer* input = in.next()) {
+            const ArchiveMember& member = members[input->tag];
+            auto start = std::chrono::steady_clock::now();
+            double stalled = out.producer_stalled_seconds();
+            
+            if (!is_lz4_member(member.name)) {
+                BufferPool::Buffer* copy = out.acquire();
+                if (copy) {
+                    std::memcpy(copy->data.data(), input->data.data(), input->size);
+                    copy->size = input->size;
+                    copy->tag = input->tag;
+                    copy->offset = input->offset;
+                    out.submit(copy);
+                }
+                stopped = copy == nullptr;
+            } else {
+                if (input->offset == 0) {
+                    decoder.reset();
+                }
+                bool decoded = decoder.feed(input->filled(), [&](ByteSpan data) {
+                    while (!data.empty()) {
+                        if (!pending && !(pending = out.acquire())) {
+                            stopped = true;
+                            return false;
+                        }
+                        if (pending->size == 0) {
+                            pending->tag = input->tag;
+                            pending->offset = decoder.output_size() - data.size();
+                        }
+                        size_t take = std::min(data.size(), pending->data.size() - pending->size);
+                        std::memcpy(pending->data.data() + pending->size, data.data(), take);
+                        pending->size += take;
+                        data = data.subspan(take);
+                        if (pending->size == pending->data.size()) {
+                            out.submit(pending);
+                            pending = nullptr;
+                        }
+                    }
+                    return true;
+                });
+                if (!decoded && !stopped) {
+                    error = "Failed to decompress " + member.name + ": " + decoder.get_last_error();
+                } else if (decoded && input->offset + input->size == member.size) {
+                    if (!decoder.finished() || decoder.output_size() != image_sizes[input->tag]) {
+                        error = member.name + " decompressed to " + std::to_string(decoder.output_size()) +
+                                " bytes instead of " + std::to_string(image_sizes[input->tag]);
+                    } else if (pending) {
+                        out.submit(pending);
+                        pending = nullptr;
+                    }
+                }
+            }
+            
+            // Time spent waiting for a free output buffer is a stall, not work
+            double waited = out.producer_stalled_seconds() - stalled;
+            busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() -
+                       static_cast<int64_t>(waited * 1e9);
+            in.release(input);
+            if (stopped || !error.empty()) {
+                break;
+            }
+        }
+        if (pending) {
+            out.release(pending);
+        }
+        if (stopped || !error.empty()) {
+            // Unblock the reader, and the transfer when the error is ours
+            in.cancel();
+            if (!error.empty()) {
+                out.cancel();
+            }
+        }
+        out.finish();
+        return error;
+    }
+    
+    bool read_sparse_chunks(ByteSpan image, std::vector<SparseChunk>& chunks, uint64_t& logical_size) {
+        SparseImageReader reader;
+        if (!reader.open(image)) {
+            last_error_ = reader.get_last_error();
+            return false;
+        }
+        chunks.reserve(reader.chunk_count());
+        SparseChunk chunk;
+        while (reader.next(chunk)) {
+            chunks.push_back(chunk);
+        }
+        if (!reader.at_end()) {
+            last_error_ = reader.get_last_error();
+            return false;
+        }
+        logical_size = reader.output_size();
+        return true;
+    }
+    
+    // How far into the expanded image the first physical_bytes of the
+    // sparse file reach; a RAW chunk counts as far as its data has gone
+    static uint64_t logical_offset(const std::vector<SparseChunk>& chunks, size_t physical_bytes) {
+        for (const auto& chunk : chunks) {
+            if (chunk.input_offset + chunk.input_size <= physical_bytes) {
+                continue;
+            }
+            size_t payload_offset = chunk.input_size - chunk.data.size();
+            if (chunk.type == SPARSE_CHUNK_RAW && physical_bytes > chunk.input_offset + payload_offset) {
+                return chunk.output_offset + (physical_bytes - chunk.input_offset - payload_offset);
+            }
+            return chunk.output_offset;
+        }
+        return chunks.empty() ? 0 : chunks.back().output_offset + chunks.back().output_size;
+    }
+    
+    void report_write_progress(EnhancedFlashProgress& progress) {
+        auto stats = device_interface_->get_transfer_stats();
+        progress.percentage = progress.total_bytes == 0
+            ? 100.0 : 100.0 * static_cast<double>(progress.bytes_written) / progress.total_bytes;
+        progress.transfer_chunk_size = stats.chunk_size;
+        progress.pipeline_depth = stats.pipeline_depth;
+        progress.throughput_bps = stats.throughput_bps;
+        progress.partition_progress[0].bytes_written = progress.bytes_written;
+        progress.partition_progress[0].partition_percentage = progress.percentage;
+        update_progress(progress);
+    }
 };
 
 } // namespace SamFlash
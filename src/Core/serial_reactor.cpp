@@ -0,0 +1,534 @@
+#include "serial_reactor.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace SamFlash {
+
+namespace {
+    constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+    constexpr int MAX_EVENTS = 64;
+    // epoll_event.data.u64 value reserved for the wakeup eventfd
+    constexpr uint64_t WAKE_TOKEN = 0;
+}
+
+SerialReactor::SerialReactor() : running_(false), next_port_id_(1) {}
+
+SerialReactor::~SerialReactor() {
+    stop();
+}
+
+bool SerialReactor::is_supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef __linux__
+
+bool SerialReactor::start(size_t thread_count) {
+    if (running_) {
+        set_error("Reactor already running");
+        return false;
+    }
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+
+    loops_.clear();
+    for (size_t i = 0; i < thread_count; ++i) {
+        auto loop = std::make_unique<Loop>();
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epoll_fd < 0 || loop->wake_fd < 0) {
+            set_error(std::string("Failed to create reactor loop: ") + std::strerror(errno));
+            if (loop->epoll_fd >= 0) ::close(loop->epoll_fd);
+            if (loop->wake_fd >= 0) ::close(loop->wake_fd);
+            loops_.clear();
+            return false;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = WAKE_TOKEN;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+        loops_.push_back(std::move(loop));
+    }
+
+    running_ = true;
+    for (auto& loop : loops_) {
+        Loop* raw = loop.get();
+        loop->thread = std::thread([this, raw]() { run_loop(raw); });
+    }
+    return true;
+}
+
+void SerialReactor::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    for (auto& loop : loops_) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(loop->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+
+    // Fail any writes that never made it out and release the ports
+    for (auto& loop : loops_) {
+        std::unordered_map<PortId, std::shared_ptr<Port>> ports;
+        {
+            std::lock_guard<std::mutex> lock(loop->mutex);
+            ports.swap(loop->ports);
+        }
+        for (auto& [id, port] : ports) {
+            std::deque<PendingWrite> pending;
+            {
+                std::lock_guard<std::mutex> io_lock(port->io_mutex);
+                pending.swap(port->writes);
+            }
+            for (auto& write : pending) {
+                if (write.completion) write.completion(id, false);
+            }
+        }
+        ::close(loop->epoll_fd);
+        ::close(loop->wake_fd);
+    }
+    loops_.clear();
+}
+
+SerialReactor::PortId SerialReactor::add_port(std::unique_ptr<SerialTransport> transport, PortCallbacks callbacks) {
+    if (!transport) {
+        set_error("Transport is not open");
+        return INVALID_PORT;
+    }
+    auto port = std::make_shared<Port>();
+    port->transport = transport.get();
+    port->callbacks = std::move(callbacks);
+    PortId id = register_port(port);
+    if (id != INVALID_PORT) {
+        port->owned_transport = std::move(transport);
+    }
+    return id;
+}
+
+SerialReactor::PortId SerialReactor::add_port(SerialTransport& transport, PortCallbacks callbacks) {
+    auto port = std::make_shared<Port>();
+    port->transport = &transport;
+    port->callbacks = std::move(callbacks);
+    return register_port(port);
+}
+
+SerialReactor::PortId SerialReactor::register_port(std::shared_ptr<Port> port) {
+    if (!running_) {
+        set_error("Reactor not running");
+        return INVALID_PORT;
+    }
+    if (!port->transport->is_open()) {
+        set_error("Transport is not open");
+        return INVALID_PORT;
+    }
+    int fd = port->transport->native_handle();
+    if (fd < 0) {
+        set_error("Transport does not expose a pollable handle");
+        return INVALID_PORT;
+    }
+
+    // Least loaded loop gets the new port
+    Loop* loop = std::min_element(loops_.begin(), loops_.end(),
+        [](const std::unique_ptr<Loop>& a, const std::unique_ptr<Loop>& b) {
+            return a->port_count < b->port_count;
+        })->get();
+
+    port->id = next_port_id_++;
+    port->fd = fd;
+    port->loop = loop;
+
+    {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        loop->ports[port->id] = port;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u64 = port->id;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        set_error(std::string("Failed to register port: ") + std::strerror(errno));
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        loop->ports.erase(port->id);
+        return INVALID_PORT;
+    }
+    loop->port_count++;
+    return port->id;
+}
+
+std::unique_ptr<SerialTransport> SerialReactor::remove_port(PortId id) {
+    auto port = find_port(id);
+    if (!port) {
+        set_error("Unknown port id: " + std::to_string(id));
+        return nullptr;
+    }
+
+    {
+        // Wait out a callback the worker is running for this port
+        std::lock_guard<std::mutex> callback_lock(port->callback_mutex);
+        detach_port(port);
+    }
+    {
+        Loop* loop = port->loop;
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        loop->ports.erase(port->id);
+        loop->port_count--;
+    }
+
+    // Wait for any in-flight dispatch on the worker to finish with the driver
+    std::deque<PendingWrite> pending;
+    std::unique_ptr<SerialTransport> transport;
+    {
+        std::lock_guard<std::mutex> io_lock(port->io_mutex);
+        pending.swap(port->writes);
+        transport = std::move(port->owned_transport);
+        port->transport = nullptr;
+    }
+    for (auto& write : pending) {
+        if (write.completion) write.completion(id, false);
+    }
+    return transport;
+}
+
+bool SerialReactor::async_write(PortId id, std::vector<uint8_t> data, WriteCompletion completion) {
+    auto port = find_port(id);
+    if (!port) {
+        set_error("Unknown port id: " + std::to_string(id));
+        return false;
+    }
+    if (data.empty()) {
+        if (completion) completion(id, true);
+        return true;
+    }
+
+    std::lock_guard<std::mutex> io_lock(port->io_mutex);
+    PendingWrite write;
+    write.data = std::move(data);
+    write.completion = std::move(completion);
+    port->writes.push_back(std::move(write));
+    // The worker picks the queue up as soon as the port reports writable
+    return port->write_armed || arm_write(*port, true);
+}
+
+void SerialReactor::run_loop(Loop* loop) {
+    std::vector<uint8_t> buffer(READ_BUFFER_SIZE);
+    epoll_event events[MAX_EVENTS];
+
+    while (running_) {
+        int count = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            set_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.u64 == WAKE_TOKEN) {
+                uint64_t value;
+                ssize_t ignored = ::read(loop->wake_fd, &value, sizeof(value));
+                (void)ignored;
+                continue;
+            }
+
+            std::shared_ptr<Port> port;
+            {
+                std::lock_guard<std::mutex> lock(loop->mutex);
+                auto it = loop->ports.find(static_cast<PortId>(events[i].data.u64));
+                if (it == loop->ports.end()) continue;
+                port = it->second;
+            }
+
+            uint32_t flags = events[i].events;
+            if (flags & EPOLLIN) {
+                handle_readable(port, buffer);
+            }
+            if ((flags & EPOLLOUT) && !port->removed) {
+                handle_writable(port);
+            }
+            if ((flags & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) && !port->removed) {
+                handle_error(port, "Port closed or reported an error");
+            }
+        }
+    }
+}
+
+void SerialReactor::handle_readable(const std::shared_ptr<Port>& port, std::vector<uint8_t>& buffer) {
+    // Drain everything the driver has so one wakeup serves a whole burst
+    while (!port->removed) {
+        size_t limit = buffer.size();
+        if (port->callbacks.read_capacity) {
+            limit = std::min(limit, port->callbacks.read_capacity(port->id));
+            if (limit == 0) {
+                pause_reading(port);
+                return;
+            }
+        }
+        size_t bytes_read = 0;
+        bool ok;
+        std::string error;
+        {
+            std::lock_guard<std::mutex> io_lock(port->io_mutex);
+            if (!port->transport) return;
+            ok = port->transport->read_nonblocking(buffer.data(), limit, bytes_read);
+            if (!ok) error = port->transport->get_last_error();
+        }
+        if (!ok) {
+            handle_error(port, "Read failed: " + error);
+            return;
+        }
+        if (bytes_read == 0) {
+            return;
+        }
+        if (port->callbacks.on_data) {
+            std::lock_guard<std::mutex> callback_lock(port->callback_mutex);
+            if (port->removed) {
+                return;
+            }
+            port->callbacks.on_data(port->id, buffer.data(), bytes_read);
+        }
+        if (bytes_read < limit) {
+            return;
+        }
+    }
+}
+
+// Leave the data in the driver until the consumer makes room; the port's
+// hangups and errors are still reported meanwhile
+void SerialReactor::pause_reading(const std::shared_ptr<Port>& port) {
+    std::lock_guard<std::mutex> io_lock(port->io_mutex);
+    if (!port->transport || port->removed) return;
+    port->read_paused = true;
+    update_events(*port);
+    // Room made before the pause took effect has no resume to follow it
+    if (port->callbacks.read_capacity(port->id) > 0) {
+        port->read_paused = false;
+        update_events(*port);
+    }
+}
+
+void SerialReactor::resume_reading(PortId id) {
+    auto port = find_port(id);
+    if (!port) return;
+    std::lock_guard<std::mutex> io_lock(port->io_mutex);
+    if (port->read_paused && !port->removed) {
+        port->read_paused = false;
+        update_events(*port);
+    }
+}
+
+void SerialReactor::handle_writable(const std::shared_ptr<Port>& port) {
+    std::string error;
+    {
+        // Held throughout, so remove_port() can't return while a
+        // completion is still to run
+        std::lock_guard<std::mutex> callback_lock(port->callback_mutex);
+        if (port->removed) return;
+
+        std::vector<PendingWrite> completed;
+        {
+            std::lock_guard<std::mutex> io_lock(port->io_mutex);
+            if (!port->transport) return;
+
+            while (!port->writes.empty()) {
+                PendingWrite& write = port->writes.front();
+                size_t written = 0;
+                if (!port->transport->write_nonblocking(write.data.data() + write.offset,
+                                                        write.data.size() - write.offset, written)) {
+                    error = port->transport->get_last_error();
+                    break;
+                }
+                write.offset += written;
+                if (write.offset < write.data.size()) {
+                    break; // driver buffer full; wait for the next EPOLLOUT
+                }
+                completed.push_back(std::move(write));
+                port->writes.pop_front();
+            }
+
+            if (port->writes.empty() && error.empty()) {
+                arm_write(*port, false);
+            }
+        }
+        for (auto& write : completed) {
+            if (write.completion) write.completion(port->id, true);
+        }
+    }
+    if (!error.empty()) {
+        handle_error(port, "Write failed: " + error);
+    }
+}
+
+void SerialReactor::handle_error(const std::shared_ptr<Port>& port, const std::string& error) {
+    std::lock_guard<std::mutex> callback_lock(port->callback_mutex);
+    if (port->removed) return;
+    detach_port(port);
+
+    std::deque<PendingWrite> pending;
+    {
+        std::lock_guard<std::mutex> io_lock(port->io_mutex);
+        pending.swap(port->writes);
+    }
+    for (auto& write : pending) {
+        if (write.completion) write.completion(port->id, false);
+    }
+    if (port->callbacks.on_error) {
+        port->callbacks.on_error(port->id, error);
+    }
+}
+
+bool SerialReactor::arm_write(Port& port, bool enable) {
+    bool was_armed = port.write_armed;
+    port.write_armed = enable;
+    if (!update_events(port)) {
+        port.write_armed = was_armed;
+        return false;
+    }
+    return true;
+}
+
+// Register the events the port's state calls for; caller holds io_mutex
+bool SerialReactor::update_events(Port& port) {
+    epoll_event ev{};
+    ev.events = EPOLLRDHUP | (port.read_paused ? 0u : EPOLLIN) | (port.write_armed ? EPOLLOUT : 0u);
+    ev.data.u64 = port.id;
+    if (epoll_ctl(port.loop->epoll_fd, EPOLL_CTL_MOD, port.fd, &ev) != 0) {
+        set_error(std::string("Failed to update port events: ") + std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Stop polling the port; it stays registered until remove_port()
+void SerialReactor::detach_port(const std::shared_ptr<Port>& port) {
+    if (port->removed.exchange(true)) {
+        return;
+    }
+    epoll_ctl(port->loop->epoll_fd, EPOLL_CTL_DEL, port->fd, nullptr);
+}
+
+#else // !__linux__
+
+bool SerialReactor::start(size_t thread_count) {
+    (void)thread_count;
+    set_error("SerialReactor requires epoll and is only available on Linux");
+    return false;
+}
+
+void SerialReactor::stop() {
+    running_ = false;
+}
+
+SerialReactor::PortId SerialReactor::add_port(std::unique_ptr<SerialTransport> transport, PortCallbacks callbacks) {
+    (void)transport;
+    (void)callbacks;
+    set_error("SerialReactor requires epoll and is only available on Linux");
+    return INVALID_PORT;
+}
+
+SerialReactor::PortId SerialReactor::add_port(SerialTransport& transport, PortCallbacks callbacks) {
+    (void)transport;
+    (void)callbacks;
+    set_error("SerialReactor requires epoll and is only available on Linux");
+    return INVALID_PORT;
+}
+
+std::unique_ptr<SerialTransport> SerialReactor::remove_port(PortId id) {
+    set_error("Unknown port id: " + std::to_string(id));
+    return nullptr;
+}
+
+void SerialReactor::resume_reading(PortId id) {
+    (void)id;
+}
+
+bool SerialReactor::async_write(PortId id, std::vector<uint8_t> data, WriteCompletion completion) {
+    (void)data;
+    (void)completion;
+    set_error("Unknown port id: " + std::to_string(id));
+    return false;
+}
+
+#endif // __linux__
+
+bool SerialReactor::async_write(PortId id, const uint8_t* data, size_t size, WriteCompletion completion) {
+    return async_write(id, std::vector<uint8_t>(data, data + size), std::move(completion));
+}
+
+bool SerialReactor::is_running() const {
+    return running_;
+}
+
+std::shared_ptr<SerialReactor> SerialReactor::shared_instance() {
+    static std::mutex mutex;
+    static std::weak_ptr<SerialReactor> instance;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto reactor = instance.lock();
+    if (!reactor && is_supported()) {
+        reactor = std::make_shared<SerialReactor>();
+        if (!reactor->start(1)) {
+            return nullptr;
+        }
+        instance = reactor;
+    }
+    return reactor;
+}
+
+SerialTransport* SerialReactor::get_transport(PortId id) {
+    auto port = find_port(id);
+    return port ? port->transport : nullptr;
+}
+
+size_t SerialReactor::port_count() const {
+    size_t count = 0;
+    for (const auto& loop : loops_) {
+        count += loop->port_count;
+    }
+    return count;
+}
+
+std::string SerialReactor::get_last_error() const {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return last_error_;
+}
+
+void SerialReactor::clear_error() {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    last_error_.clear();
+}
+
+std::shared_ptr<SerialReactor::Port> SerialReactor::find_port(PortId id) const {
+    for (const auto& loop : loops_) {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        auto it = loop->ports.find(id);
+        if (it != loop->ports.end()) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+void SerialReactor::set_error(const std::string& error) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    last_error_ = error;
+}
+
+} // namespace SamFlash
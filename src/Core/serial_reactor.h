@@ -0,0 +1,140 @@
+#ifndef SERIAL_REACTOR_H
+#define SERIAL_REACTOR_H
+
+#include "serial_transport.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace SamFlash {
+
+// Event-driven I/O reactor that drives many open serial ports from a small
+// number of threads. Each worker thread owns an epoll instance; ports are
+// assigned to the least loaded worker when they are added. Received data and
+// write completions are delivered through callbacks on the worker threads.
+//
+// Only available on Linux. On other platforms is_supported() returns false
+// and start() fails, so callers can fall back to blocking transports.
+class SerialReactor {
+public:
+    using PortId = uint32_t;
+    static constexpr PortId INVALID_PORT = 0;
+
+    struct PortCallbacks {
+        // Called with every block of data drained from the port
+        std::function<void(PortId, const uint8_t*, size_t)> on_data;
+        // Called once when the port reports an error or hangup; the port is
+        // no longer polled afterwards but stays registered until removed
+        std::function<void(PortId, const std::string&)> on_error;
+        // Optional: how many bytes on_data can take right now. Reads are
+        // capped at it, and at zero the port stops being polled for input
+        // until resume_reading(), so a slow consumer holds up only its
+        // own port and never the worker.
+        std::function<size_t(PortId)> read_capacity;
+    };
+
+    using WriteCompletion = std::function<void(PortId, bool success)>;
+
+    SerialReactor();
+    ~SerialReactor();
+
+    SerialReactor(const SerialReactor&) = delete;
+    SerialReactor& operator=(const SerialReactor&) = delete;
+
+    static bool is_supported();
+
+    // Reactor shared by every receiver in the process: one thread, started
+    // on first use and stopped when the last user lets go. Null where the
+    // reactor isn't supported.
+    static std::shared_ptr<SerialReactor> shared_instance();
+
+    // Lifecycle
+    bool start(size_t thread_count = 1);
+    void stop();
+    bool is_running() const;
+
+    // Port management. The reactor takes ownership of an already open
+    // transport; remove_port() hands it back. A borrowed transport must
+    // outlive its registration, and remove_port() returns null for it.
+    // remove_port() waits for a running callback of the port to return, so
+    // it must not be called from one.
+    PortId add_port(std::unique_ptr<SerialTransport> transport, PortCallbacks callbacks);
+    PortId add_port(SerialTransport& transport, PortCallbacks callbacks);
+    std::unique_ptr<SerialTransport> remove_port(PortId id);
+    SerialTransport* get_transport(PortId id);
+    size_t port_count() const;
+    // Poll a port that ran out of read_capacity again; any thread
+    void resume_reading(PortId id);
+
+    // Queue data for transmission. The completion runs on the worker thread
+    // once all bytes have been handed to the driver (or the write failed).
+    bool async_write(PortId id, std::vector<uint8_t> data, WriteCompletion completion = nullptr);
+    bool async_write(PortId id, const uint8_t* data, size_t size, WriteCompletion completion = nullptr);
+
+    // Error handling
+    std::string get_last_error() const;
+    void clear_error();
+
+private:
+    struct PendingWrite {
+        std::vector<uint8_t> data;
+        size_t offset = 0;
+        WriteCompletion completion;
+    };
+
+    struct Loop;
+
+    struct Port {
+        PortId id = INVALID_PORT;
+        std::unique_ptr<SerialTransport> owned_transport; // null when borrowed
+        SerialTransport* transport = nullptr;
+        int fd = -1;
+        PortCallbacks callbacks;
+        Loop* loop = nullptr;
+
+        std::mutex io_mutex;                // serializes driver access
+        std::deque<PendingWrite> writes;    // guarded by io_mutex
+        bool write_armed = false;           // EPOLLOUT registered; guarded by io_mutex
+        bool read_paused = false;           // EPOLLIN dropped; guarded by io_mutex
+        std::mutex callback_mutex;          // held while a callback runs
+        std::atomic<bool> removed{false};   // no longer polled
+    };
+
+    struct Loop {
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        std::thread thread;
+        std::mutex mutex;
+        std::unordered_map<PortId, std::shared_ptr<Port>> ports; // guarded by mutex
+        std::atomic<size_t> port_count{0};
+    };
+
+    PortId register_port(std::shared_ptr<Port> port);
+    void run_loop(Loop* loop);
+    void handle_readable(const std::shared_ptr<Port>& port, std::vector<uint8_t>& buffer);
+    void handle_writable(const std::shared_ptr<Port>& port);
+    void handle_error(const std::shared_ptr<Port>& port, const std::string& error);
+    bool arm_write(Port& port, bool enable);
+    bool update_events(Port& port);
+    void pause_reading(const std::shared_ptr<Port>& port);
+    std::shared_ptr<Port> find_port(PortId id) const;
+    void detach_port(const std::shared_ptr<Port>& port);
+    void set_error(const std::string& error);
+
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<bool> running_;
+    std::atomic<PortId> next_port_id_;
+    mutable std::mutex error_mutex_;
+    std::string last_error_;
+};
+
+} // namespace SamFlash
+
+#endif // SERIAL_REACTOR_H
@@ -0,0 +1,224 @@
+#include "serial_receiver.h"
+#include <vector>
+
+namespace SamFlash {
+
+namespace {
+    // Upper bound on how long stop() waits for the receive thread to notice
+    constexpr auto POLL_INTERVAL = std::chrono::milliseconds(50);
+    constexpr size_t DRAIN_CHUNK = 16 * 1024;
+    // Consecutive failed reads before the port is treated as gone
+    constexpr int MAX_READ_FAILURES = 5;
+}
+
+SerialReceiver::SerialReceiver(SerialTransport& transport, size_t ring_capacity)
+    : transport_(transport), ring_(ring_capacity), running_(false) {}
+
+SerialReceiver::~SerialReceiver() {
+    stop();
+}
+
+bool SerialReceiver::start() {
+    if (running_) {
+        return true;
+    }
+    if (!transport_.is_open()) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        last_error_ = "Transport not open";
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&SerialReceiver::run, this);
+    return true;
+}
+
+bool SerialReceiver::start(SerialReactor& reactor) {
+    if (running_) {
+        return true;
+    }
+    SerialReactor::PortCallbacks callbacks;
+    // Reads are capped at the ring's free space, so store() never waits on
+    // the reactor thread; a full ring pauses this port until room is made
+    callbacks.on_data = [this](SerialReactor::PortId, const uint8_t* data, size_t size) {
+        store(data, size);
+    };
+    callbacks.read_capacity = [this](SerialReactor::PortId) {
+        size_t space = ring_.free_space();
+        if (space == 0) {
+            reading_paused_ = true;
+        }
+        return space;
+    };
+    callbacks.on_error = [this](SerialReactor::PortId, const std::string& error) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            last_error_ = "Receive failed: " + error;
+        }
+        // Nothing more will arrive; fail waiting callers now
+        running_ = false;
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+        }
+        data_cv_.notify_all();
+    };
+    running_ = true;
+    reading_paused_ = false;
+    port_id_ = reactor.add_port(transport_, std::move(callbacks));
+    if (port_id_ == SerialReactor::INVALID_PORT) {
+        running_ = false;
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        last_error_ = reactor.get_last_error();
+        return false;
+    }
+    reactor_ = &reactor;
+    return true;
+}
+
+void SerialReceiver::stop() {
+    // A port error may already have cleared running_; the reactor still
+    // holds the port until it is removed
+    running_ = false;
+    space_cv_.notify_all();
+    if (reactor_) {
+        reactor_->remove_port(port_id_);
+        reactor_ = nullptr;
+        port_id_ = SerialReactor::INVALID_PORT;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    data_cv_.notify_all();
+}
+
+bool SerialReceiver::is_running() const {
+    return running_;
+}
+
+void SerialReceiver::run() {
+    std::vector<uint8_t> chunk(DRAIN_CHUNK);
+    int failures = 0;
+
+    while (running_) {
+        if (!transport_.wait_readable(POLL_INTERVAL)) {
+            continue;
+        }
+
+        // Readable with nothing to read means the other end hung up
+        size_t bytes_read = 0;
+        bool ok = transport_.read_nonblocking(chunk.data(), chunk.size(), bytes_read);
+        if (ok && bytes_read > 0) {
+            failures = 0;
+            store(chunk.data(), bytes_read);
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            last_error_ = "Receive failed: " + (ok ? std::string("port closed") : transport_.get_last_error());
+        }
+        // A persistent error would otherwise spin; back off, then give up
+        // and fail waiting callers like a reactor port error does
+        if (++failures >= MAX_READ_FAILURES) {
+            running_ = false;
+            {
+                std::lock_guard<std::mutex> lock(wait_mutex_);
+            }
+            data_cv_.notify_all();
+            break;
+        }
+        std::this_thread::sleep_for(POLL_INTERVAL * failures);
+    }
+}
+
+void SerialReceiver::store(const uint8_t* data, size_t size) {
+    size_t stored = 0;
+    while (stored < size && running_) {
+        stored += ring_.write(data + stored, size - stored);
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+        }
+        data_cv_.notify_all();
+
+        if (stored < size) {
+            // Consumer is behind; wait for room rather than dropping bytes
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            space_cv_.wait_for(lock, POLL_INTERVAL, [this]() {
+                return ring_.free_space() > 0 || !running_;
+            });
+        }
+    }
+}
+
+bool SerialReceiver::wait_for_frame(IResponseFramer& framer, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    uint8_t scratch[4096];
+
+    while (!framer.is_complete()) {
+        size_t available = ring_.peek(scratch, sizeof(scratch));
+        if (available > 0) {
+            ring_.skip(framer.consume(scratch, available));
+            space_freed();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        if (!data_cv_.wait_until(lock, deadline, [this]() { return !ring_.empty() || !running_; })) {
+            return false;
+        }
+        if (ring_.empty() && !running_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SerialReceiver::read_exact(MutableByteSpan buffer, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t filled = 0;
+
+    while (filled < buffer.size()) {
+        size_t copied = ring_.read(buffer.data() + filled, buffer.size() - filled);
+        if (copied > 0) {
+            filled += copied;
+            space_freed();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        if (!data_cv_.wait_until(lock, deadline, [this]() { return !ring_.empty() || !running_; })) {
+            return false;
+        }
+        if (ring_.empty() && !running_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SerialReceiver::wait_for_data(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    return data_cv_.wait_for(lock, timeout, [this]() { return !ring_.empty(); });
+}
+
+size_t SerialReceiver::bytes_buffered() const {
+    return ring_.size();
+}
+
+void SerialReceiver::discard() {
+    ring_.clear();
+    space_freed();
+}
+
+void SerialReceiver::space_freed() {
+    space_cv_.notify_one();
+    if (reading_paused_.exchange(false) && reactor_) {
+        reactor_->resume_reading(port_id_);
+    }
+}
+
+std::string SerialReceiver::get_last_error() const {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return last_error_;
+}
+
+} // namespace SamFlash
@@ -0,0 +1,78 @@
+#ifndef SERIAL_RECEIVER_H
+#define SERIAL_RECEIVER_H
+
+#include "serial_transport.h"
+#include "serial_reactor.h"
+#include "ring_buffer.h"
+#include "response_framer.h"
+#include "byte_span.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace SamFlash {
+
+// Per-port background receiver. A dedicated thread, or a reactor thread
+// shared with other ports, drains the transport into a lock-free ring as
+// soon as the driver has data; callers block in wait_for_frame() and are
+// woken the moment a complete response has been assembled, instead of
+// sleeping for a fixed interval.
+class SerialReceiver {
+public:
+    explicit SerialReceiver(SerialTransport& transport, size_t ring_capacity = 256 * 1024);
+    ~SerialReceiver();
+
+    SerialReceiver(const SerialReceiver&) = delete;
+    SerialReceiver& operator=(const SerialReceiver&) = delete;
+
+    bool start();
+    // Drain on the reactor's threads instead of one of our own. The
+    // reactor must stay running until stop().
+    bool start(SerialReactor& reactor);
+    void stop();
+    bool is_running() const;
+
+    // Feed buffered bytes to the framer until it completes or the timeout
+    // expires. Bytes after the frame stay buffered for the next call.
+    bool wait_for_frame(IResponseFramer& framer, std::chrono::milliseconds timeout);
+
+    // Copy exactly buffer.size() bytes out of the ring, straight into the
+    // caller's buffer. Used for raw reads whose length is known up front.
+    bool read_exact(MutableByteSpan buffer, std::chrono::milliseconds timeout);
+
+    // Wait until at least one byte is buffered
+    bool wait_for_data(std::chrono::milliseconds timeout);
+
+    size_t bytes_buffered() const;
+    void discard();
+
+    std::string get_last_error() const;
+
+private:
+    void run();
+    void store(const uint8_t* data, size_t size);
+    void space_freed();
+
+    SerialTransport& transport_;
+    SpscByteRing ring_;
+    std::thread thread_;
+    SerialReactor* reactor_ = nullptr;
+    SerialReactor::PortId port_id_ = SerialReactor::INVALID_PORT;
+    std::atomic<bool> running_;
+    std::atomic<bool> reading_paused_{false}; // reactor stopped polling for a full ring
+
+    // Only used to park the consumer; the data path itself is lock-free
+    mutable std::mutex wait_mutex_;
+    std::condition_variable data_cv_;
+    std::condition_variable space_cv_;
+
+    mutable std::mutex error_mutex_;
+    std::string last_error_;
+};
+
+} // namespace SamFlash
+
+#endif // SERIAL_RECEIVER_H
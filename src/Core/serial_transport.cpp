@@ -2,7 +2,7 @@
 #include <thread>
 #include <chrono>
 
-#ifdef HAVE_LIBSERIALPORT
+#if defined(HAVE_LIBSERIALPORT) && !defined(SAMFLASH_TERMIOS_BACKEND)
 
 namespace SamFlash {
 
@@ -146,22 +146,39 @@ bool SerialTransport::read(uint8_t* buffer, size_t size, size_t& bytes_read) {
     return true;
 }
 
+bool SerialTransport::write(ByteSpan data) {
+    return write(data.data(), data.size());
+}
+
+bool SerialTransport::read(MutableByteSpan buffer, size_t& bytes_read) {
+    return read(buffer.data(), buffer.size(), bytes_read);
+}
+
 bool SerialTransport::write_bulk(const std::vector<uint8_t>& data, 
                                std::function<void(const TransferProgress&)> progress_callback) {
+    return write_bulk(ByteSpan(data), progress_callback);
+}
+
+bool SerialTransport::write_bulk(ByteSpan data,
+                               std::function<void(const TransferProgress&)> progress_callback) {
     if (!check_port_open()) return false;
     
-    const size_t chunk_size = 1024; // 1KB chunks for progress reporting
     const size_t total_bytes = data.size();
     size_t bytes_written = 0;
     auto start_time = std::chrono::steady_clock::now();
     
     while (bytes_written < total_bytes) {
-        size_t current_chunk = std::min(chunk_size, total_bytes - bytes_written);
+        // Chunk size follows what the link has been sustaining
+        size_t current_chunk = std::min<size_t>(write_chunker_.chunk_size(), total_bytes - bytes_written);
+        auto chunk_start = std::chrono::steady_clock::now();
         
         if (!write(data.data() + bytes_written, current_chunk)) {
+            write_chunker_.record_timeout();
             return false;
         }
         
+        auto chunk_time = std::chrono::steady_clock::now() - chunk_start;
+        write_chunker_.record(current_chunk, chunk_time, chunk_time);
         bytes_written += current_chunk;
         
         if (progress_callback) {
@@ -170,6 +187,8 @@ bool SerialTransport::write_bulk(const std::vector<uint8_t>& data,
             progress.total_bytes = total_bytes;
             progress.percentage = (double(bytes_written) / total_bytes) * 100.0;
             progress.operation = "Writing";
+            progress.chunk_size = current_chunk;
+            progress.throughput_bps = write_chunker_.throughput_bps();
             progress.start_time = start_time;
             progress.elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start_time);
@@ -191,25 +210,36 @@ bool SerialTransport::write_bulk(const std::vector<uint8_t>& data,
 
 std::vector<uint8_t> SerialTransport::read_bulk(size_t expected_bytes,
                                               std::function<void(const TransferProgress&)> progress_callback) {
-    std::vector<uint8_t> data;
-    if (!check_port_open()) return data;
+    std::vector<uint8_t> data(expected_bytes);
+    if (!read_bulk(MutableByteSpan(data), progress_callback)) {
+        return std::vector<uint8_t>();
+    }
+    return data;
+}
+
+bool SerialTransport::read_bulk(MutableByteSpan buffer,
+                              std::function<void(const TransferProgress&)> progress_callback) {
+    if (!check_port_open()) return false;
     
-    const size_t chunk_size = 1024; // 1KB chunks for progress reporting
-    data.reserve(expected_bytes);
+    const size_t expected_bytes = buffer.size();
     size_t bytes_read = 0;
     auto start_time = std::chrono::steady_clock::now();
     
     while (bytes_read < expected_bytes) {
-        size_t current_chunk = std::min(chunk_size, expected_bytes - bytes_read);
-        auto chunk_data = read(current_chunk);
+        size_t current_chunk = std::min<size_t>(read_chunker_.chunk_size(), expected_bytes - bytes_read);
+        size_t chunk_read = 0;
+        auto chunk_start = std::chrono::steady_clock::now();
         
-        if (chunk_data.empty()) {
+        // Read straight into the caller's buffer
+        if (!read(buffer.data() + bytes_read, current_chunk, chunk_read) || chunk_read == 0) {
+            read_chunker_.record_timeout();
             last_error_ = "Failed to read expected data";
-            return std::vector<uint8_t>();
+            return false;
         }
         
-        data.insert(data.end(), chunk_data.begin(), chunk_data.end());
-        bytes_read += chunk_data.size();
+        auto chunk_time = std::chrono::steady_clock::now() - chunk_start;
+        read_chunker_.record(chunk_read, chunk_time, chunk_time);
+        bytes_read += chunk_read;
         
         if (progress_callback) {
             TransferProgress progress;
@@ -217,6 +247,8 @@ std::vector<uint8_t> SerialTransport::read_bulk(size_t expected_bytes,
             progress.total_bytes = expected_bytes;
             progress.percentage = (double(bytes_read) / expected_bytes) * 100.0;
             progress.operation = "Reading";
+            progress.chunk_size = current_chunk;
+            progress.throughput_bps = read_chunker_.throughput_bps();
             progress.start_time = start_time;
             progress.elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start_time);
@@ -233,7 +265,7 @@ std::vector<uint8_t> SerialTransport::read_bulk(size_t expected_bytes,
         }
     }
     
-    return data;
+    return true;
 }
 
 bool SerialTransport::flush() {
@@ -248,10 +280,72 @@ size_t SerialTransport::bytes_available() {
     return sp_input_waiting(port_);
 }
 
+size_t SerialTransport::bytes_pending_output() {
+    int waiting = sp_output_waiting(port_);
+    return waiting > 0 ? static_cast<size_t>(waiting) : 0;
+}
+
 bool SerialTransport::clear_buffers() {
     return flush();
 }
 
+bool SerialTransport::wait_readable(std::chrono::milliseconds timeout) {
+    if (!check_port_open()) return false;
+    if (sp_input_waiting(port_) > 0) return true;
+
+    struct sp_event_set* events = nullptr;
+    if (sp_new_event_set(&events) != SP_OK) {
+        last_error_ = "Failed to create event set";
+        return false;
+    }
+    bool ready = false;
+    if (sp_add_port_events(events, port_, SP_EVENT_RX_READY) == SP_OK &&
+        sp_wait(events, static_cast<unsigned int>(timeout.count())) == SP_OK) {
+        ready = sp_input_waiting(port_) > 0;
+    }
+    sp_free_event_set(events);
+    return ready;
+}
+
+bool SerialTransport::read_nonblocking(uint8_t* buffer, size_t size, size_t& bytes_read) {
+    bytes_read = 0;
+    if (!check_port_open()) return false;
+
+    int result = sp_nonblocking_read(port_, buffer, size);
+    if (result < 0) {
+        set_error_from_result(static_cast<sp_return>(result));
+        return false;
+    }
+    bytes_read = static_cast<size_t>(result);
+    return true;
+}
+
+bool SerialTransport::write_nonblocking(const uint8_t* data, size_t size, size_t& bytes_written) {
+    bytes_written = 0;
+    if (!check_port_open()) return false;
+
+    int result = sp_nonblocking_write(port_, data, size);
+    if (result < 0) {
+        set_error_from_result(static_cast<sp_return>(result));
+        return false;
+    }
+    bytes_written = static_cast<size_t>(result);
+    return true;
+}
+
+int SerialTransport::native_handle() const {
+#ifdef _WIN32
+    return -1; // HANDLE-based; not usable with the epoll reactor
+#else
+    if (!is_open_) return -1;
+    int fd = -1;
+    if (sp_get_port_handle(port_, &fd) != SP_OK) {
+        return -1;
+    }
+    return fd;
+#endif
+}
+
 bool SerialTransport::set_dtr(bool state) {
     return (sp_set_dtr(port_, state) == SP_OK);
 }
@@ -357,8 +451,8 @@ bool SerialTransport::check_port_open() {
 
 #endif // HAVE_LIBSERIALPORT
 
-// Include stub implementation if libserialport is not available
-#ifndef HAVE_LIBSERIALPORT
+// Include stub implementation if no real backend is available
+#if !defined(HAVE_LIBSERIALPORT) && !defined(SAMFLASH_TERMIOS_BACKEND)
 #include "serial_transport_stub.cpp"
 #endif
 
@@ -6,8 +6,10 @@
 #include <memory>
 #include <functional>
 #include <chrono>
+#include "byte_span.h"
+#include "adaptive_chunker.h"
 
-#ifdef HAVE_LIBSERIALPORT
+#if defined(HAVE_LIBSERIALPORT) && !defined(SAMFLASH_TERMIOS_BACKEND)
 #include <libserialport.h>
 #endif
 
@@ -62,6 +64,8 @@ struct TransferProgress {
     std::chrono::steady_clock::time_point start_time;
     std::chrono::milliseconds elapsed_time;
     double estimated_remaining_seconds;
+    size_t chunk_size = 0;       // chunk the adaptive controller is using
+    double throughput_bps = 0.0; // link rate it last measured
 };
 
 class SerialTransport {
@@ -82,21 +86,35 @@ public:
     // I/O operations
     bool write(const std::vector<uint8_t>& data);
     bool write(const uint8_t* data, size_t size);
+    bool write(ByteSpan data);
     std::vector<uint8_t> read(size_t max_bytes = 4096);
     bool read(uint8_t* buffer, size_t size, size_t& bytes_read);
+    bool read(MutableByteSpan buffer, size_t& bytes_read);
     
     // Bulk operations with progress reporting
     bool write_bulk(const std::vector<uint8_t>& data, 
                    std::function<void(const TransferProgress&)> progress_callback = nullptr);
+    bool write_bulk(ByteSpan data,
+                   std::function<void(const TransferProgress&)> progress_callback = nullptr);
     std::vector<uint8_t> read_bulk(size_t expected_bytes,
                                   std::function<void(const TransferProgress&)> progress_callback = nullptr);
+    // Fills the caller's buffer completely; no intermediate allocations
+    bool read_bulk(MutableByteSpan buffer,
+                   std::function<void(const TransferProgress&)> progress_callback = nullptr);
     
     // Flow control and status
     bool flush();
     bool drain();
-    size_t bytes_available();
+    size_t bytes_available();      // kernel input queue
+    size_t bytes_pending_output(); // kernel output queue, not yet on the wire
     bool clear_buffers();
     
+    // Readiness and non-blocking I/O (used by SerialReactor)
+    bool wait_readable(std::chrono::milliseconds timeout);
+    bool read_nonblocking(uint8_t* buffer, size_t size, size_t& bytes_read);
+    bool write_nonblocking(const uint8_t* data, size_t size, size_t& bytes_written);
+    int native_handle() const; // OS file descriptor, or -1 if not available
+    
     // Signal control
     bool set_dtr(bool state);
     bool set_rts(bool state);
@@ -119,7 +137,15 @@ public:
     SerialPortInfo get_port_info() const;
 
 private:
-#ifdef HAVE_LIBSERIALPORT
+#if defined(SAMFLASH_TERMIOS_BACKEND)
+    int fd_;
+    std::string port_name_;
+    // Read mode currently applied to the descriptor, so per-call changes
+    // only cost a syscall when something differs
+    bool blocking_reads_ = false;
+    uint8_t vmin_ = 0;
+    uint8_t vtime_ = 0;
+#elif defined(HAVE_LIBSERIALPORT)
     struct sp_port* port_;
 #else
     void* port_; // Placeholder for stub implementation
@@ -128,8 +154,17 @@ private:
     std::string last_error_;
     bool is_open_;
     
+    // Bulk chunk sizes adapt to the link and carry over between calls
+    AdaptiveChunker write_chunker_{AdaptiveChunker::Limits{64, 64 * 1024, 64, 1, 1}, 1024};
+    AdaptiveChunker read_chunker_{AdaptiveChunker::Limits{64, 64 * 1024, 64, 1, 1}, 1024};
+    
     // Helper methods
-#ifdef HAVE_LIBSERIALPORT
+#if defined(SAMFLASH_TERMIOS_BACKEND)
+    bool set_read_mode(bool blocking, uint8_t vmin, uint8_t vtime);
+    bool enable_low_latency();
+    bool get_modem_line(int line);
+    void set_error_from_errno(const std::string& context);
+#elif defined(HAVE_LIBSERIALPORT)
     sp_parity convert_parity(SerialParity parity) const;
     sp_stopbits convert_stop_bits(SerialStopBits stop_bits) const;
     sp_flowcontrol convert_flow_control(SerialFlowControl flow_control) const;
@@ -2,7 +2,7 @@
 #include <thread>
 #include <chrono>
 
-#ifndef HAVE_LIBSERIALPORT
+#if !defined(HAVE_LIBSERIALPORT) && !defined(SAMFLASH_TERMIOS_BACKEND)
 
 namespace SamFlash {
 
@@ -82,10 +82,12 @@ bool SerialTransport::write(const uint8_t* data, size_t size) {
 }
 
 std::vector<uint8_t> SerialTransport::read(size_t max_bytes) {
-    std::vector<uint8_t> data;
-    size_t bytes_read;
+    std::vector<uint8_t> data(max_bytes);
+    size_t bytes_read = 0;
     if (read(data.data(), max_bytes, bytes_read)) {
         data.resize(bytes_read);
+    } else {
+        data.clear();
     }
     return data;
 }
@@ -105,22 +107,39 @@ bool SerialTransport::read(uint8_t* buffer, size_t size, size_t& bytes_read) {
     return true;
 }
 
+bool SerialTransport::write(ByteSpan data) {
+    return write(data.data(), data.size());
+}
+
+bool SerialTransport::read(MutableByteSpan buffer, size_t& bytes_read) {
+    return read(buffer.data(), buffer.size(), bytes_read);
+}
+
 bool SerialTransport::write_bulk(const std::vector<uint8_t>& data, 
                                std::function<void(const TransferProgress&)> progress_callback) {
+    return write_bulk(ByteSpan(data), progress_callback);
+}
+
+bool SerialTransport::write_bulk(ByteSpan data,
+                               std::function<void(const TransferProgress&)> progress_callback) {
     if (!check_port_open()) return false;
     
-    const size_t chunk_size = 1024;
     const size_t total_bytes = data.size();
     size_t bytes_written = 0;
     auto start_time = std::chrono::steady_clock::now();
     
     while (bytes_written < total_bytes) {
-        size_t current_chunk = std::min(chunk_size, total_bytes - bytes_written);
+        // Chunk size follows what the link has been sustaining
+        size_t current_chunk = std::min<size_t>(write_chunker_.chunk_size(), total_bytes - bytes_written);
+        auto chunk_start = std::chrono::steady_clock::now();
         
         if (!write(data.data() + bytes_written, current_chunk)) {
+            write_chunker_.record_timeout();
             return false;
         }
         
+        auto chunk_time = std::chrono::steady_clock::now() - chunk_start;
+        write_chunker_.record(current_chunk, chunk_time, chunk_time);
         bytes_written += current_chunk;
         
         if (progress_callback) {
@@ -129,6 +148,8 @@ bool SerialTransport::write_bulk(const std::vector<uint8_t>& data,
             progress.total_bytes = total_bytes;
             progress.percentage = (double(bytes_written) / total_bytes) * 100.0;
             progress.operation = "Writing";
+            progress.chunk_size = current_chunk;
+            progress.throughput_bps = write_chunker_.throughput_bps();
             progress.start_time = start_time;
             progress.elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start_time);
@@ -150,25 +171,36 @@ bool SerialTransport::write_bulk(const std::vector<uint8_t>& data,
 
 std::vector<uint8_t> SerialTransport::read_bulk(size_t expected_bytes,
                                               std::function<void(const TransferProgress&)> progress_callback) {
-    std::vector<uint8_t> data;
-    if (!check_port_open()) return data;
+    std::vector<uint8_t> data(expected_bytes);
+    if (!read_bulk(MutableByteSpan(data), progress_callback)) {
+        return std::vector<uint8_t>();
+    }
+    return data;
+}
+
+bool SerialTransport::read_bulk(MutableByteSpan buffer,
+                              std::function<void(const TransferProgress&)> progress_callback) {
+    if (!check_port_open()) return false;
     
-    const size_t chunk_size = 1024;
-    data.reserve(expected_bytes);
+    const size_t expected_bytes = buffer.size();
     size_t bytes_read = 0;
     auto start_time = std::chrono::steady_clock::now();
     
     while (bytes_read < expected_bytes) {
-        size_t current_chunk = std::min(chunk_size, expected_bytes - bytes_read);
-        auto chunk_data = read(current_chunk);
+        size_t current_chunk = std::min<size_t>(read_chunker_.chunk_size(), expected_bytes - bytes_read);
+        size_t chunk_read = 0;
+        auto chunk_start = std::chrono::steady_clock::now();
         
-        if (chunk_data.empty()) {
+        // Read straight into the caller's buffer
+        if (!read(buffer.data() + bytes_read, current_chunk, chunk_read) || chunk_read == 0) {
+            read_chunker_.record_timeout();
             last_error_ = "Failed to read expected data";
-            return std::vector<uint8_t>();
+            return false;
         }
         
-        data.insert(data.end(), chunk_data.begin(), chunk_data.end());
-        bytes_read += chunk_data.size();
+        auto chunk_time = std::chrono::steady_clock::now() - chunk_start;
+        read_chunker_.record(chunk_read, chunk_time, chunk_time);
+        bytes_read += chunk_read;
         
         if (progress_callback) {
             TransferProgress progress;
@@ -176,6 +208,8 @@ std::vector<uint8_t> SerialTransport::read_bulk(size_t expected_bytes,
             progress.total_bytes = expected_bytes;
             progress.percentage = (double(bytes_read) / expected_bytes) * 100.0;
             progress.operation = "Reading";
+            progress.chunk_size = current_chunk;
+            progress.throughput_bps = read_chunker_.throughput_bps();
             progress.start_time = start_time;
             progress.elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start_time);
@@ -192,7 +226,7 @@ std::vector<uint8_t> SerialTransport::read_bulk(size_t expected_bytes,
         }
     }
     
-    return data;
+    return true;
 }
 
 bool SerialTransport::flush() {
@@ -207,10 +241,39 @@ size_t SerialTransport::bytes_available() {
     return 0;
 }
 
+size_t SerialTransport::bytes_pending_output() {
+    return 0;
+}
+
 bool SerialTransport::clear_buffers() {
     return true;
 }
 
+bool SerialTransport::wait_readable(std::chrono::milliseconds timeout) {
+    // The stub never receives unsolicited data; behave like an idle port
+    std::this_thread::sleep_for(timeout);
+    return false;
+}
+
+bool SerialTransport::read_nonblocking(uint8_t* buffer, size_t size, size_t& bytes_read) {
+    (void)buffer;
+    (void)size;
+    bytes_read = 0;
+    return check_port_open();
+}
+
+bool SerialTransport::write_nonblocking(const uint8_t* data, size_t size, size_t& bytes_written) {
+    (void)data;
+    bytes_written = 0;
+    if (!check_port_open()) return false;
+    bytes_written = size;
+    return true;
+}
+
+int SerialTransport::native_handle() const {
+    return -1;
+}
+
 bool SerialTransport::set_dtr(bool state) {
     return true;
 }
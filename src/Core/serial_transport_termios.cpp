@@ -0,0 +1,648 @@
+#include "serial_transport.h"
+#include <thread>
+#include <chrono>
+
+#ifdef SAMFLASH_TERMIOS_BACKEND
+
+// termios2 (arbitrary baud rates) comes from the kernel headers, which
+// clash with <termios.h>; everything here goes through ioctl directly
+#include <asm/termbits.h>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+namespace SamFlash {
+
+namespace {
+    // Inter-byte gap (deciseconds) after which a blocking read returns what
+    // it has; the overall timeout is enforced with poll() before each read
+    constexpr cc_t READ_INTER_BYTE_DECISECONDS = 1;
+    constexpr size_t MAX_VMIN = 255;
+    // How far up from the tty device to look for USB descriptor attributes
+    constexpr int USB_ATTRIBUTE_SEARCH_DEPTH = 4;
+
+    std::string read_sysfs_attribute(const std::string& directory, const char* name) {
+        std::ifstream file(directory + "/" + name);
+        std::string value;
+        std::getline(file, value);
+        return value;
+    }
+
+    std::string canonical_path(const std::string& path) {
+        char resolved[PATH_MAX];
+        if (::realpath(path.c_str(), resolved) == nullptr) {
+            return std::string();
+        }
+        return resolved;
+    }
+
+    int remaining_ms(std::chrono::steady_clock::time_point deadline) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        return static_cast<int>(std::max<int64_t>(0, left.count()));
+    }
+
+    // Wait for the descriptor to become ready; false on timeout or error
+    bool poll_fd(int fd, short events, int timeout_ms) {
+        struct pollfd pfd = {fd, events, 0};
+        while (true) {
+            int result = ::poll(&pfd, 1, timeout_ms);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            return result > 0 && (pfd.revents & events) != 0;
+        }
+    }
+}
+
+SerialTransport::SerialTransport() : fd_(-1), is_open_(false) {}
+
+SerialTransport::~SerialTransport() {
+    if (is_open_) {
+        close();
+    }
+}
+
+std::vector<SerialPortInfo> SerialTransport::enumerate_ports() {
+    std::vector<SerialPortInfo> ports;
+
+    // Every tty backed by real hardware has a device link in sysfs
+    DIR* dir = ::opendir("/sys/class/tty");
+    if (dir == nullptr) {
+        return ports;
+    }
+    while (struct dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        std::string device_dir = canonical_path("/sys/class/tty/" + name + "/device");
+        if (device_dir.empty()) {
+            continue;
+        }
+        // Legacy 8250 ports are always registered whether or not a UART exists
+        std::string driver = canonical_path(device_dir + "/driver");
+        if (driver.size() >= 10 && driver.compare(driver.size() - 10, 10, "serial8250") == 0) {
+            continue;
+        }
+
+        SerialPortInfo info;
+        info.port_name = "/dev/" + name;
+        info.description = name;
+
+        // USB adapters: the descriptor attributes live on an ancestor
+        std::string usb_dir = device_dir;
+        for (int depth = 0; depth < USB_ATTRIBUTE_SEARCH_DEPTH && usb_dir.size() > 1; ++depth) {
+            std::string vendor = read_sysfs_attribute(usb_dir, "idVendor");
+            if (!vendor.empty()) {
+                info.vendor_id = static_cast<uint16_t>(std::strtoul(vendor.c_str(), nullptr, 16));
+                info.product_id = static_cast<uint16_t>(std::strtoul(read_sysfs_attribute(usb_dir, "idProduct").c_str(), nullptr, 16));
+                info.manufacturer = read_sysfs_attribute(usb_dir, "manufacturer");
+                info.product = read_sysfs_attribute(usb_dir, "product");
+                info.serial_number = read_sysfs_attribute(usb_dir, "serial");
+                if (!info.product.empty()) {
+                    info.description = info.product + " (" + name + ")";
+                }
+                break;
+            }
+            usb_dir = usb_dir.substr(0, usb_dir.find_last_of('/'));
+        }
+        ports.push_back(info);
+    }
+    ::closedir(dir);
+
+    std::sort(ports.begin(), ports.end(), [](const SerialPortInfo& a, const SerialPortInfo& b) {
+        return a.port_name < b.port_name;
+    });
+    return ports;
+}
+
+bool SerialTransport::open(const std::string& port_name, const SerialConfig& config) {
+    if (is_open_) {
+        last_error_ = "Port already open";
+        return false;
+    }
+
+    // Non-blocking so open doesn't wait for carrier and the reactor can
+    // use the descriptor as is; blocking reads switch modes per call
+    fd_ = ::open(port_name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+        set_error_from_errno("Failed to open port " + port_name);
+        return false;
+    }
+    if (::ioctl(fd_, TIOCEXCL) != 0) {
+        set_error_from_errno("Failed to lock port " + port_name);
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    blocking_reads_ = false;
+
+    is_open_ = configure(config);
+    if (!is_open_) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    // Best effort: not every driver (or a pseudo-terminal) supports it
+    enable_low_latency();
+    port_name_ = port_name;
+    return true;
+}
+
+bool SerialTransport::close() {
+    if (!is_open_) return false;
+    is_open_ = false;
+    ::close(fd_);
+    fd_ = -1;
+    return true;
+}
+
+bool SerialTransport::is_open() const {
+    return is_open_;
+}
+
+bool SerialTransport::configure(const SerialConfig& set_config) {
+    if (fd_ < 0) {
+        last_error_ = "Port is not open";
+        return false;
+    }
+
+    struct termios2 tio;
+    if (::ioctl(fd_, TCGETS2, &tio) != 0) {
+        set_error_from_errno("Failed to read port settings");
+        return false;
+    }
+
+    // Raw mode: no line editing, translation, echo or signals
+    tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+    tio.c_oflag &= ~OPOST;
+    tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    tio.c_cflag |= CLOCAL | CREAD;
+
+    tio.c_cflag &= ~CSIZE;
+    switch (set_config.data_bits) {
+        case 5: tio.c_cflag |= CS5; break;
+        case 6: tio.c_cflag |= CS6; break;
+        case 7: tio.c_cflag |= CS7; break;
+        case 8: tio.c_cflag |= CS8; break;
+        default:
+            last_error_ = "Unsupported data bits: " + std::to_string(set_config.data_bits);
+            return false;
+    }
+
+    tio.c_cflag &= ~(PARENB | PARODD | CMSPAR);
+    switch (set_config.parity) {
+        case SerialParity::NONE: break;
+        case SerialParity::ODD: tio.c_cflag |= PARENB | PARODD; break;
+        case SerialParity::EVEN: tio.c_cflag |= PARENB; break;
+        case SerialParity::MARK: tio.c_cflag |= PARENB | PARODD | CMSPAR; break;
+        case SerialParity::SPACE: tio.c_cflag |= PARENB | CMSPAR; break;
+    }
+
+    switch (set_config.stop_bits) {
+        case SerialStopBits::ONE: tio.c_cflag &= ~CSTOPB; break;
+        case SerialStopBits::TWO: tio.c_cflag |= CSTOPB; break;
+        case SerialStopBits::ONE_HALF:
+            last_error_ = "1.5 stop bits are not supported";
+            return false;
+    }
+
+    tio.c_cflag &= ~CRTSCTS;
+    switch (set_config.flow_control) {
+        case SerialFlowControl::NONE: break;
+        case SerialFlowControl::XON_XOFF: tio.c_iflag |= IXON | IXOFF; break;
+        case SerialFlowControl::RTS_CTS: tio.c_cflag |= CRTSCTS; break;
+        case SerialFlowControl::DTR_DSR:
+            last_error_ = "DTR/DSR flow control is not supported";
+            return false;
+    }
+
+    // Any baud rate, not just the Bxxx constants
+    tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ispeed = static_cast<speed_t>(set_config.baud_rate);
+    tio.c_ospeed = static_cast<speed_t>(set_config.baud_rate);
+
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (::ioctl(fd_, TCSETS2, &tio) != 0) {
+        set_error_from_errno("Failed to apply port settings");
+        return false;
+    }
+    vmin_ = 0;
+    vtime_ = 0;
+
+    config_ = set_config;
+    return true;
+}
+
+SerialConfig SerialTransport::get_config() const {
+    return config_;
+}
+
+bool SerialTransport::write(const std::vector<uint8_t>& data) {
+    return write(data.data(), data.size());
+}
+
+bool SerialTransport::write(const uint8_t* data, size_t size) {
+    if (!check_port_open()) return false;
+
+    auto deadline = std::chrono::steady_clock::now() + config_.write_timeout;
+    size_t bytes_written = 0;
+    while (bytes_written < size) {
+        ssize_t result = ::write(fd_, data + bytes_written, size - bytes_written);
+        if (result > 0) {
+            bytes_written += static_cast<size_t>(result);
+            continue;
+        }
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0 && errno != EAGAIN) {
+            set_error_from_errno("Write failed");
+            return false;
+        }
+        // Output queue full: wait for room
+        if (!poll_fd(fd_, POLLOUT, remaining_ms(deadline))) {
+            last_error_ = "Timeout during write operation";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<uint8_t> SerialTransport::read(size_t max_bytes) {
+    std::vector<uint8_t> data(max_bytes);
+    size_t bytes_read;
+    if (!read(data.data(), max_bytes, bytes_read)) {
+        data.resize(0);
+    } else {
+        data.resize(bytes_read);
+    }
+    return data;
+}
+
+bool SerialTransport::read(uint8_t* buffer, size_t size, size_t& bytes_read) {
+    bytes_read = 0;
+    if (!check_port_open()) return false;
+
+    auto deadline = std::chrono::steady_clock::now() + config_.read_timeout;
+    while (bytes_read < size) {
+        if (!poll_fd(fd_, POLLIN, remaining_ms(deadline))) {
+            last_error_ = "Timeout during read operation";
+            return false;
+        }
+
+        // Data is waiting: let the kernel gather the rest of the request
+        // (up to VMIN bytes, or until the line goes quiet) in one wakeup
+        cc_t vmin = static_cast<cc_t>(std::min(size - bytes_read, MAX_VMIN));
+        if (!set_read_mode(true, vmin, READ_INTER_BYTE_DECISECONDS)) {
+            return false;
+        }
+        ssize_t result = ::read(fd_, buffer + bytes_read, size - bytes_read);
+        if (result < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            set_error_from_errno("Read failed");
+            return false;
+        }
+        bytes_read += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+bool SerialTransport::write(ByteSpan data) {
+    return write(data.data(), data.size());
+}
+
+bool SerialTransport::read(MutableByteSpan buffer, size_t& bytes_read) {
+    return read(buffer.data(), buffer.size(), bytes_read);
+}
+
+bool SerialTransport::write_bulk(const std::vector<uint8_t>& data,
+                               std::function<void(const TransferProgress&)> progress_callback) {
+    return write_bulk(ByteSpan(data), progress_callback);
+}
+
+bool SerialTransport::write_bulk(ByteSpan data,
+                               std::function<void(const TransferProgress&)> progress_callback) {
+    if (!check_port_open()) return false;
+
+    const size_t total_bytes = data.size();
+    size_t bytes_written = 0;
+    auto start_time = std::chrono::steady_clock::now();
+
+    while (bytes_written < total_bytes) {
+        // Chunk size follows what the link has been sustaining
+        size_t current_chunk = std::min<size_t>(write_chunker_.chunk_size(), total_bytes - bytes_written);
+        auto chunk_start = std::chrono::steady_clock::now();
+
+        if (!write(data.data() + bytes_written, current_chunk)) {
+            write_chunker_.record_timeout();
+            return false;
+        }
+
+        auto chunk_time = std::chrono::steady_clock::now() - chunk_start;
+        write_chunker_.record(current_chunk, chunk_time, chunk_time);
+        bytes_written += current_chunk;
+
+        if (progress_callback) {
+            TransferProgress progress;
+            progress.bytes_transferred = bytes_written;
+            progress.total_bytes = total_bytes;
+            progress.percentage = (double(bytes_written) / total_bytes) * 100.0;
+            progress.operation = "Writing";
+            progress.chunk_size = current_chunk;
+            progress.throughput_bps = write_chunker_.throughput_bps();
+            progress.start_time = start_time;
+            progress.elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time);
+
+            if (progress.elapsed_time.count() > 0 && bytes_written > 0) {
+                double bytes_per_ms = double(bytes_written) / progress.elapsed_time.count();
+                double remaining_bytes = total_bytes - bytes_written;
+                progress.estimated_remaining_seconds = remaining_bytes / (bytes_per_ms * 1000.0);
+            } else {
+                progress.estimated_remaining_seconds = 0.0;
+            }
+
+            progress_callback(progress);
+        }
+    }
+
+    return true;
+}
+
+std::vector<uint8_t> SerialTransport::read_bulk(size_t expected_bytes,
+                                              std::function<void(const TransferProgress&)> progress_callback) {
+    std::vector<uint8_t> data(expected_bytes);
+    if (!read_bulk(MutableByteSpan(data), progress_callback)) {
+        return std::vector<uint8_t>();
+    }
+    return data;
+}
+
+bool SerialTransport::read_bulk(MutableByteSpan buffer,
+                              std::function<void(const TransferProgress&)> progress_callback) {
+    if (!check_port_open()) return false;
+
+    const size_t expected_bytes = buffer.size();
+    size_t bytes_read = 0;
+    auto start_time = std::chrono::steady_clock::now();
+
+    while (bytes_read < expected_bytes) {
+        size_t current_chunk = std::min<size_t>(read_chunker_.chunk_size(), expected_bytes - bytes_read);
+        size_t chunk_read = 0;
+        auto chunk_start = std::chrono::steady_clock::now();
+
+        // Read straight into the caller's buffer
+        if (!read(buffer.data() + bytes_read, current_chunk, chunk_read) || chunk_read == 0) {
+            read_chunker_.record_timeout();
+            last_error_ = "Failed to read expected data";
+            return false;
+        }
+
+        auto chunk_time = std::chrono::steady_clock::now() - chunk_start;
+        read_chunker_.record(chunk_read, chunk_time, chunk_time);
+        bytes_read += chunk_read;
+
+        if (progress_callback) {
+            TransferProgress progress;
+            progress.bytes_transferred = bytes_read;
+            progress.total_bytes = expected_bytes;
+            progress.percentage = (double(bytes_read) / expected_bytes) * 100.0;
+            progress.operation = "Reading";
+            progress.chunk_size = current_chunk;
+            progress.throughput_bps = read_chunker_.throughput_bps();
+            progress.start_time = start_time;
+            progress.elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time);
+
+            if (progress.elapsed_time.count() > 0 && bytes_read > 0) {
+                double bytes_per_ms = double(bytes_read) / progress.elapsed_time.count();
+                double remaining_bytes = expected_bytes - bytes_read;
+                progress.estimated_remaining_seconds = remaining_bytes / (bytes_per_ms * 1000.0);
+            } else {
+                progress.estimated_remaining_seconds = 0.0;
+            }
+
+            progress_callback(progress);
+        }
+    }
+
+    return true;
+}
+
+bool SerialTransport::flush() {
+    if (!check_port_open()) return false;
+    return ::ioctl(fd_, TCFLSH, TCIOFLUSH) == 0;
+}
+
+bool SerialTransport::drain() {
+    if (!check_port_open()) return false;
+    // TCSBRK with a non-zero argument waits for output to drain (tcdrain)
+    return ::ioctl(fd_, TCSBRK, 1) == 0;
+}
+
+size_t SerialTransport::bytes_available() {
+    int count = 0;
+    if (!is_open_ || ::ioctl(fd_, TIOCINQ, &count) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(count);
+}
+
+size_t SerialTransport::bytes_pending_output() {
+    int count = 0;
+    if (!is_open_ || ::ioctl(fd_, TIOCOUTQ, &count) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(count);
+}
+
+bool SerialTransport::clear_buffers() {
+    return flush();
+}
+
+bool SerialTransport::wait_readable(std::chrono::milliseconds timeout) {
+    if (!check_port_open()) return false;
+    return poll_fd(fd_, POLLIN, static_cast<int>(timeout.count()));
+}
+
+bool SerialTransport::read_nonblocking(uint8_t* buffer, size_t size, size_t& bytes_read) {
+    bytes_read = 0;
+    if (!check_port_open()) return false;
+    if (!set_read_mode(false, 0, 0)) return false;
+
+    ssize_t result = ::read(fd_, buffer, size);
+    if (result < 0) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return true;
+        }
+        set_error_from_errno("Read failed");
+        return false;
+    }
+    bytes_read = static_cast<size_t>(result);
+    return true;
+}
+
+bool SerialTransport::write_nonblocking(const uint8_t* data, size_t size, size_t& bytes_written) {
+    bytes_written = 0;
+    if (!check_port_open()) return false;
+    if (!set_read_mode(false, 0, 0)) return false;
+
+    ssize_t result = ::write(fd_, data, size);
+    if (result < 0) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return true;
+        }
+        set_error_from_errno("Write failed");
+        return false;
+    }
+    bytes_written = static_cast<size_t>(result);
+    return true;
+}
+
+int SerialTransport::native_handle() const {
+    return is_open_ ? fd_ : -1;
+}
+
+bool SerialTransport::set_dtr(bool state) {
+    int bits = TIOCM_DTR;
+    return is_open_ && ::ioctl(fd_, state ? TIOCMBIS : TIOCMBIC, &bits) == 0;
+}
+
+bool SerialTransport::set_rts(bool state) {
+    int bits = TIOCM_RTS;
+    return is_open_ && ::ioctl(fd_, state ? TIOCMBIS : TIOCMBIC, &bits) == 0;
+}
+
+bool SerialTransport::get_cts() {
+    return get_modem_line(TIOCM_CTS);
+}
+
+bool SerialTransport::get_dsr() {
+    return get_modem_line(TIOCM_DSR);
+}
+
+bool SerialTransport::get_dcd() {
+    return get_modem_line(TIOCM_CAR);
+}
+
+bool SerialTransport::get_ri() {
+    return get_modem_line(TIOCM_RNG);
+}
+
+void SerialTransport::set_read_timeout(std::chrono::milliseconds timeout) {
+    config_.read_timeout = timeout;
+}
+
+void SerialTransport::set_write_timeout(std::chrono::milliseconds timeout) {
+    config_.write_timeout = timeout;
+}
+
+std::chrono::milliseconds SerialTransport::get_read_timeout() const {
+    return config_.read_timeout;
+}
+
+std::chrono::milliseconds SerialTransport::get_write_timeout() const {
+    return config_.write_timeout;
+}
+
+std::string SerialTransport::get_last_error() const {
+    return last_error_;
+}
+
+void SerialTransport::clear_error() {
+    last_error_.clear();
+}
+
+SerialPortInfo SerialTransport::get_port_info() const {
+    // USB descriptor details come from the same sysfs walk as enumeration
+    std::string path = canonical_path(port_name_);
+    if (!path.empty()) {
+        for (const auto& port : enumerate_ports()) {
+            if (canonical_path(port.port_name) == path) {
+                return port;
+            }
+        }
+    }
+    SerialPortInfo info;
+    info.port_name = port_name_;
+    return info;
+}
+
+bool SerialTransport::set_read_mode(bool blocking, uint8_t vmin, uint8_t vtime) {
+    // Mode changes cost a syscall or two, so only apply what differs; the
+    // reactor's non-blocking path settles into one mode and stays there
+    if (blocking != blocking_reads_) {
+        int flags = ::fcntl(fd_, F_GETFL);
+        if (flags < 0 || ::fcntl(fd_, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK)) != 0) {
+            set_error_from_errno("Failed to change port mode");
+            return false;
+        }
+        blocking_reads_ = blocking;
+    }
+    if (vmin != vmin_ || vtime != vtime_) {
+        struct termios2 tio;
+        if (::ioctl(fd_, TCGETS2, &tio) != 0) {
+            set_error_from_errno("Failed to read port settings");
+            return false;
+        }
+        tio.c_cc[VMIN] = vmin;
+        tio.c_cc[VTIME] = vtime;
+        if (::ioctl(fd_, TCSETS2, &tio) != 0) {
+            set_error_from_errno("Failed to apply port settings");
+            return false;
+        }
+        vmin_ = vmin;
+        vtime_ = vtime;
+    }
+    return true;
+}
+
+bool SerialTransport::enable_low_latency() {
+    // Lets the driver push received bytes up immediately; for FTDI
+    // adapters this also drops the 16 ms latency timer to 1 ms
+    struct serial_struct serial;
+    if (::ioctl(fd_, TIOCGSERIAL, &serial) != 0) {
+        return false;
+    }
+    serial.flags |= ASYNC_LOW_LATENCY;
+    return ::ioctl(fd_, TIOCSSERIAL, &serial) == 0;
+}
+
+bool SerialTransport::get_modem_line(int line) {
+    int bits = 0;
+    if (!is_open_ || ::ioctl(fd_, TIOCMGET, &bits) != 0) {
+        return false;
+    }
+    return (bits & line) != 0;
+}
+
+void SerialTransport::set_error_from_errno(const std::string& context) {
+    last_error_ = context + ": " + std::strerror(errno);
+}
+
+bool SerialTransport::check_port_open() {
+    if (!is_open_) {
+        last_error_ = "Port is not open";
+        return false;
+    }
+    return true;
+}
+
+} // namespace SamFlash
+
+#endif // SAMFLASH_TERMIOS_BACKEND
@@ -0,0 +1,172 @@
+#include "session_journal.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace SamFlash {
+
+namespace {
+    constexpr int JOURNAL_VERSION = 1;
+    constexpr const char* JOURNAL_SUFFIX = ".samflash-journal";
+
+    // Write the file and get it onto the disk before it is renamed into
+    // place, so a power loss can't leave an empty or short journal
+    bool write_durably(const std::string& path, const std::string& content, std::string& error) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            error = "Failed to write journal: " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        size_t written = 0;
+        while (written < content.size()) {
+            ssize_t count = ::write(fd, content.data() + written, content.size() - written);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(count);
+        }
+        bool ok = written == content.size() && ::fsync(fd) == 0;
+        if (!ok) {
+            error = "Failed to write journal: " + path + ": " + std::strerror(errno);
+        }
+        ::close(fd);
+        return ok;
+#else
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+        file.flush();
+        if (!file) {
+            error = "Failed to write journal: " + path;
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    // The rename itself is only durable once the directory is synced
+    bool sync_directory(const std::string& path, std::string& error) {
+#ifndef _WIN32
+        std::string directory = std::filesystem::path(path).parent_path().string();
+        int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            error = "Failed to sync journal directory: " + std::string(std::strerror(errno));
+            return false;
+        }
+        // Some file systems can't sync a directory and say so with EINVAL
+        bool ok = ::fsync(fd) == 0 || errno == EINVAL;
+        if (!ok) {
+            error = "Failed to sync journal directory: " + std::string(std::strerror(errno));
+        }
+        ::close(fd);
+        return ok;
+#else
+        (void)path;
+        (void)error;
+        return true;
+#endif
+    }
+}
+
+SessionJournal::SessionJournal(std::string path) : path_(std::move(path)) {}
+
+bool SessionJournal::load(SessionCheckpoint& checkpoint) {
+    std::ifstream file(path_);
+    if (!file.is_open()) {
+        last_error_ = "No journal at " + path_;
+        return false;
+    }
+
+    SessionCheckpoint loaded;
+    int version = 0;
+    std::string line;
+    try {
+        while (std::getline(file, line)) {
+            auto separator = line.find('=');
+            if (separator == std::string::npos) {
+                continue;
+            }
+            std::string key = line.substr(0, separator);
+            std::string value = line.substr(separator + 1);
+
+            if (key == "version") {
+                version = std::stoi(value);
+            } else if (key == "image_path") {
+                loaded.image_path = value;
+            } else if (key == "image_size") {
+                loaded.image_size = std::stoull(value);
+            } else if (key == "image_crc32") {
+                loaded.image_crc32 = static_cast<uint32_t>(std::stoul(value, nullptr, 16));
+            } else if (key == "device") {
+                loaded.device_identity = value;
+            } else if (key == "partition") {
+                loaded.partition = value;
+            } else if (key == "confirmed_bytes") {
+                loaded.confirmed_bytes = std::stoull(value);
+            }
+        }
+    } catch (const std::exception&) {
+        last_error_ = "Corrupt journal: " + path_;
+        return false;
+    }
+
+    if (version != JOURNAL_VERSION) {
+        last_error_ = "Unsupported journal version in " + path_;
+        return false;
+    }
+
+    checkpoint = loaded;
+    return true;
+}
+
+bool SessionJournal::save(const SessionCheckpoint& checkpoint) {
+    const std::string temp_path = path_ + ".tmp";
+    std::ostringstream crc;
+    crc << std::hex << checkpoint.image_crc32;
+    std::ostringstream content;
+    content << "version=" << JOURNAL_VERSION << "\n"
+            << "image_path=" << checkpoint.image_path << "\n"
+            << "image_size=" << checkpoint.image_size << "\n"
+            << "image_crc32=" << crc.str() << "\n"
+            << "device=" << checkpoint.device_identity << "\n"
+            << "partition=" << checkpoint.partition << "\n"
+            << "confirmed_bytes=" << checkpoint.confirmed_bytes << "\n";
+    if (!write_durably(temp_path, content.str(), last_error_)) {
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path_, error);
+    if (error) {
+        last_error_ = "Failed to replace journal: " + error.message();
+        return false;
+    }
+    return sync_directory(path_, last_error_);
+}
+
+bool SessionJournal::clear() {
+    std::error_code error;
+    std::filesystem::remove(path_, error);
+    if (error) {
+        last_error_ = "Failed to remove journal: " + error.message();
+        return false;
+    }
+    return true;
+}
+
+std::string SessionJournal::default_path_for(const std::string& image_path) {
+    return image_path + JOURNAL_SUFFIX;
+}
+
+} // namespace SamFlash
@@ -0,0 +1,49 @@
+#ifndef SESSION_JOURNAL_H
+#define SESSION_JOURNAL_H
+
+#include <cstdint>
+#include <string>
+
+namespace SamFlash {
+
+// Progress of one flashing session, enough to continue it later
+struct SessionCheckpoint {
+    std::string image_path;
+    uint64_t image_size = 0;
+    uint32_t image_crc32 = 0;
+    std::string device_identity;
+    std::string partition;        // partition being written when last saved
+    uint64_t confirmed_bytes = 0; // bytes of that partition the device acknowledged
+
+    // Same image on the same unit, so the checkpoint still applies
+    bool matches(const SessionCheckpoint& other) const {
+        return image_size == other.image_size && image_crc32 == other.image_crc32 &&
+               device_identity == other.device_identity;
+    }
+};
+
+// Small key=value file holding the latest checkpoint. Saves go through a
+// temporary file that is synced to disk before it is renamed into place,
+// so a crash or power loss mid-save leaves the previous checkpoint intact.
+class SessionJournal {
+public:
+    explicit SessionJournal(std::string path);
+
+    bool load(SessionCheckpoint& checkpoint);
+    bool save(const SessionCheckpoint& checkpoint);
+    bool clear();
+
+    const std::string& path() const { return path_; }
+    std::string get_last_error() const { return last_error_; }
+
+    // Journal location used when none is given: next to the image
+    static std::string default_path_for(const std::string& image_path);
+
+private:
+    std::string path_;
+    std::string last_error_;
+};
+
+} // namespace SamFlash
+
+#endif // SESSION_JOURNAL_H
@@ -0,0 +1,121 @@
+#include "sparse_image.h"
+#include "byte_order.h"
+#include <sstream>
+
+namespace SamFlash {
+
+namespace {
+    uint16_t read_le16(const uint8_t* in) {
+        return static_cast<uint16_t>(in[0] | (in[1] << 8));
+    }
+}
+
+uint32_t SparseChunk::value() const {
+    return data.size() >= 4 ? read_le32(data.data()) : 0;
+}
+
+bool SparseImageReader::is_sparse(ByteSpan image) {
+    return image.size() >= SPARSE_HEADER_SIZE && read_le32(image.data()) == SPARSE_HEADER_MAGIC;
+}
+
+bool SparseImageReader::open(ByteSpan image) {
+    image_ = ByteSpan();
+    position_ = 0;
+    chunks_read_ = 0;
+    blocks_read_ = 0;
+    total_chunks_ = 0;
+    last_error_.clear();
+
+    if (!is_sparse(image)) {
+        last_error_ = "Not an Android sparse image";
+        return false;
+    }
+
+    const uint8_t* header = image.data();
+    uint16_t major_version = read_le16(header + 4);
+    uint16_t file_header_size = read_le16(header + 8);
+    uint16_t chunk_header_size = read_le16(header + 10);
+    if (major_version != 1) {
+        last_error_ = "Unsupported sparse image version " + std::to_string(major_version);
+        return false;
+    }
+    // Newer writers may append fields to either header; skip what we don't know
+    if (file_header_size < SPARSE_HEADER_SIZE || chunk_header_size < SPARSE_CHUNK_HEADER_SIZE ||
+        file_header_size > image.size()) {
+        last_error_ = "Sparse image has bad header sizes";
+        return false;
+    }
+
+    block_size_ = read_le32(header + 12);
+    if (block_size_ == 0 || block_size_ % 4 != 0) {
+        last_error_ = "Sparse image has bad block size " + std::to_string(block_size_);
+        return false;
+    }
+
+    image_ = image;
+    chunk_header_size_ = chunk_header_size;
+    total_blocks_ = read_le32(header + 16);
+    total_chunks_ = read_le32(header + 20);
+    position_ = file_header_size;
+    return true;
+}
+
+bool SparseImageReader::next(SparseChunk& chunk) {
+    if (!last_error_.empty() || image_.empty()) {
+        return false;
+    }
+    if (chunks_read_ == total_chunks_) {
+        if (blocks_read_ != total_blocks_) {
+            last_error_ = "Sparse chunks cover " + std::to_string(blocks_read_) + " of " +
+                          std::to_string(total_blocks_) + " blocks";
+        }
+        return false;
+    }
+
+    if (image_.size() - position_ < chunk_header_size_) {
+        last_error_ = "Sparse image truncated in chunk " + std::to_string(chunks_read_);
+        return false;
+    }
+    const uint8_t* header = image_.data() + position_;
+    uint16_t type = read_le16(header);
+    uint32_t blocks = read_le32(header + 4);
+    uint32_t total_size = read_le32(header + 8);
+
+    uint64_t payload_size = 0;
+    switch (type) {
+        case SPARSE_CHUNK_RAW: payload_size = uint64_t(blocks) * block_size_; break;
+        case SPARSE_CHUNK_FILL: payload_size = 4; break;
+        case SPARSE_CHUNK_DONT_CARE: payload_size = 0; break;
+        case SPARSE_CHUNK_CRC32: payload_size = 4; blocks = 0; break;
+        default:
+        {
+            std::ostringstream message;
+            message << "Unknown sparse chunk type 0x" << std::hex << type << std::dec << " in chunk "
+                    << chunks_read_;
+            last_error_ = message.str();
+            return false;
+        }
+    }
+    if (total_size != chunk_header_size_ + payload_size || total_size > image_.size() - position_) {
+        last_error_ = "Sparse chunk " + std::to_string(chunks_read_) + " has a bad size";
+        return false;
+    }
+    if (blocks_read_ + blocks > total_blocks_) {
+        last_error_ = "Sparse chunk " + std::to_string(chunks_read_) + " runs past the image";
+        return false;
+    }
+
+    chunk.type = type;
+    chunk.output_offset = blocks_read_ * block_size_;
+    chunk.output_size = uint64_t(blocks) * block_size_;
+    chunk.input_offset = position_;
+    chunk.input_size = total_size;
+    chunk.data = image_.subspan(position_ + chunk_header_size_, static_cast<size_t>(payload_size));
+
+    position_ += total_size;
+    blocks_read_ += blocks;
+    ++chunks_read_;
+    return true;
+}
+
+} // namespace SamFlash
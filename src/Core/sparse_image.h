@@ -0,0 +1,67 @@
+#ifndef SPARSE_IMAGE_H
+#define SPARSE_IMAGE_H
+
+#include "byte_span.h"
+#include <cstdint>
+#include <string>
+
+namespace SamFlash {
+
+// Android sparse image format: a file header, then chunks that each cover
+// a run of output blocks. RAW chunks carry the blocks' data, FILL chunks a
+// 4-byte pattern repeated over them, DONT_CARE chunks nothing at all, and
+// CRC32 chunks a checksum of the output so far.
+constexpr uint32_t SPARSE_HEADER_MAGIC = 0xED26FF3A;
+constexpr uint16_t SPARSE_CHUNK_RAW = 0xCAC1;
+constexpr uint16_t SPARSE_CHUNK_FILL = 0xCAC2;
+constexpr uint16_t SPARSE_CHUNK_DONT_CARE = 0xCAC3;
+constexpr uint16_t SPARSE_CHUNK_CRC32 = 0xCAC4;
+constexpr size_t SPARSE_HEADER_SIZE = 28;
+constexpr size_t SPARSE_CHUNK_HEADER_SIZE = 12;
+
+struct SparseChunk {
+    uint16_t type = 0;
+    uint64_t output_offset = 0; // where the chunk lands in the expanded image
+    uint64_t output_size = 0;   // bytes it covers there; 0 for CRC32
+    size_t input_offset = 0;    // chunk header position in the sparse file
+    size_t input_size = 0;      // header plus payload
+    ByteSpan data;              // RAW blocks, or the FILL pattern / CRC32 value
+
+    uint32_t value() const; // FILL pattern or CRC32, little-endian
+};
+
+// Walks a sparse image chunk by chunk without expanding it. The image
+// must stay alive while chunks are in use; their data points into it.
+class SparseImageReader {
+public:
+    static bool is_sparse(ByteSpan image);
+
+    // Validate the file header and rewind to the first chunk
+    bool open(ByteSpan image);
+    // Next chunk; false at the end or on a malformed chunk, which
+    // get_last_error() tells apart
+    bool next(SparseChunk& chunk);
+    bool at_end() const { return chunks_read_ == total_chunks_ && get_last_error().empty(); }
+
+    uint32_t block_size() const { return block_size_; }
+    uint64_t output_size() const { return uint64_t(total_blocks_) * block_size_; }
+    uint32_t chunk_count() const { return total_chunks_; }
+
+    std::string get_last_error() const { return last_error_; }
+
+private:
+    ByteSpan image_;
+    size_t chunk_header_size_ = SPARSE_CHUNK_HEADER_SIZE;
+    uint32_t block_size_ = 0;
+    uint32_t total_blocks_ = 0;
+    uint32_t total_chunks_ = 0;
+
+    size_t position_ = 0;
+    uint32_t chunks_read_ = 0;
+    uint64_t blocks_read_ = 0;
+    std::string last_error_;
+};
+
+} // namespace SamFlash
+
+#endif // SPARSE_IMAGE_H
@@ -1,12 +1,76 @@
 #include "usb_serial_interface.h"
+#include "crc16.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
-#include <sstream>
-#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <deque>
 
 namespace SamFlash {
 
+namespace {
+    // SAM-BA monitor prompt terminating every interactive response
+    constexpr const char* SAMBA_PROMPT = "\n\r>";
+    constexpr size_t SAMBA_PROMPT_LENGTH = 3;
+    // Line ending of replies once the monitor is in normal (binary) mode
+    constexpr const char* SAMBA_EOL = "\n\r";
+    // Acknowledgement of the 'Y' buffer-copy command
+    constexpr const char* SAMBA_COPY_ACK = "Y\n\r";
+    
+    // Provisional geometry, used until the real values are read at connect
+    constexpr uint32_t DEFAULT_FLASH_SIZE = 1024 * 1024;
+    constexpr uint32_t DEFAULT_PAGE_SIZE = 256;
+    constexpr uint32_t DEFAULT_SECTOR_SIZE = 8 * 1024;
+    constexpr uint32_t DEFAULT_RAM_BUFFER_SIZE = 0x10000;
+    
+    // SRAM staging area for write blocks; split into one slot per in-flight
+    // block. The monitor keeps its own data below this address and its
+    // stack at the top of SRAM.
+    constexpr uint32_t SRAM_BASE_ADDRESS = 0x20000000;
+    constexpr uint32_t SAMBA_RAM_BUFFER_ADDRESS = 0x20004000;
+    constexpr uint32_t SAMBA_STACK_RESERVE = 0x1000;
+    
+    // Chip identification and embedded flash controller registers
+    constexpr uint32_t CHIPID_CIDR = 0x400E0740;
+    constexpr uint32_t EEFC_FCR = 0x400E0A04;
+    constexpr uint32_t EEFC_FSR = 0x400E0A08;
+    constexpr uint32_t EEFC_FRR = 0x400E0A0C;
+    constexpr uint32_t EEFC_FCR_KEY = 0x5Au << 24;
+    constexpr uint32_t EEFC_CMD_GETD = 0x00;
+    constexpr uint32_t EEFC_CMD_EA = 0x05;
+    constexpr uint32_t EEFC_CMD_STUI = 0x0E;
+    constexpr uint32_t EEFC_CMD_SPUI = 0x0F;
+    constexpr uint32_t EEFC_FSR_FRDY = 0x1;
+    constexpr uint32_t EEFC_FSR_FCMDE = 0x2;
+    constexpr uint32_t EEFC_FSR_FLOCKE = 0x4;
+    constexpr int EEFC_READY_POLLS = 100;
+    // Words of the 128-bit unique identifier read back after STUI
+    constexpr uint32_t EEFC_UNIQUE_ID_WORDS = 4;
+    // Upper bound on planes/lock regions we accept from GETD
+    constexpr uint32_t EEFC_MAX_DESCRIPTOR_ENTRIES = 256;
+    // Pages erased by the smallest EEFC erase-pages command
+    constexpr uint32_t EEFC_MIN_ERASE_PAGES = 8;
+    
+    // CIDR.SRAMSIZ encoding, in KB
+    constexpr uint32_t SRAM_SIZE_KB[16] = {48, 192, 384, 6, 24, 4, 80, 160, 8, 16, 32, 64, 128, 256, 96, 512};
+    // Reads stream straight from flash and are not limited by the RAM buffer
+    constexpr uint32_t MAX_READ_BLOCK_SIZE = 64 * 1024;
+    // Slowest link we expect to see, used to scale timeouts with block size
+    constexpr uint32_t MIN_LINK_BYTES_PER_SECOND = 11520;
+    // Acknowledgement of the 'E' region-erase command
+    constexpr const char* SAMBA_ERASE_ACK = "E\n\r";
+    // Conservative flash erase rate, used to scale erase timeouts
+    constexpr uint32_t MIN_ERASE_BYTES_PER_SECOND = 64 * 1024;
+    // Conservative on-device CRC rate, used to scale checksum timeouts
+    constexpr uint32_t MIN_DEVICE_CRC_BYTES_PER_SECOND = 1024 * 1024;
+    // Reply to 'Z': "Z" + 8 hex digits + "#\n\r"
+    constexpr size_t SAMBA_CHECKSUM_REPLY_LENGTH = 12;
+    // Time for late replies to a failed transfer to arrive before they are dropped
+    constexpr auto RESYNC_SETTLE_TIME = std::chrono::milliseconds(50);
+}
+
 USBSerialInterface::USBSerialInterface() 
     : transport_(std::make_unique<SerialTransport>()), connected_(false), status_(FlashStatus::IDLE) {
 }
@@ -30,9 +94,10 @@ std::vector<DeviceInfo> USBSerialInterface::discover_devices() {
         device.manufacturer = port.manufacturer.empty() ? "Unknown" : port.manufacturer;
         device.type = DeviceType::USB_SERIAL;
         device.port_or_address = port.port_name;
-        device.flash_size = 1024 * 1024; // Default 1MB - would be detected on connection
-        device.page_size = 256; // Default page size
+        device.vendor_id = port.vendor_id;
         device.is_connected = false;
+        // Provisional until connect() reads the real geometry
+        apply_default_geometry(device);
         
         // Filter for likely microcontroller programmer devices
         if (port.manufacturer.find("FTDI") != std::string::npos ||
@@ -71,8 +136,24 @@ bool USBSerialInterface::connect(const std::string& device_id) {
         return false;
     }
     
+    // Start draining the port in the background before talking to it. All
+    // ports share the process-wide reactor's thread where there is one.
+    receiver_ = std::make_unique<SerialReceiver>(*transport_);
+    reactor_ = SerialReactor::shared_instance();
+    if (!reactor_ || !receiver_->start(*reactor_)) {
+        reactor_.reset();
+    }
+    if (!reactor_ && !receiver_->start()) {
+        last_error_ = "Failed to start receiver: " + receiver_->get_last_error();
+        transport_->close();
+        status_ = FlashStatus::ERROR;
+        return false;
+    }
+    
     // Try to enter programming mode
     if (!enter_programming_mode()) {
+        receiver_->stop();
+        reactor_.reset();
         transport_->close();
         status_ = FlashStatus::ERROR;
         return false;
@@ -80,14 +161,36 @@ bool USBSerialInterface::connect(const std::string& device_id) {
     
     connected_ = true;
     status_ = FlashStatus::CONNECTED;
+    checksum_unsupported_ = false;
+    write_chunker_.reset();
     device_id_ = device_id;
     port_name_ = device_id;
     
     // Store device info
     current_device_info_.id = device_id;
+    current_device_info_.name = "SAM Device";
+    current_device_info_.manufacturer = "Microchip";
+    current_device_info_.type = DeviceType::USB_SERIAL;
     current_device_info_.port_or_address = device_id;
     current_device_info_.is_connected = true;
     
+    // Everything below sizes its transfers from the real geometry; keep
+    // the provisional values if the monitor can't report it
+    apply_default_geometry(current_device_info_);
+    if (!discover_geometry(current_device_info_)) {
+        std::cerr << "USBSerialInterface: Flash geometry unavailable (" << last_error_
+                  << "), using defaults" << std::endl;
+        apply_default_geometry(current_device_info_);
+        last_error_.clear();
+    }
+    
+    // Session journals are keyed on this; the chip's own ID survives a
+    // change of cable or adapter, the USB serial number is the fallback
+    if (!read_unique_id(current_device_info_.serial_number)) {
+        current_device_info_.serial_number = transport_->get_port_info().serial_number;
+        last_error_.clear();
+    }
+    
     return true;
 }
 
@@ -99,6 +202,12 @@ bool USBSerialInterface::disconnect() {
     // Try to exit programming mode gracefully
     exit_programming_mode();
     
+    // Stop the receive thread before the port goes away
+    if (receiver_) {
+        receiver_->stop();
+    }
+    reactor_.reset();
+    
     // Close the transport
     if (transport_->is_open()) {
         transport_->close();
@@ -117,18 +226,10 @@ bool USBSerialInterface::is_connected() const {
 }
 
 DeviceInfo USBSerialInterface::get_device_info() const {
-    DeviceInfo info;
-    if (connected_) {
-        info.id = device_id_;
-        info.name = "SAM Device";
-        info.manufacturer = "Microchip";
-        info.type = DeviceType::USB_SERIAL;
-        info.port_or_address = "COM3";
-        info.flash_size = 1024 * 1024;
-        info.page_size = 256;
-        info.is_connected = true;
+    if (!connected_) {
+        return DeviceInfo{};
     }
-    return info;
+    return current_device_info_;
 }
 
 std::string USBSerialInterface::get_device_signature() {
@@ -148,23 +249,48 @@ bool USBSerialInterface::erase_chip() {
     }
     
     status_ = FlashStatus::FLASHING;
-    
-    // Simulate chip erase
-    for (int i = 0; i <= 100; i += 10) {
+    auto report = [this](double percentage) {
         if (progress_callback_) {
             FlashProgress progress;
             progress.bytes_written = 0;
             progress.total_bytes = 0;
-            progress.percentage = i;
+            progress.percentage = percentage;
             progress.current_operation = "Erasing chip";
             progress.status = FlashStatus::FLASHING;
             progress_callback_(progress);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    };
+    report(0);
     
-    status_ = FlashStatus::CONNECTED;
-    return true;
+    // Erase All runs on the flash controller; FRDY comes back once the
+    // whole array reads as erased
+    if (!write_word(EEFC_FCR, EEFC_FCR_KEY | EEFC_CMD_EA)) {
+        status_ = FlashStatus::ERROR;
+        return false;
+    }
+    auto deadline = std::chrono::steady_clock::now() + transport_->get_read_timeout() +
+                    std::chrono::milliseconds(uint64_t(current_device_info_.flash_size) * 1000 / MIN_ERASE_BYTES_PER_SECOND);
+    uint32_t fsr = 0;
+    do {
+        if (!read_word(EEFC_FSR, fsr)) {
+            status_ = FlashStatus::ERROR;
+            return false;
+        }
+    } while (!(fsr & EEFC_FSR_FRDY) && std::chrono::steady_clock::now() < deadline);
+    
+    if (!(fsr & EEFC_FSR_FRDY)) {
+        last_error_ = "Timed out waiting for chip erase";
+    } else if (fsr & EEFC_FSR_FLOCKE) {
+        last_error_ = "Chip erase refused: flash has locked regions";
+    } else if (fsr & EEFC_FSR_FCMDE) {
+        last_error_ = "Chip erase rejected by flash controller";
+    } else {
+        report(100);
+        status_ = FlashStatus::CONNECTED;
+        return true;
+    }
+    status_ = FlashStatus::ERROR;
+    return false;
 }
 
 bool USBSerialInterface::erase_page(uint32_t address) {
@@ -173,45 +299,208 @@ bool USBSerialInterface::erase_page(uint32_t address) {
         return false;
     }
     
-    // Simulate page erase
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    return true;
+    return erase_region(address, current_device_info_.page_size);
 }
 
-bool USBSerialInterface::write_page(uint32_t address, const std::vector<uint8_t>& data) {
+bool USBSerialInterface::erase_region(uint32_t address, uint32_t size) {
     if (!connected_) {
         last_error_ = "Device not connected";
         return false;
     }
     
-    if (data.size() > 256) {
-        last_error_ = "Page size exceeds maximum (256 bytes)";
+    if (!send_command(create_erase_command(address, size))) {
         return false;
     }
+    auto timeout = transport_->get_read_timeout() +
+                   std::chrono::milliseconds(uint64_t(size) * 1000 / MIN_ERASE_BYTES_PER_SECOND);
+    return expect_reply(SAMBA_ERASE_ACK, timeout);
+}
+
+bool USBSerialInterface::write_page(uint32_t address, const std::vector<uint8_t>& data) {
+    return write_page(address, ByteSpan(data));
+}
+
+bool USBSerialInterface::write_page(uint32_t address, ByteSpan data) {
+    // Any length is accepted; large writes are split into transfer blocks
+    return write_pages(address, data);
+}
+
+void USBSerialInterface::set_transfer_options(const TransferOptions& options) {
+    transfer_options_ = options;
+    // New bounds; relearn from scratch
+    write_chunker_.reset();
+}
+
+bool USBSerialInterface::write_pages(uint32_t address, ByteSpan data, const WriteProgressFn& on_progress) {
+    if (!connected_) {
+        last_error_ = "Device not connected";
+        return false;
+    }
+    
+    // Blocks are whole pages and every in-flight block needs its own RAM
+    // slot, so large blocks trade pipeline depth for fewer commands
+    const uint32_t page_size = current_device_info_.page_size;
+    const uint32_t ram_buffer_size = current_device_info_.ram_buffer_size;
+    AdaptiveChunker* chunker = transfer_options_.adaptive ? &write_chunker() : nullptr;
+    
+    status_ = FlashStatus::FLASHING;
+    
+    // Blocks whose programming has not been acknowledged yet. RAM slots are
+    // handed out round-robin, so a slot is free once every older block
+    // overlapping it has been retired.
+    struct InFlightBlock {
+        size_t data_end;
+        uint32_t slot_offset;
+        uint32_t slot_size;
+        std::chrono::steady_clock::time_point sent_at;
+    };
+    std::deque<InFlightBlock> in_flight;
+    std::vector<uint8_t> padded_block;
+    uint32_t slot_cursor = 0;
+    auto last_completion = std::chrono::steady_clock::now();
+    
+    auto retire_oldest = [&]() {
+        const InFlightBlock& oldest = in_flight.front();
+        if (!complete_block_transfer(oldest.slot_size)) {
+            if (chunker) {
+                chunker->record_timeout();
+            }
+            resync_link();
+            status_ = FlashStatus::ERROR;
+            return false;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (chunker) {
+            chunker->record(oldest.slot_size, now - last_completion, now - oldest.sent_at);
+        }
+        last_completion = now;
+        if (on_progress) {
+            on_progress(oldest.data_end);
+        }
+        in_flight.pop_front();
+        return true;
+    };
+    
+    auto slot_busy = [&](uint32_t slot_offset, uint32_t slot_size) {
+        return std::any_of(in_flight.begin(), in_flight.end(), [&](const InFlightBlock& block) {
+            return slot_offset < block.slot_offset + block.slot_size && block.slot_offset < slot_offset + slot_size;
+        });
+    };
+    
+    size_t offset = 0;
+    while (offset < data.size()) {
+        const uint32_t block_size = chunker ? chunker->chunk_size() : effective_block_size(ram_buffer_size);
+        const uint32_t depth = std::max<uint32_t>(1, chunker ? chunker->pipeline_depth() : transfer_options_.pipeline_depth);
+        
+        ByteSpan block = data.subspan(offset, block_size);
+        const size_t block_end = offset + block.size();
+        if (block.size() % page_size != 0) {
+            // Pad the final partial page with the erased value
+            padded_block.assign((block.size() + page_size - 1) / page_size * page_size, 0xFF);
+            std::copy(block.begin(), block.end(), padded_block.begin());
+            block = ByteSpan(padded_block);
+        }
+        const uint32_t slot_size = static_cast<uint32_t>(block.size());
+        if (slot_cursor + slot_size > ram_buffer_size) {
+            slot_cursor = 0;
+        }
+        
+        // Block k+depth is only sent once block k has been programmed
+        while (!in_flight.empty() && (in_flight.size() >= depth || slot_busy(slot_cursor, slot_size))) {
+            if (!retire_oldest()) {
+                return false;
+            }
+        }
+        
+        uint32_t slot = current_device_info_.ram_buffer_address + slot_cursor;
+        if (!send_block_transfer(slot, address + static_cast<uint32_t>(offset), block)) {
+            resync_link();
+            status_ = FlashStatus::ERROR;
+            return false;
+        }
+        in_flight.push_back({block_end, slot_cursor, slot_size, std::chrono::steady_clock::now()});
+        slot_cursor += slot_size;
+        offset = block_end;
+    }
+    
+    while (!in_flight.empty()) {
+        if (!retire_oldest()) {
+            return false;
+        }
+    }
     
-    // Simulate page write
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    status_ = FlashStatus::CONNECTED;
     return true;
 }
 
+IDeviceInterface::TransferStats USBSerialInterface::get_transfer_stats() const {
+    TransferStats stats;
+    if (write_chunker_ && transfer_options_.adaptive) {
+        stats.chunk_size = write_chunker_->chunk_size();
+        stats.pipeline_depth = write_chunker_->pipeline_depth();
+        stats.throughput_bps = write_chunker_->throughput_bps();
+    } else if (connected_) {
+        stats.chunk_size = effective_block_size(current_device_info_.ram_buffer_size);
+        stats.pipeline_depth = std::max<uint32_t>(1, transfer_options_.pipeline_depth);
+    }
+    return stats;
+}
+
+AdaptiveChunker& USBSerialInterface::write_chunker() {
+    // Created on first use so its limits come from the connected device;
+    // it then keeps learning for the rest of the connection
+    if (!write_chunker_) {
+        const uint32_t page_size = current_device_info_.page_size;
+        AdaptiveChunker::Limits limits;
+        limits.granularity = page_size;
+        limits.min_chunk = page_size;
+        limits.max_chunk = current_device_info_.ram_buffer_size;
+        limits.min_depth = 1;
+        limits.max_depth = std::max<uint32_t>(1, transfer_options_.pipeline_depth);
+        write_chunker_ = std::make_unique<AdaptiveChunker>(
+            limits, effective_block_size(current_device_info_.ram_buffer_size), transfer_options_.pipeline_depth);
+    }
+    return *write_chunker_;
+}
+
 std::vector<uint8_t> USBSerialInterface::read_page(uint32_t address, uint32_t size) {
-    std::vector<uint8_t> data;
-    
+    std::vector<uint8_t> data(size);
+    if (!read_page(address, MutableByteSpan(data))) {
+        data.clear();
+    }
+    return data;
+}
+
+bool USBSerialInterface::read_page(uint32_t address, MutableByteSpan buffer) {
     if (!connected_) {
         last_error_ = "Device not connected";
-        return data;
+        return false;
     }
     
-    // Simulate reading data
-    data.resize(size);
-    for (uint32_t i = 0; i < size; ++i) {
-        data[i] = (address + i) & 0xFF; // Dummy data
+    // 'R' streams flash contents back raw, so reads are only bounded by
+    // the transfer block size and land directly in the caller's buffer
+    const uint32_t block_size = effective_block_size(MAX_READ_BLOCK_SIZE);
+    for (size_t offset = 0; offset < buffer.size(); offset += block_size) {
+        MutableByteSpan block = buffer.subspan(offset, block_size);
+        if (!send_command(create_read_command(address + static_cast<uint32_t>(offset),
+                                              static_cast<uint32_t>(block.size())))) {
+            return false;
+        }
+        if (!receiver_->read_exact(block, read_timeout_for(block.size()))) {
+            last_error_ = "Timed out reading " + std::to_string(block.size()) +
+                          " bytes at address " + std::to_string(address + offset);
+            return false;
+        }
     }
     
-    return data;
+    return true;
 }
 
 bool USBSerialInterface::verify_flash(const std::vector<uint8_t>& expected_data, uint32_t start_address) {
+    return verify_flash(ByteSpan(expected_data), start_address);
+}
+
+bool USBSerialInterface::verify_flash(ByteSpan expected_data, uint32_t start_address) {
     if (!connected_) {
         last_error_ = "Device not connected";
         return false;
@@ -219,18 +508,26 @@ bool USBSerialInterface::verify_flash(const std::vector<uint8_t>& expected_data,
     
     status_ = FlashStatus::VERIFYING;
     
-    // Simulate verification process
-    for (size_t i = 0; i < expected_data.size(); i += 256) {
-        size_t chunk_size = std::min(size_t(256), expected_data.size() - i);
-        auto read_data = read_page(start_address + i, chunk_size);
+    // One read-back buffer reused for every block
+    std::vector<uint8_t> read_data(effective_block_size(MAX_READ_BLOCK_SIZE));
+    
+    for (size_t i = 0; i < expected_data.size(); i += read_data.size()) {
+        size_t chunk_size = std::min(read_data.size(), expected_data.size() - i);
+        if (!read_page(start_address + i, MutableByteSpan(read_data.data(), chunk_size))) {
+            status_ = FlashStatus::ERROR;
+            return false;
+        }
         
-        // Compare data (simplified)
-        for (size_t j = 0; j < chunk_size; ++j) {
-            if (read_data[j] != expected_data[i + j]) {
-                last_error_ = "Verification failed at address " + std::to_string(start_address + i + j);
-                status_ = FlashStatus::ERROR;
-                return false;
+        // Compare data; locate the exact byte only on mismatch
+        if (std::memcmp(read_data.data(), expected_data.data() + i, chunk_size) != 0) {
+            for (size_t j = 0; j < chunk_size; ++j) {
+                if (read_data[j] != expected_data[i + j]) {
+                    last_error_ = "Verification failed at address " + std::to_string(start_address + i + j);
+                    break;
+                }
             }
+            status_ = FlashStatus::ERROR;
+            return false;
         }
         
         if (progress_callback_) {
@@ -248,6 +545,45 @@ bool USBSerialInterface::verify_flash(const std::vector<uint8_t>& expected_data,
     return true;
 }
 
+bool USBSerialInterface::compute_flash_checksum(uint32_t address, uint32_t size, uint32_t& checksum) {
+    if (!connected_) {
+        last_error_ = "Device not connected";
+        return false;
+    }
+    
+    // Older monitors ignore 'Z'; don't pay the timeout again
+    if (checksum_unsupported_) {
+        last_error_ = "Device does not support checksum command";
+        return false;
+    }
+    
+    if (!send_command(create_checksum_command(address, size))) {
+        return false;
+    }
+    
+    auto timeout = transport_->get_read_timeout() +
+                   std::chrono::milliseconds(uint64_t(size) * 1000 / MIN_DEVICE_CRC_BYTES_PER_SECOND);
+    auto reply = receive_response(SAMBA_CHECKSUM_REPLY_LENGTH, timeout);
+    if (reply.size() != SAMBA_CHECKSUM_REPLY_LENGTH || reply[0] != 'Z' || reply[9] != '#') {
+        checksum_unsupported_ = true;
+        receiver_->discard();
+        last_error_ = "Device does not support checksum command";
+        return false;
+    }
+    
+    try {
+        checksum = static_cast<uint32_t>(std::stoul(std::string(reply.begin() + 1, reply.begin() + 9), nullptr, 16));
+    } catch (const std::exception&) {
+        last_error_ = "Malformed checksum reply";
+        return false;
+    }
+    return true;
+}
+
+uint32_t USBSerialInterface::checksum_of(ByteSpan data) const {
+    return Crc16::compute(data);
+}
+
 void USBSerialInterface::set_progress_callback(std::function<void(const FlashProgress&)> callback) {
     progress_callback_ = callback;
 }
@@ -265,7 +601,7 @@ void USBSerialInterface::clear_error() {
 }
 
 // Protocol helper implementations
-bool USBSerialInterface::send_command(const std::vector<uint8_t>& command) {
+bool USBSerialInterface::send_command(ByteSpan command) {
     if (!transport_->is_open()) {
         last_error_ = "Transport not open";
         return false;
@@ -279,43 +615,284 @@ bool USBSerialInterface::send_command(const std::vector<uint8_t>& command) {
     return true;
 }
 
-std::vector<uint8_t> USBSerialInterface::receive_response(size_t expected_size) {
-    if (!transport_->is_open()) {
+bool USBSerialInterface::send_command(const SambaCommand& command) {
+    // Sending the part that fitted would leave the monitor out of step
+    if (command.overflowed()) {
+        last_error_ = "Command too long for the command buffer";
+        return false;
+    }
+    return send_command(command.span());
+}
+
+std::vector<uint8_t> USBSerialInterface::receive_response(size_t expected_size, std::chrono::milliseconds timeout) {
+    if (!transport_->is_open() || !receiver_ || !receiver_->is_running()) {
         last_error_ = "Transport not open";
         return std::vector<uint8_t>();
     }
     
     if (expected_size > 0) {
-        return transport_->read(expected_size);
-    } else {
-        // Read whatever is available
-        std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Give time for response
-        size_t available = transport_->bytes_available();
-        if (available > 0) {
-            return transport_->read(available);
+        FixedSizeFramer framer(expected_size);
+        if (!receiver_->wait_for_frame(framer, timeout)) {
+            last_error_ = "Timed out waiting for " + std::to_string(expected_size) + " byte response";
+            return std::vector<uint8_t>();
         }
+        return framer.take_frame();
     }
     
-    return std::vector<uint8_t>();
+    // Variable-length response: complete once the monitor prompt arrives
+    DelimiterFramer framer(SAMBA_PROMPT);
+    if (!receiver_->wait_for_frame(framer, timeout)) {
+        last_error_ = "Timed out waiting for prompt";
+        return std::vector<uint8_t>();
+    }
+    if (framer.overflowed()) {
+        // Not a monitor reply; drop the rest rather than parse it as one
+        receiver_->discard();
+        last_error_ = "Response too long, no prompt received";
+        return std::vector<uint8_t>();
+    }
+    return framer.take_frame();
 }
 
 bool USBSerialInterface::wait_for_response_with_timeout(std::chrono::milliseconds timeout) {
-    auto start = std::chrono::steady_clock::now();
+    if (!receiver_) {
+        return false;
+    }
+    // Woken by the receive thread as soon as data lands in the ring
+    return receiver_->wait_for_data(timeout);
+}
+
+bool USBSerialInterface::expect_reply(const char* expected, std::chrono::milliseconds timeout) {
+    DelimiterFramer framer(SAMBA_EOL);
+    if (!receiver_ || !receiver_->wait_for_frame(framer, timeout)) {
+        last_error_ = std::string("Timed out waiting for reply ") + expected;
+        return false;
+    }
+    const auto& frame = framer.frame();
+    if (std::string(frame.begin(), frame.end()) != expected) {
+        last_error_ = "Unexpected reply: " + std::string(frame.begin(), frame.end());
+        return false;
+    }
+    return true;
+}
+
+bool USBSerialInterface::send_block_transfer(uint32_t ram_slot, uint32_t flash_address, ByteSpan block) {
+    // Stage the block in RAM, then ask the monitor to copy it into flash.
+    // Nothing here waits for the device, so the next block can be sent
+    // while this one is still being programmed.
+    if (!send_command(create_write_command(ram_slot, static_cast<uint32_t>(block.size())))) {
+        return false;
+    }
+    if (!transport_->write(block)) {
+        last_error_ = "Failed to send block data: " + transport_->get_last_error();
+        return false;
+    }
+    
+    SambaCommand copy_cmd = create_copy_command(ram_slot, 0);
+    copy_cmd.append('Y', flash_address, static_cast<uint32_t>(block.size()));
+    return send_command(copy_cmd);
+}
+
+bool USBSerialInterface::complete_block_transfer(uint32_t block_size) {
+    // One acknowledgement for the source address, one for the copy itself
+    auto timeout = read_timeout_for(block_size);
+    return expect_reply(SAMBA_COPY_ACK, timeout) && expect_reply(SAMBA_COPY_ACK, timeout);
+}
+
+void USBSerialInterface::resync_link() {
+    // Drop replies still owed for abandoned blocks so a retry starts from
+    // a clean stream
+    std::this_thread::sleep_for(RESYNC_SETTLE_TIME);
+    receiver_->discard();
+}
+
+uint32_t USBSerialInterface::effective_block_size(uint32_t limit) const {
+    const uint32_t page_size = current_device_info_.page_size;
+    // Without an explicit size, split the device's RAM buffer evenly
+    // between the blocks that may be in flight
+    uint32_t requested = transfer_options_.block_size;
+    if (requested == 0) {
+        requested = current_device_info_.ram_buffer_size / std::max<uint32_t>(1, transfer_options_.pipeline_depth);
+    }
+    uint32_t block = std::min(requested, limit);
+    // Whole pages only
+    return std::max(page_size, block / page_size * page_size);
+}
+
+void USBSerialInterface::apply_default_geometry(DeviceInfo& info) {
+    info.flash_size = DEFAULT_FLASH_SIZE;
+    info.page_size = DEFAULT_PAGE_SIZE;
+    info.erase_block_size = DEFAULT_SECTOR_SIZE;
+    info.lock_region_size = DEFAULT_SECTOR_SIZE;
+    info.lock_region_count = DEFAULT_FLASH_SIZE / DEFAULT_SECTOR_SIZE;
+    info.ram_buffer_address = SAMBA_RAM_BUFFER_ADDRESS;
+    info.ram_buffer_size = DEFAULT_RAM_BUFFER_SIZE;
+    info.erase_granularities = {DEFAULT_PAGE_SIZE, DEFAULT_SECTOR_SIZE};
+}
+
+bool USBSerialInterface::discover_geometry(DeviceInfo& info) {
+    // SRAM size comes from the chip ID register
+    uint32_t cidr = 0;
+    if (!read_word(CHIPID_CIDR, cidr)) {
+        return false;
+    }
+    uint32_t sram_size = SRAM_SIZE_KB[(cidr >> 16) & 0xF] * 1024;
     
-    while (std::chrono::steady_clock::now() - start < timeout) {
-        if (transport_->bytes_available() > 0) {
-            return true;
+    // The flash controller's Get Descriptor command reports flash size,
+    // page size, planes and lock regions through successive FRR reads
+    if (!write_word(EEFC_FCR, EEFC_FCR_KEY | EEFC_CMD_GETD)) {
+        return false;
+    }
+    uint32_t fsr = 0;
+    if (!wait_flash_ready(fsr)) {
+        return false;
+    }
+    
+    uint32_t flash_id = 0;
+    uint32_t flash_size = 0;
+    uint32_t page_size = 0;
+    uint32_t plane_count = 0;
+    if (!read_word(EEFC_FRR, flash_id) || !read_word(EEFC_FRR, flash_size) ||
+        !read_word(EEFC_FRR, page_size) || !read_word(EEFC_FRR, plane_count)) {
+        return false;
+    }
+    if (plane_count > EEFC_MAX_DESCRIPTOR_ENTRIES) {
+        last_error_ = "Implausible flash plane count";
+        return false;
+    }
+    for (uint32_t i = 0; i < plane_count; ++i) {
+        uint32_t plane_size = 0;
+        if (!read_word(EEFC_FRR, plane_size)) {
+            return false;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
     
-    return false;
+    uint32_t lock_count = 0;
+    if (!read_word(EEFC_FRR, lock_count)) {
+        return false;
+    }
+    if (lock_count > EEFC_MAX_DESCRIPTOR_ENTRIES) {
+        last_error_ = "Implausible lock region count";
+        return false;
+    }
+    uint32_t lock_size = 0;
+    for (uint32_t i = 0; i < lock_count; ++i) {
+        uint32_t region_size = 0;
+        if (!read_word(EEFC_FRR, region_size)) {
+            return false;
+        }
+        // Regions are uniform on the parts we support; keep the smallest
+        lock_size = (lock_size == 0) ? region_size : std::min(lock_size, region_size);
+    }
+    
+    auto is_power_of_two = [](uint32_t value) { return value != 0 && (value & (value - 1)) == 0; };
+    if (!is_power_of_two(page_size) || flash_size == 0 || flash_size % page_size != 0) {
+        last_error_ = "Implausible flash descriptor";
+        return false;
+    }
+    if (!is_power_of_two(lock_size) || lock_size < page_size) {
+        lock_size = page_size * EEFC_MIN_ERASE_PAGES;
+    }
+    
+    uint32_t reserved = (SAMBA_RAM_BUFFER_ADDRESS - SRAM_BASE_ADDRESS) + SAMBA_STACK_RESERVE;
+    if (sram_size <= reserved + page_size) {
+        last_error_ = "Device SRAM too small for a transfer buffer";
+        return false;
+    }
+    
+    info.flash_size = flash_size;
+    info.page_size = page_size;
+    info.erase_block_size = lock_size;
+    info.lock_region_size = lock_size;
+    info.lock_region_count = lock_count;
+    info.ram_buffer_address = SAMBA_RAM_BUFFER_ADDRESS;
+    info.ram_buffer_size = (sram_size - reserved) / page_size * page_size;
+    info.erase_granularities = {page_size};
+    if (page_size * EEFC_MIN_ERASE_PAGES < lock_size) {
+        info.erase_granularities.push_back(page_size * EEFC_MIN_ERASE_PAGES);
+    }
+    if (lock_size > page_size) {
+        info.erase_granularities.push_back(lock_size);
+    }
+    
+    std::cout << "USBSerialInterface: Flash 0x" << std::hex << flash_id << std::dec << ", "
+              << flash_size / 1024 << " KB, " << page_size << "-byte pages, "
+              << lock_count << " x " << lock_size / 1024 << " KB lock regions, "
+              << info.ram_buffer_size / 1024 << " KB transfer buffer" << std::endl;
+    return true;
+}
+
+bool USBSerialInterface::wait_flash_ready(uint32_t& fsr) {
+    int polls = 0;
+    do {
+        if (!read_word(EEFC_FSR, fsr)) {
+            return false;
+        }
+    } while (!(fsr & EEFC_FSR_FRDY) && ++polls < EEFC_READY_POLLS);
+    if (!(fsr & EEFC_FSR_FRDY)) {
+        last_error_ = "Flash controller not ready";
+        return false;
+    }
+    return true;
+}
+
+bool USBSerialInterface::read_unique_id(std::string& id) {
+    // Start Read Unique Identifier maps the 128-bit ID over the start of
+    // flash until Stop Read Unique Identifier
+    if (!write_word(EEFC_FCR, EEFC_FCR_KEY | EEFC_CMD_STUI)) {
+        return false;
+    }
+    uint32_t words[EEFC_UNIQUE_ID_WORDS] = {};
+    bool read = true;
+    for (uint32_t i = 0; i < EEFC_UNIQUE_ID_WORDS && read; ++i) {
+        read = read_word(i * 4, words[i]);
+    }
+    uint32_t fsr = 0;
+    if (!write_word(EEFC_FCR, EEFC_FCR_KEY | EEFC_CMD_SPUI) || !wait_flash_ready(fsr) || !read) {
+        return false;
+    }
+    
+    // Erased flash or a controller without the command reads back uniform
+    if (std::all_of(std::begin(words), std::end(words), [&words](uint32_t word) { return word == words[0]; })) {
+        last_error_ = "No unique identifier";
+        return false;
+    }
+    char text[EEFC_UNIQUE_ID_WORDS * 8 + 1];
+    for (uint32_t i = 0; i < EEFC_UNIQUE_ID_WORDS; ++i) {
+        std::snprintf(text + i * 8, 9, "%08X", words[i]);
+    }
+    id = text;
+    return true;
+}
+
+bool USBSerialInterface::read_word(uint32_t address, uint32_t& value) {
+    if (!send_command(create_word_read_command(address))) {
+        return false;
+    }
+    auto reply = receive_response(sizeof(uint32_t), transport_->get_read_timeout());
+    if (reply.size() != sizeof(uint32_t)) {
+        return false;
+    }
+    // The monitor answers in target (little-endian) byte order
+    value = uint32_t(reply[0]) | (uint32_t(reply[1]) << 8) | (uint32_t(reply[2]) << 16) | (uint32_t(reply[3]) << 24);
+    return true;
+}
+
+bool USBSerialInterface::write_word(uint32_t address, uint32_t value) {
+    return send_command(create_word_write_command(address, value));
+}
+
+std::chrono::milliseconds USBSerialInterface::read_timeout_for(size_t bytes) const {
+    // Base timeout plus the time the block needs on a slow link
+    return transport_->get_read_timeout() +
+           std::chrono::milliseconds(bytes * 1000 / MIN_LINK_BYTES_PER_SECOND);
 }
 
 // SAM-BA protocol implementations (simplified examples)
 bool USBSerialInterface::enter_programming_mode() {
     // Clear any existing data
     transport_->clear_buffers();
+    receiver_->discard();
     
     // Send autobaud detection character sequence
     std::vector<uint8_t> autobaud = {'#'};
@@ -324,19 +901,13 @@ bool USBSerialInterface::enter_programming_mode() {
         return false;
     }
     
-    // Wait for response
-    if (!wait_for_response_with_timeout(std::chrono::milliseconds(1000))) {
+    // The framer returns as soon as the prompt arrives
+    auto response = receive_response(0, std::chrono::milliseconds(1000));
+    if (response.empty()) {
         last_error_ = "No response to autobaud character";
         return false;
     }
     
-    // Read response
-    auto response = receive_response();
-    if (response.empty() || response[0] != '\r') {
-        last_error_ = "Invalid autobaud response";
-        return false;
-    }
-    
     // Send version command to verify communication
     std::vector<uint8_t> version_cmd = {'V', '#'};
     if (!send_command(version_cmd)) {
@@ -344,14 +915,16 @@ bool USBSerialInterface::enter_programming_mode() {
         return false;
     }
     
-    if (!wait_for_response_with_timeout(std::chrono::milliseconds(1000))) {
-        last_error_ = "No response to version command";
+    auto version_response = receive_response(0, std::chrono::milliseconds(1000));
+    if (version_response.size() <= SAMBA_PROMPT_LENGTH) {
+        last_error_ = version_response.empty() ? "No version response: " + last_error_ : "Empty version response";
         return false;
     }
     
-    auto version_response = receive_response();
-    if (version_response.empty()) {
-        last_error_ = "Empty version response";
+    // Switch the monitor to normal (binary) mode for data transfers
+    std::vector<uint8_t> normal_mode_cmd = {'N', '#'};
+    if (!send_command(normal_mode_cmd) || !expect_reply(SAMBA_EOL, std::chrono::milliseconds(1000))) {
+        last_error_ = "Failed to enter normal mode: " + last_error_;
         return false;
     }
     
@@ -370,80 +943,33 @@ bool USBSerialInterface::exit_programming_mode() {
     return true;
 }
 
-std::vector<uint8_t> USBSerialInterface::create_read_command(uint32_t address, uint32_t size) {
-    std::vector<uint8_t> cmd;
-    cmd.push_back('w'); // Read word command
-    
-    // Convert address to hex string
-    std::stringstream ss;
-    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << address;
-    std::string addr_str = ss.str();
-    
-    for (char c : addr_str) {
-        cmd.push_back(static_cast<uint8_t>(c));
-    }
-    
-    cmd.push_back(',');
-    
-    // Convert size to hex string
-    ss.str("");
-    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << size;
-    std::string size_str = ss.str();
-    
-    for (char c : size_str) {
-        cmd.push_back(static_cast<uint8_t>(c));
-    }
-    
-    cmd.push_back('#');
-    
-    return cmd;
+// Fields are fixed-width hex, encoded straight into a stack buffer
+SambaCommand USBSerialInterface::create_read_command(uint32_t address, uint32_t size) {
+    return SambaCommand('R', address, size); // Read buffer command; data follows raw
 }
 
-std::vector<uint8_t> USBSerialInterface::create_write_command(uint32_t address, const std::vector<uint8_t>& data) {
-    std::vector<uint8_t> cmd;
-    cmd.push_back('S'); // Send file command
-    
-    // Convert address to hex string
-    std::stringstream ss;
-    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << address;
-    std::string addr_str = ss.str();
-    
-    for (char c : addr_str) {
-        cmd.push_back(static_cast<uint8_t>(c));
-    }
-    
-    cmd.push_back(',');
-    
-    // Convert size to hex string
-    ss.str("");
-    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << data.size();
-    std::string size_str = ss.str();
-    
-    for (char c : size_str) {
-        cmd.push_back(static_cast<uint8_t>(c));
-    }
-    
-    cmd.push_back('#');
-    
-    return cmd;
+SambaCommand USBSerialInterface::create_write_command(uint32_t address, uint32_t size) {
+    return SambaCommand('S', address, size); // Send file command
 }
 
-std::vector<uint8_t> USBSerialInterface::create_erase_command(uint32_t address) {
-    std::vector<uint8_t> cmd;
-    cmd.push_back('E'); // Erase command
-    
-    // Convert address to hex string
-    std::stringstream ss;
-    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << address;
-    std::string addr_str = ss.str();
-    
-    for (char c : addr_str) {
-        cmd.push_back(static_cast<uint8_t>(c));
-    }
-    
-    cmd.push_back('#');
-    
-    return cmd;
+SambaCommand USBSerialInterface::create_erase_command(uint32_t address, uint32_t size) {
+    return SambaCommand('E', address, size); // Erase an aligned region
+}
+
+SambaCommand USBSerialInterface::create_copy_command(uint32_t address, uint32_t size) {
+    return SambaCommand('Y', address, size); // Buffer copy command (size 0 sets the source address)
+}
+
+SambaCommand USBSerialInterface::create_checksum_command(uint32_t address, uint32_t size) {
+    return SambaCommand('Z', address, size); // CRC-16/CCITT of a flash region, padded to 8 hex digits
+}
+
+SambaCommand USBSerialInterface::create_word_read_command(uint32_t address) {
+    return SambaCommand().append_literal('w', address, '4'); // Read word command
+}
+
+SambaCommand USBSerialInterface::create_word_write_command(uint32_t address, uint32_t value) {
+    return SambaCommand('W', address, value); // Write word command
 }
 
 } // namespace SamFlash
@@ -3,6 +3,9 @@
 
 #include "device_interface.h"
 #include "serial_transport.h"
+#include "serial_receiver.h"
+#include "adaptive_chunker.h"
+#include "samba_protocol.h"
 #include <string>
 #include <atomic>
 #include <memory>
@@ -27,9 +30,18 @@ public:
     // Flash operations
     bool erase_chip() override;
     bool erase_page(uint32_t address) override;
+    bool erase_region(uint32_t address, uint32_t size) override;
     bool write_page(uint32_t address, const std::vector<uint8_t>& data) override;
     std::vector<uint8_t> read_page(uint32_t address, uint32_t size) override;
     bool verify_flash(const std::vector<uint8_t>& expected_data, uint32_t start_address = 0) override;
+    bool write_page(uint32_t address, ByteSpan data) override;
+    bool read_page(uint32_t address, MutableByteSpan buffer) override;
+    bool verify_flash(ByteSpan expected_data, uint32_t start_address = 0) override;
+    void set_transfer_options(const TransferOptions& options) override;
+    bool write_pages(uint32_t address, ByteSpan data, const WriteProgressFn& on_progress = nullptr) override;
+    bool compute_flash_checksum(uint32_t address, uint32_t size, uint32_t& checksum) override;
+    uint32_t checksum_of(ByteSpan data) const override;
+    TransferStats get_transfer_stats() const override;
     
     // Progress and status
     void set_progress_callback(std::function<void(const FlashProgress&)> callback) override;
@@ -41,6 +53,8 @@ public:
 
 private:
     std::unique_ptr<SerialTransport> transport_;
+    std::shared_ptr<SerialReactor> reactor_; // outlives receiver_
+    std::unique_ptr<SerialReceiver> receiver_;
     std::atomic<bool> connected_;
     std::atomic<FlashStatus> status_;
     std::string device_id_;
@@ -48,18 +62,44 @@ private:
     DeviceInfo current_device_info_;
     std::string last_error_;
     std::function<void(const FlashProgress&)> progress_callback_;
+    TransferOptions transfer_options_;
+    std::unique_ptr<AdaptiveChunker> write_chunker_;
+    bool checksum_unsupported_ = false;
     
     // Protocol helpers
-    bool send_command(const std::vector<uint8_t>& command);
-    std::vector<uint8_t> receive_response(size_t expected_size = 0);
+    bool send_command(ByteSpan command);
+    bool send_command(const SambaCommand& command);
+    std::vector<uint8_t> receive_response(size_t expected_size = 0,
+                                          std::chrono::milliseconds timeout = std::chrono::milliseconds(2000));
     bool wait_for_response_with_timeout(std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
+    bool expect_reply(const char* expected, std::chrono::milliseconds timeout);
+    
+    // Pipelined block programming
+    bool send_block_transfer(uint32_t ram_slot, uint32_t flash_address, ByteSpan block);
+    bool complete_block_transfer(uint32_t block_size);
+    void resync_link();
+    AdaptiveChunker& write_chunker();
+    uint32_t effective_block_size(uint32_t limit) const;
+    
+    // Flash geometry
+    static void apply_default_geometry(DeviceInfo& info);
+    bool discover_geometry(DeviceInfo& info);
+    bool read_unique_id(std::string& id);
+    bool wait_flash_ready(uint32_t& fsr);
+    bool read_word(uint32_t address, uint32_t& value);
+    bool write_word(uint32_t address, uint32_t value);
+    std::chrono::milliseconds read_timeout_for(size_t bytes) const;
     
     // SAM-BA protocol commands (example)
     bool enter_programming_mode();
     bool exit_programming_mode();
-    std::vector<uint8_t> create_read_command(uint32_t address, uint32_t size);
-    std::vector<uint8_t> create_write_command(uint32_t address, const std::vector<uint8_t>& data);
-    std::vector<uint8_t> create_erase_command(uint32_t address);
+    SambaCommand create_read_command(uint32_t address, uint32_t size);
+    SambaCommand create_write_command(uint32_t address, uint32_t size);
+    SambaCommand create_copy_command(uint32_t address, uint32_t size);
+    SambaCommand create_erase_command(uint32_t address, uint32_t size);
+    SambaCommand create_checksum_command(uint32_t address, uint32_t size);
+    SambaCommand create_word_read_command(uint32_t address);
+    SambaCommand create_word_write_command(uint32_t address, uint32_t value);
 };
 
 } // namespace SamFlash
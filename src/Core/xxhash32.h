@@ -0,0 +1,107 @@
+#ifndef XXHASH32_H
+#define XXHASH32_H
+
+#include "byte_span.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace SamFlash {
+
+// Incremental xxHash32, the checksum used by the LZ4 frame format for its
+// header, blocks and content.
+class XxHash32 {
+public:
+    explicit XxHash32(uint32_t seed = 0) { reset(seed); }
+
+    void reset(uint32_t seed = 0) {
+        seed_ = seed;
+        acc_[0] = seed + PRIME1 + PRIME2;
+        acc_[1] = seed + PRIME2;
+        acc_[2] = seed;
+        acc_[3] = seed - PRIME1;
+        length_ = 0;
+        buffered_ = 0;
+    }
+
+    void update(ByteSpan data) {
+        const uint8_t* in = data.data();
+        size_t size = data.size();
+        length_ += size;
+
+        if (buffered_ != 0) {
+            size_t take = std::min(size, sizeof(buffer_) - buffered_);
+            std::memcpy(buffer_ + buffered_, in, take);
+            buffered_ += take;
+            in += take;
+            size -= take;
+            if (buffered_ < sizeof(buffer_)) {
+                return;
+            }
+            consume(buffer_);
+            buffered_ = 0;
+        }
+        for (; size >= sizeof(buffer_); in += sizeof(buffer_), size -= sizeof(buffer_)) {
+            consume(in);
+        }
+        std::memcpy(buffer_, in, size);
+        buffered_ = size;
+    }
+
+    uint32_t digest() const {
+        uint32_t hash = length_ >= sizeof(buffer_)
+                            ? rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18)
+                            : seed_ + PRIME5;
+        hash += static_cast<uint32_t>(length_);
+
+        size_t i = 0;
+        for (; i + 4 <= buffered_; i += 4) {
+            hash = rotl(hash + read32(buffer_ + i) * PRIME3, 17) * PRIME4;
+        }
+        for (; i < buffered_; ++i) {
+            hash = rotl(hash + buffer_[i] * PRIME5, 11) * PRIME1;
+        }
+        hash ^= hash >> 15;
+        hash *= PRIME2;
+        hash ^= hash >> 13;
+        hash *= PRIME3;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    static uint32_t compute(ByteSpan data, uint32_t seed = 0) {
+        XxHash32 hash(seed);
+        hash.update(data);
+        return hash.digest();
+    }
+
+private:
+    static constexpr uint32_t PRIME1 = 2654435761u;
+    static constexpr uint32_t PRIME2 = 2246822519u;
+    static constexpr uint32_t PRIME3 = 3266489917u;
+    static constexpr uint32_t PRIME4 = 668265263u;
+    static constexpr uint32_t PRIME5 = 374761393u;
+
+    static uint32_t rotl(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+    static uint32_t read32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    void consume(const uint8_t* stripe) {
+        for (int lane = 0; lane < 4; ++lane) {
+            acc_[lane] = rotl(acc_[lane] + read32(stripe + lane * 4) * PRIME2, 13) * PRIME1;
+        }
+    }
+
+    uint32_t seed_ = 0;
+    uint32_t acc_[4] = {};
+    uint64_t length_ = 0;
+    uint8_t buffer_[16] = {};
+    size_t buffered_ = 0;
+};
+
+} // namespace SamFlash
+
+#endif // XXHASH32_H
@@ -134,7 +134,7 @@ void MainWindow::select_firmware_file() {
         this, 
         "Select Firmware File", 
         "", 
-        "Firmware Files (*.bin *.hex *.elf);;All Files (*)"
+        "Firmware Files (*.bin *.hex *.elf *.img *.tar *.md5 *.lz4);;All Files (*)"
     );
     
     if (!file.isEmpty()) {
@@ -271,6 +271,12 @@ void MainWindow::on_progress_update(const SamFlash::FlashProgress& progress) {
         .arg(progress.percentage, 0, 'f', 1)
         .arg(progress.bytes_written)
         .arg(progress.total_bytes);
+    if (progress.transfer_chunk_size > 0) {
+        status_msg += QString(" - %1 KB blocks x%2, %3 KB/s")
+            .arg(progress.transfer_chunk_size / 1024.0, 0, 'f', 1)
+            .arg(progress.pipeline_depth)
+            .arg(progress.throughput_bps / 1024.0, 0, 'f', 1);
+    }
     
     statusBar()->showMessage(status_msg);
 }
@@ -21,7 +21,9 @@ int handle_scan(bool json_output) {
     return 0;
 }
 
-int handle_flash(const std::string& firmware_file, const std::string& device_id, bool json_output, bool verify, bool erase) {
+int handle_flash(const std::string& firmware_file, const std::string& device_id, bool json_output, bool verify, bool erase,
+                 bool differential, bool resume, const std::string& journal_path,
+                 const std::vector<std::string>& partitions, size_t memory_budget_mb) {
     ProgressReporter reporter(json_output);
     FlashManager manager;
     
@@ -29,6 +31,11 @@ int handle_flash(const std::string& firmware_file, const std::string& device_id,
     FlashConfig config = manager.get_config();
     config.verify_after_write = verify;
     config.erase_before_write = erase;
+    config.differential_flash = differential;
+    config.resume = resume;
+    config.journal_path = journal_path;
+    config.partitions = partitions;
+    config.memory_budget = memory_budget_mb * 1024 * 1024;
     manager.set_config(config);
     
     // Set up progress callback
@@ -104,10 +111,14 @@ int handle_verify(const std::string& firmware_file, const std::string& device_id
     return success ? 0 : 1;
 }
 
-int handle_erase(const std::string& device_id, bool json_output) {
+int handle_erase(const std::string& device_id, bool json_output, const std::vector<std::string>& partitions) {
     ProgressReporter reporter(json_output);
     FlashManager manager;
     
+    FlashConfig config = manager.get_config();
+    config.partitions = partitions;
+    manager.set_config(config);
+    
     // Connect to device
     if (!device_id.empty()) {
         if (!manager.connect_device(device_id)) {
@@ -215,6 +226,11 @@ int main(int argc, char** argv) {
     std::string flash_device_id;
     bool flash_verify = true;
     bool flash_erase = true;
+    bool flash_differential = false;
+    bool flash_resume = false;
+    std::string flash_journal;
+    std::vector<std::string> flash_partitions;
+    size_t flash_memory_budget = 0;
     
     flash_cmd->add_option("--file,-f", flash_file, "Firmware file to flash")
         ->required()
@@ -226,9 +242,21 @@ int main(int argc, char** argv) {
     flash_cmd->add_flag("--no-erase", flash_erase, "Skip erase before flashing")
         ->default_val(true)
         ->transform([](bool flag) { return !flag; });
+    flash_cmd->add_flag("--differential", flash_differential,
+                        "Only erase and rewrite sectors whose device checksum differs from the image");
+    flash_cmd->add_flag("--resume", flash_resume,
+                        "Continue an interrupted flash of the same image from its last checkpoint, "
+                        "keeping checkpoints for this one");
+    flash_cmd->add_option("--journal", flash_journal,
+                          "Keep session checkpoints in this file (default with --resume: <file>.samflash-journal)");
+    flash_cmd->add_option("--partition,-p", flash_partitions,
+                          "PIT partition to write, e.g. BOOT; repeat for several (default: all the firmware has)");
+    flash_cmd->add_option("--memory-budget", flash_memory_budget,
+                          "Stream the image from disk through this many MB instead of mapping it (minimum 4; .lz4 images always stream)");
     
     flash_cmd->callback([&]() {
-        return handle_flash(flash_file, flash_device_id, json_output, flash_verify, flash_erase);
+        return handle_flash(flash_file, flash_device_id, json_output, flash_verify, flash_erase, flash_differential,
+                            flash_resume, flash_journal, flash_partitions, flash_memory_budget);
     });
     
     // Verify command
@@ -248,11 +276,14 @@ int main(int argc, char** argv) {
     // Erase command
     auto erase_cmd = app.add_subcommand("erase", "Erase device flash memory");
     std::string erase_device_id;
+    std::vector<std::string> erase_partitions;
     
     erase_cmd->add_option("--device,-d", erase_device_id, "Target device ID (auto-detect if not specified)");
+    erase_cmd->add_option("--partition,-p", erase_partitions,
+                          "PIT partition to erase; repeat for several (default: the whole device)");
     
     erase_cmd->callback([&]() {
-        return handle_erase(erase_device_id, json_output);
+        return handle_erase(erase_device_id, json_output, erase_partitions);
     });
     
     // Batch command
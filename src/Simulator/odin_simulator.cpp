@@ -0,0 +1,382 @@
+#include "odin_simulator.h"
+#include <Core/sparse_image.h>
+#include <algorithm>
+#include <cstring>
+
+namespace SamFlash {
+
+namespace {
+    void write_name(const std::string& name, uint8_t* out) {
+        std::memcpy(out, name.data(), std::min(name.size(), PIT_NAME_SIZE - 1));
+    }
+
+    std::vector<uint8_t> encode_pit(const std::vector<PITEntry>& entries) {
+        std::vector<uint8_t> pit(PIT_HEADER_SIZE + entries.size() * PIT_ENTRY_SIZE, 0);
+        write_le32(PIT_MAGIC, pit.data());
+        write_le32(static_cast<uint32_t>(entries.size()), pit.data() + 4);
+        std::memcpy(pit.data() + 8, "COM_TAR2SIMULATE", 16);
+
+        uint8_t* out = pit.data() + PIT_HEADER_SIZE;
+        for (const auto& entry : entries) {
+            const uint32_t fields[] = {
+                entry.binary_type, entry.device_type, entry.identifier, entry.attributes,
+                entry.update_attributes, entry.block_size_or_offset, entry.block_count_or_size,
+                entry.file_offset, entry.file_size};
+            for (size_t i = 0; i < 9; ++i) {
+                write_le32(fields[i], out + 4 * i);
+            }
+            write_name(entry.partition_name, out + 36);
+            write_name(entry.flash_filename, out + 36 + PIT_NAME_SIZE);
+            write_name(entry.fota_filename, out + 36 + 2 * PIT_NAME_SIZE);
+            out += PIT_ENTRY_SIZE;
+        }
+        return pit;
+    }
+
+    // Expand a sparse image the way the bootloader does when the last
+    // sequence of a file lands; DONT_CARE blocks read back as zero
+    bool unsparse(const std::vector<uint8_t>& sparse, uint64_t capacity, std::vector<uint8_t>& out) {
+        SparseImageReader reader;
+        if (!reader.open(ByteSpan(sparse)) || reader.output_size() > capacity) {
+            return false;
+        }
+        out.assign(static_cast<size_t>(reader.output_size()), 0);
+        SparseChunk chunk;
+        while (reader.next(chunk)) {
+            uint8_t* dest = out.data() + chunk.output_offset;
+            if (chunk.type == SPARSE_CHUNK_RAW) {
+                std::memcpy(dest, chunk.data.data(), chunk.data.size());
+            } else if (chunk.type == SPARSE_CHUNK_FILL) {
+                for (uint64_t i = 0; i < chunk.output_size; i += 4) {
+                    std::memcpy(dest + i, chunk.data.data(), 4);
+                }
+            }
+        }
+        return reader.at_end();
+    }
+
+    std::chrono::steady_clock::duration transfer_time(uint64_t bytes, double bytes_per_second) {
+        if (bytes_per_second <= 0) {
+            return std::chrono::steady_clock::duration::zero();
+        }
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(bytes) / bytes_per_second));
+    }
+}
+
+std::vector<PITEntry> OdinDeviceModel::default_partitions() {
+    // Offsets and sizes in 512-byte blocks; device type 2 is eMMC
+    auto entry = [](uint32_t identifier, const char* name, const char* file, uint32_t offset, uint32_t blocks) {
+        PITEntry e{};
+        e.device_type = 2;
+        e.identifier = identifier;
+        e.attributes = 5;
+        e.update_attributes = 1;
+        e.block_size_or_offset = offset;
+        e.block_count_or_size = blocks;
+        e.partition_name = name;
+        e.flash_filename = file;
+        return e;
+    };
+    return {
+        entry(1, "BOOTLOADER", "sboot.bin", 0x2000, 0x2000),
+        entry(2, "PARAM", "param.bin", 0x4000, 0x2000),
+        entry(3, "BOOT", "boot.img", 0x6000, 0x20000),
+        entry(4, "RECOVERY", "recovery.img", 0x26000, 0x20000),
+        entry(5, "RADIO", "modem.bin", 0x46000, 0x40000),
+        entry(6, "SYSTEM", "system.img", 0x86000, 0x800000),
+        entry(7, "USERDATA", "userdata.img", 0x886000, 0x1000000),
+    };
+}
+
+OdinSimulator::OdinSimulator(const OdinDeviceModel& device, const OdinTimingModel& timing)
+    : device_(device), timing_(timing), link_(timing.link_bytes_per_second), pit_data_(encode_pit(device.partitions)) {
+    // Partition contents are stored as written, so multi-GB layouts cost
+    // only what the host actually sends
+    for (const auto& entry : device_.partitions) {
+        Partition& partition = partitions_[entry.identifier];
+        partition.capacity = uint64_t(entry.block_count_or_size) * device_.block_size;
+        partition.device_type = entry.device_type;
+    }
+}
+
+OdinSimulator::~OdinSimulator() {
+    stop();
+}
+
+bool OdinSimulator::start() {
+    if (running_) {
+        return true;
+    }
+    if (!link_.start()) {
+        last_error_ = link_.get_last_error();
+        return false;
+    }
+
+    stats_.file_part_size = device_.default_file_part_size;
+    running_ = true;
+    command_thread_ = std::thread(&OdinSimulator::command_loop, this);
+    return true;
+}
+
+void OdinSimulator::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    link_.stop();
+    if (command_thread_.joinable()) {
+        command_thread_.join();
+    }
+    link_.close();
+}
+
+std::vector<uint8_t> OdinSimulator::read_partition(uint32_t identifier) const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto it = partitions_.find(identifier);
+    return it != partitions_.end() ? it->second.data : std::vector<uint8_t>{};
+}
+
+uint64_t OdinSimulator::partition_size(uint32_t identifier) const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto it = partitions_.find(identifier);
+    return it != partitions_.end() ? it->second.size : 0;
+}
+
+OdinSimulator::Stats OdinSimulator::get_stats() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    Stats stats = stats_;
+    stats.bytes_received = link_.bytes_received();
+    stats.bytes_sent = link_.bytes_sent();
+    return stats;
+}
+
+void OdinSimulator::command_loop() {
+    std::vector<uint8_t> packet(ODIN_CONTROL_PACKET_SIZE);
+    std::vector<uint8_t> part;
+    uint32_t part_index = 0;
+
+    while (true) {
+        // Inside a sequence the host sends raw file parts until the
+        // announced byte count has arrived
+        if (sequence_.size() < sequence_expected_) {
+            uint32_t part_size = get_stats().file_part_size;
+            part.resize(part_size);
+            if (!link_.receive(part.data(), part.size())) {
+                return;
+            }
+            size_t take = std::min<size_t>(part_size, sequence_expected_ - sequence_.size());
+            sequence_.insert(sequence_.end(), part.begin(), part.begin() + take);
+            {
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                ++stats_.file_parts;
+            }
+            wait_for(transfer_time(take, timing_.storage_bytes_per_second));
+            respond(SamsungHandshake::FILE_PART, part_index++);
+            continue;
+        }
+        part_index = 0;
+
+        // Every packet starts with a word; "ODIN" in its place is a
+        // (re)connecting host
+        if (!link_.receive(packet.data(), ODIN_HANDSHAKE_LENGTH)) {
+            return;
+        }
+        if (std::memcmp(packet.data(), ODIN_HANDSHAKE, ODIN_HANDSHAKE_LENGTH) == 0) {
+            link_.send(reinterpret_cast<const uint8_t*>(ODIN_HANDSHAKE_REPLY), ODIN_HANDSHAKE_LENGTH);
+            continue;
+        }
+        if (!link_.receive(packet.data() + ODIN_HANDSHAKE_LENGTH, packet.size() - ODIN_HANDSHAKE_LENGTH)) {
+            return;
+        }
+
+        OdinControlPacket control = OdinControlPacket::from_bytes(packet.data());
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            ++stats_.packets;
+        }
+        switch (control.type()) {
+            case SamsungHandshake::SESSION_BEGIN: handle_session(control); break;
+            case SamsungHandshake::PIT_FILE: handle_pit(control); break;
+            case SamsungHandshake::FILE_PART: handle_file(control); break;
+            case SamsungHandshake::SESSION_END: handle_end(control); break;
+            default: reject(); break;
+        }
+    }
+}
+
+void OdinSimulator::handle_session(const OdinControlPacket& packet) {
+    switch (packet.request()) {
+        case OdinSessionRequest::BEGIN:
+            {
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                stats_.file_part_size = device_.default_file_part_size;
+                stats_.total_bytes = 0;
+                stats_.session_ended = false;
+            }
+            respond(SamsungHandshake::SESSION_BEGIN, device_.protocol_version);
+            return;
+
+        case OdinSessionRequest::DEVICE_TYPE:
+            respond(SamsungHandshake::SESSION_BEGIN, 0);
+            return;
+
+        case OdinSessionRequest::TOTAL_BYTES:
+            {
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                stats_.total_bytes = packet.argument(0) | (uint64_t(packet.argument(1)) << 32);
+            }
+            respond(SamsungHandshake::SESSION_BEGIN, 0);
+            return;
+
+        case OdinSessionRequest::FILE_PART_SIZE: {
+            uint32_t size = packet.argument(0);
+            if (device_.protocol_version == 0 || size == 0 || size > device_.max_file_part_size) {
+                reject();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                stats_.file_part_size = size;
+            }
+            respond(SamsungHandshake::SESSION_BEGIN, 0);
+            return;
+        }
+
+        default:
+            reject();
+            return;
+    }
+}
+
+void OdinSimulator::handle_pit(const OdinControlPacket& packet) {
+    switch (packet.request()) {
+        case OdinTransferRequest::DUMP:
+            respond(SamsungHandshake::PIT_FILE, static_cast<uint32_t>(pit_data_.size()));
+            return;
+
+        case OdinTransferRequest::PART: {
+            // Parts go out raw, without a response header
+            size_t offset = size_t(packet.argument(0)) * ODIN_PIT_PART_SIZE;
+            if (offset >= pit_data_.size()) {
+                reject();
+                return;
+            }
+            size_t length = std::min(ODIN_PIT_PART_SIZE, pit_data_.size() - offset);
+            wait_for(timing_.packet_latency);
+            link_.send(pit_data_.data() + offset, length);
+            return;
+        }
+
+        case OdinTransferRequest::END:
+            respond(SamsungHandshake::PIT_FILE, 0);
+            return;
+
+        default:
+            // Repartitioning isn't simulated
+            reject();
+            return;
+    }
+}
+
+void OdinSimulator::handle_file(const OdinControlPacket& packet) {
+    switch (packet.request()) {
+        case OdinTransferRequest::FLASH:
+            // The bootloader wants the session total before any file
+            if (packet.argument(0) == 0 || get_stats().total_bytes == 0) {
+                reject();
+                return;
+            }
+            sequence_.clear();
+            sequence_expected_ = packet.argument(0);
+            respond(SamsungHandshake::FILE_PART, 0);
+            return;
+
+        case OdinTransferRequest::END: {
+            uint32_t length = packet.argument(OdinFileEnd::SEQUENCE_BYTES);
+            uint32_t identifier = packet.argument(OdinFileEnd::IDENTIFIER);
+            bool last = packet.argument(OdinFileEnd::LAST_SEQUENCE) != 0;
+            std::vector<uint8_t> sequence;
+            sequence.swap(sequence_);
+            sequence_expected_ = 0;
+
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            auto it = partitions_.find(identifier);
+            if (it == partitions_.end() || length != sequence.size() ||
+                packet.argument(OdinFileEnd::DEVICE_TYPE) != it->second.device_type ||
+                it->second.write_offset + length > it->second.capacity) {
+                lock.unlock();
+                reject();
+                return;
+            }
+
+            // A file always starts at the front of its partition
+            Partition& partition = it->second;
+            if (partition.write_offset == 0) {
+                partition.data.clear();
+            }
+            if (device_.store_data) {
+                partition.data.resize(partition.write_offset + length);
+                std::copy(sequence.begin(), sequence.end(), partition.data.begin() + partition.write_offset);
+            }
+            partition.write_offset += length;
+            partition.size = partition.write_offset;
+            ++stats_.sequences;
+            if (last) {
+                partition.write_offset = 0;
+                if (device_.store_data && SparseImageReader::is_sparse(ByteSpan(partition.data))) {
+                    std::vector<uint8_t> expanded;
+                    if (!unsparse(partition.data, partition.capacity, expanded)) {
+                        partition.data.clear();
+                        lock.unlock();
+                        reject();
+                        return;
+                    }
+                    partition.data.swap(expanded);
+                    partition.size = partition.data.size();
+                    ++stats_.sparse_files;
+                }
+                ++stats_.files_completed;
+            }
+            lock.unlock();
+            respond(SamsungHandshake::FILE_PART, 0);
+            return;
+        }
+
+        default:
+            reject();
+            return;
+    }
+}
+
+void OdinSimulator::handle_end(const OdinControlPacket& packet) {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (packet.request() == OdinEndRequest::REBOOT) {
+            stats_.reboot_requested = true;
+        }
+        stats_.session_ended = true;
+    }
+    respond(SamsungHandshake::SESSION_END, 0);
+}
+
+void OdinSimulator::respond(uint32_t type, uint32_t value) {
+    wait_for(timing_.packet_latency);
+    auto bytes = OdinResponse{type, value}.encode();
+    link_.send(bytes.data(), bytes.size());
+}
+
+void OdinSimulator::reject() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        ++stats_.protocol_errors;
+    }
+    respond(ODIN_RESPONSE_FAIL, 0);
+}
+
+void OdinSimulator::wait_for(std::chrono::steady_clock::duration time) {
+    if (time > std::chrono::steady_clock::duration::zero()) {
+        std::this_thread::sleep_for(time);
+    }
+}
+
+} // namespace SamFlash
@@ -0,0 +1,121 @@
+#ifndef ODIN_SIMULATOR_H
+#define ODIN_SIMULATOR_H
+
+#include "simulated_link.h"
+#include <Core/odin_protocol.h>
+#include <Core/pit_parser.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SamFlash {
+
+// What the simulated phone looks like: the partition table it serves and
+// the protocol options its bootloader offers.
+struct OdinDeviceModel {
+    std::vector<PITEntry> partitions = default_partitions();
+    uint32_t block_size = 512;              // unit of PIT offsets and sizes
+    uint32_t protocol_version = 1;          // 0: no part size negotiation
+    uint32_t default_file_part_size = 1024; // until the host negotiates
+    uint32_t max_file_part_size = 1024 * 1024;
+    bool store_data = true;                 // false: only count what lands, for multi-GB files
+
+    // A small eMMC layout with the usual boot, radio and system partitions
+    static std::vector<PITEntry> default_partitions();
+};
+
+// How long things take. Zero disables a delay.
+struct OdinTimingModel {
+    double link_bytes_per_second = 0.0;      // USB bulk rate in each direction
+    std::chrono::microseconds packet_latency{0}; // turnaround before every response
+    double storage_bytes_per_second = 0.0;   // eMMC write rate for file data
+};
+
+// Samsung download-mode bootloader running on the master end of a
+// pseudo-terminal. Speaks the Odin session protocol against an in-memory
+// partition store, so SamsungFlasher can be exercised and timed without a
+// phone attached.
+class OdinSimulator {
+public:
+    struct Stats {
+        uint64_t packets = 0; // control packets received
+        uint64_t bytes_received = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t file_parts = 0;
+        uint64_t sequences = 0;
+        uint64_t files_completed = 0;
+        uint64_t sparse_files = 0; // completed files expanded from sparse images
+        uint64_t protocol_errors = 0;
+        uint32_t file_part_size = 0; // currently in effect
+        uint64_t total_bytes = 0;    // announced for the session; 0 until TOTAL_BYTES
+        bool session_ended = false;
+        bool reboot_requested = false;
+    };
+
+    explicit OdinSimulator(const OdinDeviceModel& device = OdinDeviceModel{},
+                           const OdinTimingModel& timing = OdinTimingModel{});
+    ~OdinSimulator();
+
+    OdinSimulator(const OdinSimulator&) = delete;
+    OdinSimulator& operator=(const OdinSimulator&) = delete;
+
+    bool start();
+    void stop();
+    bool is_running() const { return running_; }
+
+    const std::string& port_path() const { return link_.port_path(); }
+    std::string get_last_error() const { return last_error_; }
+
+    // The PIT as served to the host
+    const std::vector<uint8_t>& pit_data() const { return pit_data_; }
+
+    // Inspection, safe while running
+    std::vector<uint8_t> read_partition(uint32_t identifier) const;
+    uint64_t partition_size(uint32_t identifier) const; // bytes written, stored or not
+    Stats get_stats() const;
+
+private:
+    struct Partition {
+        uint64_t capacity = 0;
+        uint32_t device_type = 0;  // FILE_PART END must name the same one
+        uint64_t write_offset = 0; // where the next sequence lands
+        uint64_t size = 0;         // of the file written last, even when not stored
+        std::vector<uint8_t> data;
+    };
+
+    void command_loop();
+    void handle_session(const OdinControlPacket& packet);
+    void handle_pit(const OdinControlPacket& packet);
+    void handle_file(const OdinControlPacket& packet);
+    void handle_end(const OdinControlPacket& packet);
+
+    void respond(uint32_t type, uint32_t value);
+    void reject();
+    void wait_for(std::chrono::steady_clock::duration time);
+
+    OdinDeviceModel device_;
+    OdinTimingModel timing_;
+    SimulatedLink link_;
+    std::string last_error_;
+    std::vector<uint8_t> pit_data_;
+
+    std::atomic<bool> running_{false};
+    std::thread command_thread_;
+
+    // Sequence being received; only touched by the command thread
+    std::vector<uint8_t> sequence_;
+    uint32_t sequence_expected_ = 0;
+
+    mutable std::mutex state_mutex_;
+    std::map<uint32_t, Partition> partitions_;
+    Stats stats_;
+};
+
+} // namespace SamFlash
+
+#endif // ODIN_SIMULATOR_H
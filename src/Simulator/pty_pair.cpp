@@ -0,0 +1,61 @@
+#include "pty_pair.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace SamFlash {
+
+PtyPair::~PtyPair() {
+    close();
+}
+
+bool PtyPair::open() {
+    close();
+
+    master_fd_ = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (master_fd_ < 0) {
+        last_error_ = std::string("posix_openpt failed: ") + std::strerror(errno);
+        return false;
+    }
+
+    char name[128];
+    if (::grantpt(master_fd_) != 0 || ::unlockpt(master_fd_) != 0 ||
+        ::ptsname_r(master_fd_, name, sizeof(name)) != 0) {
+        last_error_ = std::string("Failed to set up pseudo-terminal: ") + std::strerror(errno);
+        close();
+        return false;
+    }
+    slave_path_ = name;
+
+    // Raw from the start, so nothing written before a client configures
+    // the port is echoed or translated
+    slave_fd_ = ::open(name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave_fd_ < 0) {
+        last_error_ = std::string("Failed to open ") + name + ": " + std::strerror(errno);
+        close();
+        return false;
+    }
+    struct termios tio;
+    if (::tcgetattr(slave_fd_, &tio) == 0) {
+        ::cfmakeraw(&tio);
+        ::tcsetattr(slave_fd_, TCSANOW, &tio);
+    }
+    return true;
+}
+
+void PtyPair::close() {
+    if (slave_fd_ >= 0) {
+        ::close(slave_fd_);
+        slave_fd_ = -1;
+    }
+    if (master_fd_ >= 0) {
+        ::close(master_fd_);
+        master_fd_ = -1;
+    }
+    slave_path_.clear();
+}
+
+} // namespace SamFlash
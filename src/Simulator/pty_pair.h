@@ -0,0 +1,35 @@
+#ifndef PTY_PAIR_H
+#define PTY_PAIR_H
+
+#include <string>
+
+namespace SamFlash {
+
+// Linux pseudo-terminal pair. A simulated device reads and writes the
+// master end; the slave path is opened like any serial port.
+class PtyPair {
+public:
+    PtyPair() = default;
+    ~PtyPair();
+
+    PtyPair(const PtyPair&) = delete;
+    PtyPair& operator=(const PtyPair&) = delete;
+
+    bool open();
+    void close();
+    bool is_open() const { return master_fd_ >= 0; }
+
+    int master_fd() const { return master_fd_; }
+    const std::string& slave_path() const { return slave_path_; }
+    std::string get_last_error() const { return last_error_; }
+
+private:
+    int master_fd_ = -1;
+    int slave_fd_ = -1; // held open so the master never sees a hangup between clients
+    std::string slave_path_;
+    std::string last_error_;
+};
+
+} // namespace SamFlash
+
+#endif // PTY_PAIR_H
@@ -0,0 +1,377 @@
+#include "samba_simulator.h"
+#include <Core/crc16.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace SamFlash {
+
+namespace {
+    constexpr uint32_t SRAM_BASE = 0x20000000;
+    constexpr uint32_t CHIPID_CIDR = 0x400E0740;
+    constexpr uint32_t EEFC_FCR = 0x400E0A04;
+    constexpr uint32_t EEFC_FSR = 0x400E0A08;
+    constexpr uint32_t EEFC_FRR = 0x400E0A0C;
+    constexpr uint32_t EEFC_FCR_KEY = 0x5Au << 24;
+    constexpr uint32_t EEFC_CMD_GETD = 0x00;
+    constexpr uint32_t EEFC_CMD_EA = 0x05;
+    constexpr uint32_t EEFC_CMD_STUI = 0x0E;
+    constexpr uint32_t EEFC_CMD_SPUI = 0x0F;
+    constexpr uint32_t EEFC_FSR_FRDY = 0x1;
+    constexpr uint32_t FLASH_ID = 0x00000150;
+    // CIDR for a SAM4S with the SRAM size field (bits 16..19) cleared
+    constexpr uint32_t CHIP_ID_BASE = 0x28A00CE0;
+    constexpr uint32_t SRAM_SIZE_KB[16] = {48, 192, 384, 6, 24, 4, 80, 160, 8, 16, 32, 64, 128, 256, 96, 512};
+
+    constexpr const char* PROMPT = "\n\r>";
+    constexpr const char* VERSION = "v1.1 SamFlash simulator";
+    // Longest "X<addr>,<arg>#" command text; anything longer is noise
+    constexpr size_t MAX_COMMAND_LENGTH = 32;
+
+    bool parse_hex(const std::string& text, uint32_t& value) {
+        if (text.empty() || text.size() > 8) {
+            return false;
+        }
+        value = 0;
+        for (char c : text) {
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'A' && c <= 'F') value |= static_cast<uint32_t>(c - 'A' + 10);
+            else if (c >= 'a' && c <= 'f') value |= static_cast<uint32_t>(c - 'a' + 10);
+            else return false;
+        }
+        return true;
+    }
+}
+
+// 8N1 framing puts ten bits on the wire per byte
+SambaSimulator::SambaSimulator(const SambaDeviceModel& device, const SambaTimingModel& timing)
+    : device_(device), timing_(timing), link_(timing.baud_rate / 10.0),
+      flash_(device.flash_size, 0xFF), sram_(device.sram_size, 0x00) {}
+
+SambaSimulator::~SambaSimulator() {
+    stop();
+}
+
+bool SambaSimulator::start() {
+    if (running_) {
+        return true;
+    }
+    if (std::find(std::begin(SRAM_SIZE_KB), std::end(SRAM_SIZE_KB), device_.sram_size / 1024) == std::end(SRAM_SIZE_KB)) {
+        last_error_ = "SRAM size can't be encoded in the chip ID";
+        return false;
+    }
+    if (!link_.start()) {
+        last_error_ = link_.get_last_error();
+        return false;
+    }
+
+    running_ = true;
+    command_thread_ = std::thread(&SambaSimulator::command_loop, this);
+    return true;
+}
+
+void SambaSimulator::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    link_.stop();
+    if (command_thread_.joinable()) {
+        command_thread_.join();
+    }
+    link_.close();
+}
+
+std::vector<uint8_t> SambaSimulator::read_flash(uint32_t address, uint32_t size) const {
+    std::lock_guard<std::mutex> lock(memory_mutex_);
+    if (address >= flash_.size()) {
+        return {};
+    }
+    size = std::min<uint32_t>(size, static_cast<uint32_t>(flash_.size()) - address);
+    return std::vector<uint8_t>(flash_.begin() + address, flash_.begin() + address + size);
+}
+
+void SambaSimulator::load_flash(uint32_t address, ByteSpan data) {
+    std::lock_guard<std::mutex> lock(memory_mutex_);
+    if (address < flash_.size()) {
+        size_t count = std::min(data.size(), flash_.size() - address);
+        std::copy(data.begin(), data.begin() + count, flash_.begin() + address);
+    }
+}
+
+SambaSimulator::Stats SambaSimulator::get_stats() const {
+    std::lock_guard<std::mutex> lock(memory_mutex_);
+    Stats stats = stats_;
+    stats.bytes_received = link_.bytes_received();
+    stats.bytes_sent = link_.bytes_sent();
+    return stats;
+}
+
+void SambaSimulator::command_loop() {
+    std::string text;
+    uint8_t byte = 0;
+    while (next_byte(byte)) {
+        // A bare '#' is the autobaud probe
+        if (byte == '#' && text.empty()) {
+            send(PROMPT);
+            continue;
+        }
+        if (byte != '#') {
+            if (text.size() < MAX_COMMAND_LENGTH && byte > ' ') {
+                text.push_back(static_cast<char>(byte));
+            }
+            continue;
+        }
+
+        // "<op>[<hex>[,<hex>]]#"
+        char op = text[0];
+        std::vector<uint32_t> args;
+        bool valid = true;
+        size_t start = 1;
+        while (start < text.size()) {
+            size_t comma = text.find(',', start);
+            std::string field = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+            uint32_t value = 0;
+            valid = valid && parse_hex(field, value);
+            args.push_back(value);
+            if (comma == std::string::npos) {
+                break;
+            }
+            start = comma + 1;
+        }
+        text.clear();
+
+        if (!valid) {
+            std::lock_guard<std::mutex> lock(memory_mutex_);
+            ++stats_.protocol_errors;
+            continue;
+        }
+        execute(op, args);
+    }
+}
+
+void SambaSimulator::execute(char op, const std::vector<uint32_t>& args) {
+    uint32_t address = args.size() > 0 ? args[0] : 0;
+    uint32_t argument = args.size() > 1 ? args[1] : 0;
+
+    std::unique_lock<std::mutex> lock(memory_mutex_);
+    ++stats_.commands;
+
+    switch (op) {
+        case 'V':
+            lock.unlock();
+            send(std::string(VERSION) + PROMPT);
+            return;
+
+        case 'N':
+        case 'T':
+            lock.unlock();
+            send("\n\r");
+            return;
+
+        case 'S': {
+            // Raw data follows the command
+            uint8_t* target = memory_at(address, argument);
+            lock.unlock();
+            std::vector<uint8_t> data(argument);
+            if (!next_bytes(data.data(), data.size())) {
+                return;
+            }
+            lock.lock();
+            if (target == nullptr) {
+                ++stats_.protocol_errors;
+                return;
+            }
+            std::copy(data.begin(), data.end(), target);
+            return;
+        }
+
+        case 'R': {
+            uint8_t* source = memory_at(address, argument);
+            if (source == nullptr) {
+                ++stats_.protocol_errors;
+                return;
+            }
+            std::vector<uint8_t> data(source, source + argument);
+            lock.unlock();
+            send(data.data(), data.size());
+            return;
+        }
+
+        case 'w': {
+            uint32_t value = read_word(address);
+            uint8_t reply[4] = {
+                static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+                static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+            lock.unlock();
+            send(reply, sizeof(reply));
+            return;
+        }
+
+        case 'W':
+            write_word(address, argument);
+            return;
+
+        case 'Y': {
+            // Y<addr>,0 sets the copy source; Y<addr>,<len> programs flash
+            if (argument == 0) {
+                copy_source_ = address;
+                lock.unlock();
+                send("Y\n\r");
+                return;
+            }
+            uint8_t* source = memory_at(copy_source_, argument);
+            if (source == nullptr || address >= flash_.size() || argument > flash_.size() - address) {
+                ++stats_.protocol_errors;
+                return;
+            }
+            // NOR programming only clears bits; unerased pages show up as corruption
+            for (uint32_t i = 0; i < argument; ++i) {
+                flash_[address + i] &= source[i];
+            }
+            uint64_t pages = (argument + device_.page_size - 1) / device_.page_size;
+            stats_.pages_programmed += pages;
+            lock.unlock();
+            wait_for(timing_.page_program_time, pages);
+            send("Y\n\r");
+            return;
+        }
+
+        case 'E': {
+            if (address >= flash_.size() || argument > flash_.size() - address ||
+                address % device_.page_size != 0 || argument % device_.page_size != 0) {
+                ++stats_.protocol_errors;
+                return;
+            }
+            std::fill(flash_.begin() + address, flash_.begin() + address + argument, 0xFF);
+            uint64_t pages = argument / device_.page_size;
+            stats_.pages_erased += pages;
+            lock.unlock();
+            wait_for(timing_.page_erase_time, pages);
+            send("E\n\r");
+            return;
+        }
+
+        case 'Z': {
+            uint8_t* source = memory_at(address, argument);
+            if (source == nullptr) {
+                ++stats_.protocol_errors;
+                return;
+            }
+            // The monitor's CRC-16, zero-extended to the same 8 digits as every reply
+            uint16_t crc = Crc16::compute(ByteSpan(source, argument));
+            lock.unlock();
+            char reply[16];
+            std::snprintf(reply, sizeof(reply), "Z%08X#\n\r", static_cast<unsigned>(crc));
+            send(reply);
+            return;
+        }
+
+        case 'G':
+            stats_.application_started = true;
+            return;
+
+        default:
+            ++stats_.protocol_errors;
+            return;
+    }
+}
+
+bool SambaSimulator::next_byte(uint8_t& byte) {
+    return next_bytes(&byte, 1);
+}
+
+bool SambaSimulator::next_bytes(uint8_t* out, size_t count) {
+    return link_.receive(out, count);
+}
+
+void SambaSimulator::send(const uint8_t* data, size_t size) {
+    link_.send(data, size);
+}
+
+void SambaSimulator::send(const std::string& text) {
+    link_.send(text);
+}
+
+uint8_t* SambaSimulator::memory_at(uint32_t address, uint32_t size) {
+    if (address < flash_.size() && size <= flash_.size() - address) {
+        return flash_.data() + address;
+    }
+    if (address >= SRAM_BASE && address - SRAM_BASE < sram_.size() && size <= sram_.size() - (address - SRAM_BASE)) {
+        return sram_.data() + (address - SRAM_BASE);
+    }
+    return nullptr;
+}
+
+uint32_t SambaSimulator::read_word(uint32_t address) {
+    switch (address) {
+        case CHIPID_CIDR: {
+            uint32_t index = static_cast<uint32_t>(
+                std::find(std::begin(SRAM_SIZE_KB), std::end(SRAM_SIZE_KB), device_.sram_size / 1024) - std::begin(SRAM_SIZE_KB));
+            return CHIP_ID_BASE | (index << 16);
+        }
+        case EEFC_FSR:
+            return unique_id_mode_ ? 0 : EEFC_FSR_FRDY;
+        case EEFC_FRR: {
+            if (flash_descriptor_.empty()) {
+                return 0;
+            }
+            uint32_t value = flash_descriptor_.front();
+            flash_descriptor_.pop_front();
+            return value;
+        }
+        default:
+            break;
+    }
+    if (unique_id_mode_ && address < device_.unique_id.size() * 4) {
+        return device_.unique_id[address / 4];
+    }
+
+    const uint8_t* source = memory_at(address, 4);
+    if (source == nullptr) {
+        return 0;
+    }
+    return uint32_t(source[0]) | (uint32_t(source[1]) << 8) | (uint32_t(source[2]) << 16) | (uint32_t(source[3]) << 24);
+}
+
+void SambaSimulator::write_word(uint32_t address, uint32_t value) {
+    if (address == EEFC_FCR) {
+        if ((value & 0xFF000000u) != EEFC_FCR_KEY) {
+            return;
+        }
+        if ((value & 0xFF) == EEFC_CMD_GETD) {
+            // Get Descriptor: flash ID, size, page size, planes, lock regions
+            uint32_t lock_count = device_.flash_size / device_.lock_region_size;
+            flash_descriptor_ = {FLASH_ID, device_.flash_size, device_.page_size, 1, device_.flash_size, lock_count};
+            for (uint32_t i = 0; i < lock_count; ++i) {
+                flash_descriptor_.push_back(device_.lock_region_size);
+            }
+        } else if ((value & 0xFF) == EEFC_CMD_EA) {
+            // Erase All; done by the time the next FSR read comes in
+            std::fill(flash_.begin(), flash_.end(), 0xFF);
+            stats_.pages_erased += flash_.size() / device_.page_size;
+        } else if ((value & 0xFF) == EEFC_CMD_STUI) {
+            unique_id_mode_ = true;
+        } else if ((value & 0xFF) == EEFC_CMD_SPUI) {
+            unique_id_mode_ = false;
+        }
+        return;
+    }
+
+    uint8_t* target = memory_at(address, 4);
+    if (target == nullptr) {
+        ++stats_.protocol_errors;
+        return;
+    }
+    for (int i = 0; i < 4; ++i) {
+        target[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void SambaSimulator::wait_for(std::chrono::microseconds per_unit, uint64_t units) {
+    if (per_unit.count() > 0 && units > 0) {
+        std::this_thread::sleep_for(per_unit * units);
+    }
+}
+
+} // namespace SamFlash
@@ -0,0 +1,108 @@
+#ifndef SAMBA_SIMULATOR_H
+#define SAMBA_SIMULATOR_H
+
+#include "simulated_link.h"
+#include <Core/byte_span.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SamFlash {
+
+// What the simulated part looks like. Flash starts at address 0 and SRAM
+// at 0x20000000; chip ID and flash controller registers are those of the
+// SAM3/SAM4 parts the real monitor runs on.
+struct SambaDeviceModel {
+    uint32_t flash_size = 1024 * 1024;
+    uint32_t page_size = 512;
+    uint32_t lock_region_size = 8 * 1024;
+    uint32_t sram_size = 128 * 1024; // must be one of the sizes the chip ID can encode
+    std::array<uint32_t, 4> unique_id = {0x53494D31, 0x00000001, 0x00000002, 0x00000003}; // all equal reads as none
+};
+
+// How long things take on the simulated device. Zero disables a delay.
+struct SambaTimingModel {
+    uint32_t baud_rate = 0; // line rate in both directions, 10 bits per byte
+    std::chrono::microseconds page_program_time{0};
+    std::chrono::microseconds page_erase_time{0};
+};
+
+// SAM-BA monitor running on the master end of a pseudo-terminal, backed by
+// in-memory flash and SRAM. Point USBSerialInterface at port_path() to
+// exercise the whole stack without hardware.
+//
+// Bytes are timestamped as they would arrive over a link of the modelled
+// baud rate while the device keeps working, so transfers overlap with
+// programming the way they do on a real board.
+class SambaSimulator {
+public:
+    struct Stats {
+        uint64_t commands = 0;
+        uint64_t bytes_received = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t pages_programmed = 0;
+        uint64_t pages_erased = 0;
+        uint64_t protocol_errors = 0;
+        bool application_started = false; // a G command was received
+    };
+
+    explicit SambaSimulator(const SambaDeviceModel& device = SambaDeviceModel{},
+                            const SambaTimingModel& timing = SambaTimingModel{});
+    ~SambaSimulator();
+
+    SambaSimulator(const SambaSimulator&) = delete;
+    SambaSimulator& operator=(const SambaSimulator&) = delete;
+
+    bool start();
+    void stop();
+    bool is_running() const { return running_; }
+
+    const std::string& port_path() const { return link_.port_path(); }
+    std::string get_last_error() const { return last_error_; }
+
+    // Inspection, safe while running
+    std::vector<uint8_t> read_flash(uint32_t address, uint32_t size) const;
+    void load_flash(uint32_t address, ByteSpan data);
+    Stats get_stats() const;
+
+private:
+    void command_loop();
+
+    // Blocking reads from the modelled link; false once stopped
+    bool next_byte(uint8_t& byte);
+    bool next_bytes(uint8_t* out, size_t count);
+    void send(const uint8_t* data, size_t size);
+    void send(const std::string& text);
+
+    void execute(char op, const std::vector<uint32_t>& args);
+    uint8_t* memory_at(uint32_t address, uint32_t size);
+    uint32_t read_word(uint32_t address);
+    void write_word(uint32_t address, uint32_t value);
+    void wait_for(std::chrono::microseconds per_unit, uint64_t units);
+
+    SambaDeviceModel device_;
+    SambaTimingModel timing_;
+    SimulatedLink link_;
+    std::string last_error_;
+
+    std::atomic<bool> running_{false};
+    std::thread command_thread_;
+
+    mutable std::mutex memory_mutex_;
+    std::vector<uint8_t> flash_;
+    std::vector<uint8_t> sram_;
+    uint32_t copy_source_ = 0;
+    std::deque<uint32_t> flash_descriptor_; // pending EEFC FRR words
+    bool unique_id_mode_ = false; // between STUI and SPUI, flash reads return the ID
+    Stats stats_;
+};
+
+} // namespace SamFlash
+
+#endif // SAMBA_SIMULATOR_H
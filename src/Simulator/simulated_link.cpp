@@ -0,0 +1,141 @@
+#include "simulated_link.h"
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+
+namespace SamFlash {
+
+namespace {
+    constexpr auto RECEIVE_POLL_INTERVAL = std::chrono::milliseconds(50);
+}
+
+SimulatedLink::SimulatedLink(double bytes_per_second) : bytes_per_second_(bytes_per_second) {}
+
+SimulatedLink::~SimulatedLink() {
+    stop();
+    close();
+}
+
+bool SimulatedLink::start() {
+    if (running_) {
+        return true;
+    }
+    if (!pty_.open()) {
+        last_error_ = pty_.get_last_error();
+        return false;
+    }
+
+    rx_queue_.clear();
+    rx_line_free_ = tx_line_free_ = std::chrono::steady_clock::now();
+    bytes_received_ = 0;
+    bytes_sent_ = 0;
+    running_ = true;
+    receive_thread_ = std::thread(&SimulatedLink::receive_loop, this);
+    return true;
+}
+
+void SimulatedLink::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    rx_ready_.notify_all();
+    if (receive_thread_.joinable()) {
+        receive_thread_.join();
+    }
+}
+
+void SimulatedLink::close() {
+    pty_.close();
+}
+
+void SimulatedLink::receive_loop() {
+    // Drain the pty as soon as the host writes, stamping each chunk with
+    // when its last byte would have arrived over the modelled link
+    std::vector<uint8_t> buffer(4096);
+    while (running_) {
+        struct pollfd pfd = {pty_.master_fd(), POLLIN, 0};
+        int ready = ::poll(&pfd, 1, static_cast<int>(RECEIVE_POLL_INTERVAL.count()));
+        if (ready <= 0 || !(pfd.revents & POLLIN)) {
+            continue;
+        }
+        ssize_t count = ::read(pty_.master_fd(), buffer.data(), buffer.size());
+        if (count <= 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(rx_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        rx_line_free_ = std::max(rx_line_free_, now) + line_time(static_cast<size_t>(count));
+        rx_queue_.push_back({std::vector<uint8_t>(buffer.begin(), buffer.begin() + count), 0, rx_line_free_});
+        rx_ready_.notify_one();
+    }
+}
+
+bool SimulatedLink::receive(uint8_t* out, size_t count) {
+    std::unique_lock<std::mutex> lock(rx_mutex_);
+    while (count > 0) {
+        rx_ready_.wait(lock, [this] { return !rx_queue_.empty() || !running_; });
+        if (!running_) {
+            return false;
+        }
+
+        Chunk& chunk = rx_queue_.front();
+        auto arrives_at = chunk.arrives_at;
+        if (bytes_per_second_ > 0 && arrives_at > std::chrono::steady_clock::now()) {
+            lock.unlock();
+            std::this_thread::sleep_until(arrives_at);
+            lock.lock();
+            continue;
+        }
+
+        size_t take = std::min(count, chunk.bytes.size() - chunk.offset);
+        std::copy(chunk.bytes.begin() + chunk.offset, chunk.bytes.begin() + chunk.offset + take, out);
+        out += take;
+        count -= take;
+        chunk.offset += take;
+        if (chunk.offset == chunk.bytes.size()) {
+            rx_queue_.pop_front();
+        }
+        bytes_received_ += take;
+    }
+    return true;
+}
+
+void SimulatedLink::send(const uint8_t* data, size_t size) {
+    if (bytes_per_second_ > 0) {
+        auto now = std::chrono::steady_clock::now();
+        tx_line_free_ = std::max(tx_line_free_, now) + line_time(size);
+        std::this_thread::sleep_until(tx_line_free_);
+    }
+
+    size_t sent = 0;
+    while (sent < size && running_) {
+        ssize_t count = ::write(pty_.master_fd(), data + sent, size - sent);
+        if (count > 0) {
+            sent += static_cast<size_t>(count);
+            continue;
+        }
+        if (count < 0 && errno != EAGAIN && errno != EINTR) {
+            break;
+        }
+        // Host isn't reading; wait for room
+        struct pollfd pfd = {pty_.master_fd(), POLLOUT, 0};
+        ::poll(&pfd, 1, static_cast<int>(RECEIVE_POLL_INTERVAL.count()));
+    }
+    bytes_sent_ += sent;
+}
+
+void SimulatedLink::send(const std::string& text) {
+    send(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+std::chrono::steady_clock::duration SimulatedLink::line_time(size_t bytes) const {
+    if (bytes_per_second_ <= 0) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(bytes) / bytes_per_second_));
+}
+
+} // namespace SamFlash
@@ -0,0 +1,78 @@
+#ifndef SIMULATED_LINK_H
+#define SIMULATED_LINK_H
+
+#include "pty_pair.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SamFlash {
+
+// Device end of a simulated host link: the master side of a pseudo-terminal
+// and a model of how fast bytes cross the wire. Incoming bytes are
+// timestamped as they would arrive over the modelled link, so a simulated
+// device keeps working while the host is still sending.
+class SimulatedLink {
+public:
+    // bytes_per_second of zero means an unlimited link
+    explicit SimulatedLink(double bytes_per_second = 0.0);
+    ~SimulatedLink();
+
+    SimulatedLink(const SimulatedLink&) = delete;
+    SimulatedLink& operator=(const SimulatedLink&) = delete;
+
+    // Open the pty and start draining it
+    bool start();
+    // Stop draining and wake any blocked receive(); the pty stays open
+    // until close() so a device thread can finish its current reply
+    void stop();
+    void close();
+    bool is_running() const { return running_; }
+
+    const std::string& port_path() const { return pty_.slave_path(); }
+    std::string get_last_error() const { return last_error_; }
+
+    // Blocks until count bytes have arrived; false once stopped
+    bool receive(uint8_t* out, size_t count);
+    void send(const uint8_t* data, size_t size);
+    void send(const std::string& text);
+
+    uint64_t bytes_received() const { return bytes_received_; }
+    uint64_t bytes_sent() const { return bytes_sent_; }
+
+private:
+    struct Chunk {
+        std::vector<uint8_t> bytes;
+        size_t offset;
+        std::chrono::steady_clock::time_point arrives_at;
+    };
+
+    void receive_loop();
+    std::chrono::steady_clock::duration line_time(size_t bytes) const;
+
+    double bytes_per_second_;
+    PtyPair pty_;
+    std::string last_error_;
+
+    std::atomic<bool> running_{false};
+    std::thread receive_thread_;
+
+    std::mutex rx_mutex_;
+    std::condition_variable rx_ready_;
+    std::deque<Chunk> rx_queue_;
+    std::chrono::steady_clock::time_point rx_line_free_;
+    std::chrono::steady_clock::time_point tx_line_free_;
+
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+};
+
+} // namespace SamFlash
+
+#endif // SIMULATED_LINK_H
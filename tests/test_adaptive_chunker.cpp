@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <Core/adaptive_chunker.h>
+
+using namespace SamFlash;
+
+namespace {
+    // Link with a fixed per-block round trip; deeper pipelines hide it
+    std::chrono::steady_clock::duration block_time(uint32_t chunk, uint32_t depth) {
+        const double bytes_per_second = 1e6;
+        const double round_trip = 0.05;
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(chunk / bytes_per_second + round_trip / depth));
+    }
+}
+
+TEST(AdaptiveChunkerTest, GrowsChunkAndDepthOnLatencyBoundLink) {
+    AdaptiveChunker::Limits limits;
+    limits.min_chunk = 256;
+    limits.max_chunk = 16 * 1024;
+    limits.granularity = 256;
+    limits.max_depth = 8;
+    AdaptiveChunker chunker(limits);
+
+    for (int i = 0; i < 400 && !chunker.converged(); ++i) {
+        chunker.record(chunker.chunk_size(), block_time(chunker.chunk_size(), chunker.pipeline_depth()));
+    }
+
+    EXPECT_TRUE(chunker.converged());
+    EXPECT_EQ(chunker.chunk_size(), 16u * 1024);
+    EXPECT_GT(chunker.pipeline_depth(), 1u);
+    EXPECT_GT(chunker.throughput_bps(), 100000.0);
+}
+
+TEST(AdaptiveChunkerTest, TimeoutBacksOff) {
+    AdaptiveChunker::Limits limits;
+    limits.granularity = 256;
+    limits.max_depth = 4;
+    AdaptiveChunker chunker(limits, 8192, 4);
+
+    chunker.record_timeout();
+    EXPECT_EQ(chunker.chunk_size(), 4096u);
+    EXPECT_EQ(chunker.pipeline_depth(), 3u);
+    EXPECT_FALSE(chunker.converged());
+}
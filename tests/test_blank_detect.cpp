@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include <Core/blank_detect.h>
+#include <vector>
+
+using namespace SamFlash;
+
+TEST(BlankDetectTest, FindsSingleProgrammedByteAnywhere) {
+    // Covers the vector, tail and scalar paths
+    std::vector<uint8_t> data(300, ERASED_BYTE);
+    EXPECT_TRUE(is_erased(ByteSpan(data)));
+    EXPECT_TRUE(is_erased(ByteSpan()));
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = 0xFE;
+        EXPECT_FALSE(is_erased(ByteSpan(data))) << "byte " << i;
+        data[i] = ERASED_BYTE;
+    }
+}
+
+TEST(BlankDetectTest, MergesAdjacentProgrammedPages) {
+    // Pages: data, data, blank, blank, data, partial tail
+    std::vector<uint8_t> image(5 * 256 + 100, ERASED_BYTE);
+    image[10] = 0x00;
+    image[256 + 255] = 0x00;
+    image[4 * 256] = 0x00;
+    image[5 * 256 + 99] = 0x00;
+
+    auto extents = find_programmed_extents(ByteSpan(image), 256);
+    ASSERT_EQ(extents.size(), 2u);
+    EXPECT_EQ(extents[0].offset, 0u);
+    EXPECT_EQ(extents[0].size, 512u);
+    EXPECT_EQ(extents[1].offset, 4u * 256);
+    EXPECT_EQ(extents[1].size, 256u + 100);
+}
@@ -0,0 +1,25 @@
+#include <gtest/gtest.h>
+#include <Core/crc16.h>
+#include <string>
+#include <vector>
+
+using namespace SamFlash;
+
+TEST(Crc16Test, MatchesReferenceCheckValue) {
+    const std::string input = "123456789";
+    ByteSpan data(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    EXPECT_EQ(Crc16::compute(data), 0x31C3u);
+    EXPECT_EQ(Crc16::compute(ByteSpan()), 0u);
+}
+
+TEST(Crc16Test, IncrementalMatchesSinglePass) {
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    Crc16 crc;
+    crc.update(ByteSpan(data).subspan(0, 333));
+    crc.update(ByteSpan(data).subspan(333));
+    EXPECT_EQ(crc.value(), Crc16::compute(ByteSpan(data)));
+}
@@ -0,0 +1,25 @@
+#include <gtest/gtest.h>
+#include <Core/crc32.h>
+#include <string>
+#include <vector>
+
+using namespace SamFlash;
+
+TEST(Crc32Test, MatchesReferenceCheckValue) {
+    const std::string input = "123456789";
+    ByteSpan data(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    EXPECT_EQ(Crc32::compute(data), 0xCBF43926u);
+    EXPECT_EQ(Crc32::compute(ByteSpan()), 0u);
+}
+
+TEST(Crc32Test, IncrementalMatchesSinglePass) {
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    Crc32 crc;
+    crc.update(ByteSpan(data).subspan(0, 333));
+    crc.update(ByteSpan(data).subspan(333));
+    EXPECT_EQ(crc.value(), Crc32::compute(ByteSpan(data)));
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <Core/erase_planner.h>
+
+using namespace SamFlash;
+
+namespace {
+    EraseGeometry sam_geometry() {
+        EraseGeometry geometry;
+        geometry.flash_size = 1024 * 1024;
+        geometry.granularities = {256, 8 * 1024, 64 * 1024};
+        return geometry;
+    }
+}
+
+TEST(ErasePlannerTest, UsesLargestAlignedUnits) {
+    // 0x100..0x12100 is covered by pages, then sectors, then pages again
+    auto plan = plan_erase({{0x100, 0x12000}}, sam_geometry());
+
+    ASSERT_FALSE(plan.empty());
+    uint32_t covered = 0;
+    uint32_t next = plan.front().address;
+    for (const auto& op : plan) {
+        EXPECT_EQ(op.kind, EraseOperation::Kind::REGION);
+        EXPECT_EQ(op.address, next);
+        EXPECT_EQ(op.address % op.size, 0u);
+        next = op.address + op.size;
+        covered += op.size;
+    }
+    EXPECT_EQ(plan.front().address, 0x100u);
+    EXPECT_EQ(covered, 0x12000u);
+
+    // 31 pages to 0x2000, 8 sectors to 0x12000, one trailing page
+    EXPECT_EQ(plan.size(), 31u + 8u + 1u);
+}
+
+TEST(ErasePlannerTest, MergesTouchingRangesAndPicksBlocks) {
+    auto plan = plan_erase({{0x20000, 0x8000}, {0x28000, 0x8000}, {0x50, 0x10}}, sam_geometry());
+
+    ASSERT_EQ(plan.size(), 2u);
+    EXPECT_EQ(plan[0].address, 0u);
+    EXPECT_EQ(plan[0].size, 256u);
+    EXPECT_EQ(plan[1].address, 0x20000u);
+    EXPECT_EQ(plan[1].size, 0x10000u);
+}
+
+TEST(ErasePlannerTest, WholeDeviceBecomesChipErase) {
+    auto geometry = sam_geometry();
+    auto plan = plan_erase({{0, geometry.flash_size}}, geometry);
+
+    ASSERT_EQ(plan.size(), 1u);
+    EXPECT_EQ(plan[0].kind, EraseOperation::Kind::CHIP);
+}
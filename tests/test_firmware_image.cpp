@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <Core/firmware_image.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+using namespace SamFlash;
+
+namespace {
+    std::string temp_path(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    std::vector<uint8_t> pattern(size_t size) {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<uint8_t>(i * 11 + 3);
+        }
+        return data;
+    }
+
+    void write_file(const std::string& path, const std::vector<uint8_t>& data) {
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+}
+
+TEST(FirmwareImageTest, MapsRegularFiles) {
+    auto expected = pattern(3 * 1024 * 1024 + 7);
+    std::string path = temp_path("samflash_image.bin");
+    write_file(path, expected);
+
+    FirmwareImage image;
+    ASSERT_TRUE(image.open(path)) << image.get_last_error();
+#ifndef _WIN32
+    EXPECT_TRUE(image.is_mapped());
+#endif
+    ASSERT_EQ(image.size(), expected.size());
+    EXPECT_TRUE(std::equal(image.data().begin(), image.data().end(), expected.begin()));
+
+    FirmwareImage moved = std::move(image);
+    EXPECT_TRUE(image.empty());
+    EXPECT_EQ(moved.size(), expected.size());
+
+    EXPECT_FALSE(image.open(temp_path("samflash_missing.bin")));
+    EXPECT_NE(image.get_last_error().find("Failed to open"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+#ifndef _WIN32
+TEST(FirmwareImageTest, ReadsPipesIntoMemory) {
+    std::string path = temp_path("samflash_image.fifo");
+    std::remove(path.c_str());
+    ASSERT_EQ(mkfifo(path.c_str(), 0600), 0);
+
+    auto expected = pattern(2 * 1024 * 1024 + 5);
+    std::thread writer([&] { write_file(path, expected); });
+    FirmwareImage image;
+    bool opened = image.open(path);
+    writer.join();
+
+    ASSERT_TRUE(opened) << image.get_last_error();
+    EXPECT_FALSE(image.is_mapped());
+    ASSERT_EQ(image.size(), expected.size());
+    EXPECT_TRUE(std::equal(image.data().begin(), image.data().end(), expected.begin()));
+    std::remove(path.c_str());
+}
+#endif
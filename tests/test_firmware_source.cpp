@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <Core/firmware_source.h>
+#include <Core/lz4_frame.h>
+#include <Core/byte_order.h>
+#include <Core/xxhash32.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+using namespace SamFlash;
+
+namespace {
+    constexpr size_t MB = 1024 * 1024;
+
+    std::string temp_path(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    std::vector<uint8_t> pattern(size_t size) {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<uint8_t>(i * 7 + i / 4096);
+        }
+        return data;
+    }
+
+    void write_file(const std::string& path, const std::vector<uint8_t>& data) {
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    // Frame of stored blocks that claims content_size bytes, or records
+    // no size at all
+    std::vector<uint8_t> stored_lz4_frame(const std::vector<uint8_t>& data, std::optional<uint64_t> content_size) {
+        std::vector<uint8_t> out(4);
+        write_le32(LZ4_FRAME_MAGIC, out.data());
+        std::vector<uint8_t> descriptor = {static_cast<uint8_t>(content_size ? 0x48 : 0x40), 0x70};
+        for (int i = 0; content_size && i < 8; ++i) {
+            descriptor.push_back(static_cast<uint8_t>(*content_size >> (8 * i)));
+        }
+        descriptor.push_back(static_cast<uint8_t>(XxHash32::compute(ByteSpan(descriptor)) >> 8));
+        out.insert(out.end(), descriptor.begin(), descriptor.end());
+        auto put = [&out](uint32_t value) {
+            out.resize(out.size() + 4);
+            write_le32(value, out.data() + out.size() - 4);
+        };
+        const size_t block = 4 * MB;
+        for (size_t offset = 0; offset < data.size(); offset += block) {
+            size_t size = std::min(block, data.size() - offset);
+            put(static_cast<uint32_t>(size) | 0x80000000u);
+            out.insert(out.end(), data.begin() + offset, data.begin() + offset + size);
+        }
+        put(0);
+        return out;
+    }
+
+    // Pull the whole image in chunks of chunk_size
+    std::vector<uint8_t> drain(FirmwareSource& source, size_t chunk_size) {
+        std::vector<uint8_t> out;
+        FirmwareChunk chunk;
+        while (source.next(chunk_size, chunk)) {
+            EXPECT_EQ(chunk.offset, out.size());
+            EXPECT_TRUE(chunk.data.size() == chunk_size || out.size() + chunk.data.size() == source.size());
+            out.insert(out.end(), chunk.data.begin(), chunk.data.end());
+        }
+        return out;
+    }
+}
+
+TEST(FirmwareSourceTest, StreamsFilesThroughFixedBuffers) {
+    auto expected = pattern(9 * MB + 123);
+    std::string path = temp_path("samflash_stream.bin");
+    write_file(path, expected);
+
+    StreamingFirmwareSource source(4 * MB);
+    ASSERT_TRUE(source.open(path)) << source.get_last_error();
+    EXPECT_FALSE(source.is_compressed());
+    EXPECT_EQ(source.size(), expected.size());
+    EXPECT_EQ(source.chunk_size_hint(), 1 * MB);
+    EXPECT_TRUE(source.contiguous().empty());
+
+    // Chunks that straddle buffers are assembled, aligned ones are views
+    EXPECT_EQ(drain(source, 768 * 1024), expected);
+    EXPECT_TRUE(source.at_end());
+
+    ASSERT_TRUE(source.rewind());
+    EXPECT_FALSE(source.at_end());
+    EXPECT_EQ(drain(source, source.chunk_size_hint()), expected);
+    EXPECT_TRUE(source.at_end());
+    std::remove(path.c_str());
+}
+
+TEST(FirmwareSourceTest, DecompressesLz4FilesOnTheReader) {
+    auto expected = pattern(6 * MB + 5);
+    std::string path = temp_path("samflash_stream.bin.lz4");
+    write_file(path, stored_lz4_frame(expected, expected.size()));
+
+    StreamingFirmwareSource source(0);
+    ASSERT_TRUE(source.open(path)) << source.get_last_error();
+    EXPECT_TRUE(source.is_compressed());
+    EXPECT_EQ(source.size(), expected.size());
+    EXPECT_EQ(drain(source, 512 * 1024), expected);
+    EXPECT_TRUE(source.at_end());
+
+    // A frame that falls short of its recorded size stops the stream
+    write_file(path, stored_lz4_frame(expected, expected.size() + 4096));
+    ASSERT_TRUE(source.open(path)) << source.get_last_error();
+    drain(source, MB);
+    EXPECT_FALSE(source.at_end());
+    EXPECT_NE(source.get_last_error().find("header says"), std::string::npos);
+
+    // So does one that runs past it, whether or not the recorded size
+    // ends on a buffer boundary
+    for (uint64_t recorded : {uint64_t(expected.size() - 4096), uint64_t(6 * MB)}) {
+        write_file(path, stored_lz4_frame(expected, recorded));
+        ASSERT_TRUE(source.open(path)) << source.get_last_error();
+        EXPECT_LT(drain(source, MB).size(), recorded);
+        EXPECT_FALSE(source.at_end());
+        EXPECT_NE(source.get_last_error().find("past its recorded"), std::string::npos) << source.get_last_error();
+    }
+    std::remove(path.c_str());
+}
+
+TEST(FirmwareSourceTest, MeasuresLz4FilesWithoutARecordedSize) {
+    auto expected = pattern(5 * MB + 17);
+    std::string path = temp_path("samflash_unsized.bin.lz4");
+    auto frame = stored_lz4_frame(expected, std::nullopt);
+    write_file(path, frame);
+
+    StreamingFirmwareSource source(0);
+    ASSERT_TRUE(source.open(path)) << source.get_last_error();
+    EXPECT_TRUE(source.is_compressed());
+    EXPECT_EQ(source.size(), expected.size());
+    EXPECT_EQ(drain(source, MB), expected);
+    EXPECT_TRUE(source.at_end());
+
+    // Without its end mark the frame is refused before anything is read
+    frame.resize(frame.size() - 4);
+    write_file(path, frame);
+    EXPECT_FALSE(source.open(path));
+    EXPECT_NE(source.get_last_error().find("truncated"), std::string::npos) << source.get_last_error();
+    std::remove(path.c_str());
+}
+
+TEST(FirmwareSourceTest, MemorySourceIsOneView) {
+    auto image = pattern(10000);
+    MemoryFirmwareSource source{ByteSpan(image)};
+    EXPECT_EQ(source.contiguous().data(), image.data());
+
+    FirmwareChunk chunk;
+    ASSERT_TRUE(source.next(source.chunk_size_hint(), chunk));
+    EXPECT_EQ(chunk.data.data(), image.data());
+    EXPECT_EQ(chunk.data.size(), image.size());
+    EXPECT_FALSE(source.next(source.chunk_size_hint(), chunk));
+    EXPECT_TRUE(source.at_end());
+    ASSERT_TRUE(source.rewind());
+    EXPECT_EQ(drain(source, 4096), image);
+}
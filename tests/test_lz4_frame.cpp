@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <Core/lz4_frame.h>
+#include <Core/byte_order.h>
+#include <Core/xxhash32.h>
+#include <string>
+
+using namespace SamFlash;
+
+namespace {
+    struct Block {
+        std::vector<uint8_t> data;
+        bool compressed;
+    };
+
+    void append_le32(std::vector<uint8_t>& out, uint32_t value) {
+        uint8_t bytes[4];
+        write_le32(value, bytes);
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    // 64 KB linked blocks with every checksum and the content size
+    std::vector<uint8_t> make_frame(const std::vector<Block>& blocks, const std::string& content) {
+        std::vector<uint8_t> frame;
+        append_le32(frame, LZ4_FRAME_MAGIC);
+        std::vector<uint8_t> descriptor = {0x40 | 0x10 | 0x08 | 0x04, 0x40};
+        for (int i = 0; i < 8; ++i) {
+            descriptor.push_back(static_cast<uint8_t>(uint64_t(content.size()) >> (8 * i)));
+        }
+        descriptor.push_back(static_cast<uint8_t>(XxHash32::compute(ByteSpan(descriptor)) >> 8));
+        frame.insert(frame.end(), descriptor.begin(), descriptor.end());
+        for (const auto& block : blocks) {
+            append_le32(frame, static_cast<uint32_t>(block.data.size()) | (block.compressed ? 0 : 0x80000000u));
+            frame.insert(frame.end(), block.data.begin(), block.data.end());
+            append_le32(frame, XxHash32::compute(ByteSpan(block.data)));
+        }
+        append_le32(frame, 0);
+        append_le32(frame, XxHash32::compute(ByteSpan(reinterpret_cast<const uint8_t*>(content.data()), content.size())));
+        return frame;
+    }
+
+    std::vector<uint8_t> bytes(const std::string& text) {
+        return std::vector<uint8_t>(text.begin(), text.end());
+    }
+
+    // Literals "abcd", a 12-byte match 4 back, then literals "xy"; a stored
+    // block; then a match reaching back into the first block
+    const std::string SAMPLE = "abcdabcdabcdabcdxytailabcdaz";
+    std::vector<Block> sample_blocks() {
+        std::vector<uint8_t> first = {0x48, 'a', 'b', 'c', 'd', 4, 0, 0x20, 'x', 'y'};
+        std::vector<uint8_t> linked = {0x01, 22, 0, 0x10, 'z'};
+        return {{first, true}, {bytes("tail"), false}, {linked, true}};
+    }
+
+    std::string decode(Lz4FrameDecoder& decoder, const std::vector<uint8_t>& frame, size_t step, bool& ok) {
+        std::string out;
+        ok = true;
+        for (size_t i = 0; i < frame.size() && ok; i += step) {
+            ok = decoder.feed(ByteSpan(frame).subspan(i, step), [&](ByteSpan data) {
+                out.append(reinterpret_cast<const char*>(data.data()), data.size());
+                return true;
+            });
+        }
+        return out;
+    }
+}
+
+TEST(Lz4FrameTest, XxHash32MatchesReferenceVectors) {
+    EXPECT_EQ(XxHash32::compute(ByteSpan()), 0x02CC5D05u);
+    auto abc = bytes("abc");
+    EXPECT_EQ(XxHash32::compute(ByteSpan(abc)), 0x32D153FFu);
+
+    // Fed in pieces across stripe boundaries
+    auto text = bytes("Nobody inspects the spammish repetition, nobody at all");
+    XxHash32 hash;
+    hash.update(ByteSpan(text).subspan(0, 5));
+    hash.update(ByteSpan(text).subspan(5, 20));
+    hash.update(ByteSpan(text).subspan(25));
+    EXPECT_EQ(hash.digest(), XxHash32::compute(ByteSpan(text)));
+}
+
+TEST(Lz4FrameTest, DecodesLinkedBlocksFedInAnyPieces) {
+    auto frame = make_frame(sample_blocks(), SAMPLE);
+    EXPECT_TRUE(Lz4FrameDecoder::is_lz4(ByteSpan(frame)));
+    EXPECT_EQ(Lz4FrameDecoder::content_size(ByteSpan(frame).subspan(0, LZ4_MAX_HEADER_SIZE)), SAMPLE.size());
+
+    for (size_t step : {size_t(1), size_t(3), frame.size()}) {
+        Lz4FrameDecoder decoder;
+        bool ok = false;
+        EXPECT_EQ(decode(decoder, frame, step, ok), SAMPLE) << "step " << step;
+        EXPECT_TRUE(ok) << decoder.get_last_error();
+        EXPECT_TRUE(decoder.finished());
+        EXPECT_EQ(decoder.output_size(), SAMPLE.size());
+    }
+
+    // Concatenated frames decode as one stream
+    auto twice = frame;
+    twice.insert(twice.end(), frame.begin(), frame.end());
+    Lz4FrameDecoder decoder;
+    bool ok = false;
+    EXPECT_EQ(decode(decoder, twice, 7, ok), SAMPLE + SAMPLE);
+    EXPECT_TRUE(decoder.finished());
+}
+
+TEST(Lz4FrameTest, RejectsCorruptFrames) {
+    // Content that doesn't match the checksum in the frame
+    auto frame = make_frame(sample_blocks(), SAMPLE);
+    frame[frame.size() - 1] ^= 0xFF;
+    Lz4FrameDecoder decoder;
+    bool ok = true;
+    decode(decoder, frame, frame.size(), ok);
+    EXPECT_FALSE(ok);
+    EXPECT_NE(decoder.get_last_error().find("content checksum"), std::string::npos);
+
+    // A match reaching back before the start of the output
+    std::vector<Block> blocks = {{{0x10, 'a', 9, 0, 0x10, 'b'}, true}};
+    frame = make_frame(blocks, "ab");
+    decoder.reset();
+    decode(decoder, frame, frame.size(), ok);
+    EXPECT_FALSE(ok);
+    EXPECT_NE(decoder.get_last_error().find("Corrupt LZ4 block"), std::string::npos);
+
+    // Truncated input never finishes
+    frame = make_frame(sample_blocks(), SAMPLE);
+    frame.resize(frame.size() - 6);
+    decoder.reset();
+    decode(decoder, frame, frame.size(), ok);
+    EXPECT_TRUE(ok);
+    EXPECT_FALSE(decoder.finished());
+}
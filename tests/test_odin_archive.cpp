@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <Core/buffer_pool.h>
+#include <Core/md5.h>
+#include <Core/odin_archive.h>
+#include <Core/odin_protocol.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace SamFlash;
+
+namespace {
+    std::string archive_path(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    void append_header(std::vector<uint8_t>& tar, const std::string& name, size_t size, char type = '0') {
+        uint8_t header[TAR_BLOCK_SIZE] = {};
+        std::memcpy(header, name.data(), std::min<size_t>(name.size(), 100));
+        std::snprintf(reinterpret_cast<char*>(header + 100), 8, "%07o", 0644);
+        std::snprintf(reinterpret_cast<char*>(header + 124), 12, "%011zo", size);
+        header[156] = static_cast<uint8_t>(type);
+        std::memcpy(header + 257, "ustar", 6);
+        std::memcpy(header + 263, "00", 2);
+        std::memset(header + 148, ' ', 8);
+        unsigned sum = 0;
+        for (uint8_t byte : header) {
+            sum += byte;
+        }
+        std::snprintf(reinterpret_cast<char*>(header + 148), 8, "%06o", sum);
+        tar.insert(tar.end(), header, header + TAR_BLOCK_SIZE);
+    }
+
+    void append_member(std::vector<uint8_t>& tar, const std::string& name, const std::vector<uint8_t>& data) {
+        append_header(tar, name, data.size());
+        tar.insert(tar.end(), data.begin(), data.end());
+        tar.resize((tar.size() + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE, 0);
+    }
+
+    // Closes the tar and, like Samsung's packaging, appends its MD5
+    std::string write_archive(const char* name, std::vector<uint8_t> tar, bool with_md5) {
+        tar.resize(tar.size() + 2 * TAR_BLOCK_SIZE, 0);
+        if (with_md5) {
+            std::string line = Md5::to_hex(Md5::compute(ByteSpan(tar))) + "  " + name + "\n";
+            tar.insert(tar.end(), line.begin(), line.end());
+        }
+        std::string path = archive_path(name);
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(tar.data()), tar.size());
+        return path;
+    }
+
+    std::vector<uint8_t> pattern(size_t size, uint8_t seed) {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<uint8_t>(i * 7 + seed);
+        }
+        return data;
+    }
+}
+
+TEST(OdinArchiveTest, Md5MatchesReferenceVectors) {
+    EXPECT_EQ(Md5::to_hex(Md5::compute(ByteSpan())), "d41d8cd98f00b204e9800998ecf8427e");
+    std::string abc = "abc";
+    EXPECT_EQ(Md5::to_hex(Md5::compute(ByteSpan(reinterpret_cast<const uint8_t*>(abc.data()), abc.size())))
+              , "900150983cd24fb0d6963f7d28e17f72");
+
+    // Fed in uneven pieces across block boundaries
+    std::string text = "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+    Md5 md5;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(text.data());
+    md5.update(ByteSpan(bytes, 3));
+    md5.update(ByteSpan(bytes + 3, 70));
+    md5.update(ByteSpan(bytes + 73, text.size() - 73));
+    EXPECT_EQ(Md5::to_hex(md5.digest()), "57edf4a22be3c955ac49da2e2107b67a");
+}
+
+TEST(OdinArchiveTest, IndexesAndStreamsMembers) {
+    auto boot = pattern(3000, 1);
+    auto modem = pattern(70000, 2);
+    std::vector<uint8_t> tar;
+    append_member(tar, "boot.img", boot);
+    append_header(tar, "meta-data/", 0, '5');
+    append_member(tar, "modem.bin", modem);
+    std::string path = write_archive("samflash_stream.tar.md5", tar, true);
+
+    ASSERT_TRUE(OdinArchive::is_archive(path));
+    OdinArchive archive;
+    ASSERT_TRUE(archive.open(path)) << archive.get_last_error();
+    ASSERT_EQ(archive.members().size(), 2u);
+    EXPECT_EQ(archive.members()[0].name, "boot.img");
+    EXPECT_EQ(archive.members()[1].size, modem.size());
+    EXPECT_TRUE(archive.has_md5());
+
+    std::vector<std::string> names;
+    std::vector<std::vector<uint8_t>> received(2);
+    ASSERT_TRUE(archive.stream(
+        16 * 1024,
+        [&](const ArchiveMember& member) {
+            names.push_back(member.name);
+            return true;
+        },
+        [&](const ArchiveMember& member, uint64_t offset, ByteSpan data) {
+            auto& out = received[names.size() - 1];
+            EXPECT_EQ(offset, out.size());
+            EXPECT_LE(data.size(), 16u * 1024);
+            out.insert(out.end(), data.begin(), data.end());
+            return member.name == names.back();
+        }))
+        << archive.get_last_error();
+    EXPECT_EQ(received[0], boot);
+    EXPECT_EQ(received[1], modem);
+    std::remove(path.c_str());
+}
+
+TEST(OdinArchiveTest, ReadsAheadIntoPooledBuffers) {
+    auto boot = pattern(50000, 5);
+    auto modem = pattern(9000, 6);
+    std::vector<uint8_t> tar;
+    append_member(tar, "boot.img", boot);
+    append_member(tar, "modem.bin", modem);
+    std::string path = write_archive("samflash_pool.tar.md5", tar, true);
+
+    OdinArchive archive;
+    ASSERT_TRUE(archive.open(path));
+    BufferPool pool(2, 4096);
+    std::thread reader([&] {
+        ASSERT_TRUE(archive.rewind());
+        while (BufferPool::Buffer* buffer = pool.acquire()) {
+            ArchivePiece piece;
+            if (!archive.read_next(MutableByteSpan(buffer->data.data(), buffer->data.size()), piece)) {
+                pool.release(buffer);
+                break;
+            }
+            buffer->size = piece.size;
+            buffer->tag = piece.member;
+            buffer->offset = piece.offset;
+            pool.submit(buffer);
+        }
+        pool.finish();
+    });
+
+    std::vector<std::vector<uint8_t>> received(2);
+    while (BufferPool::Buffer* buffer = pool.next()) {
+        auto& out = received[buffer->tag];
+        EXPECT_EQ(buffer->offset, out.size());
+        out.insert(out.end(), buffer->filled().begin(), buffer->filled().end());
+        pool.release(buffer);
+    }
+    reader.join();
+    EXPECT_TRUE(archive.at_end()) << archive.get_last_error();
+    EXPECT_EQ(received[0], boot);
+    EXPECT_EQ(received[1], modem);
+
+    // Cancelling unblocks a reader waiting for a free buffer
+    BufferPool stalled(1, 16);
+    stalled.acquire();
+    std::thread waiter([&] { EXPECT_EQ(stalled.acquire(), nullptr); });
+    stalled.cancel();
+    waiter.join();
+    EXPECT_EQ(stalled.next(), nullptr);
+    std::remove(path.c_str());
+}
+
+TEST(OdinArchiveTest, DetectsChecksumMismatchWhileStreaming) {
+    std::vector<uint8_t> tar;
+    append_member(tar, "boot.img", pattern(5000, 3));
+    std::string path = write_archive("samflash_corrupt.tar.md5", tar, true);
+
+    // Flip a data byte after the trailer was computed
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(TAR_BLOCK_SIZE + 100);
+        file.put('\x5A');
+    }
+
+    OdinArchive archive;
+    ASSERT_TRUE(archive.open(path));
+    size_t delivered = 0;
+    EXPECT_FALSE(archive.stream(4096, nullptr, [&](const ArchiveMember&, uint64_t, ByteSpan data) {
+        delivered += data.size();
+        return true;
+    }));
+    EXPECT_EQ(delivered, 5000u);
+    EXPECT_NE(archive.get_last_error().find("MD5 mismatch"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(OdinArchiveTest, RejectsDamagedArchives) {
+    std::vector<uint8_t> tar;
+    append_member(tar, "boot.img", pattern(2000, 4));
+    tar[130] ^= 0x01; // size field no longer matches the header checksum
+    std::string path = write_archive("samflash_damaged.tar", tar, false);
+
+    OdinArchive archive;
+    EXPECT_FALSE(archive.open(path));
+    EXPECT_NE(archive.get_last_error().find("Corrupt tar header"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(OdinArchiveTest, MapsMembersToPartitions) {
+    std::vector<uint8_t> pit(PIT_HEADER_SIZE + 2 * PIT_ENTRY_SIZE, 0);
+    write_le32(PIT_MAGIC, pit.data());
+    write_le32(2, pit.data() + 4);
+    const char* names[][2] = {{"BOOT", "boot.img"}, {"SYSTEM", "system.img"}};
+    for (uint32_t i = 0; i < 2; ++i) {
+        uint8_t* record = pit.data() + PIT_HEADER_SIZE + i * PIT_ENTRY_SIZE;
+        write_le32(i + 3, record + 8);
+        std::memcpy(record + 36, names[i][0], std::strlen(names[i][0]));
+        std::memcpy(record + 36 + PIT_NAME_SIZE, names[i][1], std::strlen(names[i][1]));
+    }
+    PitTable table;
+    ASSERT_TRUE(table.parse(ByteSpan(pit)));
+
+    EXPECT_EQ(find_partition_for_member(table, "boot.img")->identifier(), 3u);
+    EXPECT_EQ(find_partition_for_member(table, "AP/system.img")->identifier(), 4u);
+    EXPECT_EQ(find_partition_for_member(table, "system.img.ext4")->identifier(), 4u);
+    EXPECT_FALSE(find_partition_for_member(table, "cache.img").has_value());
+}
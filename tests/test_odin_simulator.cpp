@@ -0,0 +1,523 @@
+#include <gtest/gtest.h>
+#include <Core/firmware_source.h>
+#include <Core/flash_manager.h>
+#include <Core/lz4_frame.h>
+#include <Core/md5.h>
+#include <Core/odin_archive.h>
+#include <Core/samsung_flasher.h>
+#include <Core/samsung_strategy.h>
+#include <Core/sparse_image.h>
+#include <Simulator/odin_simulator.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace SamFlash;
+
+namespace {
+    std::vector<uint8_t> test_image(size_t size) {
+        std::vector<uint8_t> image(size);
+        for (size_t i = 0; i < size; ++i) {
+            image[i] = static_cast<uint8_t>(i * 13 + 5);
+        }
+        return image;
+    }
+
+    // Sparse image of a RAW block, a 0x5A5A5A5A FILL over the next three
+    // and a trailing DONT_CARE block
+    std::vector<uint8_t> test_sparse_image(uint32_t block_size) {
+        std::vector<uint8_t> out(SPARSE_HEADER_SIZE, 0);
+        auto put = [&out](uint32_t value, size_t bytes) {
+            for (size_t i = 0; i < bytes; ++i) {
+                out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+            }
+        };
+        write_le32(SPARSE_HEADER_MAGIC, out.data());
+        out[4] = 1;                                 // major version
+        out[8] = SPARSE_HEADER_SIZE;
+        out[10] = SPARSE_CHUNK_HEADER_SIZE;
+        write_le32(block_size, out.data() + 12);
+        write_le32(5, out.data() + 16);             // blocks
+        write_le32(3, out.data() + 20);             // chunks
+
+        put(SPARSE_CHUNK_RAW, 4);
+        put(1, 4);
+        put(SPARSE_CHUNK_HEADER_SIZE + block_size, 4);
+        auto raw = test_image(block_size);
+        out.insert(out.end(), raw.begin(), raw.end());
+        put(SPARSE_CHUNK_FILL, 4);
+        put(3, 4);
+        put(SPARSE_CHUNK_HEADER_SIZE + 4, 4);
+        put(0x5A5A5A5A, 4);
+        put(SPARSE_CHUNK_DONT_CARE, 4);
+        put(1, 4);
+        put(SPARSE_CHUNK_HEADER_SIZE, 4);
+        return out;
+    }
+
+    // LZ4 frame with the content size, alternating literal-only compressed
+    // blocks and stored ones
+    std::vector<uint8_t> test_lz4_frame(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> out(4);
+        write_le32(LZ4_FRAME_MAGIC, out.data());
+        std::vector<uint8_t> descriptor = {0x48, 0x40};
+        for (int i = 0; i < 8; ++i) {
+            descriptor.push_back(static_cast<uint8_t>(uint64_t(data.size()) >> (8 * i)));
+        }
+        descriptor.push_back(static_cast<uint8_t>(XxHash32::compute(ByteSpan(descriptor)) >> 8));
+        out.insert(out.end(), descriptor.begin(), descriptor.end());
+        auto put = [&out](uint32_t value) {
+            out.resize(out.size() + 4);
+            write_le32(value, out.data() + out.size() - 4);
+        };
+        const size_t piece = 60000;
+        for (size_t offset = 0; offset < data.size(); offset += piece) {
+            size_t size = std::min(piece, data.size() - offset);
+            std::vector<uint8_t> block;
+            bool compressed = (offset / piece) % 2 == 0;
+            if (compressed) {
+                block.push_back(0xF0);
+                size_t extra = size - 15;
+                for (; extra >= 255; extra -= 255) {
+                    block.push_back(255);
+                }
+                block.push_back(static_cast<uint8_t>(extra));
+            }
+            block.insert(block.end(), data.begin() + offset, data.begin() + offset + size);
+            put(static_cast<uint32_t>(block.size()) | (compressed ? 0 : 0x80000000u));
+            out.insert(out.end(), block.begin(), block.end());
+        }
+        put(0);
+        return out;
+    }
+
+    // Minimal .tar.md5 of regular files
+    std::string write_tar_md5(const char* name, const std::vector<std::pair<std::string, std::vector<uint8_t>>>& files) {
+        std::vector<uint8_t> tar;
+        for (const auto& file : files) {
+            uint8_t header[TAR_BLOCK_SIZE] = {};
+            std::memcpy(header, file.first.data(), file.first.size());
+            std::snprintf(reinterpret_cast<char*>(header + 124), 12, "%011zo", file.second.size());
+            header[156] = '0';
+            std::memcpy(header + 257, "ustar", 6);
+            std::memset(header + 148, ' ', 8);
+            unsigned sum = 0;
+            for (uint8_t byte : header) {
+                sum += byte;
+            }
+            std::snprintf(reinterpret_cast<char*>(header + 148), 8, "%06o", sum);
+            tar.insert(tar.end(), header, header + TAR_BLOCK_SIZE);
+            tar.insert(tar.end(), file.second.begin(), file.second.end());
+            tar.resize((tar.size() + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE, 0);
+        }
+        tar.resize(tar.size() + 2 * TAR_BLOCK_SIZE, 0);
+        std::string line = Md5::to_hex(Md5::compute(ByteSpan(tar))) + "  " + name + "\n";
+        tar.insert(tar.end(), line.begin(), line.end());
+        std::string path = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(tar.data()), tar.size());
+        return path;
+    }
+}
+
+TEST(OdinSimulatorTest, HandshakeAndPitDownload) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    SamsungFlasher flasher;
+    ASSERT_TRUE(flasher.connect(simulator.port_path())) << flasher.get_last_error();
+    ASSERT_TRUE(flasher.parse_pit()) << flasher.get_last_error();
+    EXPECT_EQ(flasher.get_pit_data(), simulator.pit_data());
+    EXPECT_EQ(flasher.get_pit_table().size(), OdinDeviceModel::default_partitions().size());
+    EXPECT_EQ(simulator.get_stats().file_part_size, SamsungFlasher::DEFAULT_FILE_PART_SIZE);
+
+    EXPECT_TRUE(flasher.disconnect());
+    EXPECT_TRUE(simulator.get_stats().session_ended);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+}
+
+TEST(OdinSimulatorTest, StreamsFileIntoPartition) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    SamsungFlasher flasher;
+    ASSERT_TRUE(flasher.connect(simulator.port_path())) << flasher.get_last_error();
+    ASSERT_TRUE(flasher.parse_pit()) << flasher.get_last_error();
+
+    auto image = test_image(5 * 1024 + 300);
+    ByteSpan data(image);
+    ASSERT_TRUE(flasher.begin_file(3, image.size()));
+    ASSERT_TRUE(flasher.write_page(0, data.subspan(0, 4096))) << flasher.get_last_error();
+    EXPECT_FALSE(flasher.write_page(0, data.subspan(4096)));
+    ASSERT_TRUE(flasher.write_page(4096, data.subspan(4096))) << flasher.get_last_error();
+    EXPECT_TRUE(flasher.verify_flash(data)) << flasher.get_last_error();
+
+    EXPECT_EQ(simulator.read_partition(3), image);
+    auto stats = simulator.get_stats();
+    EXPECT_EQ(stats.files_completed, 1u);
+    EXPECT_EQ(stats.protocol_errors, 0u);
+}
+
+TEST(OdinSimulatorTest, NegotiatesPartSizeAndStreamsWindowed) {
+    OdinDeviceModel model;
+    model.max_file_part_size = 16 * 1024;
+    OdinSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    SamsungFlasher flasher;
+    ASSERT_TRUE(flasher.connect(simulator.port_path())) << flasher.get_last_error();
+    IDeviceInterface::TransferOptions options;
+    options.pipeline_depth = 4;
+    flasher.set_transfer_options(options);
+    EXPECT_EQ(flasher.get_transfer_stats().chunk_size, 16u * 1024);
+
+    auto image = test_image(200 * 1024 + 17);
+    std::vector<size_t> confirmed;
+    ASSERT_TRUE(flasher.parse_pit());
+    ASSERT_TRUE(flasher.begin_file(6, image.size()));
+    ASSERT_TRUE(flasher.write_pages(0, ByteSpan(image), [&](size_t done) { confirmed.push_back(done); }))
+        << flasher.get_last_error();
+
+    ASSERT_EQ(confirmed.size(), 13u);
+    EXPECT_TRUE(std::is_sorted(confirmed.begin(), confirmed.end()));
+    EXPECT_EQ(confirmed.back(), image.size());
+    EXPECT_EQ(simulator.read_partition(6), image);
+    auto stats = simulator.get_stats();
+    EXPECT_EQ(stats.file_parts, 13u);
+    EXPECT_EQ(stats.sequences, 1u);
+    EXPECT_EQ(stats.files_completed, 1u);
+}
+
+TEST(OdinSimulatorTest, LegacyBootloaderKeepsSmallParts) {
+    OdinDeviceModel model;
+    model.protocol_version = 0;
+    OdinSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    SamsungFlasher flasher;
+    ASSERT_TRUE(flasher.connect(simulator.port_path())) << flasher.get_last_error();
+    EXPECT_EQ(flasher.get_transfer_stats().chunk_size, SamsungFlasher::LEGACY_FILE_PART_SIZE);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+}
+
+TEST(OdinSimulatorTest, RejectsUnknownPartition) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    SamsungFlasher flasher;
+    ASSERT_TRUE(flasher.connect(simulator.port_path())) << flasher.get_last_error();
+
+    // The PIT is fetched to look the partition up, so nothing reaches the device
+    auto image = test_image(512);
+    EXPECT_FALSE(flasher.begin_file(99, image.size()));
+    EXPECT_FALSE(flasher.get_pit_table().empty());
+    EXPECT_FALSE(flasher.write_page(0, ByteSpan(image)));
+    EXPECT_EQ(simulator.get_stats().sequences, 0u);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+}
+
+TEST(OdinSimulatorTest, EndsSequencesWithPartitionDeviceType) {
+    // The modem lives on its own device, as on phones with a separate radio chip
+    OdinDeviceModel model;
+    model.partitions[4].device_type = 8;
+    OdinSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    SamsungFlasher flasher;
+    ASSERT_TRUE(flasher.connect(simulator.port_path())) << flasher.get_last_error();
+    auto boot = test_image(3000);
+    auto radio = test_image(5000);
+    ASSERT_TRUE(flasher.set_total_bytes(boot.size() + radio.size())) << flasher.get_last_error();
+    EXPECT_EQ(simulator.get_stats().total_bytes, boot.size() + radio.size());
+    ASSERT_TRUE(flasher.begin_file(3, boot.size())) << flasher.get_last_error();
+    ASSERT_TRUE(flasher.write_pages(0, ByteSpan(boot))) << flasher.get_last_error();
+    ASSERT_TRUE(flasher.begin_file(5, radio.size())) << flasher.get_last_error();
+    ASSERT_TRUE(flasher.write_pages(0, ByteSpan(radio))) << flasher.get_last_error();
+
+    EXPECT_EQ(simulator.read_partition(3), boot);
+    EXPECT_EQ(simulator.read_partition(5), radio);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+}
+
+TEST(OdinSimulatorTest, SendsSparseImagesCompact) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto flasher = std::make_shared<SamsungFlasher>();
+    ASSERT_TRUE(flasher->connect(simulator.port_path())) << flasher->get_last_error();
+
+    SamsungStrategy strategy;
+    FlashConfig config;
+    config.erase_before_write = false;
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    EnhancedFlashProgress last;
+    strategy.set_progress_callback([&](const EnhancedFlashProgress& progress) { last = progress; });
+
+    const uint32_t block_size = 4096;
+    auto sparse = test_sparse_image(block_size);
+    ASSERT_TRUE(strategy.write_firmware(sparse)) << strategy.get_last_error();
+    ASSERT_TRUE(flasher->verify_flash(ByteSpan(sparse))) << flasher->get_last_error();
+
+    // Only the sparse file crosses the link; the bootloader expands it
+    EXPECT_EQ(last.bytes_written, sparse.size());
+    EXPECT_EQ(last.logical_total_bytes, 5u * block_size);
+    EXPECT_EQ(last.logical_bytes_written, last.logical_total_bytes);
+
+    auto expected = test_image(block_size);
+    expected.resize(4 * block_size, 0x5A);
+    expected.resize(5 * block_size, 0);
+    uint32_t identifier = flasher->get_pit_table()[0].identifier();
+    EXPECT_EQ(simulator.read_partition(identifier), expected);
+    EXPECT_EQ(simulator.get_stats().sparse_files, 1u);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+}
+
+TEST(OdinSimulatorTest, StreamsArchiveMembersToPartitions) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto flasher = std::make_shared<SamsungFlasher>();
+    ASSERT_TRUE(flasher->connect(simulator.port_path())) << flasher->get_last_error();
+    SamsungStrategy strategy;
+    FlashConfig config;
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    EnhancedFlashProgress last;
+    strategy.set_progress_callback([&](const EnhancedFlashProgress& progress) { last = progress; });
+
+    auto boot = test_image(300 * 1024 + 5);
+    auto modem = test_image(7000);
+    std::string path = write_tar_md5("samflash_odin.tar.md5",
+                                     {{"boot.img", boot}, {"fota.zip", test_image(100)}, {"modem.bin", modem}});
+    OdinArchive archive;
+    ASSERT_TRUE(archive.open(path)) << archive.get_last_error();
+    ASSERT_TRUE(strategy.write_archive(archive)) << strategy.get_last_error();
+    ASSERT_TRUE(flasher->verify_flash(ByteSpan())) << flasher->get_last_error();
+
+    EXPECT_EQ(simulator.read_partition(3), boot);
+    EXPECT_EQ(simulator.read_partition(5), modem);
+    EXPECT_EQ(last.total_partitions, 2u);
+    EXPECT_EQ(last.completed_partitions, 2u);
+    EXPECT_EQ(last.bytes_written, boot.size() + modem.size());
+    ASSERT_EQ(last.pipeline_stages.size(), 2u);
+    EXPECT_EQ(last.pipeline_stages[0].name, "read");
+    EXPECT_GT(last.pipeline_stages[1].utilization, 0.0);
+    EXPECT_EQ(simulator.get_stats().files_completed, 2u);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+    std::remove(path.c_str());
+}
+
+TEST(OdinSimulatorTest, DecompressesLz4MembersOnTheWay) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto flasher = std::make_shared<SamsungFlasher>();
+    ASSERT_TRUE(flasher->connect(simulator.port_path())) << flasher->get_last_error();
+    SamsungStrategy strategy;
+    FlashConfig config;
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    EnhancedFlashProgress last;
+    strategy.set_progress_callback([&](const EnhancedFlashProgress& progress) { last = progress; });
+
+    auto boot = test_image(300 * 1024 + 5);
+    auto modem = test_image(7000);
+    std::string path = write_tar_md5("samflash_lz4.tar.md5", {{"boot.img.lz4", test_lz4_frame(boot)}, {"modem.bin", modem}});
+    OdinArchive archive;
+    ASSERT_TRUE(archive.open(path)) << archive.get_last_error();
+    ASSERT_TRUE(strategy.write_archive(archive)) << strategy.get_last_error();
+
+    EXPECT_EQ(simulator.read_partition(3), boot);
+    EXPECT_EQ(simulator.read_partition(5), modem);
+    EXPECT_EQ(last.bytes_written, boot.size() + modem.size());
+    ASSERT_EQ(last.pipeline_stages.size(), 3u);
+    EXPECT_EQ(last.pipeline_stages[1].name, "decode");
+    std::remove(path.c_str());
+
+    // A frame that ends short of its recorded size fails the flash
+    auto truncated = test_lz4_frame(boot);
+    truncated.resize(truncated.size() - 1000);
+    path = write_tar_md5("samflash_lz4_short.tar.md5", {{"boot.img.lz4", truncated}});
+    ASSERT_TRUE(archive.open(path)) << archive.get_last_error();
+    EXPECT_FALSE(strategy.write_archive(archive));
+    EXPECT_NE(strategy.get_last_error().find("boot.img.lz4"), std::string::npos) << strategy.get_last_error();
+    std::remove(path.c_str());
+}
+
+TEST(OdinSimulatorTest, FlashesOnlySelectedPartitions) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto flasher = std::make_shared<SamsungFlasher>();
+    ASSERT_TRUE(flasher->connect(simulator.port_path())) << flasher->get_last_error();
+    SamsungStrategy strategy;
+    FlashConfig config;
+    config.partitions = {"radio"};
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    EnhancedFlashProgress last;
+    strategy.set_progress_callback([&](const EnhancedFlashProgress& progress) { last = progress; });
+
+    auto modem = test_image(9000);
+    std::string path = write_tar_md5("samflash_select.tar.md5",
+                                     {{"sboot.bin", test_image(4000)}, {"boot.img", test_image(20000)}, {"modem.bin", modem}});
+    OdinArchive archive;
+    ASSERT_TRUE(archive.open(path)) << archive.get_last_error();
+    ASSERT_TRUE(strategy.write_archive(archive)) << strategy.get_last_error();
+
+    EXPECT_EQ(simulator.read_partition(5), modem);
+    EXPECT_TRUE(simulator.read_partition(1).empty());
+    EXPECT_TRUE(simulator.read_partition(3).empty());
+    ASSERT_EQ(last.partition_progress.size(), 1u);
+    EXPECT_EQ(last.partition_progress[0].partition_name, "RADIO");
+    EXPECT_EQ(last.bytes_written, modem.size());
+    EXPECT_EQ(simulator.get_stats().files_completed, 1u);
+
+    // A flat image goes to the one partition named
+    config.partitions = {"BOOT"};
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    auto boot = test_image(6000);
+    ASSERT_TRUE(strategy.write_firmware(boot)) << strategy.get_last_error();
+    EXPECT_EQ(simulator.read_partition(3), boot);
+    EXPECT_EQ(last.current_partition, "BOOT");
+
+    // Names must be in the PIT and, for an archive, provided by it
+    config.partitions = {"CACHE"};
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    EXPECT_FALSE(strategy.write_firmware(boot));
+    config.partitions = {"RECOVERY"};
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    EXPECT_FALSE(strategy.write_archive(archive));
+    EXPECT_NE(strategy.get_last_error().find("RECOVERY"), std::string::npos);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+    std::remove(path.c_str());
+}
+
+TEST(OdinSimulatorTest, FlashesImagesLargerThanTheMemoryBudget) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto flasher = std::make_shared<SamsungFlasher>();
+    ASSERT_TRUE(flasher->connect(simulator.port_path())) << flasher->get_last_error();
+    SamsungStrategy strategy;
+    FlashConfig config;
+    config.erase_before_write = false;
+    config.partitions = {"SYSTEM"};
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    EnhancedFlashProgress last;
+    strategy.set_progress_callback([&](const EnhancedFlashProgress& progress) { last = progress; });
+
+    // Streamed through four 1 MB buffers, one window per buffer
+    auto image = test_image(9 * 1024 * 1024 + 777);
+    std::string path = (std::filesystem::temp_directory_path() / "samflash_budget.img").string();
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(image.data()), image.size());
+    StreamingFirmwareSource source(4 * 1024 * 1024);
+    ASSERT_TRUE(source.open(path)) << source.get_last_error();
+    ASSERT_TRUE(strategy.write_firmware(source)) << strategy.get_last_error();
+    ASSERT_TRUE(strategy.verify_firmware(source)) << strategy.get_last_error();
+
+    EXPECT_EQ(simulator.read_partition(6), image);
+    EXPECT_EQ(last.bytes_written, image.size());
+    EXPECT_EQ(simulator.get_stats().files_completed, 1u);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+    std::remove(path.c_str());
+}
+
+TEST(OdinSimulatorTest, FlashManagerRoutesSamsungPortsToOdin) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto image = test_image(200 * 1024 + 3);
+    std::string path = (std::filesystem::temp_directory_path() / "samflash_routed.img").string();
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(image.data()), image.size());
+
+    // A pty has no USB descriptor, so the vendor ID is supplied the way a
+    // scan would have reported it
+    DeviceInfo device{};
+    device.id = simulator.port_path();
+    device.type = DeviceType::USB_SERIAL;
+    device.vendor_id = SamsungFlasher::SAMSUNG_VENDOR_ID;
+
+    FlashManager manager;
+    FlashConfig config;
+    config.partitions = {"BOOT"};
+    manager.set_config(config);
+    ASSERT_TRUE(manager.connect_device(device)) << manager.get_last_error();
+    EXPECT_EQ(manager.get_connected_device().manufacturer, "Samsung");
+    ASSERT_TRUE(manager.load_firmware_file(path)) << manager.get_last_error();
+    ASSERT_TRUE(manager.flash_firmware()) << manager.get_last_error();
+    EXPECT_TRUE(manager.disconnect_device());
+
+    EXPECT_EQ(simulator.read_partition(3), image);
+    EXPECT_EQ(simulator.get_stats().files_completed, 1u);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+    std::remove(path.c_str());
+}
+
+TEST(OdinSimulatorTest, FlashManagerStreamsLz4ImagesWithoutABudget) {
+    OdinSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto image = test_image(300 * 1024 + 9);
+    std::string path = (std::filesystem::temp_directory_path() / "samflash_streamed.img.lz4").string();
+    auto frame = test_lz4_frame(image);
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(frame.data()), frame.size());
+
+    DeviceInfo device{};
+    device.id = simulator.port_path();
+    device.type = DeviceType::USB_SERIAL;
+    device.vendor_id = SamsungFlasher::SAMSUNG_VENDOR_ID;
+
+    // No memory budget: a plain file would be mapped, but the .lz4 is
+    // still decompressed on the reader thread rather than whole
+    FlashManager manager;
+    FlashConfig config;
+    config.partitions = {"BOOT"};
+    manager.set_config(config);
+    ASSERT_TRUE(manager.connect_device(device)) << manager.get_last_error();
+    ASSERT_TRUE(manager.load_firmware_file(path)) << manager.get_last_error();
+    ASSERT_TRUE(manager.flash_firmware()) << manager.get_last_error();
+    EXPECT_TRUE(manager.disconnect_device());
+
+    EXPECT_EQ(simulator.read_partition(3), image);
+    EXPECT_EQ(simulator.get_stats().files_completed, 1u);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+    std::remove(path.c_str());
+}
+
+TEST(OdinSimulatorTest, StreamsFilesPastFourGigabytes) {
+    // Counted, not stored: the point is the offsets past 32 bits
+    OdinDeviceModel device;
+    device.store_data = false;
+    OdinSimulator simulator(device);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto flasher = std::make_shared<SamsungFlasher>();
+    ASSERT_TRUE(flasher->connect(simulator.port_path())) << flasher->get_last_error();
+    IDeviceInterface::TransferOptions options;
+    options.block_size = 1024 * 1024;
+    options.pipeline_depth = 4;
+    flasher->set_transfer_options(options);
+    SamsungStrategy strategy;
+    FlashConfig config;
+    config.partitions = {"USERDATA"};
+    ASSERT_TRUE(strategy.initialize(flasher, config));
+    EnhancedFlashProgress last;
+    strategy.set_progress_callback([&](const EnhancedFlashProgress& progress) { last = progress; });
+
+    // A hole on disk, so the file costs no space
+    const uint64_t size = (uint64_t(4) << 30) + 3 * 1024 * 1024 + 11;
+    std::string path = (std::filesystem::temp_directory_path() / "samflash_4g.img").string();
+    std::ofstream(path, std::ios::binary).close();
+    std::filesystem::resize_file(path, size);
+    StreamingFirmwareSource source(16 * 1024 * 1024);
+    ASSERT_TRUE(source.open(path)) << source.get_last_error();
+    ASSERT_TRUE(strategy.write_firmware(source)) << strategy.get_last_error();
+    ASSERT_TRUE(flasher->verify_flash(ByteSpan())) << flasher->get_last_error();
+
+    EXPECT_EQ(simulator.partition_size(7), size);
+    EXPECT_EQ(last.bytes_written, size);
+    EXPECT_EQ(simulator.get_stats().total_bytes, size);
+    EXPECT_EQ(simulator.get_stats().files_completed, 1u);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+    std::remove(path.c_str());
+}
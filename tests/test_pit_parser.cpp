@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <Core/pit_parser.h>
+#include <Core/odin_protocol.h>
+#include <cstring>
+#include <vector>
+
+using namespace SamFlash;
+
+namespace {
+    std::vector<uint8_t> make_pit(const std::vector<std::pair<uint32_t, std::string>>& partitions) {
+        std::vector<uint8_t> pit(PIT_HEADER_SIZE + partitions.size() * PIT_ENTRY_SIZE, 0);
+        write_le32(PIT_MAGIC, pit.data());
+        write_le32(static_cast<uint32_t>(partitions.size()), pit.data() + 4);
+        for (size_t i = 0; i < partitions.size(); ++i) {
+            uint8_t* record = pit.data() + PIT_HEADER_SIZE + i * PIT_ENTRY_SIZE;
+            write_le32(partitions[i].first, record + 8);          // identifier
+            write_le32(0x1000 * (i + 1), record + 20);            // block offset
+            write_le32(0x800, record + 24);                       // block count
+            std::memcpy(record + 36, partitions[i].second.data(), partitions[i].second.size());
+            std::memcpy(record + 68, "image.bin", 9);
+        }
+        return pit;
+    }
+}
+
+TEST(PitParserTest, ReadsEntriesInPlace) {
+    auto pit = make_pit({{1, "BOOT"}, {7, "SYSTEM"}});
+    PitTable table;
+    ASSERT_TRUE(table.parse(ByteSpan(pit))) << table.get_last_error();
+    ASSERT_EQ(table.size(), 2u);
+
+    PitEntryView system = table[1];
+    EXPECT_EQ(system.identifier(), 7u);
+    EXPECT_EQ(system.block_size_or_offset(), 0x2000u);
+    EXPECT_EQ(system.block_count_or_size(), 0x800u);
+    EXPECT_EQ(system.partition_name(), "SYSTEM");
+    EXPECT_EQ(system.flash_filename(), "image.bin");
+    EXPECT_TRUE(system.fota_filename().empty());
+    // Names point into the buffer rather than at copies
+    EXPECT_EQ(reinterpret_cast<const uint8_t*>(system.partition_name().data()),
+              pit.data() + PIT_HEADER_SIZE + PIT_ENTRY_SIZE + 36);
+
+    PITEntry owned = system.to_entry();
+    EXPECT_EQ(owned.partition_name, "SYSTEM");
+    EXPECT_EQ(owned.identifier, 7u);
+}
+
+TEST(PitParserTest, FindsByNameAndIdentifier) {
+    auto pit = make_pit({{1, "BOOT"}, {7, "SYSTEM"}});
+    PitTable table;
+    ASSERT_TRUE(table.parse(ByteSpan(pit)));
+
+    auto boot = table.find("BOOT");
+    ASSERT_TRUE(boot.has_value());
+    EXPECT_EQ(boot->identifier(), 1u);
+    ASSERT_TRUE(table.find(7u).has_value());
+    EXPECT_EQ(table.find(7u)->partition_name(), "SYSTEM");
+    EXPECT_FALSE(table.find("RADIO").has_value());
+    EXPECT_FALSE(table.find(3u).has_value());
+}
+
+TEST(PitParserTest, UnterminatedNameUsesWholeField) {
+    std::string name(PIT_NAME_SIZE, 'A');
+    auto pit = make_pit({{1, name}});
+    PitTable table;
+    ASSERT_TRUE(table.parse(ByteSpan(pit)));
+    EXPECT_EQ(table[0].partition_name(), name);
+}
+
+TEST(PitParserTest, RejectsMalformedTables) {
+    PitTable table;
+    auto pit = make_pit({{1, "BOOT"}, {2, "RADIO"}});
+
+    auto bad_magic = pit;
+    bad_magic[0] ^= 0xFF;
+    EXPECT_FALSE(table.parse(ByteSpan(bad_magic)));
+
+    EXPECT_FALSE(table.parse(ByteSpan(pit.data(), pit.size() - 1)));
+    EXPECT_FALSE(table.parse(ByteSpan(pit.data(), PIT_HEADER_SIZE - 1)));
+
+    auto huge_count = pit;
+    write_le32(0xFFFFFFFF, huge_count.data() + 4);
+    EXPECT_FALSE(table.parse(ByteSpan(huge_count)));
+    EXPECT_TRUE(table.empty());
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <Core/ring_buffer.h>
+#include <Core/response_framer.h>
+#include <cstring>
+#include <string>
+
+using namespace SamFlash;
+
+TEST(SpscByteRingTest, WrapsAroundCapacity) {
+    SpscByteRing ring(8);
+    EXPECT_EQ(ring.capacity(), 8u);
+
+    const uint8_t first[] = {1, 2, 3, 4, 5, 6};
+    EXPECT_EQ(ring.write(first, sizeof(first)), sizeof(first));
+    EXPECT_EQ(ring.skip(4), 4u);
+
+    // Crosses the end of the storage
+    const uint8_t second[] = {7, 8, 9, 10, 11, 12, 13};
+    EXPECT_EQ(ring.write(second, sizeof(second)), 6u);
+    EXPECT_EQ(ring.free_space(), 0u);
+
+    uint8_t out[8] = {};
+    EXPECT_EQ(ring.read(out, sizeof(out)), 8u);
+    const uint8_t expected[] = {5, 6, 7, 8, 9, 10, 11, 12};
+    EXPECT_EQ(0, memcmp(out, expected, sizeof(expected)));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(ResponseFramerTest, DelimiterSplitAcrossChunks) {
+    DelimiterFramer framer("\n\r>");
+    const std::string part1 = "v1.1 Nov 10 2023\n";
+    const std::string part2 = "\r>N#";
+
+    EXPECT_EQ(framer.consume(reinterpret_cast<const uint8_t*>(part1.data()), part1.size()), part1.size());
+    EXPECT_FALSE(framer.is_complete());
+
+    // Only the prompt is consumed; the trailing bytes belong to the next frame
+    EXPECT_EQ(framer.consume(reinterpret_cast<const uint8_t*>(part2.data()), part2.size()), 2u);
+    ASSERT_TRUE(framer.is_complete());
+
+    auto frame = framer.take_frame();
+    EXPECT_EQ(std::string(frame.begin(), frame.end()), "v1.1 Nov 10 2023\n\r>");
+    EXPECT_FALSE(framer.is_complete());
+}
+
+TEST(ResponseFramerTest, FixedSizeStopsAtFrameBoundary) {
+    FixedSizeFramer framer(8);
+    const uint8_t data[12] = {};
+
+    EXPECT_EQ(framer.consume(data, 5), 5u);
+    EXPECT_FALSE(framer.is_complete());
+    EXPECT_EQ(framer.consume(data, 7), 3u);
+    EXPECT_TRUE(framer.is_complete());
+    EXPECT_EQ(framer.take_frame().size(), 8u);
+}
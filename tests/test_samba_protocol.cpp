@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include <Core/samba_protocol.h>
+#include <string>
+
+using namespace SamFlash;
+
+namespace {
+    std::string as_string(const SambaCommand& cmd) {
+        return std::string(reinterpret_cast<const char*>(cmd.data()), cmd.size());
+    }
+}
+
+TEST(SambaProtocolTest, EncodesFixedWidthUpperCaseHex) {
+    EXPECT_EQ(as_string(SambaCommand('S', 0x20004000, 0x100)), "S20004000,00000100#");
+    EXPECT_EQ(as_string(SambaCommand('R', 0, 0xFFFFFFFF)), "R00000000,FFFFFFFF#");
+    EXPECT_EQ(as_string(SambaCommand('W', 0x400E0A04, 0x5A00000B)), "W400E0A04,5A00000B#");
+}
+
+TEST(SambaProtocolTest, AppendsCommandsForOneWrite) {
+    SambaCommand cmd('Y', 0x20004000, 0);
+    cmd.append('Y', 0x00400100, 0x200);
+    EXPECT_EQ(as_string(cmd), "Y20004000,00000000#Y00400100,00000200#");
+}
+
+TEST(SambaProtocolTest, DropsCommandsBeyondCapacity) {
+    SambaCommand cmd('Y', 0x20004000, 0);
+    cmd.append('Y', 0x00400100, 0x200);
+    EXPECT_FALSE(cmd.overflowed());
+    cmd.append('Y', 0x00400300, 0x200).append_literal('w', 0x400E0740, '4');
+    EXPECT_TRUE(cmd.overflowed());
+    EXPECT_EQ(as_string(cmd), "Y20004000,00000000#Y00400100,00000200#");
+}
+
+TEST(SambaProtocolTest, CharacterArgumentIsWrittenVerbatim) {
+    EXPECT_EQ(as_string(SambaCommand().append_literal('w', 0x400E0740, '4')), "w400E0740,4#");
+}
+
+TEST(SambaProtocolTest, EncodesAtCompileTime) {
+    constexpr SambaCommand cmd('E', 0xDEADBEEF, 0x2000);
+    static_assert(cmd.size() == 19, "command is op, two 8-digit fields and separators");
+    static_assert(cmd.data()[1] == 'D' && cmd.data()[8] == 'F', "address digits are upper case");
+    EXPECT_EQ(as_string(cmd), "EDEADBEEF,00002000#");
+}
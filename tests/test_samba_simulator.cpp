@@ -0,0 +1,306 @@
+#include <gtest/gtest.h>
+#include <Core/usb_serial_interface.h>
+#include <Core/crc16.h>
+#include <Core/firmware_source.h>
+#include <Core/flash_manager.h>
+#include <Core/session_journal.h>
+#include <Core/crc32.h>
+#include <Core/generic_strategy.h>
+#include <Simulator/samba_simulator.h>
+#include <Simulator/pty_pair.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace SamFlash;
+
+namespace {
+    std::vector<uint8_t> test_image(size_t size) {
+        std::vector<uint8_t> image(size);
+        for (size_t i = 0; i < size; ++i) {
+            image[i] = static_cast<uint8_t>(i * 31 + 7);
+        }
+        return image;
+    }
+}
+
+TEST(SambaSimulatorTest, AnswersAutobaudAndVersion) {
+    SambaSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    SerialTransport transport;
+    ASSERT_TRUE(transport.open(simulator.port_path())) << transport.get_last_error();
+
+    ASSERT_TRUE(transport.write(std::vector<uint8_t>{'#'}));
+    std::vector<uint8_t> prompt(3);
+    size_t bytes_read = 0;
+    ASSERT_TRUE(transport.read(prompt.data(), prompt.size(), bytes_read));
+    EXPECT_EQ(std::string(prompt.begin(), prompt.end()), "\n\r>");
+}
+
+TEST(SambaSimulatorTest, InterfaceDiscoversSimulatedGeometry) {
+    SambaDeviceModel model;
+    model.flash_size = 512 * 1024;
+    model.page_size = 512;
+    model.lock_region_size = 8 * 1024;
+    model.sram_size = 64 * 1024;
+    SambaSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    USBSerialInterface device;
+    ASSERT_TRUE(device.connect(simulator.port_path())) << device.get_last_error();
+    DeviceInfo info = device.get_device_info();
+    EXPECT_EQ(info.flash_size, model.flash_size);
+    EXPECT_EQ(info.page_size, model.page_size);
+    EXPECT_EQ(info.erase_block_size, model.lock_region_size);
+    EXPECT_GT(info.ram_buffer_size, 0u);
+    EXPECT_TRUE(device.disconnect());
+}
+
+TEST(SambaSimulatorTest, InterfaceReadsChipUniqueId) {
+    SambaDeviceModel model;
+    SambaSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+    USBSerialInterface device;
+    ASSERT_TRUE(device.connect(simulator.port_path())) << device.get_last_error();
+    EXPECT_EQ(device.get_device_info().serial_number, "53494D31000000010000000200000003");
+    EXPECT_TRUE(device.disconnect());
+
+    // A part without one, on a port without a USB serial number
+    model.unique_id.fill(0xFFFFFFFF);
+    SambaSimulator anonymous(model);
+    ASSERT_TRUE(anonymous.start()) << anonymous.get_last_error();
+    ASSERT_TRUE(device.connect(anonymous.port_path())) << device.get_last_error();
+    EXPECT_TRUE(device.get_device_info().serial_number.empty());
+    EXPECT_EQ(anonymous.get_stats().protocol_errors, 0u);
+}
+
+TEST(SambaSimulatorTest, FlashManagerWontResumeOnUnidentifiedDevice) {
+    SambaDeviceModel model;
+    model.unique_id.fill(0);
+    SambaSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+    std::vector<uint8_t> dirty(model.flash_size, 0x00);
+    simulator.load_flash(0, ByteSpan(dirty));
+
+    auto image = test_image(64 * 1024);
+    std::string path = (std::filesystem::temp_directory_path() / "samflash_resume.bin").string();
+    std::string journal_path = path + ".journal";
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(image.data()), image.size());
+
+    // A journal some other unit of the same model could have left behind
+    SessionCheckpoint stale;
+    stale.image_path = path;
+    stale.image_size = image.size();
+    stale.image_crc32 = Crc32::compute(ByteSpan(image));
+    stale.partition = "main";
+    stale.confirmed_bytes = 32 * 1024;
+    SessionJournal journal(journal_path);
+    ASSERT_TRUE(journal.save(stale)) << journal.get_last_error();
+
+    FlashManager manager;
+    FlashConfig config;
+    config.journal_path = journal_path;
+    config.resume = true;
+    manager.set_config(config);
+    ASSERT_TRUE(manager.connect_device(simulator.port_path())) << manager.get_last_error();
+    ASSERT_TRUE(manager.load_firmware_file(path)) << manager.get_last_error();
+    ASSERT_TRUE(manager.flash_firmware()) << manager.get_last_error();
+
+    // Written from the start, not from the stale checkpoint
+    EXPECT_EQ(simulator.read_flash(0, static_cast<uint32_t>(image.size())), image);
+    EXPECT_TRUE(manager.disconnect_device());
+    std::remove(path.c_str());
+    std::remove(journal_path.c_str());
+}
+
+TEST(SambaSimulatorTest, FlashManagerJournalsOnlyWhenAsked) {
+    SambaDeviceModel model;
+    model.flash_size = 4 * 1024 * 1024;
+    SambaSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    auto image = test_image(3 * 1024 * 1024);
+    std::string path = (std::filesystem::temp_directory_path() / "samflash_journaled.bin").string();
+    std::string journal_path = SessionJournal::default_path_for(path);
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(image.data()), image.size());
+    std::remove(journal_path.c_str());
+
+    FlashManager manager;
+    bool journal_seen = false;
+    manager.set_progress_callback([&](const FlashProgress&) {
+        journal_seen = journal_seen || std::filesystem::exists(journal_path);
+    });
+    ASSERT_TRUE(manager.connect_device(simulator.port_path())) << manager.get_last_error();
+    ASSERT_TRUE(manager.load_firmware_file(path)) << manager.get_last_error();
+
+    // A plain flash neither hashes the image nor keeps checkpoints
+    ASSERT_TRUE(manager.flash_firmware()) << manager.get_last_error();
+    EXPECT_FALSE(journal_seen);
+
+    FlashConfig config;
+    config.resume = true;
+    manager.set_config(config);
+    manager.select_strategy();
+    ASSERT_TRUE(manager.flash_firmware()) << manager.get_last_error();
+    EXPECT_TRUE(journal_seen);
+    EXPECT_FALSE(std::filesystem::exists(journal_path));
+    EXPECT_EQ(simulator.read_flash(0, static_cast<uint32_t>(image.size())), image);
+    EXPECT_TRUE(manager.disconnect_device());
+    std::remove(path.c_str());
+}
+
+TEST(SambaSimulatorTest, InterfaceRejectsResponseWithoutPrompt) {
+    PtyPair pty;
+    ASSERT_TRUE(pty.open()) << pty.get_last_error();
+
+    // Answers autobaud, then streams more than any reply without a prompt
+    std::thread board([&pty]() {
+        int fd = pty.master_fd();
+        auto wait = [fd](short events) {
+            struct pollfd pfd = {fd, events, 0};
+            return ::poll(&pfd, 1, 2000) > 0;
+        };
+        std::string received;
+        char buffer[64];
+        bool prompted = false;
+        while (received.find("V#") == std::string::npos) {
+            ssize_t count = wait(POLLIN) ? ::read(fd, buffer, sizeof(buffer)) : -1;
+            if (count <= 0) {
+                return;
+            }
+            received.append(buffer, static_cast<size_t>(count));
+            if (!prompted && received.find('#') != std::string::npos) {
+                prompted = ::write(fd, "\n\r>", 3) == 3;
+            }
+        }
+        std::string junk(66 * 1024, 'x');
+        for (size_t sent = 0; sent < junk.size();) {
+            ssize_t count = wait(POLLOUT) ? ::write(fd, junk.data() + sent, junk.size() - sent) : -1;
+            if (count <= 0) {
+                return;
+            }
+            sent += static_cast<size_t>(count);
+        }
+    });
+
+    USBSerialInterface device;
+    EXPECT_FALSE(device.connect(pty.slave_path()));
+    EXPECT_NE(device.get_last_error().find("too long"), std::string::npos) << device.get_last_error();
+    board.join();
+}
+
+TEST(SambaSimulatorTest, ProgramsReadsAndChecksumsFlash) {
+    SambaSimulator simulator;
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+
+    USBSerialInterface device;
+    ASSERT_TRUE(device.connect(simulator.port_path())) << device.get_last_error();
+    IDeviceInterface::TransferOptions options;
+    options.pipeline_depth = 4;
+    device.set_transfer_options(options);
+
+    // Simulated flash starts erased; make it dirty so a missing erase shows
+    std::vector<uint8_t> dirty(64 * 1024, 0x00);
+    simulator.load_flash(0, ByteSpan(dirty));
+
+    auto image = test_image(40 * 1024 + 100);
+    ASSERT_TRUE(device.erase_region(0, 48 * 1024)) << device.get_last_error();
+    ASSERT_TRUE(device.write_pages(0, ByteSpan(image))) << device.get_last_error();
+
+    EXPECT_EQ(simulator.read_flash(0, static_cast<uint32_t>(image.size())), image);
+    EXPECT_TRUE(device.verify_flash(ByteSpan(image), 0)) << device.get_last_error();
+
+    uint32_t checksum = 0;
+    ASSERT_TRUE(device.compute_flash_checksum(0, static_cast<uint32_t>(image.size()), checksum));
+    EXPECT_EQ(checksum, Crc16::compute(ByteSpan(image)));
+    EXPECT_EQ(checksum, device.checksum_of(ByteSpan(image)));
+
+    EXPECT_TRUE(device.disconnect());
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+}
+
+TEST(SambaSimulatorTest, ChipEraseClearsWholeFlash) {
+    SambaDeviceModel model;
+    SambaSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+    std::vector<uint8_t> dirty(model.flash_size, 0x5A);
+    simulator.load_flash(0, ByteSpan(dirty));
+
+    auto device = std::make_shared<USBSerialInterface>();
+    ASSERT_TRUE(device->connect(simulator.port_path())) << device->get_last_error();
+    GenericStrategy strategy;
+    ASSERT_TRUE(strategy.initialize(device, FlashConfig()));
+    ASSERT_TRUE(strategy.erase_device()) << strategy.get_last_error();
+
+    EXPECT_EQ(simulator.read_flash(0, model.flash_size), std::vector<uint8_t>(model.flash_size, 0xFF));
+    EXPECT_EQ(simulator.get_stats().pages_erased, model.flash_size / model.page_size);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+}
+
+TEST(SambaSimulatorTest, GenericStrategyRefusesPartitionSelection) {
+    SambaDeviceModel model;
+    SambaSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+    std::vector<uint8_t> dirty(model.flash_size, 0x5A);
+    simulator.load_flash(0, ByteSpan(dirty));
+
+    auto device = std::make_shared<USBSerialInterface>();
+    ASSERT_TRUE(device->connect(simulator.port_path())) << device->get_last_error();
+    GenericStrategy strategy;
+    FlashConfig config;
+    config.partitions = {"BOOT"};
+    ASSERT_TRUE(strategy.initialize(device, config));
+
+    // Flashing the whole chip is not what was asked for
+    EXPECT_FALSE(strategy.erase_device());
+    EXPECT_NE(strategy.get_last_error().find("no PIT"), std::string::npos) << strategy.get_last_error();
+    EXPECT_FALSE(strategy.write_firmware(test_image(4096)));
+    EXPECT_EQ(simulator.read_flash(0, model.flash_size), dirty);
+}
+
+TEST(SambaSimulatorTest, GenericStrategyStreamsImageInWindows) {
+    SambaDeviceModel model;
+    model.flash_size = 8 * 1024 * 1024;
+    model.lock_region_size = 64 * 1024;
+    SambaSimulator simulator(model);
+    ASSERT_TRUE(simulator.start()) << simulator.get_last_error();
+    std::vector<uint8_t> dirty(model.flash_size, 0x00);
+    simulator.load_flash(0, ByteSpan(dirty));
+
+    auto device = std::make_shared<USBSerialInterface>();
+    ASSERT_TRUE(device->connect(simulator.port_path())) << device->get_last_error();
+    GenericStrategy strategy;
+    FlashConfig config;
+    config.differential_flash = true;
+    ASSERT_TRUE(strategy.initialize(device, config));
+
+    // More than the 4 MB budget, so it goes out one 1 MB window at a time
+    auto image = test_image(5 * 1024 * 1024 + 300);
+    std::string path = (std::filesystem::temp_directory_path() / "samflash_windows.bin").string();
+    auto save = [&] {
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(image.data()), image.size());
+    };
+    save();
+    StreamingFirmwareSource source(4 * 1024 * 1024);
+    ASSERT_TRUE(source.open(path)) << source.get_last_error();
+    ASSERT_TRUE(strategy.write_firmware(source)) << strategy.get_last_error();
+    ASSERT_TRUE(strategy.verify_firmware(source)) << strategy.get_last_error();
+    EXPECT_EQ(simulator.read_flash(0, static_cast<uint32_t>(image.size())), image);
+
+    // A second pass only rewrites the sector that changed
+    image[3 * 1024 * 1024 + 17] ^= 0xFF;
+    save();
+    ASSERT_TRUE(source.open(path)) << source.get_last_error();
+    EnhancedFlashProgress last;
+    strategy.set_progress_callback([&](const EnhancedFlashProgress& progress) { last = progress; });
+    ASSERT_TRUE(strategy.write_firmware(source)) << strategy.get_last_error();
+    EXPECT_EQ(last.skipped_bytes, image.size() - model.lock_region_size);
+    EXPECT_EQ(simulator.read_flash(0, static_cast<uint32_t>(image.size())), image);
+    EXPECT_EQ(simulator.get_stats().protocol_errors, 0u);
+    std::remove(path.c_str());
+}
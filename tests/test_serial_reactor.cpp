@@ -0,0 +1,292 @@
+#include <gtest/gtest.h>
+#include <Core/serial_reactor.h>
+#include <Core/serial_receiver.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace SamFlash;
+
+namespace {
+    // Pseudo-terminal whose master end plays the device
+    struct Pty {
+        int master = -1;
+        std::string slave;
+
+        bool open() {
+            master = ::posix_openpt(O_RDWR | O_NOCTTY);
+            if (master < 0 || ::grantpt(master) != 0 || ::unlockpt(master) != 0) {
+                return false;
+            }
+            slave = ::ptsname(master);
+            return true;
+        }
+        void close() {
+            if (master >= 0) {
+                ::close(master);
+                master = -1;
+            }
+        }
+        ~Pty() { close(); }
+
+        std::string read(size_t size) {
+            std::string data;
+            while (data.size() < size) {
+                struct pollfd pfd = {master, POLLIN, 0};
+                if (::poll(&pfd, 1, 1000) <= 0) {
+                    break;
+                }
+                char buffer[256];
+                ssize_t count = ::read(master, buffer, std::min(sizeof(buffer), size - data.size()));
+                if (count <= 0) {
+                    break;
+                }
+                data.append(buffer, static_cast<size_t>(count));
+            }
+            return data;
+        }
+        bool write(const std::string& text) {
+            return ::write(master, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+        }
+    };
+
+    std::unique_ptr<SerialTransport> open_transport(const Pty& pty) {
+        auto transport = std::make_unique<SerialTransport>();
+        return transport->open(pty.slave) ? std::move(transport) : nullptr;
+    }
+
+    // What the reactor delivered for one port
+    struct Inbox {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::string data;
+        std::vector<std::string> errors;
+
+        SerialReactor::PortCallbacks callbacks() {
+            SerialReactor::PortCallbacks callbacks;
+            callbacks.on_data = [this](SerialReactor::PortId, const uint8_t* bytes, size_t size) {
+                std::lock_guard<std::mutex> lock(mutex);
+                data.append(reinterpret_cast<const char*>(bytes), size);
+                cv.notify_all();
+            };
+            callbacks.on_error = [this](SerialReactor::PortId, const std::string& error) {
+                std::lock_guard<std::mutex> lock(mutex);
+                errors.push_back(error);
+                cv.notify_all();
+            };
+            return callbacks;
+        }
+
+        template <typename Predicate>
+        bool wait(Predicate done) {
+            std::unique_lock<std::mutex> lock(mutex);
+            return cv.wait_for(lock, std::chrono::seconds(2), done);
+        }
+    };
+}
+
+TEST(SerialReactorTest, DrivesSeveralPortsFromOneThread) {
+    SerialReactor reactor;
+    ASSERT_TRUE(reactor.start(1)) << reactor.get_last_error();
+
+    Pty first, second;
+    ASSERT_TRUE(first.open() && second.open());
+    Inbox first_inbox, second_inbox;
+    auto first_id = reactor.add_port(open_transport(first), first_inbox.callbacks());
+    auto second_id = reactor.add_port(open_transport(second), second_inbox.callbacks());
+    ASSERT_NE(first_id, SerialReactor::INVALID_PORT) << reactor.get_last_error();
+    ASSERT_NE(second_id, SerialReactor::INVALID_PORT) << reactor.get_last_error();
+    EXPECT_EQ(reactor.port_count(), 2u);
+
+    ASSERT_TRUE(first.write("\n\r>"));
+    ASSERT_TRUE(second.write("OK"));
+    EXPECT_TRUE(first_inbox.wait([&] { return first_inbox.data == "\n\r>"; }));
+    EXPECT_TRUE(second_inbox.wait([&] { return second_inbox.data == "OK"; }));
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int completed = 0;
+    auto on_written = [&](SerialReactor::PortId, bool success) {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed += success ? 1 : 100;
+        cv.notify_all();
+    };
+    std::string command = "N#";
+    ASSERT_TRUE(reactor.async_write(second_id, std::vector<uint8_t>(command.begin(), command.end()), on_written));
+    ASSERT_TRUE(reactor.async_write(second_id, reinterpret_cast<const uint8_t*>("V#"), 2, on_written));
+    EXPECT_EQ(second.read(4), "N#V#");
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds(2), [&] { return completed == 2; }));
+    }
+
+    auto transport = reactor.remove_port(first_id);
+    ASSERT_NE(transport, nullptr);
+    EXPECT_TRUE(transport->is_open());
+    EXPECT_EQ(reactor.port_count(), 1u);
+    EXPECT_EQ(reactor.remove_port(first_id), nullptr);
+    EXPECT_FALSE(reactor.async_write(first_id, std::vector<uint8_t>{'#'}));
+    reactor.stop();
+    EXPECT_EQ(reactor.port_count(), 0u);
+}
+
+TEST(SerialReactorTest, HangupIsReportedOnceAndPortStaysUntilRemoved) {
+    SerialReactor reactor;
+    ASSERT_TRUE(reactor.start(2)) << reactor.get_last_error();
+
+    Pty pty;
+    ASSERT_TRUE(pty.open());
+    SerialTransport transport;
+    ASSERT_TRUE(transport.open(pty.slave)) << transport.get_last_error();
+    Inbox inbox;
+    auto id = reactor.add_port(transport, inbox.callbacks());
+    ASSERT_NE(id, SerialReactor::INVALID_PORT) << reactor.get_last_error();
+
+    pty.close();
+    EXPECT_TRUE(inbox.wait([&] { return !inbox.errors.empty(); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(inbox.errors.size(), 1u);
+    EXPECT_EQ(reactor.port_count(), 1u);
+
+    // A borrowed transport isn't handed back
+    EXPECT_EQ(reactor.remove_port(id), nullptr);
+    EXPECT_EQ(reactor.port_count(), 0u);
+    EXPECT_TRUE(transport.is_open());
+}
+
+TEST(SerialReactorTest, RemovePortWaitsForRunningCallbacks) {
+    SerialReactor reactor;
+    ASSERT_TRUE(reactor.start(1)) << reactor.get_last_error();
+
+    Pty pty;
+    ASSERT_TRUE(pty.open());
+    std::atomic<bool> in_callback{false};
+    std::atomic<bool> callback_done{false};
+    SerialReactor::PortCallbacks callbacks;
+    callbacks.on_data = [&](SerialReactor::PortId, const uint8_t*, size_t) {
+        in_callback = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        callback_done = true;
+    };
+    auto id = reactor.add_port(open_transport(pty), callbacks);
+    ASSERT_NE(id, SerialReactor::INVALID_PORT) << reactor.get_last_error();
+
+    ASSERT_TRUE(pty.write("x"));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!in_callback && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(in_callback);
+    EXPECT_NE(reactor.remove_port(id), nullptr);
+    EXPECT_TRUE(callback_done);
+
+    // Likewise for a write completion
+    Inbox inbox;
+    id = reactor.add_port(open_transport(pty), inbox.callbacks());
+    ASSERT_NE(id, SerialReactor::INVALID_PORT) << reactor.get_last_error();
+    in_callback = false;
+    callback_done = false;
+    ASSERT_TRUE(reactor.async_write(id, std::vector<uint8_t>{'#'}, [&](SerialReactor::PortId, bool) {
+        in_callback = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        callback_done = true;
+    }));
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!in_callback && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(in_callback);
+    EXPECT_NE(reactor.remove_port(id), nullptr);
+    EXPECT_TRUE(callback_done);
+}
+
+TEST(SerialReactorTest, ReceiverDrainsThroughSharedReactor) {
+    auto reactor = SerialReactor::shared_instance();
+    ASSERT_NE(reactor, nullptr);
+    EXPECT_EQ(SerialReactor::shared_instance(), reactor);
+
+    Pty pty;
+    ASSERT_TRUE(pty.open());
+    SerialTransport transport;
+    ASSERT_TRUE(transport.open(pty.slave)) << transport.get_last_error();
+    SerialReceiver receiver(transport);
+    ASSERT_TRUE(receiver.start(*reactor)) << receiver.get_last_error();
+    EXPECT_EQ(reactor->port_count(), 1u);
+
+    ASSERT_TRUE(pty.write("12345678"));
+    uint8_t reply[8];
+    ASSERT_TRUE(receiver.read_exact(MutableByteSpan(reply, sizeof(reply)), std::chrono::milliseconds(2000)));
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(reply), sizeof(reply)), "12345678");
+
+    // A hangup fails waiting callers instead of leaving them to time out
+    pty.close();
+    auto started = std::chrono::steady_clock::now();
+    EXPECT_FALSE(receiver.read_exact(MutableByteSpan(reply, 1), std::chrono::milliseconds(5000)));
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(2));
+    EXPECT_FALSE(receiver.is_running());
+    EXPECT_FALSE(receiver.get_last_error().empty());
+
+    receiver.stop();
+    EXPECT_EQ(reactor->port_count(), 0u);
+}
+
+TEST(SerialReactorTest, ReceiverThreadStopsOnHangup) {
+    Pty pty;
+    ASSERT_TRUE(pty.open());
+    SerialTransport transport;
+    ASSERT_TRUE(transport.open(pty.slave)) << transport.get_last_error();
+    SerialReceiver receiver(transport);
+    ASSERT_TRUE(receiver.start()) << receiver.get_last_error();
+
+    // The thread backs off and gives up rather than spinning on the dead port
+    pty.close();
+    uint8_t reply[1];
+    EXPECT_FALSE(receiver.read_exact(MutableByteSpan(reply, sizeof(reply)), std::chrono::milliseconds(5000)));
+    EXPECT_FALSE(receiver.is_running());
+    EXPECT_NE(receiver.get_last_error().find("Receive failed"), std::string::npos);
+    receiver.stop();
+}
+
+TEST(SerialReactorTest, FullReceiverDoesNotHoldUpOtherPorts) {
+    SerialReactor reactor;
+    ASSERT_TRUE(reactor.start(1)) << reactor.get_last_error();
+
+    Pty slow_pty, fast_pty;
+    ASSERT_TRUE(slow_pty.open() && fast_pty.open());
+    SerialTransport slow_transport, fast_transport;
+    ASSERT_TRUE(slow_transport.open(slow_pty.slave)) << slow_transport.get_last_error();
+    ASSERT_TRUE(fast_transport.open(fast_pty.slave)) << fast_transport.get_last_error();
+    SerialReceiver slow(slow_transport, 1024);
+    SerialReceiver fast(fast_transport);
+    ASSERT_TRUE(slow.start(reactor)) << slow.get_last_error();
+    ASSERT_TRUE(fast.start(reactor)) << fast.get_last_error();
+
+    // Eight times what the slow ring holds, with nobody reading it yet
+    std::string burst;
+    for (int i = 0; i < 8 * 1024; ++i) {
+        burst.push_back(static_cast<char>('a' + i % 26));
+    }
+    ASSERT_TRUE(slow_pty.write(burst));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    ASSERT_TRUE(fast_pty.write("ping"));
+    uint8_t reply[4];
+    ASSERT_TRUE(fast.read_exact(MutableByteSpan(reply, sizeof(reply)), std::chrono::milliseconds(1000)));
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(reply), sizeof(reply)), "ping");
+
+    // The paused port picks up where it stopped once there is room
+    std::vector<uint8_t> received(burst.size());
+    ASSERT_TRUE(slow.read_exact(MutableByteSpan(received.data(), received.size()), std::chrono::milliseconds(2000)));
+    EXPECT_EQ(std::string(received.begin(), received.end()), burst);
+
+    slow.stop();
+    fast.stop();
+}
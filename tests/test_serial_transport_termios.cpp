@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <Core/serial_transport.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+using namespace SamFlash;
+
+namespace {
+    // Pseudo-terminal pair: the transport opens the slave side, the test
+    // plays the device on the master side
+    class PtyTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            master_ = ::posix_openpt(O_RDWR | O_NOCTTY);
+            ASSERT_GE(master_, 0);
+            ASSERT_EQ(::grantpt(master_), 0);
+            ASSERT_EQ(::unlockpt(master_), 0);
+            slave_name_ = ::ptsname(master_);
+        }
+
+        void TearDown() override {
+            if (master_ >= 0) {
+                ::close(master_);
+            }
+        }
+
+        std::vector<uint8_t> read_master(size_t size) {
+            std::vector<uint8_t> data;
+            while (data.size() < size) {
+                struct pollfd pfd = {master_, POLLIN, 0};
+                if (::poll(&pfd, 1, 1000) <= 0) {
+                    break;
+                }
+                uint8_t buffer[256];
+                ssize_t count = ::read(master_, buffer, std::min(sizeof(buffer), size - data.size()));
+                if (count <= 0) {
+                    break;
+                }
+                data.insert(data.end(), buffer, buffer + count);
+            }
+            return data;
+        }
+
+        void write_master(const std::string& text) {
+            ASSERT_EQ(::write(master_, text.data(), text.size()), static_cast<ssize_t>(text.size()));
+        }
+
+        int master_ = -1;
+        std::string slave_name_;
+    };
+}
+
+TEST_F(PtyTest, OpensWithNonStandardBaudRate) {
+    SerialTransport transport;
+    SerialConfig config;
+    config.baud_rate = 921600 + 1234; // no Bxxx constant exists for this
+    ASSERT_TRUE(transport.open(slave_name_, config)) << transport.get_last_error();
+    EXPECT_TRUE(transport.is_open());
+    EXPECT_GE(transport.native_handle(), 0);
+    EXPECT_EQ(transport.get_port_info().port_name, slave_name_);
+    EXPECT_TRUE(transport.close());
+}
+
+TEST_F(PtyTest, RawBytesPassThroughUnchanged) {
+    SerialTransport transport;
+    ASSERT_TRUE(transport.open(slave_name_)) << transport.get_last_error();
+
+    // Raw mode: no CR/LF translation or flow-control characters eaten
+    std::vector<uint8_t> sent = {'S', '\r', '\n', 0x00, 0x11, 0x13, 0xFF, '#'};
+    ASSERT_TRUE(transport.write(sent));
+    EXPECT_EQ(read_master(sent.size()), sent);
+
+    write_master("\n\r>\x03");
+    std::vector<uint8_t> received(4);
+    size_t bytes_read = 0;
+    ASSERT_TRUE(transport.read(received.data(), received.size(), bytes_read)) << transport.get_last_error();
+    EXPECT_EQ(bytes_read, 4u);
+    EXPECT_EQ(received, (std::vector<uint8_t>{'\n', '\r', '>', 0x03}));
+}
+
+TEST_F(PtyTest, ReadTimesOutWithoutData) {
+    SerialTransport transport;
+    SerialConfig config;
+    config.read_timeout = std::chrono::milliseconds(50);
+    ASSERT_TRUE(transport.open(slave_name_, config));
+
+    uint8_t buffer[8];
+    size_t bytes_read = 0;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(transport.read(buffer, sizeof(buffer), bytes_read));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+    EXPECT_EQ(bytes_read, 0u);
+}
+
+TEST_F(PtyTest, ReportsQueuedInputAndReadsNonBlocking) {
+    SerialTransport transport;
+    ASSERT_TRUE(transport.open(slave_name_));
+
+    uint8_t buffer[16];
+    size_t bytes_read = 1;
+    ASSERT_TRUE(transport.read_nonblocking(buffer, sizeof(buffer), bytes_read));
+    EXPECT_EQ(bytes_read, 0u);
+
+    write_master("Y\n\r");
+    ASSERT_TRUE(transport.wait_readable(std::chrono::milliseconds(1000)));
+    EXPECT_EQ(transport.bytes_available(), 3u);
+    EXPECT_EQ(transport.bytes_pending_output(), 0u);
+
+    ASSERT_TRUE(transport.read_nonblocking(buffer, sizeof(buffer), bytes_read));
+    EXPECT_EQ(std::string(buffer, buffer + bytes_read), "Y\n\r");
+    EXPECT_EQ(transport.bytes_available(), 0u);
+}
+
+TEST_F(PtyTest, SwitchesBetweenBlockingAndNonBlockingReads) {
+    SerialTransport transport;
+    ASSERT_TRUE(transport.open(slave_name_));
+
+    write_master("ab");
+    uint8_t buffer[2];
+    size_t bytes_read = 0;
+    ASSERT_TRUE(transport.read(buffer, 2, bytes_read));
+    EXPECT_EQ(bytes_read, 2u);
+
+    // After a blocking read the non-blocking path must not hang
+    ASSERT_TRUE(transport.read_nonblocking(buffer, 2, bytes_read));
+    EXPECT_EQ(bytes_read, 0u);
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <Core/session_journal.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace SamFlash;
+
+namespace {
+    std::string journal_path(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    SessionCheckpoint sample_checkpoint() {
+        SessionCheckpoint checkpoint;
+        checkpoint.image_path = "/tmp/firmware.bin";
+        checkpoint.image_size = 3 * 1024 * 1024;
+        checkpoint.image_crc32 = 0xCBF43926;
+        checkpoint.device_identity = "samba/ATSAM4S/1048576";
+        checkpoint.partition = "main";
+        checkpoint.confirmed_bytes = 1536 * 1024;
+        return checkpoint;
+    }
+}
+
+TEST(SessionJournalTest, SaveAndLoadRoundTrip) {
+    SessionJournal journal(journal_path("samflash_roundtrip.journal"));
+    ASSERT_TRUE(journal.save(sample_checkpoint()));
+
+    SessionCheckpoint loaded;
+    ASSERT_TRUE(journal.load(loaded));
+    SessionCheckpoint expected = sample_checkpoint();
+    EXPECT_EQ(loaded.image_path, expected.image_path);
+    EXPECT_EQ(loaded.image_size, expected.image_size);
+    EXPECT_EQ(loaded.image_crc32, expected.image_crc32);
+    EXPECT_EQ(loaded.device_identity, expected.device_identity);
+    EXPECT_EQ(loaded.partition, expected.partition);
+    EXPECT_EQ(loaded.confirmed_bytes, expected.confirmed_bytes);
+    EXPECT_TRUE(loaded.matches(expected));
+
+    EXPECT_TRUE(journal.clear());
+    EXPECT_FALSE(journal.load(loaded));
+}
+
+TEST(SessionJournalTest, LaterSaveReplacesEarlierOne) {
+    SessionJournal journal(journal_path("samflash_replace.journal"));
+    SessionCheckpoint checkpoint = sample_checkpoint();
+    ASSERT_TRUE(journal.save(checkpoint));
+    checkpoint.confirmed_bytes += 4096;
+    ASSERT_TRUE(journal.save(checkpoint));
+
+    SessionCheckpoint loaded;
+    ASSERT_TRUE(journal.load(loaded));
+    EXPECT_EQ(loaded.confirmed_bytes, checkpoint.confirmed_bytes);
+    journal.clear();
+}
+
+TEST(SessionJournalTest, FailedSaveKeepsPreviousCheckpoint) {
+    std::string path = journal_path("samflash_failed_save.journal");
+    SessionJournal journal(path);
+    SessionCheckpoint checkpoint = sample_checkpoint();
+    ASSERT_TRUE(journal.save(checkpoint));
+
+    // A directory in the temporary file's place makes the write fail
+    std::filesystem::create_directory(path + ".tmp");
+    checkpoint.confirmed_bytes += 4096;
+    EXPECT_FALSE(journal.save(checkpoint));
+    EXPECT_NE(journal.get_last_error().find("Failed to write journal"), std::string::npos) << journal.get_last_error();
+
+    SessionCheckpoint loaded;
+    ASSERT_TRUE(journal.load(loaded));
+    EXPECT_EQ(loaded.confirmed_bytes, sample_checkpoint().confirmed_bytes);
+    std::filesystem::remove(path + ".tmp");
+    journal.clear();
+}
+
+TEST(SessionJournalTest, RejectsMissingOrForeignFiles) {
+    SessionCheckpoint loaded;
+    SessionJournal missing(journal_path("samflash_missing.journal"));
+    missing.clear();
+    EXPECT_FALSE(missing.load(loaded));
+
+    std::string path = journal_path("samflash_foreign.journal");
+    std::ofstream(path) << "not a journal\n";
+    SessionJournal foreign(path);
+    EXPECT_FALSE(foreign.load(loaded));
+    std::remove(path.c_str());
+}
+
+TEST(SessionJournalTest, CheckpointMatchesOnlySameImageAndDevice) {
+    SessionCheckpoint checkpoint = sample_checkpoint();
+    SessionCheckpoint other = checkpoint;
+    other.confirmed_bytes = 0;
+    EXPECT_TRUE(checkpoint.matches(other));
+
+    other.image_crc32 ^= 1;
+    EXPECT_FALSE(checkpoint.matches(other));
+
+    other = checkpoint;
+    other.device_identity = "samba/ATSAM4E/1048576";
+    EXPECT_FALSE(checkpoint.matches(other));
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <Core/sparse_image.h>
+#include <Core/byte_order.h>
+#include <vector>
+
+using namespace SamFlash;
+
+namespace {
+    constexpr uint32_t BLOCK = 4096;
+
+    void put_le16(std::vector<uint8_t>& out, uint16_t value) {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void put_le32(std::vector<uint8_t>& out, uint32_t value) {
+        uint8_t bytes[4];
+        write_le32(value, bytes);
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    // RAW block of 0xAB, four FILL blocks of 0x11223344, two DONT_CARE blocks
+    std::vector<uint8_t> make_sparse(uint32_t total_blocks = 7) {
+        std::vector<uint8_t> out;
+        put_le32(out, SPARSE_HEADER_MAGIC);
+        put_le16(out, 1);
+        put_le16(out, 0);
+        put_le16(out, SPARSE_HEADER_SIZE);
+        put_le16(out, SPARSE_CHUNK_HEADER_SIZE);
+        put_le32(out, BLOCK);
+        put_le32(out, total_blocks);
+        put_le32(out, 3);
+        put_le32(out, 0);
+
+        put_le16(out, SPARSE_CHUNK_RAW);
+        put_le16(out, 0);
+        put_le32(out, 1);
+        put_le32(out, SPARSE_CHUNK_HEADER_SIZE + BLOCK);
+        out.insert(out.end(), BLOCK, 0xAB);
+
+        put_le16(out, SPARSE_CHUNK_FILL);
+        put_le16(out, 0);
+        put_le32(out, 4);
+        put_le32(out, SPARSE_CHUNK_HEADER_SIZE + 4);
+        put_le32(out, 0x11223344);
+
+        put_le16(out, SPARSE_CHUNK_DONT_CARE);
+        put_le16(out, 0);
+        put_le32(out, 2);
+        put_le32(out, SPARSE_CHUNK_HEADER_SIZE);
+        return out;
+    }
+}
+
+TEST(SparseImageTest, WalksChunksWithoutExpanding) {
+    auto image = make_sparse();
+    ASSERT_TRUE(SparseImageReader::is_sparse(ByteSpan(image)));
+
+    SparseImageReader reader;
+    ASSERT_TRUE(reader.open(ByteSpan(image))) << reader.get_last_error();
+    EXPECT_EQ(reader.block_size(), BLOCK);
+    EXPECT_EQ(reader.output_size(), 7u * BLOCK);
+
+    SparseChunk chunk;
+    ASSERT_TRUE(reader.next(chunk));
+    EXPECT_EQ(chunk.type, SPARSE_CHUNK_RAW);
+    EXPECT_EQ(chunk.output_offset, 0u);
+    EXPECT_EQ(chunk.output_size, BLOCK);
+    EXPECT_EQ(chunk.data.data(), image.data() + SPARSE_HEADER_SIZE + SPARSE_CHUNK_HEADER_SIZE);
+
+    ASSERT_TRUE(reader.next(chunk));
+    EXPECT_EQ(chunk.type, SPARSE_CHUNK_FILL);
+    EXPECT_EQ(chunk.output_offset, BLOCK);
+    EXPECT_EQ(chunk.output_size, 4u * BLOCK);
+    EXPECT_EQ(chunk.value(), 0x11223344u);
+
+    ASSERT_TRUE(reader.next(chunk));
+    EXPECT_EQ(chunk.type, SPARSE_CHUNK_DONT_CARE);
+    EXPECT_EQ(chunk.output_offset, 5u * BLOCK);
+    EXPECT_EQ(chunk.input_offset + chunk.input_size, image.size());
+
+    EXPECT_FALSE(reader.next(chunk));
+    EXPECT_TRUE(reader.at_end());
+}
+
+TEST(SparseImageTest, RejectsMalformedImages) {
+    SparseImageReader reader;
+    SparseChunk chunk;
+
+    std::vector<uint8_t> raw(64, 0xFF);
+    EXPECT_FALSE(SparseImageReader::is_sparse(ByteSpan(raw)));
+    EXPECT_FALSE(reader.open(ByteSpan(raw)));
+
+    auto truncated = make_sparse();
+    truncated.resize(SPARSE_HEADER_SIZE + SPARSE_CHUNK_HEADER_SIZE + 100);
+    ASSERT_TRUE(reader.open(ByteSpan(truncated)));
+    EXPECT_FALSE(reader.next(chunk));
+    EXPECT_FALSE(reader.at_end());
+
+    auto bad_type = make_sparse();
+    bad_type[SPARSE_HEADER_SIZE] = 0x00;
+    ASSERT_TRUE(reader.open(ByteSpan(bad_type)));
+    EXPECT_FALSE(reader.next(chunk));
+    EXPECT_NE(reader.get_last_error().find("0xca00"), std::string::npos);
+
+    // Chunks that stop short of the declared block count
+    auto short_cover = make_sparse(8);
+    ASSERT_TRUE(reader.open(ByteSpan(short_cover)));
+    while (reader.next(chunk)) {
+    }
+    EXPECT_FALSE(reader.at_end());
+
+    // Or run past it
+    auto overrun = make_sparse(6);
+    ASSERT_TRUE(reader.open(ByteSpan(overrun)));
+    while (reader.next(chunk)) {
+    }
+    EXPECT_FALSE(reader.at_end());
+}